@@ -181,12 +181,18 @@ ZMQ_EXPORT void zmq_version (int *major, int *minor, int *patch);
 #define ZMQ_SOCKET_LIMIT 3
 #define ZMQ_THREAD_PRIORITY 3
 #define ZMQ_THREAD_SCHED_POLICY 4
+#define ZMQ_RESOLVER_CACHE_TTL 5
+#define ZMQ_CRYPTO_THREADS 6
+#define ZMQ_ZAP_CACHE_TTL 7
 
 /*  Default for new contexts                                                  */
 #define ZMQ_IO_THREADS_DFLT  1
 #define ZMQ_MAX_SOCKETS_DFLT 1023
 #define ZMQ_THREAD_PRIORITY_DFLT -1
 #define ZMQ_THREAD_SCHED_POLICY_DFLT -1
+#define ZMQ_RESOLVER_CACHE_TTL_DFLT 10000
+#define ZMQ_CRYPTO_THREADS_DFLT 0
+#define ZMQ_ZAP_CACHE_TTL_DFLT 0
 
 ZMQ_EXPORT void *zmq_ctx_new (void);
 ZMQ_EXPORT int zmq_ctx_term (void *context);
@@ -223,6 +229,11 @@ ZMQ_EXPORT int zmq_msg_more (zmq_msg_t *msg);
 ZMQ_EXPORT int zmq_msg_get (zmq_msg_t *msg, int property);
 ZMQ_EXPORT int zmq_msg_set (zmq_msg_t *msg, int property, int optval);
 ZMQ_EXPORT const char *zmq_msg_gets (zmq_msg_t *msg, const char *property);
+ZMQ_EXPORT int zmq_msg_set_group (zmq_msg_t *msg, const char *group);
+ZMQ_EXPORT const char *zmq_msg_group (zmq_msg_t *msg);
+
+/*  Maximal length of a RADIO/DISH group name.                                */
+#define ZMQ_GROUP_MAX_LENGTH 15
 
 
 /******************************************************************************/
@@ -242,6 +253,8 @@ ZMQ_EXPORT const char *zmq_msg_gets (zmq_msg_t *msg, const char *property);
 #define ZMQ_XPUB 9
 #define ZMQ_XSUB 10
 #define ZMQ_STREAM 11
+#define ZMQ_RADIO 14
+#define ZMQ_DISH 15
 
 /*  Deprecated aliases                                                        */
 #define ZMQ_XREQ ZMQ_DEALER
@@ -308,6 +321,25 @@ ZMQ_EXPORT const char *zmq_msg_gets (zmq_msg_t *msg, const char *property);
 #define ZMQ_XPUB_WELCOME_MSG 72
 #define ZMQ_STREAM_NOTIFY 73
 #define ZMQ_INVERT_MATCHING 74
+#define ZMQ_IN_BATCH_SIZE 75
+#define ZMQ_OUT_BATCH_SIZE 76
+#define ZMQ_BATCH_ADAPTIVE 77
+#define ZMQ_SNDDELAY 78
+#define ZMQ_TCP_FASTOPEN 79
+#define ZMQ_COMPRESSION_THRESHOLD 80
+#define ZMQ_HEARTBEAT_IVL 81
+#define ZMQ_HEARTBEAT_TTL 82
+#define ZMQ_HEARTBEAT_TIMEOUT 83
+#define ZMQ_IPC_FD_THRESHOLD 84
+#define ZMQ_XPUB_SEQUENCE 85
+#define ZMQ_MESSAGES_LOST 86
+#define ZMQ_CONNECT_STRIPES 87
+#define ZMQ_TLS_CERT 88
+#define ZMQ_TLS_KEY 89
+#define ZMQ_TLS_CA 90
+#define ZMQ_CURVE_AEAD 91
+#define ZMQ_CURVE_TICKET_TTL 92
+#define ZMQ_TLS_VERIFY 93
 
 /*  Message options                                                           */
 #define ZMQ_MORE 1
@@ -352,6 +384,7 @@ ZMQ_EXPORT const char *zmq_msg_gets (zmq_msg_t *msg, const char *property);
 #define ZMQ_EVENT_CLOSE_FAILED      0x0100
 #define ZMQ_EVENT_DISCONNECTED      0x0200
 #define ZMQ_EVENT_MONITOR_STOPPED   0x0400
+#define ZMQ_EVENT_MESSAGES_LOST     0x0800
 #define ZMQ_EVENT_ALL               0xFFFF
 
 ZMQ_EXPORT void *zmq_socket (void *, int type);
@@ -364,6 +397,8 @@ ZMQ_EXPORT int zmq_bind (void *s, const char *addr);
 ZMQ_EXPORT int zmq_connect (void *s, const char *addr);
 ZMQ_EXPORT int zmq_unbind (void *s, const char *addr);
 ZMQ_EXPORT int zmq_disconnect (void *s, const char *addr);
+ZMQ_EXPORT int zmq_join (void *s, const char *group);
+ZMQ_EXPORT int zmq_leave (void *s, const char *group);
 ZMQ_EXPORT int zmq_send (void *s, const void *buf, size_t len, int flags);
 ZMQ_EXPORT int zmq_send_const (void *s, const void *buf, size_t len, int flags);
 ZMQ_EXPORT int zmq_recv (void *s, void *buf, size_t len, int flags);
@@ -0,0 +1,501 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+//  Measures how many connections a single listener on the loopback
+//  interface can set up per second, and how long a client waits from
+//  zmq_connect until the reply to its first message arrives. A number of
+//  client threads keep connecting, each opening a new socket for every
+//  connection, exchanging one message with the listener and closing it.
+//  Options:
+//    zap     - the listener asks a ZAP handler accepting everybody,
+//              so the cost of the ZAP round trip is included
+//    resume  - CURVE clients resume their sessions with tickets
+//              (ZMQ_CURVE_TICKET_TTL)
+
+enum mechanism_t { null_mechanism, plain_mechanism, curve_mechanism };
+
+static mechanism_t mechanism;
+static int connections_per_client;
+static char endpoint [256];
+static char server_public [41];
+
+struct client_t
+{
+    void *ctx;
+
+    //  Microseconds from zmq_connect to the reply, one per connection.
+    std::vector <unsigned long> latencies;
+};
+
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall zap_handler (void *handler_)
+#else
+static void *zap_handler (void *handler_)
+#endif
+{
+    zmq_msg_t frames [10];
+    int rc;
+    int i;
+
+    while (true) {
+
+        //  Receive the request. Its credentials depend on the mechanism.
+        int count = 0;
+        int more = 1;
+        while (more && count != 10) {
+            rc = zmq_msg_init (&frames [count]);
+            if (rc != 0) {
+                printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+                exit (1);
+            }
+            rc = zmq_msg_recv (&frames [count], handler_, 0);
+            if (rc < 0) {
+                //  The context is terminating.
+                zmq_msg_close (&frames [count]);
+                for (i = 0; i != count; i++)
+                    zmq_msg_close (&frames [i]);
+                zmq_close (handler_);
+#if defined ZMQ_HAVE_WINDOWS
+                return 0;
+#else
+                return NULL;
+#endif
+            }
+            more = zmq_msg_more (&frames [count]);
+            count++;
+        }
+
+        //  Reply 200 to the version and request id.
+        rc = zmq_msg_send (&frames [0], handler_, ZMQ_SNDMORE);
+        if (rc >= 0)
+            rc = zmq_msg_send (&frames [1], handler_, ZMQ_SNDMORE);
+        if (rc >= 0)
+            rc = zmq_send (handler_, "200", 3, ZMQ_SNDMORE);
+        if (rc >= 0)
+            rc = zmq_send (handler_, "OK", 2, ZMQ_SNDMORE);
+        if (rc >= 0)
+            rc = zmq_send (handler_, "anonymous", 9, ZMQ_SNDMORE);
+        if (rc >= 0)
+            rc = zmq_send (handler_, "", 0, 0);
+        if (rc < 0) {
+            printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        for (i = 2; i != count; i++)
+            zmq_msg_close (&frames [i]);
+    }
+}
+
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall worker (void *client_)
+#else
+static void *worker (void *client_)
+#endif
+{
+    client_t *client = (client_t *) client_;
+    void *s;
+    int rc;
+    int i;
+    char buf [16];
+    void *watch;
+    char public_key [41];
+    char secret_key [41];
+    int linger = 0;
+
+    //  The key pair stays the same for all the connections, as it would
+    //  for a real client reconnecting.
+    if (mechanism == curve_mechanism) {
+        rc = zmq_curve_keypair (public_key, secret_key);
+        if (rc != 0) {
+            printf ("error in zmq_curve_keypair: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+    }
+
+    for (i = 0; i != connections_per_client; i++) {
+
+        s = zmq_socket (client->ctx, ZMQ_DEALER);
+        if (!s) {
+            printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+
+        rc = zmq_setsockopt (s, ZMQ_LINGER, &linger, sizeof (int));
+        if (rc == 0 && mechanism == plain_mechanism) {
+            rc = zmq_setsockopt (s, ZMQ_PLAIN_USERNAME, "admin", 5);
+            if (rc == 0)
+                rc = zmq_setsockopt (s, ZMQ_PLAIN_PASSWORD, "password", 8);
+        }
+        if (rc == 0 && mechanism == curve_mechanism) {
+            rc = zmq_setsockopt (s, ZMQ_CURVE_SERVERKEY, server_public, 41);
+            if (rc == 0)
+                rc = zmq_setsockopt (s, ZMQ_CURVE_PUBLICKEY, public_key, 41);
+            if (rc == 0)
+                rc = zmq_setsockopt (s, ZMQ_CURVE_SECRETKEY, secret_key, 41);
+        }
+        if (rc != 0) {
+            printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+
+        watch = zmq_stopwatch_start ();
+
+        rc = zmq_connect (s, endpoint);
+        if (rc != 0) {
+            printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        rc = zmq_send (s, "ping", 4, 0);
+        if (rc < 0) {
+            printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        rc = zmq_recv (s, buf, sizeof buf, 0);
+        if (rc < 0) {
+            printf ("error in zmq_recv: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+
+        client->latencies.push_back (zmq_stopwatch_stop (watch));
+
+        rc = zmq_close (s);
+        if (rc != 0) {
+            printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+int main (int argc, char *argv [])
+{
+#if defined ZMQ_HAVE_WINDOWS
+    std::vector <HANDLE> threads;
+    HANDLE zap_thread = 0;
+#else
+    std::vector <pthread_t> threads;
+    pthread_t zap_thread;
+#endif
+    void *ctx;
+    void *client_ctx;
+    void *s;
+    void *handler = NULL;
+    int rc;
+    int i;
+    zmq_msg_t identity;
+    zmq_msg_t msg;
+    void *watch;
+    unsigned long elapsed;
+    unsigned long throughput;
+    int client_count;
+    int connection_count;
+    int resumed = 0;
+    bool use_zap = false;
+    bool resume = false;
+    char server_secret [41];
+    int as_server = 1;
+    int ticket_ttl = 60000;
+    size_t endpoint_size = sizeof endpoint;
+
+    if (argc < 4) {
+        printf ("usage: handshake_thr <null|plain|curve> <connection-count> "
+            "<client-count> [zap] [resume]\n");
+        return 1;
+    }
+
+    if (strcmp (argv [1], "null") == 0)
+        mechanism = null_mechanism;
+    else
+    if (strcmp (argv [1], "plain") == 0)
+        mechanism = plain_mechanism;
+    else
+    if (strcmp (argv [1], "curve") == 0)
+        mechanism = curve_mechanism;
+    else {
+        printf ("unknown mechanism: %s\n", argv [1]);
+        return 1;
+    }
+    client_count = atoi (argv [3]);
+    if (client_count < 1) {
+        printf ("client count must be positive\n");
+        return 1;
+    }
+    connections_per_client = atoi (argv [2]) / client_count;
+    if (connections_per_client < 1) {
+        printf ("connection count must be at least the client count\n");
+        return 1;
+    }
+    connection_count = connections_per_client * client_count;
+    for (i = 4; i != argc; i++) {
+        if (strcmp (argv [i], "zap") == 0)
+            use_zap = true;
+        else
+        if (strcmp (argv [i], "resume") == 0)
+            resume = true;
+        else {
+            printf ("unknown option: %s\n", argv [i]);
+            return 1;
+        }
+    }
+
+    if (mechanism == curve_mechanism && !zmq_has ("curve")) {
+        printf ("CURVE security is not available\n");
+        return 1;
+    }
+
+    //  The clients have a context of their own, so that they don't
+    //  compete with the listener for its I/O thread.
+    ctx = zmq_ctx_new ();
+    client_ctx = zmq_ctx_new ();
+    if (!ctx || !client_ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    rc = zmq_ctx_set (client_ctx, ZMQ_IO_THREADS,
+        client_count < 4 ? client_count : 4);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_set: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    if (use_zap) {
+        handler = zmq_socket (ctx, ZMQ_REP);
+        if (!handler) {
+            printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        rc = zmq_bind (handler, "inproc://zeromq.zap.01");
+        if (rc != 0) {
+            printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+#if defined ZMQ_HAVE_WINDOWS
+        zap_thread = (HANDLE) _beginthreadex (NULL, 0,
+            zap_handler, handler, 0 , NULL);
+        if (zap_thread == 0) {
+            printf ("error in _beginthreadex\n");
+            return -1;
+        }
+#else
+        rc = pthread_create (&zap_thread, NULL, zap_handler, handler);
+        if (rc != 0) {
+            printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+            return -1;
+        }
+#endif
+    }
+
+    s = zmq_socket (ctx, ZMQ_ROUTER);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = 0;
+    if (use_zap)
+        rc = zmq_setsockopt (s, ZMQ_ZAP_DOMAIN, "global", 6);
+    if (rc == 0 && mechanism == plain_mechanism)
+        rc = zmq_setsockopt (s, ZMQ_PLAIN_SERVER, &as_server, sizeof (int));
+    if (rc == 0 && mechanism == curve_mechanism) {
+        rc = zmq_curve_keypair (server_public, server_secret);
+        if (rc != 0) {
+            printf ("error in zmq_curve_keypair: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        rc = zmq_setsockopt (s, ZMQ_CURVE_SERVER, &as_server, sizeof (int));
+        if (rc == 0)
+            rc = zmq_setsockopt (s, ZMQ_CURVE_SECRETKEY, server_secret, 41);
+        if (rc == 0 && resume)
+            rc = zmq_setsockopt (s, ZMQ_CURVE_TICKET_TTL,
+                &ticket_ttl, sizeof (int));
+    }
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_bind (s, "tcp://127.0.0.1:*");
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    rc = zmq_getsockopt (s, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    if (rc != 0) {
+        printf ("error in zmq_getsockopt: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    printf ("mechanism: %s%s%s\n", argv [1],
+        use_zap ? " with ZAP" : "",
+        resume && mechanism == curve_mechanism ? " with resumption" : "");
+    printf ("connection count: %d\n", connection_count);
+    printf ("client count: %d\n", client_count);
+
+    std::vector <client_t> clients (client_count);
+
+    watch = zmq_stopwatch_start ();
+
+    for (i = 0; i != client_count; i++) {
+        clients [i].ctx = client_ctx;
+        clients [i].latencies.reserve (connections_per_client);
+#if defined ZMQ_HAVE_WINDOWS
+        HANDLE thread = (HANDLE) _beginthreadex (NULL, 0,
+            worker, &clients [i], 0 , NULL);
+        if (thread == 0) {
+            printf ("error in _beginthreadex\n");
+            return -1;
+        }
+#else
+        pthread_t thread;
+        rc = pthread_create (&thread, NULL, worker, &clients [i]);
+        if (rc != 0) {
+            printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+            return -1;
+        }
+#endif
+        threads.push_back (thread);
+    }
+
+    rc = zmq_msg_init (&identity);
+    if (rc == 0)
+        rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    //  Answer the first message of every connection.
+    for (i = 0; i != connection_count; i++) {
+        rc = zmq_msg_recv (&identity, s, 0);
+        if (rc >= 0)
+            rc = zmq_msg_recv (&msg, s, 0);
+        if (rc < 0) {
+            printf ("error in zmq_msg_recv: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        if (zmq_msg_gets (&msg, "X-Curve-Resumed"))
+            resumed++;
+        rc = zmq_msg_send (&identity, s, ZMQ_SNDMORE);
+        if (rc >= 0)
+            rc = zmq_msg_send (&msg, s, 0);
+        if (rc < 0) {
+            printf ("error in zmq_msg_send: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    for (i = 0; i != client_count; i++) {
+#if defined ZMQ_HAVE_WINDOWS
+        DWORD rc2 = WaitForSingleObject (threads [i], INFINITE);
+        if (rc2 == WAIT_FAILED) {
+            printf ("error in WaitForSingleObject\n");
+            return -1;
+        }
+        BOOL rc3 = CloseHandle (threads [i]);
+        if (rc3 == 0) {
+            printf ("error in CloseHandle\n");
+            return -1;
+        }
+#else
+        rc = pthread_join (threads [i], NULL);
+        if (rc != 0) {
+            printf ("error in pthread_join: %s\n", zmq_strerror (rc));
+            return -1;
+        }
+#endif
+    }
+
+    elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    rc = zmq_msg_close (&identity);
+    if (rc == 0)
+        rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_ctx_term (client_ctx);
+    if (rc == 0)
+        rc = zmq_ctx_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    if (use_zap) {
+#if defined ZMQ_HAVE_WINDOWS
+        WaitForSingleObject (zap_thread, INFINITE);
+        CloseHandle (zap_thread);
+#else
+        pthread_join (zap_thread, NULL);
+#endif
+    }
+
+    std::vector <unsigned long> latencies;
+    for (i = 0; i != client_count; i++)
+        latencies.insert (latencies.end (),
+            clients [i].latencies.begin (), clients [i].latencies.end ());
+    std::sort (latencies.begin (), latencies.end ());
+    const size_t n = latencies.size ();
+
+    throughput = (unsigned long)
+        ((double) connection_count / (double) elapsed * 1000000);
+
+    printf ("mean throughput: %d [handshakes/s]\n", (int) throughput);
+    if (resume && mechanism == curve_mechanism)
+        printf ("resumed sessions: %d\n", resumed);
+    printf ("time to first reply: min %lu, median %lu, 90%% %lu, "
+        "99%% %lu, max %lu [us]\n",
+        latencies [0], latencies [n / 2], latencies [n * 9 / 10],
+        latencies [n * 99 / 100], latencies [n - 1]);
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_ADAPTIVE_BATCH_HPP_INCLUDED__
+#define __ZMQ_ADAPTIVE_BATCH_HPP_INCLUDED__
+
+#include <stddef.h>
+
+#include "config.hpp"
+
+namespace zmq
+{
+
+    //  Keeps track of the size of the batches an engine reads or writes.
+    //  In adaptive mode the size starts at min_batch_size, doubles each
+    //  time a batch is used up completely and halves after a run of
+    //  batches that were mostly empty. Otherwise the size never changes.
+
+    class adaptive_batch_t
+    {
+    public:
+
+        inline adaptive_batch_t (size_t size_, bool adaptive_) :
+            batch_size (adaptive_? (size_t) min_batch_size: size_),
+            adaptive (adaptive_),
+            underused (0)
+        {
+        }
+
+        inline size_t size () const
+        {
+            return batch_size;
+        }
+
+        //  Records that a batch of used_ bytes was read or written.
+        inline void update (size_t used_)
+        {
+            if (!adaptive)
+                return;
+
+            if (used_ >= batch_size) {
+                underused = 0;
+                if (batch_size < max_batch_size)
+                    batch_size *= 2;
+            }
+            else
+            if (used_ >= batch_size / 4)
+                underused = 0;
+            else
+            if (++underused >= batch_shrink_threshold) {
+                underused = 0;
+                if (batch_size > min_batch_size)
+                    batch_size /= 2;
+            }
+        }
+
+    private:
+
+        //  Current batch size, in bytes.
+        size_t batch_size;
+
+        //  If false, the batch size is fixed.
+        bool adaptive;
+
+        //  Number of consecutive batches that used less than a quarter
+        //  of the batch size.
+        int underused;
+
+        adaptive_batch_t (const adaptive_batch_t&);
+        const adaptive_batch_t &operator = (const adaptive_batch_t&);
+    };
+
+}
+
+#endif
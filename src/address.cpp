@@ -21,6 +21,7 @@
 #include "address.hpp"
 #include "err.hpp"
 #include "tcp_address.hpp"
+#include "udp_address.hpp"
 #include "ipc_address.hpp"
 #include "tipc_address.hpp"
 
@@ -37,15 +38,22 @@ zmq::address_t::address_t (
 
 zmq::address_t::~address_t ()
 {
-    if (protocol == "tcp") {
+    if (protocol == "tcp" || protocol == "tls") {
         if (resolved.tcp_addr) {
             delete resolved.tcp_addr;
             resolved.tcp_addr = 0;
         }
     }
+    else
+    if (protocol == "udp") {
+        if (resolved.udp_addr) {
+            delete resolved.udp_addr;
+            resolved.udp_addr = 0;
+        }
+    }
 #if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
     else
-    if (protocol == "ipc") {
+    if (protocol == "ipc" || protocol == "shm") {
         if (resolved.ipc_addr) {
             delete resolved.ipc_addr;
             resolved.ipc_addr = 0;
@@ -65,9 +73,14 @@ zmq::address_t::~address_t ()
 
 int zmq::address_t::to_string (std::string &addr_) const
 {
-    if (protocol == "tcp") {
+    if (protocol == "tcp" || protocol == "tls") {
         if (resolved.tcp_addr)
-            return resolved.tcp_addr->to_string (addr_);
+            return resolved.tcp_addr->to_string (addr_, protocol.c_str ());
+    }
+    else
+    if (protocol == "udp") {
+        if (resolved.udp_addr)
+            return resolved.udp_addr->to_string (addr_);
     }
 #if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
     else
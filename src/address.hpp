@@ -25,6 +25,7 @@
 namespace zmq
 {
     class tcp_address_t;
+    class udp_address_t;
 #if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
     class ipc_address_t;
 #endif
@@ -42,6 +43,7 @@ namespace zmq
         //  Protocol specific resolved address
         union {
             tcp_address_t *tcp_addr;
+            udp_address_t *udp_addr;
 #if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
             ipc_address_t *ipc_addr;
 #endif
@@ -0,0 +1,238 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_LIBCRYPTO
+
+#include <new>
+#include <string.h>
+#include <limits.h>
+
+#include <openssl/hmac.h>
+
+#include "aead.hpp"
+#include "msg.hpp"
+#include "wire.hpp"
+#include "err.hpp"
+
+namespace
+{
+    const char aes_gcm [] = "AES-256-GCM";
+    const char chacha_poly [] = "CHACHA20-POLY1305";
+
+    //  Labels the per-direction keys are derived with.
+    const char client_label [] = "CurveZMQAEAD-C2S";
+    const char server_label [] = "CurveZMQAEAD-S2C";
+
+    //  Largest chunk handed to OpenSSL at once, which takes int lengths.
+    const size_t max_chunk = INT_MAX / 2 + 1;
+
+    bool has_aes_instructions ()
+    {
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+        return __builtin_cpu_supports ("aes") != 0;
+#else
+        //  Most other CPUs running servers have AES instructions too.
+        return true;
+#endif
+    }
+
+    const EVP_CIPHER *find_cipher (const std::string &name_)
+    {
+        if (name_ == aes_gcm)
+            return EVP_aes_256_gcm ();
+        if (name_ == chacha_poly)
+            return EVP_chacha20_poly1305 ();
+        return NULL;
+    }
+
+    //  Runs the cipher over size_ bytes, which may be more than fits
+    //  in an int.
+    void update (EVP_CIPHER_CTX *ctx_, uint8_t *out_, const uint8_t *in_,
+        size_t size_)
+    {
+        while (size_ > 0) {
+            const size_t chunk = size_ < max_chunk ? size_ : max_chunk;
+            int outl = 0;
+            const int rc = EVP_CipherUpdate (ctx_, out_, &outl, in_,
+                static_cast <int> (chunk));
+            zmq_assert (rc == 1 && outl == static_cast <int> (chunk));
+            out_ += chunk;
+            in_ += chunk;
+            size_ -= chunk;
+        }
+    }
+}
+
+std::string zmq::aead_t::offer ()
+{
+    //  Without AES instructions ChaCha20 is several times faster.
+    if (has_aes_instructions ())
+        return std::string (aes_gcm) + "," + chacha_poly;
+    return std::string (chacha_poly) + "," + aes_gcm;
+}
+
+std::string zmq::aead_t::choose (const std::string &offer_)
+{
+    size_t pos = 0;
+    while (pos <= offer_.size ()) {
+        size_t end = offer_.find (',', pos);
+        if (end == std::string::npos)
+            end = offer_.size ();
+        const std::string name = offer_.substr (pos, end - pos);
+        if (find_cipher (name))
+            return name;
+        pos = end + 1;
+    }
+    return std::string ();
+}
+
+zmq::aead_t *zmq::aead_t::create (const std::string &name_,
+    const uint8_t *secret_, bool as_server_)
+{
+    const EVP_CIPHER *cipher = find_cipher (name_);
+    if (!cipher)
+        return NULL;
+
+    uint8_t client_key [32];
+    uint8_t server_key [32];
+    unsigned int len = 0;
+    uint8_t *key = HMAC (EVP_sha256 (), secret_, 32,
+        (const unsigned char *) client_label, sizeof client_label - 1,
+        client_key, &len);
+    zmq_assert (key && len == 32);
+    key = HMAC (EVP_sha256 (), secret_, 32,
+        (const unsigned char *) server_label, sizeof server_label - 1,
+        server_key, &len);
+    zmq_assert (key && len == 32);
+
+    aead_t *aead = new (std::nothrow) aead_t;
+    alloc_assert (aead);
+
+    int rc = EVP_EncryptInit_ex (aead->encrypt_ctx, cipher, NULL,
+        as_server_ ? server_key : client_key, NULL);
+    zmq_assert (rc == 1);
+    rc = EVP_DecryptInit_ex (aead->decrypt_ctx, cipher, NULL,
+        as_server_ ? client_key : server_key, NULL);
+    zmq_assert (rc == 1);
+
+    memset (client_key, 0, sizeof client_key);
+    memset (server_key, 0, sizeof server_key);
+    return aead;
+}
+
+zmq::aead_t::aead_t () :
+    encrypt_ctx (EVP_CIPHER_CTX_new ()),
+    decrypt_ctx (EVP_CIPHER_CTX_new ())
+{
+    alloc_assert (encrypt_ctx);
+    alloc_assert (decrypt_ctx);
+}
+
+zmq::aead_t::~aead_t ()
+{
+    EVP_CIPHER_CTX_free (encrypt_ctx);
+    EVP_CIPHER_CTX_free (decrypt_ctx);
+}
+
+void zmq::aead_t::set_nonce (EVP_CIPHER_CTX *ctx_, bool encrypt_,
+    uint64_t nonce_)
+{
+    uint8_t iv [12];
+    memset (iv, 0, 4);
+    put_uint64 (iv + 4, nonce_);
+    const int rc = EVP_CipherInit_ex (ctx_, NULL, NULL, NULL, iv,
+        encrypt_ ? 1 : 0);
+    zmq_assert (rc == 1);
+}
+
+void zmq::aead_t::seal (msg_t *msg_, uint64_t nonce_)
+{
+    uint8_t flags = 0;
+    if (msg_->flags () & msg_t::more)
+        flags |= 0x01;
+    if (msg_->flags () & msg_t::command)
+        flags |= 0x02;
+    if (msg_->flags () & msg_t::compressed)
+        flags |= 0x04;
+
+    const size_t size = msg_->size ();
+
+    msg_t sealed;
+    int rc = sealed.init_size (size + overhead);
+    errno_assert (rc == 0);
+    uint8_t *out = static_cast <uint8_t *> (sealed.data ());
+
+    set_nonce (encrypt_ctx, true, nonce_);
+    update (encrypt_ctx, out,
+        static_cast <const uint8_t *> (msg_->data ()), size);
+    update (encrypt_ctx, out + size, &flags, 1);
+
+    int outl = 0;
+    rc = EVP_EncryptFinal_ex (encrypt_ctx, out + size + 1, &outl);
+    zmq_assert (rc == 1 && outl == 0);
+    rc = EVP_CIPHER_CTX_ctrl (encrypt_ctx, EVP_CTRL_AEAD_GET_TAG, 16,
+        out + size + 1);
+    zmq_assert (rc == 1);
+
+    rc = msg_->move (sealed);
+    errno_assert (rc == 0);
+}
+
+int zmq::aead_t::open (msg_t *msg_, uint64_t nonce_)
+{
+    if (msg_->size () < overhead) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    //  Messages coming from the decoder own their buffers, so they
+    //  can be decrypted in place.
+    zmq_assert (!msg_->is_cmsg () && !(msg_->flags () & msg_t::shared));
+
+    uint8_t *data = static_cast <uint8_t *> (msg_->data ());
+    const size_t size = msg_->size () - 16;
+
+    set_nonce (decrypt_ctx, false, nonce_);
+    int rc = EVP_CIPHER_CTX_ctrl (decrypt_ctx, EVP_CTRL_AEAD_SET_TAG, 16,
+        data + size);
+    zmq_assert (rc == 1);
+    update (decrypt_ctx, data, data, size);
+
+    int outl = 0;
+    if (EVP_DecryptFinal_ex (decrypt_ctx, data + size, &outl) != 1) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    const uint8_t flags = data [size - 1];
+    msg_->reset_flags (msg_t::more | msg_t::command | msg_t::compressed);
+    if (flags & 0x01)
+        msg_->set_flags (msg_t::more);
+    if (flags & 0x02)
+        msg_->set_flags (msg_t::command);
+    if (flags & 0x04)
+        msg_->set_flags (msg_t::compressed);
+
+    msg_->shrink (size - 1);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,96 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_AEAD_HPP_INCLUDED__
+#define __ZMQ_AEAD_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_LIBCRYPTO
+
+#include <stddef.h>
+#include <string>
+
+#include <openssl/evp.h>
+
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    class msg_t;
+
+    //  Cipher protecting the messages of a CURVE connection once the
+    //  handshake is done (ZMQ_CURVE_AEAD), in place of the MESSAGE
+    //  command's Salsa20/Poly1305 boxes. Each direction has its own key
+    //  derived from the connection's shared secret. Nonces are message
+    //  counters both ends keep, so none is sent. A sealed message is
+    //  the encrypted payload followed by the encrypted flags byte and
+    //  the 16-byte tag.
+
+    class aead_t
+    {
+    public:
+
+        //  Returns the names of the supported ciphers separated by commas,
+        //  the one that is fastest on this CPU first.
+        static std::string offer ();
+
+        //  Returns the first cipher of the offer that we support, or an
+        //  empty string if there is none.
+        static std::string choose (const std::string &offer_);
+
+        //  Creates the cipher of the given name keyed from the 32-byte
+        //  shared secret. Returns NULL if the name is not supported.
+        static aead_t *create (const std::string &name_,
+            const uint8_t *secret_, bool as_server_);
+
+        ~aead_t ();
+
+        //  Replaces the message by its sealed form.
+        void seal (msg_t *msg_, uint64_t nonce_);
+
+        //  Opens a sealed message in place and restores its flags.
+        //  Returns -1 with errno set to EPROTO if it does not
+        //  authenticate.
+        int open (msg_t *msg_, uint64_t nonce_);
+
+        //  Bytes a sealed message is longer than the original.
+        enum { overhead = 17 };
+
+    private:
+
+        aead_t ();
+
+        //  Sets the per-message IV, the nonce in the last eight bytes.
+        static void set_nonce (EVP_CIPHER_CTX *ctx_, bool encrypt_,
+            uint64_t nonce_);
+
+        EVP_CIPHER_CTX *encrypt_ctx;
+        EVP_CIPHER_CTX *decrypt_ctx;
+
+        aead_t (const aead_t&);
+        const aead_t &operator = (const aead_t&);
+    };
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,104 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+
+#include "batch_pool.hpp"
+#include "config.hpp"
+#include "err.hpp"
+
+zmq::batch_pool_t::batch_pool_t () :
+    pooled (0)
+{
+}
+
+zmq::batch_pool_t::~batch_pool_t ()
+{
+    for (free_lists_t::iterator it = free_lists.begin ();
+          it != free_lists.end (); ++it)
+        for (buffers_t::iterator b = it->second.begin ();
+              b != it->second.end (); ++b)
+            free (*b);
+}
+
+unsigned char *zmq::batch_pool_t::allocate (size_t size_)
+{
+    free_lists_t::iterator it = free_lists.find (size_);
+    if (it != free_lists.end () && !it->second.empty ()) {
+        unsigned char *buf = it->second.back ();
+        it->second.pop_back ();
+        pooled -= size_;
+        return buf;
+    }
+
+    unsigned char *buf = (unsigned char*) malloc (size_);
+    alloc_assert (buf);
+    return buf;
+}
+
+void zmq::batch_pool_t::deallocate (unsigned char *buf_, size_t size_)
+{
+    if (pooled + size_ > batch_pool_size) {
+        free (buf_);
+        return;
+    }
+    free_lists [size_].push_back (buf_);
+    pooled += size_;
+}
+
+zmq::batch_buffer_t::batch_buffer_t (size_t size_, batch_pool_t *pool_) :
+    bufsize (size_),
+    buf (NULL),
+    pool (pool_)
+{
+}
+
+zmq::batch_buffer_t::~batch_buffer_t ()
+{
+    release ();
+}
+
+void zmq::batch_buffer_t::resize (size_t size_)
+{
+    if (size_ == bufsize)
+        return;
+    release ();
+    bufsize = size_;
+}
+
+void zmq::batch_buffer_t::release ()
+{
+    if (!buf)
+        return;
+    if (pool)
+        pool->deallocate (buf, bufsize);
+    else
+        free (buf);
+    buf = NULL;
+}
+
+void zmq::batch_buffer_t::allocate ()
+{
+    if (pool)
+        buf = pool->allocate (bufsize);
+    else {
+        buf = (unsigned char*) malloc (bufsize);
+        alloc_assert (buf);
+    }
+}
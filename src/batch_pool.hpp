@@ -0,0 +1,116 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_BATCH_POOL_HPP_INCLUDED__
+#define __ZMQ_BATCH_POOL_HPP_INCLUDED__
+
+#include <stddef.h>
+#include <map>
+#include <vector>
+
+namespace zmq
+{
+
+    //  Cache of batch buffers shared by the engines of one I/O thread.
+    //  Buffers released by idle engines are kept here, grouped by size,
+    //  so that engines becoming active again don't have to go to the
+    //  allocator. The pool is not thread-safe; it must only be used
+    //  from the I/O thread that owns it.
+
+    class batch_pool_t
+    {
+    public:
+
+        batch_pool_t ();
+        ~batch_pool_t ();
+
+        //  Returns a buffer of size_ bytes.
+        unsigned char *allocate (size_t size_);
+
+        //  Returns a buffer obtained from allocate to the pool.
+        void deallocate (unsigned char *buf_, size_t size_);
+
+        //  Returns the total size of the buffers kept for reuse, in bytes.
+        inline size_t size () const
+        {
+            return pooled;
+        }
+
+    private:
+
+        typedef std::vector <unsigned char*> buffers_t;
+        typedef std::map <size_t, buffers_t> free_lists_t;
+
+        //  Released buffers, keyed by their size.
+        free_lists_t free_lists;
+
+        //  Total size of the buffers in the free lists, in bytes.
+        size_t pooled;
+
+        batch_pool_t (const batch_pool_t&);
+        const batch_pool_t &operator = (const batch_pool_t&);
+    };
+
+    //  Batch buffer of an encoder or decoder. Memory is only allocated
+    //  when the buffer is accessed and can be given back at any time.
+    //  Buffers come from the pool if one is supplied, from the heap
+    //  otherwise.
+
+    class batch_buffer_t
+    {
+    public:
+
+        batch_buffer_t (size_t size_, batch_pool_t *pool_);
+        ~batch_buffer_t ();
+
+        //  Returns the buffer, allocating it if needed.
+        inline unsigned char *data ()
+        {
+            if (!buf)
+                allocate ();
+            return buf;
+        }
+
+        inline size_t size () const
+        {
+            return bufsize;
+        }
+
+        //  Changes the size of the buffer. The contents are lost.
+        void resize (size_t size_);
+
+        //  Gives the memory back. The buffer will be allocated anew
+        //  when it is accessed next time.
+        void release ();
+
+    private:
+
+        void allocate ();
+
+        size_t bufsize;
+        unsigned char *buf;
+        batch_pool_t *pool;
+
+        batch_buffer_t (const batch_buffer_t&);
+        const batch_buffer_t &operator = (const batch_buffer_t&);
+    };
+
+}
+
+#endif
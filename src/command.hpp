@@ -30,6 +30,7 @@ namespace zmq
     struct i_engine;
     class pipe_t;
     class socket_base_t;
+    struct resolve_request_t;
 
     //  This structure defines the commands that can be sent between threads.
 
@@ -60,6 +61,7 @@ namespace zmq
             reap,
             reaped,
             inproc_connected,
+            resolved,
             done
         } type;
 
@@ -145,6 +147,12 @@ namespace zmq
             struct {
             } reaped;
 
+            //  Sent by the resolver to the object that requested a host
+            //  name lookup once the lookup is done.
+            struct {
+                zmq::resolve_request_t *request;
+            } resolved;
+
             //  Sent by reaper thread to the term thread when all the sockets
             //  are successfully deallocated.
             struct {
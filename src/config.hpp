@@ -55,6 +55,74 @@ namespace zmq
         //  unnecessary network stack traversals.
         out_batch_size = 8192,
 
+        //  Bounds for batch sizes of engines in adaptive batching mode
+        //  (ZMQ_BATCH_ADAPTIVE). Such engines start with the smallest
+        //  batch, double it whenever a batch is filled completely and
+        //  halve it after 'batch_shrink_threshold' consecutive batches
+        //  that used less than a quarter of the space. The largest batch
+        //  is also the most ZMQ_IN_BATCH_SIZE and ZMQ_OUT_BATCH_SIZE
+        //  accept.
+        min_batch_size = 1024,
+        max_batch_size = 262144,
+        batch_shrink_threshold = 16,
+
+        //  Engines allocate their batch buffers only when they need them
+        //  and give them back to the I/O thread's buffer pool after they
+        //  have been idle for 'batch_release_ivl' milliseconds. The pool
+        //  keeps at most 'batch_pool_size' bytes of released buffers for
+        //  reuse, the rest is returned to the allocator.
+        batch_release_ivl = 1000,
+        batch_pool_size = 4194304,
+
+        //  Host names in connect addresses are resolved by a pool of at
+        //  most 'max_resolver_threads' threads started on demand. Results
+        //  of the lookups are cached, the cache holds at most
+        //  'resolver_cache_size' entries.
+        max_resolver_threads = 4,
+        resolver_cache_size = 1024,
+
+        //  When a host name maps to several addresses, connecters try them
+        //  in parallel, starting a new attempt every 'connect_attempt_delay'
+        //  milliseconds until one of them succeeds (RFC 8305).
+        connect_attempt_delay = 250,
+
+        //  Engines of encrypted connections on a context with crypto threads
+        //  (ZMQ_CRYPTO_THREADS) encode and decode messages in batches of up
+        //  to 'crypto_batch_msgs' messages or 'crypto_batch_size' bytes.
+        //  Only batches of at least 'crypto_parallel_size' bytes are spread
+        //  across the threads, smaller ones are not worth the hand-off.
+        crypto_batch_msgs = 1024,
+        crypto_batch_size = 4194304,
+        crypto_parallel_size = 65536,
+
+        //  CURVE clients keep at most 'curve_ticket_cache_size' session
+        //  tickets (ZMQ_CURVE_TICKET_TTL) per context.
+        curve_ticket_cache_size = 1024,
+
+        //  CURVE servers remember at most 'curve_ticket_redeemed_size'
+        //  unexpired tickets they took per context, and turn down any
+        //  more until some expire.
+        curve_ticket_redeemed_size = 65536,
+
+        //  Maximal number of ZAP replies cached per context
+        //  (ZMQ_ZAP_CACHE_TTL).
+        zap_cache_size = 1024,
+
+        //  Size in bytes of each of the two rings shared by the ends of
+        //  a shm:// connection. Must be a power of two.
+        shm_ring_size = 262144,
+
+        //  Maximal number of file descriptors passed along with a single
+        //  write to a UNIX domain socket (SCM_MAX_FD on Linux), and of
+        //  descriptors received ahead of the frames they belong to.
+        max_passed_fds = 253,
+        max_queued_fds = 1024,
+
+        //  Largest datagram sent or received by the udp:// transport, and
+        //  the number of datagrams moved by a single system call.
+        udp_max_datagram_size = 8192,
+        udp_batch_size = 32,
+
         //  Maximal delta between high and low watermark.
         max_wm_delta = 1024,
 
@@ -0,0 +1,177 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <new>
+#include <algorithm>
+
+#include "../include/zmq.h"
+#include "crypto_pool.hpp"
+#include "ctx.hpp"
+#include "err.hpp"
+
+zmq::crypto_pool_t::crypto_pool_t (class ctx_t *ctx_) :
+    ctx (ctx_),
+    stopping (false)
+{
+}
+
+zmq::crypto_pool_t::~crypto_pool_t ()
+{
+    sync.lock ();
+    stopping = true;
+    for (workers_t::size_type i = 0; i != workers.size (); i++)
+        if (workers [i]->idle) {
+            workers [i]->idle = false;
+            workers [i]->signaler.send ();
+        }
+    sync.unlock ();
+
+    for (workers_t::size_type i = 0; i != workers.size (); i++) {
+        workers [i]->thread.stop ();
+        delete workers [i];
+    }
+    for (signalers_t::size_type i = 0; i != signalers.size (); i++)
+        delete signalers [i];
+
+    //  Callers wait for their batches, so there can't be any left.
+    zmq_assert (queue.empty ());
+}
+
+int zmq::crypto_pool_t::run (crypto_fn *fn_, void *arg_, size_t count_)
+{
+    batch_t batch;
+    batch.fn = fn_;
+    batch.arg = arg_;
+    batch.count = count_;
+    batch.next = 0;
+    batch.done = 0;
+    batch.failed = false;
+    batch.signaler = NULL;
+    if (count_ == 0)
+        return 0;
+
+    sync.lock ();
+    queue.push_back (&batch);
+
+    //  Get as many workers going as there are items left for them, waking
+    //  up the idle ones first and starting new ones as long as there are
+    //  fewer of them than allowed.
+    const int max_workers = ctx->get (ZMQ_CRYPTO_THREADS);
+    size_t wanted = count_ - 1;
+    for (workers_t::size_type i = 0; i != workers.size () && wanted; i++)
+        if (workers [i]->idle) {
+            workers [i]->idle = false;
+            workers [i]->signaler.send ();
+            wanted--;
+        }
+    while (wanted && workers.size () < (size_t) std::max (max_workers, 0)) {
+        worker_t *worker = new (std::nothrow) worker_t ();
+        alloc_assert (worker);
+        worker->pool = this;
+        worker->idle = false;
+        workers.push_back (worker);
+        ctx->start_thread (worker->thread, worker_routine, worker);
+        wanted--;
+    }
+
+    //  Do our share of the work, then wait for the items still being
+    //  processed by the workers.
+    process (&batch);
+    if (batch.done < batch.count) {
+        if (signalers.empty ()) {
+            signaler_t *signaler = new (std::nothrow) signaler_t ();
+            alloc_assert (signaler);
+            signalers.push_back (signaler);
+        }
+        batch.signaler = signalers.back ();
+        signalers.pop_back ();
+        sync.unlock ();
+
+        int rc = batch.signaler->wait (-1);
+        while (rc == -1 && errno == EINTR)
+            rc = batch.signaler->wait (-1);
+        errno_assert (rc == 0);
+        batch.signaler->recv ();
+
+        sync.lock ();
+        signalers.push_back (batch.signaler);
+    }
+    sync.unlock ();
+
+    return batch.failed ? -1 : 0;
+}
+
+void zmq::crypto_pool_t::worker_routine (void *arg_)
+{
+    worker_t *worker = (worker_t*) arg_;
+    worker->pool->loop (worker);
+}
+
+void zmq::crypto_pool_t::loop (worker_t *worker_)
+{
+    sync.lock ();
+    while (!stopping) {
+
+        //  Wait till there's something to do.
+        if (queue.empty ()) {
+            worker_->idle = true;
+            sync.unlock ();
+            int rc = worker_->signaler.wait (-1);
+            while (rc == -1 && errno == EINTR)
+                rc = worker_->signaler.wait (-1);
+            errno_assert (rc == 0);
+            worker_->signaler.recv ();
+            sync.lock ();
+            continue;
+        }
+
+        process (queue.front ());
+    }
+    sync.unlock ();
+}
+
+void zmq::crypto_pool_t::process (batch_t *batch_)
+{
+    while (batch_->next < batch_->count) {
+        const size_t index = batch_->next++;
+
+        //  Nothing left for the others to pick up.
+        if (batch_->next == batch_->count) {
+            queue_t::iterator it =
+                std::find (queue.begin (), queue.end (), batch_);
+            zmq_assert (it != queue.end ());
+            queue.erase (it);
+        }
+
+        sync.unlock ();
+        const bool ok = batch_->fn (batch_->arg, index);
+        sync.lock ();
+
+        if (!ok)
+            batch_->failed = true;
+
+        //  The batch belongs to the caller, which may be gone as soon
+        //  as it learns that the last item is done.
+        if (++batch_->done == batch_->count) {
+            if (batch_->signaler)
+                batch_->signaler->send ();
+            return;
+        }
+    }
+}
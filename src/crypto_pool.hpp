@@ -0,0 +1,127 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_CRYPTO_POOL_HPP_INCLUDED__
+#define __ZMQ_CRYPTO_POOL_HPP_INCLUDED__
+
+#include <stddef.h>
+#include <deque>
+#include <vector>
+
+#include "mutex.hpp"
+#include "signaler.hpp"
+#include "thread.hpp"
+
+namespace zmq
+{
+
+    class ctx_t;
+
+    //  Processes the item with index 'index_' of a batch. Returns false
+    //  if the item could not be processed.
+    typedef bool (crypto_fn) (void *arg_, size_t index_);
+
+    //  Spreads the boxing and unboxing of message batches of encrypted
+    //  connections across worker threads, so that a single busy
+    //  connection can use more than one core. The number of workers is
+    //  given by the ZMQ_CRYPTO_THREADS context option. They are started
+    //  on demand.
+
+    class crypto_pool_t
+    {
+    public:
+
+        crypto_pool_t (zmq::ctx_t *ctx_);
+
+        //  Waits for the workers to terminate.
+        ~crypto_pool_t ();
+
+        //  Calls fn_ for all the indices from 0 to count_ - 1, both in the
+        //  calling thread and in the workers. Returns once all the calls
+        //  are done: 0 if all of them succeeded, -1 otherwise.
+        int run (crypto_fn *fn_, void *arg_, size_t count_);
+
+    private:
+
+        struct batch_t
+        {
+            crypto_fn *fn;
+            void *arg;
+            size_t count;
+
+            //  Index of the next item to be handed out.
+            size_t next;
+
+            //  Number of items processed.
+            size_t done;
+            bool failed;
+
+            //  If not NULL, the caller waits for this signaler to be
+            //  signalled once the last item is done.
+            signaler_t *signaler;
+        };
+
+        struct worker_t
+        {
+            crypto_pool_t *pool;
+            thread_t thread;
+
+            //  Used to wake up the worker when it is idle.
+            signaler_t signaler;
+
+            //  True iff the worker waits for the signaler.
+            bool idle;
+        };
+
+        //  Main routine of the worker threads.
+        static void worker_routine (void *arg_);
+        void loop (worker_t *worker_);
+
+        //  Processes the items of the batch until there are none left to
+        //  hand out. Called with 'sync' locked, returns with it locked.
+        void process (batch_t *batch_);
+
+        zmq::ctx_t *ctx;
+
+        //  Synchronises access to all the members below.
+        mutex_t sync;
+
+        //  Batches with items that have not been handed out yet.
+        typedef std::deque <batch_t*> queue_t;
+        queue_t queue;
+
+        typedef std::vector <worker_t*> workers_t;
+        workers_t workers;
+
+        //  Signalers of the callers waiting for their batches to be done,
+        //  kept for reuse. There are never more than there are threads
+        //  running engines.
+        typedef std::vector <signaler_t*> signalers_t;
+        signalers_t signalers;
+
+        //  Set when the pool is being destroyed.
+        bool stopping;
+
+        crypto_pool_t (const crypto_pool_t&);
+        const crypto_pool_t &operator = (const crypto_pool_t&);
+    };
+
+}
+
+#endif
@@ -24,6 +24,7 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
 #include <limits>
 #include <new>
 #include <string.h>
@@ -32,6 +33,10 @@
 #include "socket_base.hpp"
 #include "io_thread.hpp"
 #include "reaper.hpp"
+#include "resolver.hpp"
+#include "crypto_pool.hpp"
+#include "curve_tickets.hpp"
+#include "zap_cache.hpp"
 #include "pipe.hpp"
 #include "err.hpp"
 #include "msg.hpp"
@@ -61,18 +66,33 @@ zmq::ctx_t::ctx_t () :
     starting (true),
     terminating (false),
     reaper (NULL),
+    resolver (NULL),
+    crypto_pool (NULL),
+    curve_tickets (NULL),
+    zap_cache (NULL),
     slot_count (0),
     slots (NULL),
     max_sockets (clipped_maxsocket (ZMQ_MAX_SOCKETS_DFLT)),
     io_thread_count (ZMQ_IO_THREADS_DFLT),
     blocky (true),
     ipv6 (false),
+    resolver_cache_ttl (ZMQ_RESOLVER_CACHE_TTL_DFLT),
+    crypto_thread_count (ZMQ_CRYPTO_THREADS_DFLT),
+    zap_cache_ttl (ZMQ_ZAP_CACHE_TTL_DFLT),
     thread_priority (ZMQ_THREAD_PRIORITY_DFLT),
     thread_sched_policy (ZMQ_THREAD_SCHED_POLICY_DFLT)
 {
 #ifdef HAVE_FORK
     pid = getpid();
 #endif
+    resolver = new (std::nothrow) resolver_t (this);
+    alloc_assert (resolver);
+    crypto_pool = new (std::nothrow) crypto_pool_t (this);
+    alloc_assert (crypto_pool);
+    curve_tickets = new (std::nothrow) curve_tickets_t;
+    alloc_assert (curve_tickets);
+    zap_cache = new (std::nothrow) zap_cache_t (this);
+    alloc_assert (zap_cache);
 }
 
 bool zmq::ctx_t::check_tag ()
@@ -97,6 +117,17 @@ zmq::ctx_t::~ctx_t ()
     //  Deallocate the reaper thread object.
     delete reaper;
 
+    //  Wait till the resolver threads terminate. The lookups in progress
+    //  have been cancelled by their requesters at this point.
+    delete resolver;
+
+    //  The engines are gone, so the crypto threads are idle.
+    delete crypto_pool;
+
+    delete curve_tickets;
+
+    delete zap_cache;
+
     //  Deallocate the array of mailboxes. No special work is
     //  needed as mailboxes themselves were deallocated with their
     //  corresponding io_thread/socket objects.
@@ -229,6 +260,24 @@ int zmq::ctx_t::set (int option_, int optval_)
         blocky = (optval_ != 0);
         opt_sync.unlock ();
     }
+    else
+    if (option_ == ZMQ_RESOLVER_CACHE_TTL && optval_ >= 0) {
+        opt_sync.lock ();
+        resolver_cache_ttl = optval_;
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_CRYPTO_THREADS && optval_ >= 0) {
+        opt_sync.lock ();
+        crypto_thread_count = optval_;
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_ZAP_CACHE_TTL && optval_ >= 0) {
+        opt_sync.lock ();
+        zap_cache_ttl = optval_;
+        opt_sync.unlock ();
+    }
     else {
         errno = EINVAL;
         rc = -1;
@@ -253,6 +302,15 @@ int zmq::ctx_t::get (int option_)
     else
     if (option_ == ZMQ_BLOCKY)
         rc = blocky;
+    else
+    if (option_ == ZMQ_RESOLVER_CACHE_TTL)
+        rc = resolver_cache_ttl;
+    else
+    if (option_ == ZMQ_CRYPTO_THREADS)
+        rc = crypto_thread_count;
+    else
+    if (option_ == ZMQ_ZAP_CACHE_TTL)
+        rc = zap_cache_ttl;
     else {
         errno = EINVAL;
         rc = -1;
@@ -362,6 +420,26 @@ zmq::object_t *zmq::ctx_t::get_reaper ()
     return reaper;
 }
 
+zmq::resolver_t *zmq::ctx_t::get_resolver ()
+{
+    return resolver;
+}
+
+zmq::crypto_pool_t *zmq::ctx_t::get_crypto_pool ()
+{
+    return crypto_pool;
+}
+
+zmq::curve_tickets_t *zmq::ctx_t::get_curve_tickets ()
+{
+    return curve_tickets;
+}
+
+zmq::zap_cache_t *zmq::ctx_t::get_zap_cache ()
+{
+    return zap_cache;
+}
+
 void zmq::ctx_t::start_thread (thread_t &thread_, thread_fn *tfn_, void *arg_) const
 {
     thread_.start(tfn_, arg_);
@@ -373,18 +451,25 @@ void zmq::ctx_t::send_command (uint32_t tid_, const command_t &command_)
     slots [tid_]->send (command_);
 }
 
-zmq::io_thread_t *zmq::ctx_t::choose_io_thread (uint64_t affinity_)
+zmq::io_thread_t *zmq::ctx_t::choose_io_thread (uint64_t affinity_,
+    const std::vector <io_thread_t*> *taken_)
 {
     if (io_threads.empty ())
         return NULL;
 
-    //  Find the I/O thread with minimum load.
+    //  Find the I/O thread with minimum load, among those taken
+    //  the least number of times.
+    int min_taken = -1;
     int min_load = -1;
     io_thread_t *selected_io_thread = NULL;
     for (io_threads_t::size_type i = 0; i != io_threads.size (); i++) {
         if (!affinity_ || (affinity_ & (uint64_t (1) << i))) {
-            int load = io_threads [i]->get_load ();
-            if (selected_io_thread == NULL || load < min_load) {
+            const int taken = taken_ ? (int) std::count (taken_->begin (),
+                taken_->end (), io_threads [i]) : 0;
+            const int load = io_threads [i]->get_load ();
+            if (selected_io_thread == NULL || taken < min_taken
+            ||  (taken == min_taken && load < min_load)) {
+                min_taken = taken;
                 min_load = load;
                 selected_io_thread = io_threads [i];
             }
@@ -41,6 +41,10 @@ namespace zmq
     class io_thread_t;
     class socket_base_t;
     class reaper_t;
+    class resolver_t;
+    class crypto_pool_t;
+    class curve_tickets_t;
+    class zap_cache_t;
     class pipe_t;
 
     //  Information associated with inproc endpoint. Note that endpoint options
@@ -97,11 +101,26 @@ namespace zmq
         //  Returns the I/O thread that is the least busy at the moment.
         //  Affinity specifies which I/O threads are eligible (0 = all).
         //  Returns NULL if no I/O thread is available.
-        zmq::io_thread_t *choose_io_thread (uint64_t affinity_);
+        //  If given, threads that occur fewer times in 'taken_' are
+        //  preferred regardless of their load.
+        zmq::io_thread_t *choose_io_thread (uint64_t affinity_,
+            const std::vector <zmq::io_thread_t*> *taken_ = NULL);
 
         //  Returns reaper thread object.
         zmq::object_t *get_reaper ();
 
+        //  Returns the resolver for TCP addresses.
+        zmq::resolver_t *get_resolver ();
+
+        //  Returns the pool of threads for encrypting message batches.
+        zmq::crypto_pool_t *get_crypto_pool ();
+
+        //  Returns the session tickets of CURVE clients.
+        zmq::curve_tickets_t *get_curve_tickets ();
+
+        //  Returns the cache of ZAP replies.
+        zmq::zap_cache_t *get_zap_cache ();
+
         //  Management of inproc endpoints.
         int register_endpoint (const char *addr_, const endpoint_t &endpoint_);
         int unregister_endpoint (const std::string &addr_, socket_base_t *socket_);
@@ -156,6 +175,18 @@ namespace zmq
         //  The reaper thread.
         zmq::reaper_t *reaper;
 
+        //  Resolves host names in the background.
+        zmq::resolver_t *resolver;
+
+        //  Encrypts and decrypts message batches in parallel.
+        zmq::crypto_pool_t *crypto_pool;
+
+        //  CURVE session tickets.
+        zmq::curve_tickets_t *curve_tickets;
+
+        //  Replies of ZAP handlers.
+        zmq::zap_cache_t *zap_cache;
+
         //  I/O threads.
         typedef std::vector <zmq::io_thread_t*> io_threads_t;
         io_threads_t io_threads;
@@ -193,6 +224,16 @@ namespace zmq
         //  Is IPv6 enabled on this context?
         bool ipv6;
 
+        //  How long to keep the results of host name lookups, in
+        //  milliseconds.
+        int resolver_cache_ttl;
+
+        //  Maximal number of threads helping with the encryption.
+        int crypto_thread_count;
+
+        //  How long to keep the replies of ZAP handlers, in milliseconds.
+        int zap_cache_ttl;
+
 		//  Thread scheduling parameters.
         int thread_priority;
         int thread_sched_policy;
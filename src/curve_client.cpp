@@ -31,11 +31,11 @@
 #include "curve_client.hpp"
 #include "wire.hpp"
 
-zmq::curve_client_t::curve_client_t (const options_t &options_) :
-    mechanism_t (options_),
+zmq::curve_client_t::curve_client_t (const options_t &options_,
+                                     curve_tickets_t *tickets_) :
+    curve_mechanism_base_t (options_, "CurveZMQMESSAGEC", "CurveZMQMESSAGES"),
     state (send_hello),
-    cn_nonce(1),
-    cn_peer_nonce(1),
+    tickets (tickets_),
     sync()
 {
     int rc;
@@ -55,10 +55,15 @@ zmq::curve_client_t::curve_client_t (const options_t &options_) :
     //  Generate short-term key pair
     rc = crypto_box_keypair (cn_public, cn_secret);
     zmq_assert (rc == 0);
+
+    //  Resume the session of an earlier connection if we can
+    if (tickets && tickets->take (server_key, public_key, ticket, ticket_key))
+        state = send_resume;
 }
 
 zmq::curve_client_t::~curve_client_t ()
 {
+    memset (ticket_key, 0, sizeof ticket_key);
 }
 
 int zmq::curve_client_t::next_handshake_command (msg_t *msg_)
@@ -76,6 +81,11 @@ int zmq::curve_client_t::next_handshake_command (msg_t *msg_)
             if (rc == 0)
                 state = expect_ready;
             break;
+        case send_resume:
+            rc = produce_resume (msg_);
+            if (rc == 0)
+                state = expect_resumed;
+            break;
         default:
             errno = EAGAIN;
             rc = -1;
@@ -96,6 +106,9 @@ int zmq::curve_client_t::process_handshake_command (msg_t *msg_)
     if (msg_size >= 6 && !memcmp (msg_data, "\5READY", 6))
         rc = process_ready (msg_data, msg_size);
     else
+    if (msg_size >= 8 && !memcmp (msg_data, "\7RESUMED", 8))
+        rc = process_resumed (msg_data, msg_size);
+    else
     if (msg_size >= 6 && !memcmp (msg_data, "\5ERROR", 6))
         rc = process_error (msg_data, msg_size);
     else {
@@ -113,120 +126,6 @@ int zmq::curve_client_t::process_handshake_command (msg_t *msg_)
     return rc;
 }
 
-int zmq::curve_client_t::encode (msg_t *msg_)
-{
-    zmq_assert (state == connected);
-
-    uint8_t flags = 0;
-    if (msg_->flags () & msg_t::more)
-        flags |= 0x01;
-
-    uint8_t message_nonce [crypto_box_NONCEBYTES];
-    memcpy (message_nonce, "CurveZMQMESSAGEC", 16);
-    put_uint64 (message_nonce + 16, cn_nonce);
-
-    const size_t mlen = crypto_box_ZEROBYTES + 1 + msg_->size ();
-
-    uint8_t *message_plaintext = static_cast <uint8_t *> (malloc (mlen));
-    alloc_assert (message_plaintext);
-
-    memset (message_plaintext, 0, crypto_box_ZEROBYTES);
-    message_plaintext [crypto_box_ZEROBYTES] = flags;
-    memcpy (message_plaintext + crypto_box_ZEROBYTES + 1,
-            msg_->data (), msg_->size ());
-
-    uint8_t *message_box = static_cast <uint8_t *> (malloc (mlen));
-    alloc_assert (message_box);
-
-    int rc = crypto_box_afternm (message_box, message_plaintext,
-                                 mlen, message_nonce, cn_precom);
-    zmq_assert (rc == 0);
-
-    rc = msg_->close ();
-    zmq_assert (rc == 0);
-
-    rc = msg_->init_size (16 + mlen - crypto_box_BOXZEROBYTES);
-    zmq_assert (rc == 0);
-
-    uint8_t *message = static_cast <uint8_t *> (msg_->data ());
-
-    memcpy (message, "\x07MESSAGE", 8);
-    memcpy (message + 8, message_nonce + 16, 8);
-    memcpy (message + 16, message_box + crypto_box_BOXZEROBYTES,
-            mlen - crypto_box_BOXZEROBYTES);
-
-    free (message_plaintext);
-    free (message_box);
-
-    cn_nonce++;
-
-    return 0;
-}
-
-int zmq::curve_client_t::decode (msg_t *msg_)
-{
-    zmq_assert (state == connected);
-
-    if (msg_->size () < 33) {
-        errno = EPROTO;
-        return -1;
-    }
-
-    const uint8_t *message = static_cast <uint8_t *> (msg_->data ());
-    if (memcmp (message, "\x07MESSAGE", 8)) {
-        errno = EPROTO;
-        return -1;
-    }
-
-    uint8_t message_nonce [crypto_box_NONCEBYTES];
-    memcpy (message_nonce, "CurveZMQMESSAGES", 16);
-    memcpy (message_nonce + 16, message + 8, 8);
-    uint64_t nonce = get_uint64(message + 8);
-    if (nonce <= cn_peer_nonce) {
-        errno = EPROTO;
-        return -1;
-    }
-    cn_peer_nonce = nonce;
-
-
-    const size_t clen = crypto_box_BOXZEROBYTES + (msg_->size () - 16);
-
-    uint8_t *message_plaintext = static_cast <uint8_t *> (malloc (clen));
-    alloc_assert (message_plaintext);
-
-    uint8_t *message_box = static_cast <uint8_t *> (malloc (clen));
-    alloc_assert (message_box);
-
-    memset (message_box, 0, crypto_box_BOXZEROBYTES);
-    memcpy (message_box + crypto_box_BOXZEROBYTES,
-            message + 16, msg_->size () - 16);
-
-    int rc = crypto_box_open_afternm (message_plaintext, message_box,
-                                      clen, message_nonce, cn_precom);
-    if (rc == 0) {
-        rc = msg_->close ();
-        zmq_assert (rc == 0);
-
-        rc = msg_->init_size (clen - 1 - crypto_box_ZEROBYTES);
-        zmq_assert (rc == 0);
-
-        const uint8_t flags = message_plaintext [crypto_box_ZEROBYTES];
-        if (flags & 0x01)
-            msg_->set_flags (msg_t::more);
-
-        memcpy (msg_->data (),
-                message_plaintext + crypto_box_ZEROBYTES + 1,
-                msg_->size ());
-    }
-    else
-        errno = EPROTO;
-
-    free (message_plaintext);
-    free (message_box);
-
-    return rc;
-}
-
 zmq::mechanism_t::status_t zmq::curve_client_t::status () const
 {
     if (state == connected)
@@ -335,10 +234,10 @@ int zmq::curve_client_t::produce_initiate (msg_t *msg_)
                          vouch_nonce, cn_server, secret_key);
     zmq_assert (rc == 0);
 
-    //  Assume here that metadata is limited to 256 bytes
+    //  Assume here that metadata is limited to 512 bytes
     uint8_t initiate_nonce [crypto_box_NONCEBYTES];
-    uint8_t initiate_plaintext [crypto_box_ZEROBYTES + 128 + 256];
-    uint8_t initiate_box [crypto_box_BOXZEROBYTES + 144 + 256];
+    uint8_t initiate_plaintext [crypto_box_ZEROBYTES + 128 + 512];
+    uint8_t initiate_box [crypto_box_BOXZEROBYTES + 144 + 512];
 
     //  Create Box [C + vouch + metadata](C'->S')
     memset (initiate_plaintext, 0, crypto_box_ZEROBYTES);
@@ -351,16 +250,7 @@ int zmq::curve_client_t::produce_initiate (msg_t *msg_)
 
     //  Metadata starts after vouch
     uint8_t *ptr = initiate_plaintext + crypto_box_ZEROBYTES + 128;
-
-    //  Add socket type property
-    const char *socket_type = socket_type_string (options.type);
-    ptr += add_property (ptr, "Socket-Type", socket_type, strlen (socket_type));
-
-    //  Add identity property
-    if (options.type == ZMQ_REQ
-    ||  options.type == ZMQ_DEALER
-    ||  options.type == ZMQ_ROUTER)
-        ptr += add_property (ptr, "Identity", options.identity, options.identity_size);
+    ptr += add_metadata (ptr);
 
     const size_t mlen = ptr - initiate_plaintext;
 
@@ -392,24 +282,34 @@ int zmq::curve_client_t::produce_initiate (msg_t *msg_)
 int zmq::curve_client_t::process_ready (
         const uint8_t *msg_data, size_t msg_size)
 {
-    if (msg_size < 30) {
+    if (state != expect_ready || msg_size < 30) {
         errno = EPROTO;
         return -1;
     }
 
-    const size_t clen = (msg_size - 14) + crypto_box_BOXZEROBYTES;
+    return open_ready (msg_data + 6, msg_size - 6);
+}
+
+int zmq::curve_client_t::open_ready (const uint8_t *data_, size_t size_)
+{
+    const size_t clen = (size_ - 8) + crypto_box_BOXZEROBYTES;
 
     uint8_t ready_nonce [crypto_box_NONCEBYTES];
-    uint8_t ready_plaintext [crypto_box_ZEROBYTES + 256];
-    uint8_t ready_box [crypto_box_BOXZEROBYTES + 16 + 256];
+    uint8_t ready_plaintext [crypto_box_ZEROBYTES + 512];
+    uint8_t ready_box [crypto_box_BOXZEROBYTES + 16 + 512];
+
+    if (clen > sizeof ready_box) {
+        errno = EPROTO;
+        return -1;
+    }
 
     memset (ready_box, 0, crypto_box_BOXZEROBYTES);
     memcpy (ready_box + crypto_box_BOXZEROBYTES,
-            msg_data + 14, clen - crypto_box_BOXZEROBYTES);
+            data_ + 8, clen - crypto_box_BOXZEROBYTES);
 
     memcpy (ready_nonce, "CurveZMQREADY---", 16);
-    memcpy (ready_nonce + 16, msg_data + 6, 8);
-    cn_peer_nonce = get_uint64(msg_data + 6);
+    memcpy (ready_nonce + 16, data_, 8);
+    cn_peer_nonce = get_uint64 (data_);
 
     int rc = crypto_box_open_afternm (ready_plaintext, ready_box,
                                       clen, ready_nonce, cn_precom);
@@ -422,15 +322,149 @@ int zmq::curve_client_t::process_ready (
     rc = parse_metadata (ready_plaintext + crypto_box_ZEROBYTES,
                          clen - crypto_box_ZEROBYTES);
     if (rc == 0)
+        rc = accept_cipher ();
+    if (rc == 0) {
+        store_ticket ();
         state = connected;
+    }
 
     return rc;
 }
 
+int zmq::curve_client_t::produce_resume (msg_t *msg_)
+{
+    //  Assume here that metadata is limited to 512 bytes
+    uint8_t resume_nonce [crypto_box_NONCEBYTES];
+    uint8_t resume_plaintext [crypto_box_ZEROBYTES + 512];
+    uint8_t resume_box [crypto_box_BOXZEROBYTES + 16 + 512];
+
+    //  Create Box [metadata](K), K being derived from the ticket's
+    //  secret and C'
+    memset (resume_plaintext, 0, crypto_box_ZEROBYTES);
+    uint8_t *ptr = resume_plaintext + crypto_box_ZEROBYTES;
+    ptr += add_metadata (ptr);
+    const size_t mlen = ptr - resume_plaintext;
+
+    uint8_t key_input [64];
+    memcpy (key_input, ticket_key, 32);
+    memcpy (key_input + 32, cn_public, 32);
+    uint8_t resume_key [32];
+    derive_key (resume_key, "CurveZMQRESUME-K", key_input, 64);
+
+    memcpy (resume_nonce, "CurveZMQRESUME--", 16);
+    put_uint64 (resume_nonce + 16, cn_nonce);
+
+    int rc = crypto_box_afternm (resume_box, resume_plaintext,
+                                 mlen, resume_nonce, resume_key);
+    zmq_assert (rc == 0);
+    memset (resume_key, 0, sizeof resume_key);
+
+    rc = msg_->init_size (151 + mlen - crypto_box_BOXZEROBYTES);
+    errno_assert (rc == 0);
+
+    uint8_t *resume = static_cast <uint8_t *> (msg_->data ());
+
+    memcpy (resume, "\x06RESUME", 7);
+    //  Client public connection key
+    memcpy (resume + 7, cn_public, 32);
+    //  Ticket the server gave us
+    memcpy (resume + 39, ticket, curve_tickets_t::ticket_size);
+    //  Short nonce, prefixed by "CurveZMQRESUME--"
+    memcpy (resume + 143, resume_nonce + 16, 8);
+    //  Box [metadata](K)
+    memcpy (resume + 151, resume_box + crypto_box_BOXZEROBYTES,
+            mlen - crypto_box_BOXZEROBYTES);
+    cn_nonce++;
+
+    return 0;
+}
+
+int zmq::curve_client_t::process_resumed (
+        const uint8_t *msg_data, size_t msg_size)
+{
+    if (state != expect_resumed || msg_size < 64) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    //  Server's short-term public key (S')
+    memcpy (cn_server, msg_data + 8, 32);
+
+    //  The session key mixes the ticket's secret into a fresh
+    //  exchange of short-term keys
+    uint8_t key_input [64];
+    int rc = crypto_box_beforenm (key_input, cn_server, cn_secret);
+    zmq_assert (rc == 0);
+    memcpy (key_input + 32, ticket_key, 32);
+    derive_key (cn_precom, "CurveZMQRESUME-S", key_input, 64);
+    memset (key_input, 0, sizeof key_input);
+
+    rc = open_ready (msg_data + 40, msg_size - 40);
+    if (rc == 0)
+        zmtp_properties.insert (
+            metadata_t::dict_t::value_type (resumed_property, "1"));
+    return rc;
+}
+
+size_t zmq::curve_client_t::add_metadata (uint8_t *ptr_) const
+{
+    uint8_t *ptr = ptr_;
+
+    //  Add socket type property
+    const char *socket_type = socket_type_string (options.type);
+    ptr += add_property (ptr, "Socket-Type", socket_type, strlen (socket_type));
+
+    //  Add identity property
+    if (options.type == ZMQ_REQ
+    ||  options.type == ZMQ_DEALER
+    ||  options.type == ZMQ_ROUTER)
+        ptr += add_property (ptr, "Identity", options.identity, options.identity_size);
+
+    //  Add compression property
+    if (options.compression_threshold >= 0)
+        ptr += add_property (ptr, compression_property, "LZ4", 3);
+
+    //  Add gap notices property
+    if (options.type == ZMQ_SUB || options.type == ZMQ_XSUB)
+        ptr += add_property (ptr, gap_notices_property, "1", 1);
+
+    //  Offer ciphers for the messages
+    ptr += add_cipher_offer (ptr);
+
+    //  Ask for a session ticket
+    if (tickets)
+        ptr += add_property (ptr, ticket_property, "", 0);
+
+    return ptr - ptr_;
+}
+
+void zmq::curve_client_t::store_ticket ()
+{
+    const metadata_t::dict_t::iterator it =
+        zmtp_properties.find (ticket_property);
+    if (it == zmtp_properties.end ())
+        return;
+
+    //  The ticket's lifetime in milliseconds followed by the ticket
+    const std::string &value = it->second;
+    if (tickets && value.size () == 4 + curve_tickets_t::ticket_size) {
+        const uint8_t *data = (const uint8_t *) value.data ();
+        uint8_t secret [curve_tickets_t::secret_size];
+        ticket_secret (secret);
+        tickets->put (server_key, public_key, data + 4, secret,
+            get_uint32 (data));
+        memset (secret, 0, sizeof secret);
+    }
+
+    //  Nobody else has any use for it.
+    zmtp_properties.erase (it);
+}
+
 int zmq::curve_client_t::process_error (
         const uint8_t *msg_data, size_t msg_size)
 {
-    if (state != expect_welcome && state != expect_ready) {
+    if (state != expect_welcome && state != expect_ready
+    &&  state != expect_resumed) {
         errno = EPROTO;
         return -1;
     }
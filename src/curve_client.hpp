@@ -24,22 +24,9 @@
 #include "mutex.hpp"
 
 #ifdef HAVE_LIBSODIUM
-#ifdef HAVE_TWEETNACL
-#include "tweetnacl_base.h"
-#include "randombytes.h"
-#else
-#include "sodium.h"
-#endif
-
-#if crypto_box_NONCEBYTES != 24 \
-||  crypto_box_PUBLICKEYBYTES != 32 \
-||  crypto_box_SECRETKEYBYTES != 32 \
-||  crypto_box_ZEROBYTES != 32 \
-||  crypto_box_BOXZEROBYTES != 16
-#error "libsodium not built properly"
-#endif
 
-#include "mechanism.hpp"
+#include "curve_mechanism_base.hpp"
+#include "curve_tickets.hpp"
 #include "options.hpp"
 
 namespace zmq
@@ -48,18 +35,19 @@ namespace zmq
     class msg_t;
     class session_base_t;
 
-    class curve_client_t : public mechanism_t
+    class curve_client_t : public curve_mechanism_base_t
     {
     public:
 
-        curve_client_t (const options_t &options_);
+        //  Session tickets are taken from and stored in tickets_,
+        //  unless it is NULL.
+        curve_client_t (const options_t &options_,
+            curve_tickets_t *tickets_);
         virtual ~curve_client_t ();
 
         // mechanism implementation
         virtual int next_handshake_command (msg_t *msg_);
         virtual int process_handshake_command (msg_t *msg_);
-        virtual int encode (msg_t *msg_);
-        virtual int decode (msg_t *msg_);
         virtual status_t status () const;
 
     private:
@@ -69,6 +57,8 @@ namespace zmq
             expect_welcome,
             send_initiate,
             expect_ready,
+            send_resume,
+            expect_resumed,
             error_received,
             connected
         };
@@ -97,18 +87,30 @@ namespace zmq
         //  Cookie received from server
         uint8_t cn_cookie [16 + 80];
 
-        //  Intermediary buffer used to seepd up boxing and unboxing.
-        uint8_t cn_precom [crypto_box_BEFORENMBYTES];
+        //  Cache of session tickets, may be NULL
+        curve_tickets_t * const tickets;
 
-        //  Nonce
-        uint64_t cn_nonce;
-        uint64_t cn_peer_nonce;
+        //  Ticket of the session we resume and its secret
+        uint8_t ticket [curve_tickets_t::ticket_size];
+        uint8_t ticket_key [curve_tickets_t::secret_size];
 
         int produce_hello (msg_t *msg_);
         int process_welcome (const uint8_t *cmd_data, size_t data_size);
         int produce_initiate (msg_t *msg_);
         int process_ready (const uint8_t *cmd_data, size_t data_size);
+        int produce_resume (msg_t *msg_);
+        int process_resumed (const uint8_t *cmd_data, size_t data_size);
         int process_error (const uint8_t *cmd_data, size_t data_size);
+
+        //  Adds our metadata to INITIATE or RESUME.
+        size_t add_metadata (uint8_t *ptr_) const;
+
+        //  Opens the short nonce and Box [metadata](S'->C') ending
+        //  READY and RESUMED.
+        int open_ready (const uint8_t *data_, size_t size_);
+
+        //  Keeps the ticket the server handed out, if any.
+        void store_ticket ();
         mutex_t sync;
     };
 
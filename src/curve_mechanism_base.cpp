@@ -0,0 +1,336 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "platform.hpp"
+
+#ifdef HAVE_LIBSODIUM
+
+#include <string.h>
+
+#include "curve_mechanism_base.hpp"
+#include "crypto_pool.hpp"
+#include "aead.hpp"
+#include "msg.hpp"
+#include "err.hpp"
+#include "wire.hpp"
+
+zmq::curve_mechanism_base_t::curve_mechanism_base_t (
+      const options_t &options_, const char *encode_nonce_prefix_,
+      const char *decode_nonce_prefix_) :
+    mechanism_t (options_),
+    cn_nonce (1),
+    cn_peer_nonce (1),
+    encode_nonce_prefix (encode_nonce_prefix_),
+    decode_nonce_prefix (decode_nonce_prefix_),
+    aead (NULL)
+{
+}
+
+zmq::curve_mechanism_base_t::~curve_mechanism_base_t ()
+{
+#if defined ZMQ_HAVE_LIBCRYPTO
+    delete aead;
+#endif
+}
+
+const char zmq::curve_mechanism_base_t::cipher_property [] = "X-Curve-Cipher";
+const char zmq::curve_mechanism_base_t::ticket_property [] = "X-Curve-Ticket";
+const char zmq::curve_mechanism_base_t::resumed_property [] =
+    "X-Curve-Resumed";
+
+size_t zmq::curve_mechanism_base_t::add_cipher_offer (uint8_t *ptr_) const
+{
+#if defined ZMQ_HAVE_LIBCRYPTO
+    if (options.curve_aead) {
+        const std::string offer = aead_t::offer ();
+        return add_property (ptr_, cipher_property,
+            offer.c_str (), offer.size ());
+    }
+#else
+    (void) ptr_;
+#endif
+    return 0;
+}
+
+size_t zmq::curve_mechanism_base_t::add_cipher_choice (uint8_t *ptr_)
+{
+    const metadata_t::dict_t::iterator it =
+        zmtp_properties.find (cipher_property);
+    if (it == zmtp_properties.end ())
+        return 0;
+
+#if defined ZMQ_HAVE_LIBCRYPTO
+    if (options.curve_aead)
+        cipher = aead_t::choose (it->second);
+#endif
+
+    //  The message metadata shows the cipher in use rather than what
+    //  the client offered.
+    zmtp_properties.erase (it);
+    if (cipher.empty ())
+        return 0;
+    zmtp_properties.insert (
+        metadata_t::dict_t::value_type (cipher_property, cipher));
+    return add_property (ptr_, cipher_property,
+        cipher.c_str (), cipher.size ());
+}
+
+void zmq::curve_mechanism_base_t::start_cipher ()
+{
+#if defined ZMQ_HAVE_LIBCRYPTO
+    if (cipher.empty ())
+        return;
+    aead = aead_t::create (cipher, cn_precom, true);
+    zmq_assert (aead);
+
+    //  Fresh keys, so the nonces start over.
+    cn_nonce = 0;
+    cn_peer_nonce = 0;
+#endif
+}
+
+int zmq::curve_mechanism_base_t::accept_cipher ()
+{
+    const metadata_t::dict_t::const_iterator it =
+        zmtp_properties.find (cipher_property);
+    if (it == zmtp_properties.end ())
+        return 0;
+
+#if defined ZMQ_HAVE_LIBCRYPTO
+    if (options.curve_aead)
+        aead = aead_t::create (it->second, cn_precom, false);
+#endif
+    if (!aead) {
+        errno = EPROTO;
+        return -1;
+    }
+    cipher = it->second;
+    cn_nonce = 0;
+    cn_peer_nonce = 0;
+    return 0;
+}
+
+void zmq::curve_mechanism_base_t::derive_key (uint8_t *key_,
+    const char *label_, const uint8_t *data_, size_t size_)
+{
+    uint8_t input [16 + 128];
+    zmq_assert (size_ <= sizeof input - 16);
+    memcpy (input, label_, 16);
+    memcpy (input + 16, data_, size_);
+
+    uint8_t hash [crypto_hash_BYTES];
+    int rc = crypto_hash (hash, input, 16 + size_);
+    zmq_assert (rc == 0);
+    memcpy (key_, hash, 32);
+
+    memset (input, 0, sizeof input);
+    memset (hash, 0, sizeof hash);
+}
+
+void zmq::curve_mechanism_base_t::ticket_secret (uint8_t *secret_) const
+{
+    derive_key (secret_, "CurveZMQTICKET-R", cn_precom, sizeof cn_precom);
+}
+
+int zmq::curve_mechanism_base_t::encode (msg_t *msg_)
+{
+#if defined ZMQ_HAVE_LIBCRYPTO
+    if (aead) {
+        aead->seal (msg_, cn_nonce++);
+        return 0;
+    }
+#endif
+    box_message (msg_, cn_nonce);
+    cn_nonce++;
+    return 0;
+}
+
+int zmq::curve_mechanism_base_t::decode (msg_t *msg_)
+{
+#if defined ZMQ_HAVE_LIBCRYPTO
+    if (aead)
+        return aead->open (msg_, cn_peer_nonce++);
+#endif
+    if (check_message (msg_) == -1)
+        return -1;
+    return open_message (msg_);
+}
+
+int zmq::curve_mechanism_base_t::encode_batch (msg_t *msgs_, size_t count_,
+    crypto_pool_t *pool_)
+{
+    //  The cipher contexts are not shared between threads.
+    if (aead)
+        return mechanism_t::encode_batch (msgs_, count_, NULL);
+
+    //  The nonces are taken in order, the boxing can then be done in
+    //  any order.
+    batch_t batch = {this, msgs_, cn_nonce};
+    cn_nonce += count_;
+
+    if (pool_)
+        return pool_->run (box_item, &batch, count_);
+    for (size_t i = 0; i != count_; i++)
+        box_item (&batch, i);
+    return 0;
+}
+
+int zmq::curve_mechanism_base_t::decode_batch (msg_t *msgs_, size_t count_,
+    crypto_pool_t *pool_)
+{
+    if (aead)
+        return mechanism_t::decode_batch (msgs_, count_, NULL);
+
+    for (size_t i = 0; i != count_; i++)
+        if (check_message (&msgs_ [i]) == -1)
+            return -1;
+
+    batch_t batch = {this, msgs_, 0};
+    if (pool_) {
+        if (pool_->run (open_item, &batch, count_) == -1) {
+            errno = EPROTO;
+            return -1;
+        }
+        return 0;
+    }
+    for (size_t i = 0; i != count_; i++)
+        if (!open_item (&batch, i))
+            return -1;
+    return 0;
+}
+
+bool zmq::curve_mechanism_base_t::parallel_codec () const
+{
+    return aead == NULL;
+}
+
+bool zmq::curve_mechanism_base_t::box_item (void *arg_, size_t index_)
+{
+    const batch_t *batch = (const batch_t *) arg_;
+    batch->mechanism->box_message (&batch->msgs [index_],
+        batch->nonce + index_);
+    return true;
+}
+
+bool zmq::curve_mechanism_base_t::open_item (void *arg_, size_t index_)
+{
+    const batch_t *batch = (const batch_t *) arg_;
+    return batch->mechanism->open_message (&batch->msgs [index_]) == 0;
+}
+
+void zmq::curve_mechanism_base_t::box_message (msg_t *msg_,
+    uint64_t nonce_) const
+{
+    uint8_t flags = 0;
+    if (msg_->flags () & msg_t::more)
+        flags |= 0x01;
+    if (msg_->flags () & msg_t::command)
+        flags |= 0x02;
+    if (msg_->flags () & msg_t::compressed)
+        flags |= 0x04;
+
+    uint8_t message_nonce [crypto_box_NONCEBYTES];
+    memcpy (message_nonce, encode_nonce_prefix, 16);
+    put_uint64 (message_nonce + 16, nonce_);
+
+    //  The box is built in place in the outgoing message. Its leading
+    //  crypto_box_BOXZEROBYTES zeros make room for the command name and
+    //  the nonce, so the message is exactly as long as the plaintext.
+    const size_t mlen = crypto_box_ZEROBYTES + 1 + msg_->size ();
+
+    msg_t encrypted;
+    int rc = encrypted.init_size (mlen);
+    zmq_assert (rc == 0);
+
+    uint8_t *message = static_cast <uint8_t *> (encrypted.data ());
+
+    memset (message, 0, crypto_box_ZEROBYTES);
+    message [crypto_box_ZEROBYTES] = flags;
+    memcpy (message + crypto_box_ZEROBYTES + 1, msg_->data (), msg_->size ());
+
+    rc = crypto_box_afternm (message, message, mlen, message_nonce, cn_precom);
+    zmq_assert (rc == 0);
+
+    memcpy (message, "\x07MESSAGE", 8);
+    memcpy (message + 8, message_nonce + 16, 8);
+
+    rc = msg_->move (encrypted);
+    zmq_assert (rc == 0);
+}
+
+int zmq::curve_mechanism_base_t::check_message (msg_t *msg_)
+{
+    if (msg_->size () < 33) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    const uint8_t *message = static_cast <uint8_t *> (msg_->data ());
+    if (memcmp (message, "\x07MESSAGE", 8)) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    const uint64_t nonce = get_uint64 (message + 8);
+    if (nonce <= cn_peer_nonce) {
+        errno = EPROTO;
+        return -1;
+    }
+    cn_peer_nonce = nonce;
+    return 0;
+}
+
+int zmq::curve_mechanism_base_t::open_message (msg_t *msg_) const
+{
+    uint8_t *message = static_cast <uint8_t *> (msg_->data ());
+
+    uint8_t message_nonce [crypto_box_NONCEBYTES];
+    memcpy (message_nonce, decode_nonce_prefix, 16);
+    memcpy (message_nonce + 16, message + 8, 8);
+
+    //  The box is opened in place. Messages coming from the decoder own
+    //  their buffers, so nobody else sees the header being overwritten.
+    zmq_assert (!msg_->is_cmsg () && !(msg_->flags () & msg_t::shared));
+
+    const size_t clen = msg_->size ();
+    memset (message, 0, crypto_box_BOXZEROBYTES);
+
+    int rc = crypto_box_open_afternm (message, message,
+                                      clen, message_nonce, cn_precom);
+    if (rc != 0) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    const uint8_t flags = message [crypto_box_ZEROBYTES];
+    msg_->reset_flags (msg_t::more | msg_t::command | msg_t::compressed);
+    if (flags & 0x01)
+        msg_->set_flags (msg_t::more);
+    if (flags & 0x02)
+        msg_->set_flags (msg_t::command);
+    if (flags & 0x04)
+        msg_->set_flags (msg_t::compressed);
+
+    const size_t size = clen - 1 - crypto_box_ZEROBYTES;
+    memmove (message, message + crypto_box_ZEROBYTES + 1, size);
+    msg_->shrink (size);
+    return 0;
+}
+
+#endif
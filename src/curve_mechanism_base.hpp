@@ -0,0 +1,164 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_CURVE_MECHANISM_BASE_HPP_INCLUDED__
+#define __ZMQ_CURVE_MECHANISM_BASE_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+#ifdef HAVE_LIBSODIUM
+#ifdef HAVE_TWEETNACL
+#include "tweetnacl_base.h"
+#include "randombytes.h"
+#else
+#include "sodium.h"
+#endif
+
+#if crypto_box_NONCEBYTES != 24 \
+||  crypto_box_PUBLICKEYBYTES != 32 \
+||  crypto_box_SECRETKEYBYTES != 32 \
+||  crypto_box_ZEROBYTES != 32 \
+||  crypto_box_BOXZEROBYTES != 16
+#error "libsodium not built properly"
+#endif
+
+#include <string>
+
+#include "mechanism.hpp"
+#include "options.hpp"
+
+namespace zmq
+{
+
+    class msg_t;
+    class aead_t;
+
+    //  MESSAGE commands, carrying the messages once the handshake is
+    //  done, work the same way for clients and servers. Each side boxes
+    //  with its own nonce prefix and unboxes with its peer's. If both
+    //  ends agree on a cipher during the handshake (ZMQ_CURVE_AEAD),
+    //  messages are sealed with it instead.
+
+    class curve_mechanism_base_t : public mechanism_t
+    {
+    public:
+
+        curve_mechanism_base_t (const options_t &options_,
+            const char *encode_nonce_prefix_,
+            const char *decode_nonce_prefix_);
+
+        virtual ~curve_mechanism_base_t ();
+
+        // mechanism implementation
+        virtual int encode (msg_t *msg_);
+        virtual int decode (msg_t *msg_);
+        virtual int encode_batch (msg_t *msgs_, size_t count_,
+            crypto_pool_t *pool_);
+        virtual int decode_batch (msg_t *msgs_, size_t count_,
+            crypto_pool_t *pool_);
+        virtual bool parallel_codec () const;
+
+    protected:
+
+        //  Intermediary buffer used to speed up boxing and unboxing.
+        uint8_t cn_precom [crypto_box_BEFORENMBYTES];
+
+        //  Nonce
+        uint64_t cn_nonce;
+        uint64_t cn_peer_nonce;
+
+        //  Name of the property negotiating the cipher. The client offers
+        //  a list of ciphers in INITIATE, the server answers with the one
+        //  it picked in READY, or leaves the property out.
+        static const char cipher_property [];
+
+        //  Adds the client's offer to INITIATE metadata.
+        size_t add_cipher_offer (uint8_t *ptr_) const;
+
+        //  Picks a cipher from the client's offer, adds it to READY
+        //  metadata and starts using it. Called once READY is built.
+        size_t add_cipher_choice (uint8_t *ptr_);
+        void start_cipher ();
+
+        //  Starts using the cipher the server picked, if any. Returns -1
+        //  with errno set to EPROTO if we did not offer it.
+        int accept_cipher ();
+
+        //  Name of the property the client asks for a session ticket
+        //  with in INITIATE or RESUME, and the server hands it out with
+        //  in READY or RESUMED (ZMQ_CURVE_TICKET_TTL).
+        static const char ticket_property [];
+
+        //  Name of the property the message metadata of resumed sessions
+        //  has. It doesn't go over the wire.
+        static const char resumed_property [];
+
+        //  Sets the 32-byte key_ to the start of the SHA-512 hash of
+        //  the 16-byte label_ followed by the data.
+        static void derive_key (uint8_t *key_, const char *label_,
+            const uint8_t *data_, size_t size_);
+
+        //  Sets secret_ to the secret going with the ticket of this
+        //  session, which both ends derive from the session key.
+        void ticket_secret (uint8_t *secret_) const;
+
+    private:
+
+        //  Boxes the message in place using the given nonce.
+        void box_message (msg_t *msg_, uint64_t nonce_) const;
+
+        //  Checks the MESSAGE command and that its nonce is larger than
+        //  the one of the previous message.
+        int check_message (msg_t *msg_);
+
+        //  Unboxes a message checked by check_message in place.
+        int open_message (msg_t *msg_) const;
+
+        //  Batch items for the crypto pool.
+        static bool box_item (void *arg_, size_t index_);
+        static bool open_item (void *arg_, size_t index_);
+
+        //  Arguments of the batch items.
+        struct batch_t
+        {
+            const curve_mechanism_base_t *mechanism;
+            msg_t *msgs;
+            uint64_t nonce;
+        };
+
+        const char *encode_nonce_prefix;
+        const char *decode_nonce_prefix;
+
+        //  Cipher picked by the server, if any.
+        std::string cipher;
+
+        //  Cipher sealing the messages, NULL while they are sent as
+        //  MESSAGE commands.
+        aead_t *aead;
+
+        curve_mechanism_base_t (const curve_mechanism_base_t&);
+        const curve_mechanism_base_t &operator = (
+            const curve_mechanism_base_t&);
+    };
+
+}
+
+#endif
+
+#endif
@@ -25,21 +25,25 @@
 #include "windows.hpp"
 #endif
 
+#include <time.h>
+
 #include "msg.hpp"
 #include "session_base.hpp"
 #include "err.hpp"
 #include "curve_server.hpp"
+#include "curve_tickets.hpp"
 #include "wire.hpp"
 
 zmq::curve_server_t::curve_server_t (session_base_t *session_,
                                      const std::string &peer_address_,
-                                     const options_t &options_) :
-    mechanism_t (options_),
+                                     const options_t &options_,
+                                     curve_tickets_t *tickets_) :
+    curve_mechanism_base_t (options_, "CurveZMQMESSAGES", "CurveZMQMESSAGEC"),
     session (session_),
     peer_address (peer_address_),
+    tickets (tickets_),
     state (expect_hello),
-    cn_nonce (1),
-    cn_peer_nonce(1),
+    resumed (false),
     sync()
 {
     int rc;
@@ -98,7 +102,11 @@ int zmq::curve_server_t::process_handshake_command (msg_t *msg_)
 
     switch (state) {
         case expect_hello:
-            rc = process_hello (msg_);
+            if (msg_->size () >= 7
+            &&  !memcmp (msg_->data (), "\x06RESUME", 7))
+                rc = process_resume (msg_);
+            else
+                rc = process_hello (msg_);
             break;
         case expect_initiate:
             rc = process_initiate (msg_);
@@ -119,125 +127,6 @@ int zmq::curve_server_t::process_handshake_command (msg_t *msg_)
     return rc;
 }
 
-int zmq::curve_server_t::encode (msg_t *msg_)
-{
-    zmq_assert (state == connected);
-
-    const size_t mlen = crypto_box_ZEROBYTES + 1 + msg_->size ();
-
-    uint8_t message_nonce [crypto_box_NONCEBYTES];
-    memcpy (message_nonce, "CurveZMQMESSAGES", 16);
-    put_uint64 (message_nonce + 16, cn_nonce);
-
-    uint8_t flags = 0;
-    if (msg_->flags () & msg_t::more)
-        flags |= 0x01;
-
-    uint8_t *message_plaintext = static_cast <uint8_t *> (malloc (mlen));
-    alloc_assert (message_plaintext);
-
-    memset (message_plaintext, 0, crypto_box_ZEROBYTES);
-    message_plaintext [crypto_box_ZEROBYTES] = flags;
-    memcpy (message_plaintext + crypto_box_ZEROBYTES + 1,
-            msg_->data (), msg_->size ());
-
-    uint8_t *message_box = static_cast <uint8_t *> (malloc (mlen));
-    alloc_assert (message_box);
-
-    int rc = crypto_box_afternm (message_box, message_plaintext,
-                                 mlen, message_nonce, cn_precom);
-    zmq_assert (rc == 0);
-
-    rc = msg_->close ();
-    zmq_assert (rc == 0);
-
-    rc = msg_->init_size (16 + mlen - crypto_box_BOXZEROBYTES);
-    zmq_assert (rc == 0);
-
-    uint8_t *message = static_cast <uint8_t *> (msg_->data ());
-
-    memcpy (message, "\x07MESSAGE", 8);
-    memcpy (message + 8, message_nonce + 16, 8);
-    memcpy (message + 16, message_box + crypto_box_BOXZEROBYTES,
-            mlen - crypto_box_BOXZEROBYTES);
-
-    free (message_plaintext);
-    free (message_box);
-
-    cn_nonce++;
-
-    return 0;
-}
-
-int zmq::curve_server_t::decode (msg_t *msg_)
-{
-    zmq_assert (state == connected);
-
-    if (msg_->size () < 33) {
-        //  Temporary support for security debugging
-        puts ("CURVE I: invalid CURVE client, sent malformed command");
-        errno = EPROTO;
-        return -1;
-    }
-
-    const uint8_t *message = static_cast <uint8_t *> (msg_->data ());
-    if (memcmp (message, "\x07MESSAGE", 8)) {
-        //  Temporary support for security debugging
-        puts ("CURVE I: invalid CURVE client, did not send MESSAGE");
-        errno = EPROTO;
-        return -1;
-    }
-
-    uint8_t message_nonce [crypto_box_NONCEBYTES];
-    memcpy (message_nonce, "CurveZMQMESSAGEC", 16);
-    memcpy (message_nonce + 16, message + 8, 8);
-    uint64_t nonce = get_uint64(message + 8);
-    if (nonce <= cn_peer_nonce) {
-        errno = EPROTO;
-        return -1;
-    }
-    cn_peer_nonce = nonce;
-
-    const size_t clen = crypto_box_BOXZEROBYTES + msg_->size () - 16;
-
-    uint8_t *message_plaintext = static_cast <uint8_t *> (malloc (clen));
-    alloc_assert (message_plaintext);
-
-    uint8_t *message_box = static_cast <uint8_t *> (malloc (clen));
-    alloc_assert (message_box);
-
-    memset (message_box, 0, crypto_box_BOXZEROBYTES);
-    memcpy (message_box + crypto_box_BOXZEROBYTES,
-            message + 16, msg_->size () - 16);
-
-    int rc = crypto_box_open_afternm (message_plaintext, message_box,
-                                      clen, message_nonce, cn_precom);
-    if (rc == 0) {
-        rc = msg_->close ();
-        zmq_assert (rc == 0);
-
-        rc = msg_->init_size (clen - 1 - crypto_box_ZEROBYTES);
-        zmq_assert (rc == 0);
-
-        const uint8_t flags = message_plaintext [crypto_box_ZEROBYTES];
-        if (flags & 0x01)
-            msg_->set_flags (msg_t::more);
-
-        memcpy (msg_->data (),
-                message_plaintext + crypto_box_ZEROBYTES + 1,
-                msg_->size ());
-    }
-    else {
-        //  Temporary support for security debugging
-        puts ("CURVE I: connection key used for MESSAGE is wrong");
-        errno = EPROTO;
-    }
-    free (message_plaintext);
-    free (message_box);
-
-    return rc;
-}
-
 int zmq::curve_server_t::zap_msg_available ()
 {
     if (state != expect_zap_reply) {
@@ -429,8 +318,8 @@ int zmq::curve_server_t::process_initiate (msg_t *msg_)
     const size_t clen = (msg_->size () - 113) + crypto_box_BOXZEROBYTES;
 
     uint8_t initiate_nonce [crypto_box_NONCEBYTES];
-    uint8_t initiate_plaintext [crypto_box_ZEROBYTES + 128 + 256];
-    uint8_t initiate_box [crypto_box_BOXZEROBYTES + 144 + 256];
+    uint8_t initiate_plaintext [crypto_box_ZEROBYTES + 128 + 512];
+    uint8_t initiate_box [crypto_box_BOXZEROBYTES + 144 + 512];
 
     //  Open Box [C + vouch + metadata](C'->S')
     memset (initiate_box, 0, crypto_box_BOXZEROBYTES);
@@ -450,7 +339,7 @@ int zmq::curve_server_t::process_initiate (msg_t *msg_)
         return -1;
     }
 
-    const uint8_t *client_key = initiate_plaintext + crypto_box_ZEROBYTES;
+    memcpy (client_key, initiate_plaintext + crypto_box_ZEROBYTES, 32);
 
     uint8_t vouch_nonce [crypto_box_NONCEBYTES];
     uint8_t vouch_plaintext [crypto_box_ZEROBYTES + 64];
@@ -487,8 +376,140 @@ int zmq::curve_server_t::process_initiate (msg_t *msg_)
     rc = crypto_box_beforenm (cn_precom, cn_client, cn_secret);
     zmq_assert (rc == 0);
 
+    rc = authenticate ();
+    if (rc == -1)
+        return -1;
+
+    return parse_metadata (initiate_plaintext + crypto_box_ZEROBYTES + 128,
+                           clen - crypto_box_ZEROBYTES - 128);
+}
+
+int zmq::curve_server_t::process_resume (msg_t *msg_)
+{
+    //  Tickets are only good while we hand them out
+    if (options.curve_ticket_ttl == 0 || !tickets) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    if (msg_->size () < 167 || msg_->size () > 151 + 16 + 512) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    const uint8_t *resume = static_cast <uint8_t *> (msg_->data ());
+
+    //  Save client's short-term public key (C')
+    memcpy (cn_client, resume + 7, 32);
+
+    uint8_t ticket_nonce [crypto_secretbox_NONCEBYTES];
+    uint8_t ticket_plaintext [crypto_secretbox_ZEROBYTES + 72];
+    uint8_t ticket_box [crypto_secretbox_BOXZEROBYTES + 88];
+
+    //  Open Box [C + secret + expiry](K)
+    memset (ticket_box, 0, crypto_secretbox_BOXZEROBYTES);
+    memcpy (ticket_box + crypto_secretbox_BOXZEROBYTES, resume + 55, 88);
+
+    memcpy (ticket_nonce, "TICKET--", 8);
+    memcpy (ticket_nonce + 8, resume + 39, 16);
+
+    uint8_t ticket_key [crypto_secretbox_KEYBYTES];
+    derive_ticket_key (ticket_key);
+    int rc = crypto_secretbox_open (ticket_plaintext, ticket_box,
+                                    sizeof ticket_box,
+                                    ticket_nonce, ticket_key);
+    memset (ticket_key, 0, sizeof ticket_key);
+    if (rc != 0) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    const uint8_t *ticket = ticket_plaintext + crypto_secretbox_ZEROBYTES;
+    const uint64_t expiry = get_uint64 (ticket + 64);
+    const uint64_t now = (uint64_t) time (NULL) * 1000;
+    if (expiry < now) {
+        memset (ticket_plaintext, 0, sizeof ticket_plaintext);
+        errno = EPROTO;
+        return -1;
+    }
+    memcpy (client_key, ticket, 32);
+
+    uint8_t key_input [64];
+    memcpy (key_input, ticket + 32, 32);
+    memcpy (key_input + 32, cn_client, 32);
+    uint8_t resume_key [32];
+    derive_key (resume_key, "CurveZMQRESUME-K", key_input, 64);
+
+    const size_t clen = (msg_->size () - 151) + crypto_box_BOXZEROBYTES;
+
+    uint8_t resume_nonce [crypto_box_NONCEBYTES];
+    uint8_t resume_plaintext [crypto_box_ZEROBYTES + 512];
+    uint8_t resume_box [crypto_box_BOXZEROBYTES + 16 + 512];
+
+    //  Open Box [metadata](K)
+    memset (resume_box, 0, crypto_box_BOXZEROBYTES);
+    memcpy (resume_box + crypto_box_BOXZEROBYTES,
+            resume + 151, clen - crypto_box_BOXZEROBYTES);
+
+    memcpy (resume_nonce, "CurveZMQRESUME--", 16);
+    memcpy (resume_nonce + 16, resume + 143, 8);
+    cn_peer_nonce = get_uint64 (resume + 143);
+
+    rc = crypto_box_open_afternm (resume_plaintext, resume_box,
+                                  clen, resume_nonce, resume_key);
+    memset (resume_key, 0, sizeof resume_key);
+    if (rc != 0) {
+        memset (ticket_plaintext, 0, sizeof ticket_plaintext);
+        errno = EPROTO;
+        return -1;
+    }
+
+    //  Tickets are single use. A replayed RESUME opens as well as the
+    //  original, so only the first one to get here counts.
+    if (!tickets->redeem (resume + 39, expiry, now)) {
+        memset (ticket_plaintext, 0, sizeof ticket_plaintext);
+        errno = EPROTO;
+        return -1;
+    }
+
+    //  The session key mixes the ticket's secret into a fresh
+    //  exchange of short-term keys
+    rc = crypto_box_beforenm (key_input, cn_client, cn_secret);
+    zmq_assert (rc == 0);
+    memcpy (key_input + 32, ticket + 32, 32);
+    derive_key (cn_precom, "CurveZMQRESUME-S", key_input, 64);
+    memset (key_input, 0, sizeof key_input);
+    memset (ticket_plaintext, 0, sizeof ticket_plaintext);
+
+    resumed = true;
+
+    rc = authenticate ();
+    if (rc == -1)
+        return -1;
+
+    rc = parse_metadata (resume_plaintext + crypto_box_ZEROBYTES,
+                         clen - crypto_box_ZEROBYTES);
+    if (rc == 0)
+        zmtp_properties.insert (
+            metadata_t::dict_t::value_type (resumed_property, "1"));
+    return rc;
+}
+
+int zmq::curve_server_t::authenticate ()
+{
+    //  Skip the request if the handler has recently answered it.
+    const std::string credentials ((const char *) client_key,
+        crypto_box_PUBLICKEYBYTES);
+    if (find_zap_reply (session, peer_address, "CURVE",
+            &credentials, 1, status_code)) {
+        state = status_code == "200"
+            ? send_ready
+            : send_error;
+        return 0;
+    }
+
     //  Use ZAP protocol (RFC 27) to authenticate the user.
-    rc = session->zap_connect ();
+    int rc = session->zap_connect ();
     if (rc == 0) {
         send_zap_request (client_key);
         rc = receive_and_process_zap_reply ();
@@ -504,16 +525,66 @@ int zmq::curve_server_t::process_initiate (msg_t *msg_)
     }
     else
         state = send_ready;
+    return 0;
+}
 
-    return parse_metadata (initiate_plaintext + crypto_box_ZEROBYTES + 128,
-                           clen - crypto_box_ZEROBYTES - 128);
+size_t zmq::curve_server_t::add_ticket (uint8_t *ptr_)
+{
+    const metadata_t::dict_t::iterator it =
+        zmtp_properties.find (ticket_property);
+    if (it == zmtp_properties.end ())
+        return 0;
+
+    //  Nobody else has any use for the request.
+    zmtp_properties.erase (it);
+    if (options.curve_ticket_ttl == 0)
+        return 0;
+
+    uint8_t ticket_nonce [crypto_secretbox_NONCEBYTES];
+    uint8_t ticket_plaintext [crypto_secretbox_ZEROBYTES + 72];
+    uint8_t ticket_box [crypto_secretbox_BOXZEROBYTES + 88];
+
+    //  Create Box [C + secret + expiry](K), K being derived from our
+    //  secret key so that the ticket is good with any server that has it
+    memset (ticket_plaintext, 0, crypto_secretbox_ZEROBYTES);
+    uint8_t *ticket = ticket_plaintext + crypto_secretbox_ZEROBYTES;
+    memcpy (ticket, client_key, 32);
+    ticket_secret (ticket + 32);
+    put_uint64 (ticket + 64,
+        (uint64_t) time (NULL) * 1000 + options.curve_ticket_ttl);
+
+    memcpy (ticket_nonce, "TICKET--", 8);
+    randombytes (ticket_nonce + 8, 16);
+
+    uint8_t ticket_key [crypto_secretbox_KEYBYTES];
+    derive_ticket_key (ticket_key);
+    int rc = crypto_secretbox (ticket_box, ticket_plaintext,
+                               sizeof ticket_plaintext,
+                               ticket_nonce, ticket_key);
+    zmq_assert (rc == 0);
+    memset (ticket_key, 0, sizeof ticket_key);
+    memset (ticket_plaintext, 0, sizeof ticket_plaintext);
+
+    //  The lifetime goes first, so that the client knows when to stop
+    //  using the ticket
+    uint8_t value [4 + curve_tickets_t::ticket_size];
+    put_uint32 (value, (uint32_t) options.curve_ticket_ttl);
+    memcpy (value + 4, ticket_nonce + 8, 16);
+    memcpy (value + 20, ticket_box + crypto_secretbox_BOXZEROBYTES, 88);
+
+    return add_property (ptr_, ticket_property, value, sizeof value);
+}
+
+void zmq::curve_server_t::derive_ticket_key (uint8_t *key_) const
+{
+    derive_key (key_, "CurveZMQTICKET-K", secret_key, sizeof secret_key);
 }
 
 int zmq::curve_server_t::produce_ready (msg_t *msg_)
 {
     uint8_t ready_nonce [crypto_box_NONCEBYTES];
-    uint8_t ready_plaintext [crypto_box_ZEROBYTES + 256];
-    uint8_t ready_box [crypto_box_BOXZEROBYTES + 16 + 256];
+    uint8_t ready_plaintext [crypto_box_ZEROBYTES + 512];
+    uint8_t ready_box [crypto_box_BOXZEROBYTES + 16 + 512];
 
     //  Create Box [metadata](S'->C')
     memset (ready_plaintext, 0, crypto_box_ZEROBYTES);
@@ -529,6 +600,20 @@ int zmq::curve_server_t::produce_ready (msg_t *msg_)
     ||  options.type == ZMQ_ROUTER)
         ptr += add_property (ptr, "Identity", options.identity, options.identity_size);
 
+    //  Add compression property
+    if (options.compression_threshold >= 0)
+        ptr += add_property (ptr, compression_property, "LZ4", 3);
+
+    //  Add gap notices property
+    if (options.type == ZMQ_SUB || options.type == ZMQ_XSUB)
+        ptr += add_property (ptr, gap_notices_property, "1", 1);
+
+    //  Add the cipher picked for the messages
+    ptr += add_cipher_choice (ptr);
+
+    //  Add a ticket for resuming the session
+    ptr += add_ticket (ptr);
+
     const size_t mlen = ptr - ready_plaintext;
 
     memcpy (ready_nonce, "CurveZMQREADY---", 16);
@@ -538,19 +623,28 @@ int zmq::curve_server_t::produce_ready (msg_t *msg_)
                                  mlen, ready_nonce, cn_precom);
     zmq_assert (rc == 0);
 
-    rc = msg_->init_size (14 + mlen - crypto_box_BOXZEROBYTES);
+    //  A resumed session gets RESUMED, which is READY with our
+    //  short-term public key (S') in front of the nonce
+    const size_t header_size = resumed ? 8 + 32 : 6;
+    rc = msg_->init_size (header_size + 8 + mlen - crypto_box_BOXZEROBYTES);
     errno_assert (rc == 0);
 
     uint8_t *ready = static_cast <uint8_t *> (msg_->data ());
 
-    memcpy (ready, "\x05READY", 6);
+    if (resumed) {
+        memcpy (ready, "\x07RESUMED", 8);
+        memcpy (ready + 8, cn_public, 32);
+    }
+    else
+        memcpy (ready, "\x05READY", 6);
     //  Short nonce, prefixed by "CurveZMQREADY---"
-    memcpy (ready + 6, ready_nonce + 16, 8);
+    memcpy (ready + header_size, ready_nonce + 16, 8);
     //  Box [metadata](S'->C')
-    memcpy (ready + 14, ready_box + crypto_box_BOXZEROBYTES,
+    memcpy (ready + header_size + 8, ready_box + crypto_box_BOXZEROBYTES,
             mlen - crypto_box_BOXZEROBYTES);
 
     cn_nonce++;
+    start_cipher ();
 
     return 0;
 }
@@ -707,6 +801,8 @@ int zmq::curve_server_t::receive_and_process_zap_reply ()
     //  Process metadata frame
     rc = parse_metadata (static_cast <const unsigned char*> (msg [6].data ()),
                          msg [6].size (), true);
+    if (rc == 0)
+        cache_zap_reply (session, msg);
 
 error:
     for (int i = 0; i < 7; i++) {
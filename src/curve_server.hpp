@@ -23,12 +23,9 @@
 #include "platform.hpp"
 
 #ifdef HAVE_LIBSODIUM
-#ifdef HAVE_TWEETNACL
-#include "tweetnacl_base.h"
-#include "randombytes.h"
-#else
-#include "sodium.h"
-#endif
+
+#include "curve_mechanism_base.hpp"
+
 #if crypto_box_NONCEBYTES != 24 \
 ||  crypto_box_PUBLICKEYBYTES != 32 \
 ||  crypto_box_SECRETKEYBYTES != 32 \
@@ -40,8 +37,8 @@
 #error "libsodium not built properly"
 #endif
 
-#include "mechanism.hpp"
 #include "options.hpp"
+#include "curve_tickets.hpp"
 
 namespace zmq
 {
@@ -49,20 +46,21 @@ namespace zmq
     class msg_t;
     class session_base_t;
 
-    class curve_server_t : public mechanism_t
+    class curve_server_t : public curve_mechanism_base_t
     {
     public:
 
+        //  The session tickets taken are recorded in tickets_. If it is
+        //  NULL, tickets are turned down.
         curve_server_t (session_base_t *session_,
                         const std::string &peer_address_,
-                        const options_t &options_);
+                        const options_t &options_,
+                        curve_tickets_t *tickets_);
         virtual ~curve_server_t ();
 
         // mechanism implementation
         virtual int next_handshake_command (msg_t *msg_);
         virtual int process_handshake_command (msg_t *msg_);
-        virtual int encode (msg_t *msg_);
-        virtual int decode (msg_t *msg_);
         virtual int zap_msg_available ();
         virtual status_t status () const;
 
@@ -83,15 +81,15 @@ namespace zmq
 
         const std::string peer_address;
 
+        //  Record of the session tickets taken, may be NULL
+        curve_tickets_t * const tickets;
+
         //  Current FSM state
         state_t state;
 
         //  Status code as received from ZAP handler
         std::string status_code;
 
-        uint64_t cn_nonce;
-        uint64_t cn_peer_nonce;
-
         //  Our secret key (s)
         uint8_t secret_key [crypto_box_SECRETKEYBYTES];
 
@@ -104,18 +102,32 @@ namespace zmq
         //  Client's short-term public key (C')
         uint8_t cn_client [crypto_box_PUBLICKEYBYTES];
 
+        //  Client's public key (C)
+        uint8_t client_key [crypto_box_PUBLICKEYBYTES];
+
+        //  True if the client resumed an earlier session with a ticket
+        bool resumed;
+
         //  Key used to produce cookie
         uint8_t cookie_key [crypto_secretbox_KEYBYTES];
 
-        //  Intermediary buffer used to speed up boxing and unboxing.
-        uint8_t cn_precom [crypto_box_BEFORENMBYTES];
-
         int process_hello (msg_t *msg_);
         int produce_welcome (msg_t *msg_);
         int process_initiate (msg_t *msg_);
+        int process_resume (msg_t *msg_);
         int produce_ready (msg_t *msg_);
         int produce_error (msg_t *msg_) const;
 
+        //  Authenticates client_key with the ZAP handler, if there is one,
+        //  and moves on to the state following the reply.
+        int authenticate ();
+
+        //  Adds a session ticket to READY if the client asked for one.
+        size_t add_ticket (uint8_t *ptr_);
+
+        //  Sets key_ to the key tickets are boxed with.
+        void derive_ticket_key (uint8_t *key_) const;
+
         void send_zap_request (const uint8_t *key);
         int receive_and_process_zap_reply ();
         mutex_t sync;
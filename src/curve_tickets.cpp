@@ -0,0 +1,126 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include "curve_tickets.hpp"
+#include "config.hpp"
+
+zmq::curve_tickets_t::curve_tickets_t ()
+{
+}
+
+zmq::curve_tickets_t::~curve_tickets_t ()
+{
+    clear ();
+}
+
+void zmq::curve_tickets_t::put (const uint8_t *server_key_,
+    const uint8_t *client_key_, const uint8_t *ticket_,
+    const uint8_t *secret_, uint32_t ttl_)
+{
+    scoped_lock_t locker (sync);
+
+    const uint64_t now = clock.now_ms ();
+
+    //  Make room for the new entry. Drop the expired entries first and
+    //  if that doesn't help, start afresh.
+    if (cache.size () >= (size_t) curve_ticket_cache_size) {
+        cache_t::iterator it = cache.begin ();
+        while (it != cache.end ())
+            if (it->second.expiry <= now) {
+                memset (it->second.secret, 0, secret_size);
+                cache.erase (it++);
+            }
+            else
+                ++it;
+        if (cache.size () >= (size_t) curve_ticket_cache_size)
+            clear ();
+    }
+
+    entry_t entry;
+    memcpy (entry.ticket, ticket_, ticket_size);
+    memcpy (entry.secret, secret_, secret_size);
+    entry.expiry = now + ttl_;
+    cache.insert (cache_t::value_type (
+        cache_key (server_key_, client_key_), entry));
+    memset (entry.secret, 0, secret_size);
+}
+
+bool zmq::curve_tickets_t::take (const uint8_t *server_key_,
+    const uint8_t *client_key_, uint8_t *ticket_, uint8_t *secret_)
+{
+    scoped_lock_t locker (sync);
+
+    const uint64_t now = clock.now_ms ();
+    const std::string key = cache_key (server_key_, client_key_);
+
+    cache_t::iterator it = cache.lower_bound (key);
+    while (it != cache.end () && it->first == key) {
+        entry_t &entry = it->second;
+        if (entry.expiry > now) {
+            memcpy (ticket_, entry.ticket, ticket_size);
+            memcpy (secret_, entry.secret, secret_size);
+            memset (entry.secret, 0, secret_size);
+            cache.erase (it);
+            return true;
+        }
+        memset (entry.secret, 0, secret_size);
+        cache.erase (it++);
+    }
+    return false;
+}
+
+bool zmq::curve_tickets_t::redeem (const uint8_t *nonce_, uint64_t expiry_,
+    uint64_t now_)
+{
+    scoped_lock_t locker (sync);
+
+    //  Forget the expired tickets when full, servers turn those down
+    //  anyway. If that doesn't help, turn the ticket down as well;
+    //  the client falls back to the full handshake.
+    if (redeemed.size () >= (size_t) curve_ticket_redeemed_size) {
+        redeemed_t::iterator it = redeemed.begin ();
+        while (it != redeemed.end ())
+            if (it->second < now_)
+                redeemed.erase (it++);
+            else
+                ++it;
+        if (redeemed.size () >= (size_t) curve_ticket_redeemed_size)
+            return false;
+    }
+
+    return redeemed.insert (redeemed_t::value_type (
+        std::string ((const char *) nonce_, 16), expiry_)).second;
+}
+
+void zmq::curve_tickets_t::clear ()
+{
+    //  Don't leave the secrets lying around in freed memory.
+    for (cache_t::iterator it = cache.begin (); it != cache.end (); ++it)
+        memset (it->second.secret, 0, secret_size);
+    cache.clear ();
+}
+
+std::string zmq::curve_tickets_t::cache_key (const uint8_t *server_key_,
+    const uint8_t *client_key_)
+{
+    return std::string ((const char *) server_key_, 32)
+         + std::string ((const char *) client_key_, 32);
+}
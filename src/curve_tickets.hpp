@@ -0,0 +1,108 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_CURVE_TICKETS_HPP_INCLUDED__
+#define __ZMQ_CURVE_TICKETS_HPP_INCLUDED__
+
+#include <map>
+#include <string>
+
+#include "stdint.hpp"
+#include "clock.hpp"
+#include "mutex.hpp"
+
+namespace zmq
+{
+
+    //  Session tickets CURVE clients got from servers handing them out
+    //  (ZMQ_CURVE_TICKET_TTL), shared by the sockets of a context. A
+    //  ticket lets a client reconnecting with the same key pair to a
+    //  server with the same key resume its session instead of doing the
+    //  full handshake. Tickets are used only once, the resumed session
+    //  gets a new one. The servers of the context record the tickets
+    //  they took until these expire, so that none is taken twice.
+
+    class curve_tickets_t
+    {
+    public:
+
+        enum {
+            //  Size of a ticket, opaque to the client.
+            ticket_size = 104,
+
+            //  Size of the secret the client keeps along with the ticket.
+            secret_size = 32
+        };
+
+        curve_tickets_t ();
+        ~curve_tickets_t ();
+
+        //  Stores a ticket valid for ttl_ milliseconds for the pair of
+        //  32-byte keys.
+        void put (const uint8_t *server_key_, const uint8_t *client_key_,
+            const uint8_t *ticket_, const uint8_t *secret_, uint32_t ttl_);
+
+        //  Removes a ticket for the pair of keys from the cache and copies
+        //  it out. Returns false if there is no ticket that is still valid.
+        bool take (const uint8_t *server_key_, const uint8_t *client_key_,
+            uint8_t *ticket_, uint8_t *secret_);
+
+        //  Records that a server took the ticket with the 16-byte nonce_,
+        //  valid until expiry_. Returns false if the ticket was taken
+        //  before, or if there is no room to record it. Times are in
+        //  milliseconds since the epoch.
+        bool redeem (const uint8_t *nonce_, uint64_t expiry_,
+            uint64_t now_);
+
+    private:
+
+        struct entry_t
+        {
+            uint8_t ticket [ticket_size];
+            uint8_t secret [secret_size];
+            uint64_t expiry;
+        };
+
+        static std::string cache_key (const uint8_t *server_key_,
+            const uint8_t *client_key_);
+
+        //  Empties the cache, zeroing the secrets first.
+        void clear ();
+
+        //  Synchronises access to the members below.
+        mutex_t sync;
+
+        //  A pair of keys may have several tickets, one per connection
+        //  it made.
+        typedef std::multimap <std::string, entry_t> cache_t;
+        cache_t cache;
+
+        //  Nonces of the tickets servers took, with their expiry.
+        typedef std::map <std::string, uint64_t> redeemed_t;
+        redeemed_t redeemed;
+
+        clock_t clock;
+
+        curve_tickets_t (const curve_tickets_t&);
+        const curve_tickets_t &operator = (const curve_tickets_t&);
+    };
+
+}
+
+#endif
@@ -28,6 +28,7 @@
 #include "err.hpp"
 #include "msg.hpp"
 #include "i_decoder.hpp"
+#include "batch_pool.hpp"
 #include "stdint.hpp"
 
 namespace zmq
@@ -47,21 +48,18 @@ namespace zmq
     {
     public:
 
-        inline decoder_base_t (size_t bufsize_) :
+        inline decoder_base_t (size_t bufsize_, batch_pool_t *pool_) :
             next (NULL),
             read_pos (NULL),
             to_read (0),
-            bufsize (bufsize_)
+            buf (bufsize_, pool_)
         {
-            buf = (unsigned char*) malloc (bufsize_);
-            alloc_assert (buf);
         }
 
         //  The destructor doesn't have to be virtual. It is mad virtual
         //  just to keep ICC and code checking tools from complaining.
         inline virtual ~decoder_base_t ()
         {
-            free (buf);
         }
 
         //  Returns a buffer to be filled with binary data.
@@ -75,14 +73,14 @@ namespace zmq
             //  As a consequence, large messages being received won't block
             //  other engines running in the same I/O thread for excessive
             //  amounts of time.
-            if (to_read >= bufsize) {
+            if (to_read >= buf.size ()) {
                 *data_ = read_pos;
                 *size_ = to_read;
                 return;
             }
 
-            *data_ = buf;
-            *size_ = bufsize;
+            *data_ = buf.data ();
+            *size_ = buf.size ();
         }
 
         //  Processes the data in the buffer previously allocated using
@@ -132,6 +130,16 @@ namespace zmq
             return 0;
         }
 
+        inline void resize_buffer (size_t bufsize_)
+        {
+            buf.resize (bufsize_);
+        }
+
+        inline void release_buffer ()
+        {
+            buf.release ();
+        }
+
     protected:
 
         //  Prototype of state machine action. Action should return false if
@@ -161,8 +169,7 @@ namespace zmq
         size_t to_read;
 
         //  The duffer for data to decode.
-        size_t bufsize;
-        unsigned char *buf;
+        batch_buffer_t buf;
 
         decoder_base_t (const decoder_base_t&);
         const decoder_base_t &operator = (const decoder_base_t&);
@@ -0,0 +1,146 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include "dish.hpp"
+#include "err.hpp"
+
+zmq::dish_t::dish_t (class ctx_t *parent_, uint32_t tid_, int sid_) :
+    socket_base_t (parent_, tid_, sid_),
+    has_message (false)
+{
+    options.type = ZMQ_DISH;
+
+    int rc = message.init ();
+    errno_assert (rc == 0);
+}
+
+zmq::dish_t::~dish_t ()
+{
+    int rc = message.close ();
+    errno_assert (rc == 0);
+}
+
+void zmq::dish_t::xattach_pipe (pipe_t *pipe_, bool subscribe_to_all_)
+{
+    // subscribe_to_all_ is unused
+    (void) subscribe_to_all_;
+
+    zmq_assert (pipe_);
+    fq.attach (pipe_);
+}
+
+void zmq::dish_t::xread_activated (pipe_t *pipe_)
+{
+    fq.activated (pipe_);
+}
+
+void zmq::dish_t::xpipe_terminated (pipe_t *pipe_)
+{
+    fq.pipe_terminated (pipe_);
+}
+
+int zmq::dish_t::xjoin (const char *group_)
+{
+    if (strlen (group_) > ZMQ_GROUP_MAX_LENGTH) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (!subscriptions.insert (std::string (group_)).second) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return 0;
+}
+
+int zmq::dish_t::xleave (const char *group_)
+{
+    if (subscriptions.erase (std::string (group_)) == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return 0;
+}
+
+int zmq::dish_t::xrecv (msg_t *msg_)
+{
+    //  If there's already a message prepared by a previous call to zmq_poll,
+    //  return it straight ahead.
+    if (has_message) {
+        int rc = msg_->move (message);
+        errno_assert (rc == 0);
+        has_message = false;
+        return 0;
+    }
+
+    while (true) {
+
+        //  Get a message using fair queueing algorithm.
+        int rc = fq.recv (msg_);
+
+        //  If there's no message available, return immediately.
+        //  The same when error occurs.
+        if (rc != 0)
+            return -1;
+
+        if (match (msg_))
+            return 0;
+    }
+}
+
+bool zmq::dish_t::xhas_in ()
+{
+    //  If there's already a message prepared by a previous call to zmq_poll,
+    //  return straight ahead.
+    if (has_message)
+        return true;
+
+    while (true) {
+
+        //  Get a message using fair queueing algorithm.
+        int rc = fq.recv (&message);
+
+        //  If there's no message available, return immediately.
+        //  The same when error occurs.
+        if (rc != 0) {
+            errno_assert (errno == EAGAIN);
+            return false;
+        }
+
+        if (match (&message)) {
+            has_message = true;
+            return true;
+        }
+    }
+}
+
+zmq::blob_t zmq::dish_t::get_credential () const
+{
+    return fq.get_credential ();
+}
+
+bool zmq::dish_t::match (msg_t *msg_)
+{
+    return subscriptions.find (std::string (msg_->group ()))
+        != subscriptions.end ();
+}
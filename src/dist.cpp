@@ -17,17 +17,21 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <string.h>
+
 #include "dist.hpp"
 #include "pipe.hpp"
 #include "err.hpp"
 #include "msg.hpp"
 #include "likely.hpp"
+#include "wire.hpp"
 
 zmq::dist_t::dist_t () :
     matching (0),
     active (0),
     eligible (0),
-    more (false)
+    more (false),
+    gap_notices (false)
 {
 }
 
@@ -61,8 +65,11 @@ void zmq::dist_t::match (pipe_t *pipe_)
         return;
 
     //  If the pipe isn't eligible, ignore it.
-    if (pipes.index (pipe_) >= eligible)
+    if (pipes.index (pipe_) >= eligible) {
+        if (gap_notices)
+            skipped.insert (pipe_);
         return;
+    }
 
     //  Mark the pipe as matching.
     pipes.swap (pipes.index (pipe_), matching);
@@ -83,6 +90,16 @@ void zmq::dist_t::reverse_match ()
     for (pipes_t::size_type i = prev_matching; i < eligible; ++i) {
         pipes.swap(i, matching++);
     }
+
+    //  Likewise, the pipes that cannot take the message are the ones
+    //  that were not matched.
+    if (gap_notices) {
+        skipped_t unmatched;
+        for (pipes_t::size_type i = eligible; i < pipes.size (); ++i)
+            if (skipped.find (pipes [i]) == skipped.end ())
+                unmatched.insert (pipes [i]);
+        skipped.swap (unmatched);
+    }
 }
 
 void zmq::dist_t::unmatch ()
@@ -108,6 +125,11 @@ void zmq::dist_t::pipe_terminated (pipe_t *pipe_)
     }
 
     pipes.erase (pipe_);
+
+    if (gap_notices) {
+        lost.erase (pipe_);
+        skipped.erase (pipe_);
+    }
 }
 
 void zmq::dist_t::activated (pipe_t *pipe_)
@@ -135,6 +157,14 @@ int zmq::dist_t::send_to_matching (msg_t *msg_)
     //  Is this end of a multipart message?
     bool msg_more = msg_->flags () & msg_t::more ? true : false;
 
+    //  Pipes that cannot take the first part of the message miss it.
+    if (!more && !skipped.empty ()) {
+        for (skipped_t::iterator it = skipped.begin ();
+              it != skipped.end (); ++it)
+            lost [*it]++;
+        skipped.clear ();
+    }
+
     //  Push the message to matching pipes.
     distribute (msg_);
 
@@ -196,7 +226,19 @@ bool zmq::dist_t::has_out ()
 
 bool zmq::dist_t::write (pipe_t *pipe_, msg_t *msg_)
 {
+    if (gap_notices && !more && !write_gap (pipe_)) {
+        lost [pipe_]++;
+        pipes.swap (pipes.index (pipe_), matching - 1);
+        matching--;
+        pipes.swap (pipes.index (pipe_), active - 1);
+        active--;
+        pipes.swap (active, eligible - 1);
+        eligible--;
+        return false;
+    }
     if (!pipe_->write (msg_)) {
+        if (gap_notices && !more)
+            lost [pipe_]++;
         pipes.swap (pipes.index (pipe_), matching - 1);
         matching--;
         pipes.swap (pipes.index (pipe_), active - 1);
@@ -210,11 +252,49 @@ bool zmq::dist_t::write (pipe_t *pipe_, msg_t *msg_)
     return true;
 }
 
+bool zmq::dist_t::write_gap (pipe_t *pipe_)
+{
+    const lost_t::iterator it = lost.find (pipe_);
+    if (it == lost.end ())
+        return true;
+
+    //  GAP command carries the number of messages missed.
+    msg_t gap;
+    int rc = gap.init_size (12);
+    errno_assert (rc == 0);
+    unsigned char *data = (unsigned char *) gap.data ();
+    memcpy (data, "\3GAP", 4);
+    put_uint64 (data + 4, it->second);
+    gap.set_flags (msg_t::command);
+    if (!pipe_->write (&gap)) {
+        rc = gap.close ();
+        errno_assert (rc == 0);
+        return false;
+    }
+
+    //  Flush it even if the message that follows does not fit.
+    pipe_->flush ();
+    lost.erase (it);
+    return true;
+}
+
+void zmq::dist_t::set_gap_notices (bool enabled_)
+{
+    gap_notices = enabled_;
+    if (!gap_notices) {
+        lost.clear ();
+        skipped.clear ();
+    }
+}
+
 bool zmq::dist_t::check_hwm ()
 {
     for (pipes_t::size_type i = 0; i < matching; ++i)
-        if (!pipes [i]->check_hwm ())
+        if (!pipes [i]->check_hwm ()) {
+            //  The message is not sent, so nobody misses it.
+            skipped.clear ();
             return false;
+        }
 
     return true;
 }
@@ -20,10 +20,13 @@
 #ifndef __ZMQ_DIST_HPP_INCLUDED__
 #define __ZMQ_DIST_HPP_INCLUDED__
 
+#include <map>
+#include <set>
 #include <vector>
 
 #include "array.hpp"
 #include "pipe.hpp"
+#include "stdint.hpp"
 
 namespace zmq
 {
@@ -70,6 +73,11 @@ namespace zmq
         // check HWM of all pipes matching
         bool check_hwm ();
 
+        //  If enabled, count the messages each pipe misses because it is
+        //  full and write a GAP command carrying the count ahead of the next
+        //  message the pipe gets.
+        void set_gap_notices (bool enabled_);
+
     private:
 
         //  Write the message to the pipe. Make the pipe inactive if writing
@@ -101,6 +109,23 @@ namespace zmq
         //  True if last we are in the middle of a multipart message.
         bool more;
 
+        //  True if GAP commands are written to the pipes.
+        bool gap_notices;
+
+        //  Number of messages each pipe missed since the last GAP command
+        //  written to it. Pipes that missed nothing are not in the map.
+        typedef std::map <zmq::pipe_t*, uint64_t> lost_t;
+        lost_t lost;
+
+        //  Pipes passed to match() for the message being sent that could
+        //  not take it.
+        typedef std::set <zmq::pipe_t*> skipped_t;
+        skipped_t skipped;
+
+        //  Write the GAP command for the messages the pipe missed, if any.
+        //  Returns false if the pipe is full.
+        bool write_gap (zmq::pipe_t *pipe_);
+
         dist_t (const dist_t&);
         const dist_t &operator = (const dist_t&);
     };
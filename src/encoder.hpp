@@ -34,6 +34,7 @@
 #include "err.hpp"
 #include "msg.hpp"
 #include "i_encoder.hpp"
+#include "batch_pool.hpp"
 
 namespace zmq
 {
@@ -46,19 +47,16 @@ namespace zmq
     {
     public:
 
-        inline encoder_base_t (size_t bufsize_) :
-            bufsize (bufsize_),
+        inline encoder_base_t (size_t bufsize_, batch_pool_t *pool_) :
+            buf (bufsize_, pool_),
             in_progress (NULL)
         {
-            buf = (unsigned char*) malloc (bufsize_);
-            alloc_assert (buf);
         }
 
         //  The destructor doesn't have to be virtual. It is made virtual
         //  just to keep ICC and code checking tools from complaining.
         inline virtual ~encoder_base_t ()
         {
-            free (buf);
         }
         
         //  The function returns a batch of binary data. The data
@@ -66,8 +64,8 @@ namespace zmq
         //  points to NULL) decoder object will provide buffer of its own.
         inline size_t encode (unsigned char **data_, size_t size_)
         {
-            unsigned char *buffer = !*data_ ? buf : *data_;
-            size_t buffersize = !*data_ ? bufsize : size_;
+            unsigned char *buffer = *data_;
+            size_t buffersize = !*data_ ? buf.size () : size_;
 
             if (in_progress == NULL)
                 return 0;
@@ -109,6 +107,9 @@ namespace zmq
                 }
 
                 //  Copy data to the buffer. If the buffer is full, return.
+                //  Our own buffer is only allocated at this point.
+                if (!buffer)
+                    buffer = buf.data ();
                 size_t to_copy = std::min (to_write, buffersize - pos);
                 memcpy (buffer + pos, write_pos, to_copy);
                 pos += to_copy;
@@ -127,6 +128,16 @@ namespace zmq
             (static_cast <T*> (this)->*next) ();
         }
 
+        inline void resize_buffer (size_t bufsize_)
+        {
+            buf.resize (bufsize_);
+        }
+
+        inline void release_buffer ()
+        {
+            buf.release ();
+        }
+
     protected:
 
         //  Prototype of state machine action.
@@ -158,8 +169,7 @@ namespace zmq
         bool new_msg_flag;
 
         //  The buffer for encoded data.
-        size_t bufsize;
-        unsigned char *buf;
+        batch_buffer_t buf;
 
         encoder_base_t (const encoder_base_t&);
         void operator = (const encoder_base_t&);
@@ -0,0 +1,190 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_MEMFD
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "fd_passing.hpp"
+#include "config.hpp"
+#include "err.hpp"
+
+int zmq::ipc_write_fds (fd_t s_, const void *data_, size_t size_,
+    const fd_t *fds_, size_t nfds_)
+{
+    zmq_assert (nfds_ > 0 && nfds_ <= max_passed_fds);
+
+    struct iovec iov = {const_cast <void *> (data_), size_};
+    union {
+        char buf [CMSG_SPACE (max_passed_fds * sizeof (fd_t))];
+        struct cmsghdr align;
+    } control;
+    memset (&control, 0, sizeof control);
+
+    struct msghdr msg;
+    memset (&msg, 0, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = CMSG_SPACE (nfds_ * sizeof (fd_t));
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN (nfds_ * sizeof (fd_t));
+    memcpy (CMSG_DATA (cmsg), fds_, nfds_ * sizeof (fd_t));
+
+    const ssize_t nbytes = sendmsg (s_, &msg, MSG_NOSIGNAL);
+
+    //  Several errors are OK. When speculative write is being done we may not
+    //  be able to write a single byte from the socket. Also, SIGSTOP issued
+    //  by a debugging tool can result in EINTR error.
+    if (nbytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK ||
+          errno == EINTR))
+        return 0;
+
+    //  Signalise peer failure. Running out of descriptors on the
+    //  receiving side is reported with ETOOMANYREFS.
+    if (nbytes == -1) {
+        errno_assert (errno != EBADF
+                   && errno != EFAULT
+                   && errno != EINVAL
+                   && errno != ENOTSOCK
+                   && errno != EOPNOTSUPP);
+        return -1;
+    }
+
+    return static_cast <int> (nbytes);
+}
+
+int zmq::ipc_read_fds (fd_t s_, void *data_, size_t size_,
+    fd_t *fds_, size_t *nfds_)
+{
+    struct iovec iov = {data_, size_};
+    union {
+        char buf [CMSG_SPACE (max_passed_fds * sizeof (fd_t))];
+        struct cmsghdr align;
+    } control;
+
+    struct msghdr msg;
+    memset (&msg, 0, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof control.buf;
+
+    *nfds_ = 0;
+    const ssize_t rc = recvmsg (s_, &msg, MSG_CMSG_CLOEXEC);
+
+    //  Several errors are OK. When speculative read is being done we may not
+    //  be able to read a single byte from the socket. Also, SIGSTOP issued
+    //  by a debugging tool can result in EINTR error.
+    if (rc == -1) {
+        errno_assert (errno != EBADF
+                   && errno != EFAULT
+                   && errno != EINVAL
+                   && errno != ENOMEM
+                   && errno != ENOTSOCK);
+        if (errno == EWOULDBLOCK || errno == EINTR)
+            errno = EAGAIN;
+        return -1;
+    }
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg); cmsg != NULL;
+          cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            continue;
+        const size_t count =
+            (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (fd_t);
+        const unsigned char *data = CMSG_DATA (cmsg);
+        for (size_t i = 0; i != count; i++) {
+            fd_t fd;
+            memcpy (&fd, data + i * sizeof (fd_t), sizeof (fd_t));
+            if (*nfds_ < max_passed_fds)
+                fds_ [(*nfds_)++] = fd;
+            else
+                ::close (fd);
+        }
+    }
+
+    return static_cast <int> (rc);
+}
+
+zmq::fd_t zmq::memfd_from_data (const void *data_, size_t size_)
+{
+    const fd_t fd = memfd_create ("zmq-msg", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1)
+        return -1;
+
+    const unsigned char *pos = static_cast <const unsigned char *> (data_);
+    size_t left = size_;
+    while (left > 0) {
+        const ssize_t nbytes = write (fd, pos, left);
+        if (nbytes == -1 && errno == EINTR)
+            continue;
+        if (nbytes <= 0) {
+            ::close (fd);
+            return -1;
+        }
+        pos += nbytes;
+        left -= nbytes;
+    }
+
+    //  The receiver maps the memfd, so it must neither shrink nor change.
+    if (fcntl (fd, F_ADD_SEALS,
+          F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == -1) {
+        ::close (fd);
+        return -1;
+    }
+    return fd;
+}
+
+void *zmq::map_memfd (fd_t fd_, size_t size_)
+{
+    const int required = F_SEAL_SHRINK | F_SEAL_WRITE;
+    const int seals = fcntl (fd_, F_GET_SEALS);
+    struct stat st;
+    if (seals == -1 || (seals & required) != required
+    ||  fstat (fd_, &st) == -1 || (size_t) st.st_size < size_) {
+        errno = EPROTO;
+        return NULL;
+    }
+
+    //  A private writable mapping lets the application modify the
+    //  message like any other without affecting the sender.
+    void *addr = mmap (NULL, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+        fd_, 0);
+    return addr == MAP_FAILED ? NULL : addr;
+}
+
+void zmq::unmap_memfd (void *data_, void *hint_)
+{
+    const int rc = munmap (data_, reinterpret_cast <size_t> (hint_));
+    errno_assert (rc == 0);
+}
+
+#endif
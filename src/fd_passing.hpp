@@ -0,0 +1,67 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_FD_PASSING_HPP_INCLUDED__
+#define __ZMQ_FD_PASSING_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_MEMFD
+
+#include <stddef.h>
+
+#include "fd.hpp"
+
+namespace zmq
+{
+
+    //  Large messages sent over UNIX domain sockets can be handed over as
+    //  memfds (ZMQ_IPC_FD_THRESHOLD) instead of being streamed through
+    //  the socket.
+
+    //  Same as tcp_write, but passes the 'nfds_' file descriptors in
+    //  'fds_' along with the data. The descriptors have been passed iff
+    //  the return value is positive.
+    int ipc_write_fds (fd_t s_, const void *data_, size_t size_,
+        const fd_t *fds_, size_t nfds_);
+
+    //  Same as tcp_read, but stores the file descriptors passed along
+    //  with the data in 'fds_' and their number in '*nfds_'. Up to
+    //  'max_passed_fds' descriptors are received, the rest are closed.
+    int ipc_read_fds (fd_t s_, void *data_, size_t size_,
+        fd_t *fds_, size_t *nfds_);
+
+    //  Creates a sealed memfd holding a copy of the data. Returns -1 if
+    //  that fails.
+    fd_t memfd_from_data (const void *data_, size_t size_);
+
+    //  Maps the first 'size_' bytes of a memfd received from a peer as
+    //  private memory. Returns NULL, with errno set, unless the memfd is
+    //  sealed against changes and large enough.
+    void *map_memfd (fd_t fd_, size_t size_);
+
+    //  Deallocation function of messages backed by map_memfd. The hint
+    //  is the size of the mapping.
+    void unmap_memfd (void *data_, void *hint_);
+
+}
+
+#endif
+
+#endif
@@ -70,6 +70,10 @@ int zmq::gssapi_mechanism_base_t::encode_message (msg_t *msg_)
     uint8_t flags = 0;
     if (msg_->flags () & msg_t::more)
         flags |= 0x01;
+    if (msg_->flags () & msg_t::command)
+        flags |= 0x02;
+    if (msg_->flags () & msg_t::compressed)
+        flags |= 0x04;
 
     uint8_t *plaintext_buffer = static_cast <uint8_t *>(malloc(msg_->size ()+1));
     plaintext_buffer[0] = flags;
@@ -167,6 +171,10 @@ int zmq::gssapi_mechanism_base_t::decode_message (msg_t *msg_)
     const uint8_t flags = static_cast <char *> (plaintext.value)[0];
     if (flags & 0x01)
 	    msg_->set_flags (msg_t::more);
+    if (flags & 0x02)
+        msg_->set_flags (msg_t::command);
+    if (flags & 0x04)
+        msg_->set_flags (msg_t::compressed);
 
     memcpy (msg_->data (), static_cast <char *> (plaintext.value)+1, plaintext.length-1);
 
@@ -274,6 +282,14 @@ int zmq::gssapi_mechanism_base_t::produce_ready (msg_t *msg_)
     ||  options.type == ZMQ_ROUTER)
         ptr += add_property (ptr, "Identity", options.identity, options.identity_size);
 
+    //  Add compression property
+    if (options.compression_threshold >= 0)
+        ptr += add_property (ptr, compression_property, "LZ4", 3);
+
+    //  Add gap notices property
+    if (options.type == ZMQ_SUB || options.type == ZMQ_XSUB)
+        ptr += add_property (ptr, gap_notices_property, "1", 1);
+
     const size_t command_size = ptr - command_buffer;
     const int rc = msg_->init_size (command_size);
     errno_assert (rc == 0);
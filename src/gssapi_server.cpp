@@ -113,6 +113,19 @@ int zmq::gssapi_server_t::process_handshake_command (msg_t *msg_)
     }
 
     if (security_context_established) {
+        //  Skip the request if the handler has recently accepted it.
+        gss_buffer_desc principal;
+        gss_display_name (&min_stat, target_name, &principal, NULL);
+        const std::string credentials (
+            static_cast <const char *> (principal.value), principal.length);
+        gss_release_buffer (&min_stat, &principal);
+        std::string status_code;
+        if (find_zap_reply (session, peer_address, "GSSAPI",
+                &credentials, 1, status_code)) {
+            state = send_ready;
+            return 0;
+        }
+
      	//  Use ZAP protocol (RFC 27) to authenticate the user.
         bool expecting_zap_reply = false;
         int rc = session->zap_connect ();
@@ -272,6 +285,8 @@ int zmq::gssapi_server_t::receive_and_process_zap_reply ()
     //  Process metadata frame
     rc = parse_metadata (static_cast <const unsigned char*> (msg [6].data ()),
                          msg [6].size (), true);
+    if (rc == 0)
+        cache_zap_reply (session, msg);
 
 error:
     for (int i = 0; i < 7; i++) {
@@ -44,6 +44,14 @@ namespace zmq
                             size_t &processed) = 0;
 
         virtual msg_t *msg () = 0;
+
+        //  Changes the size of the decoder's own buffer. May be called
+        //  only when all the data in the buffer have been decoded.
+        virtual void resize_buffer (size_t bufsize_) = 0;
+
+        //  Gives the decoder's own buffer back to the allocator. Same
+        //  restrictions apply as to resize_buffer.
+        virtual void release_buffer () = 0;
     };
 
 }
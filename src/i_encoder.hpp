@@ -43,6 +43,14 @@ namespace zmq
         //  Load a new message into encoder.
         virtual void load_msg (msg_t *msg_) = 0;
 
+        //  Changes the size of the encoder's own buffer. May be called
+        //  only when no data returned by encode are pending to be sent.
+        virtual void resize_buffer (size_t bufsize_) = 0;
+
+        //  Gives the encoder's own buffer back to the allocator. Same
+        //  restrictions apply as to resize_buffer.
+        virtual void release_buffer () = 0;
+
     };
 
 }
@@ -48,6 +48,13 @@ namespace zmq
         virtual void restart_output () = 0;
 
         virtual void zap_msg_available () = 0;
+
+        //  This method is called by the session when it is about to
+        //  terminate, for the engine to write out the messages it has
+        //  already taken from the pipe. Returns false if there is nothing
+        //  left to write. Otherwise the engine calls the session's
+        //  engine_flushed once done, or engine_error if it can't be done.
+        virtual bool flush () = 0;
     };
 
 }
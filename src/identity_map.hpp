@@ -0,0 +1,379 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_IDENTITY_MAP_HPP_INCLUDED__
+#define __ZMQ_IDENTITY_MAP_HPP_INCLUDED__
+
+#include <new>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stdint.hpp"
+#include "blob.hpp"
+#include "wire.hpp"
+#include "err.hpp"
+#include "random.hpp"
+
+namespace zmq
+{
+
+    //  Hash table mapping peer identities to values, for the sockets that
+    //  route messages by identity. Lookups take the identity as raw bytes,
+    //  so routing a message needs no allocation, and identities of up to
+    //  inline_size bytes are stored in the table itself. The 5-byte
+    //  identities the sockets generate, a zero byte followed by a 32-bit
+    //  counter, are inserted as such and hashed and compared as the
+    //  counter alone. All other identities, including peers' ones that
+    //  merely look generated, are hashed with SipHash under a key of each
+    //  table's own, which keeps peers from picking identities that all
+    //  land in the same slots.
+    //  Inserting may move the values, so pointers returned by find are
+    //  valid only until the next insertion.
+
+    template <typename T> class identity_map_t
+    {
+    public:
+
+        inline identity_map_t () :
+            slots (NULL),
+            capacity (0),
+            count (0),
+            used (0)
+        {
+            for (int i = 0; i != 2; i++)
+                key [i] = (uint64_t) generate_random () << 32
+                        | generate_random ();
+        }
+
+        inline ~identity_map_t ()
+        {
+            for (size_t i = 0; i != capacity; i++)
+                if (slots [i].state == full_slot)
+                    free (slots [i].large_key);
+            delete [] slots;
+        }
+
+        inline bool empty () const
+        {
+            return count == 0;
+        }
+
+        inline size_t size () const
+        {
+            return count;
+        }
+
+        //  Returns the value stored for the identity, NULL if there is none.
+        inline T *find (const unsigned char *data_, size_t size_)
+        {
+            if (count == 0)
+                return NULL;
+            const size_t index = locate (data_, size_);
+            return index == capacity ? NULL : &slots [index].value;
+        }
+
+        inline T *find (const blob_t &identity_)
+        {
+            return find (identity_.data (), identity_.size ());
+        }
+
+        //  Stores the value for the identity. Returns false if there is
+        //  a value for it already. Set generated_ only for identities the
+        //  socket made up itself.
+        inline bool insert (const unsigned char *data_, size_t size_,
+            const T &value_, bool generated_ = false)
+        {
+            zmq_assert (!generated_ || is_generated (data_, size_));
+
+            //  Keep at least a quarter of the slots empty, so that probe
+            //  sequences stay short. Reclaim the removed slots if they
+            //  are what takes the room.
+            if ((used + 1) * 4 > capacity * 3) {
+                size_t new_capacity = capacity;
+                if (new_capacity < min_capacity)
+                    new_capacity = min_capacity;
+                else
+                if ((count + 1) * 2 > capacity)
+                    new_capacity *= 2;
+                rehash (new_capacity);
+            }
+
+            if (count != 0 && locate (data_, size_) != capacity)
+                return false;
+            const uint32_t hash = generated_
+                ? generated_hash (data_) : keyed_hash (data_, size_);
+
+            size_t index = hash & (capacity - 1);
+            while (slots [index].state == full_slot)
+                index = (index + 1) & (capacity - 1);
+
+            slot_t &slot = slots [index];
+            if (slot.state == empty_slot)
+                used++;
+            slot.state = full_slot;
+            slot.generated = generated_;
+            slot.hash = hash;
+            slot.size = static_cast <uint32_t> (size_);
+            if (size_ > inline_size) {
+                slot.large_key = static_cast <unsigned char *> (malloc (size_));
+                alloc_assert (slot.large_key);
+                memcpy (slot.large_key, data_, size_);
+            }
+            else {
+                slot.large_key = NULL;
+                memcpy (slot.key, data_, size_);
+            }
+            slot.value = value_;
+            count++;
+            return true;
+        }
+
+        inline bool insert (const blob_t &identity_, const T &value_,
+            bool generated_ = false)
+        {
+            return insert (identity_.data (), identity_.size (), value_,
+                generated_);
+        }
+
+        //  Removes the identity. Returns false if it is not there.
+        inline bool erase (const unsigned char *data_, size_t size_)
+        {
+            if (count == 0)
+                return false;
+            const size_t index = locate (data_, size_);
+            if (index == capacity)
+                return false;
+
+            //  The slot is left marked as removed, as probe sequences of
+            //  other identities may run through it.
+            slot_t &slot = slots [index];
+            free (slot.large_key);
+            slot.large_key = NULL;
+            slot.state = removed_slot;
+            count--;
+            return true;
+        }
+
+        inline bool erase (const blob_t &identity_)
+        {
+            return erase (identity_.data (), identity_.size ());
+        }
+
+    private:
+
+        enum {
+            //  Longest identity stored within the table. Covers generated
+            //  identities as well as UUIDs.
+            inline_size = 16,
+
+            //  Number of slots of a table that isn't empty. Always a power
+            //  of two.
+            min_capacity = 16
+        };
+
+        enum slot_state_t {
+            empty_slot,
+            full_slot,
+            removed_slot
+        };
+
+        struct slot_t
+        {
+            inline slot_t () :
+                state (empty_slot),
+                generated (false),
+                large_key (NULL)
+            {
+            }
+
+            unsigned char state;
+
+            //  True if the identity was inserted as a generated one.
+            bool generated;
+
+            uint32_t hash;
+            uint32_t size;
+            unsigned char key [inline_size];
+            unsigned char *large_key;
+            T value;
+        };
+
+        static inline bool is_generated (const unsigned char *data_,
+            size_t size_)
+        {
+            return size_ == 5 && data_ [0] == 0;
+        }
+
+        inline uint32_t generated_hash (const unsigned char *data_) const
+        {
+            //  Mixing in the key and multiplying by an odd number maps
+            //  distinct counters to distinct hashes, and consecutive
+            //  counters to different slots.
+            return (get_uint32 (data_ + 1) ^ (uint32_t) key [0])
+                * 2654435761u;
+        }
+
+        inline uint32_t keyed_hash (const unsigned char *data_,
+            size_t size_) const
+        {
+            const uint64_t hash = siphash (data_, size_);
+            return (uint32_t) (hash ^ (hash >> 32));
+        }
+
+        static inline uint64_t rotl (uint64_t x_, int bits_)
+        {
+            return (x_ << bits_) | (x_ >> (64 - bits_));
+        }
+
+        static inline void sipround (uint64_t *v_)
+        {
+            v_ [0] += v_ [1];
+            v_ [1] = rotl (v_ [1], 13);
+            v_ [1] ^= v_ [0];
+            v_ [0] = rotl (v_ [0], 32);
+            v_ [2] += v_ [3];
+            v_ [3] = rotl (v_ [3], 16);
+            v_ [3] ^= v_ [2];
+            v_ [0] += v_ [3];
+            v_ [3] = rotl (v_ [3], 21);
+            v_ [3] ^= v_ [0];
+            v_ [2] += v_ [1];
+            v_ [1] = rotl (v_ [1], 17);
+            v_ [1] ^= v_ [2];
+            v_ [2] = rotl (v_ [2], 32);
+        }
+
+        //  SipHash-2-4 of the identity under the table's key.
+        inline uint64_t siphash (const unsigned char *data_,
+            size_t size_) const
+        {
+            uint64_t v [4];
+            v [0] = key [0] ^ ((uint64_t) 0x736f6d65 << 32 | 0x70736575);
+            v [1] = key [1] ^ ((uint64_t) 0x646f7261 << 32 | 0x6e646f6d);
+            v [2] = key [0] ^ ((uint64_t) 0x6c796765 << 32 | 0x6e657261);
+            v [3] = key [1] ^ ((uint64_t) 0x74656462 << 32 | 0x79746573);
+
+            //  Words are read little-endian; the last one carries the
+            //  remaining bytes and the length.
+            const size_t words = size_ / 8;
+            for (size_t i = 0; i <= words; i++) {
+                uint64_t m = 0;
+                if (i != words)
+                    for (int j = 0; j != 8; j++)
+                        m |= (uint64_t) data_ [i * 8 + j] << (j * 8);
+                else {
+                    for (size_t j = 0; j != size_ % 8; j++)
+                        m |= (uint64_t) data_ [i * 8 + j] << (j * 8);
+                    m |= (uint64_t) size_ << 56;
+                }
+                v [3] ^= m;
+                sipround (v);
+                sipround (v);
+                v [0] ^= m;
+            }
+
+            v [2] ^= 0xff;
+            for (int i = 0; i != 4; i++)
+                sipround (v);
+            return v [0] ^ v [1] ^ v [2] ^ v [3];
+        }
+
+        //  Returns the index of the identity's slot, capacity if it is
+        //  not there. Identities that look generated may have been
+        //  inserted either way.
+        inline size_t locate (const unsigned char *data_, size_t size_) const
+        {
+            if (is_generated (data_, size_)) {
+                const size_t index =
+                    lookup (data_, size_, generated_hash (data_), true);
+                if (index != capacity)
+                    return index;
+            }
+            return lookup (data_, size_, keyed_hash (data_, size_), false);
+        }
+
+        inline size_t lookup (const unsigned char *data_, size_t size_,
+            uint32_t hash_, bool generated_) const
+        {
+            size_t index = hash_ & (capacity - 1);
+            while (true) {
+                const slot_t &slot = slots [index];
+                if (slot.state == empty_slot)
+                    return capacity;
+                if (slot.state == full_slot
+                &&  slot.generated == generated_
+                &&  slot.hash == hash_
+                &&  slot.size == size_) {
+                    //  For generated identities the hash is the identity.
+                    if (generated_)
+                        return index;
+                    const unsigned char *key =
+                        slot.large_key ? slot.large_key : slot.key;
+                    if (memcmp (key, data_, size_) == 0)
+                        return index;
+                }
+                index = (index + 1) & (capacity - 1);
+            }
+        }
+
+        //  Moves the entries to a table of new_capacity_ slots, leaving
+        //  out the removed ones.
+        inline void rehash (size_t new_capacity_)
+        {
+            slot_t *new_slots = new (std::nothrow) slot_t [new_capacity_];
+            alloc_assert (new_slots);
+
+            for (size_t i = 0; i != capacity; i++) {
+                if (slots [i].state != full_slot)
+                    continue;
+                size_t index = slots [i].hash & (new_capacity_ - 1);
+                while (new_slots [index].state != empty_slot)
+                    index = (index + 1) & (new_capacity_ - 1);
+                new_slots [index] = slots [i];
+            }
+
+            delete [] slots;
+            slots = new_slots;
+            capacity = new_capacity_;
+            used = count;
+        }
+
+        slot_t *slots;
+
+        //  Number of slots, a power of two unless zero.
+        size_t capacity;
+
+        //  Number of identities stored.
+        size_t count;
+
+        //  Number of slots that are not empty, including the removed ones.
+        size_t used;
+
+        //  Random key the identities are hashed with.
+        uint64_t key [2];
+
+        identity_map_t (const identity_map_t&);
+        const identity_map_t &operator = (const identity_map_t&);
+    };
+
+}
+
+#endif
@@ -95,6 +95,11 @@ zmq::poller_t *zmq::io_thread_t::get_poller ()
     return poller;
 }
 
+zmq::batch_pool_t *zmq::io_thread_t::get_batch_pool ()
+{
+    return &batch_pool;
+}
+
 void zmq::io_thread_t::process_stop ()
 {
     poller->rm_fd (mailbox_handle);
@@ -27,6 +27,7 @@
 #include "poller.hpp"
 #include "i_poll_events.hpp"
 #include "mailbox.hpp"
+#include "batch_pool.hpp"
 
 namespace zmq
 {
@@ -63,6 +64,9 @@ namespace zmq
         //  Used by io_objects to retrieve the assciated poller object.
         poller_t *get_poller ();
 
+        //  Used by engines to get the pool to take batch buffers from.
+        batch_pool_t *get_batch_pool ();
+
         //  Command handlers.
         void process_stop ();
 
@@ -80,6 +84,9 @@ namespace zmq
         //  I/O multiplexing is performed using a poller object.
         poller_t *poller;
 
+        //  Batch buffers released by the engines of this thread.
+        batch_pool_t batch_pool;
+
         io_thread_t (const io_thread_t&);
         const io_thread_t &operator = (const io_thread_t&);
     };
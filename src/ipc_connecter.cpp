@@ -25,6 +25,7 @@
 #include <string>
 
 #include "stream_engine.hpp"
+#include "shm_engine.hpp"
 #include "io_thread.hpp"
 #include "platform.hpp"
 #include "random.hpp"
@@ -40,7 +41,7 @@
 #include <sys/un.h>
 
 zmq::ipc_connecter_t::ipc_connecter_t (class io_thread_t *io_thread_,
-      class session_base_t *session_, const options_t &options_,
+      class session_base_t *session_, const shared_options_t &options_,
       const address_t *addr_, bool delayed_start_) :
     own_t (io_thread_, options_),
     io_object_t (io_thread_),
@@ -53,7 +54,7 @@ zmq::ipc_connecter_t::ipc_connecter_t (class io_thread_t *io_thread_,
     current_reconnect_ivl(options.reconnect_ivl)
 {
     zmq_assert (addr);
-    zmq_assert (addr->protocol == "ipc");
+    zmq_assert (addr->protocol == "ipc" || addr->protocol == "shm");
     addr->to_string (endpoint);
     socket = session-> get_socket();
 }
@@ -112,8 +113,15 @@ void zmq::ipc_connecter_t::out_event ()
         return;
     }
     //  Create the engine object for this connection.
-    stream_engine_t *engine = new (std::nothrow)
-        stream_engine_t (fd, options, endpoint);
+    i_engine *engine;
+#if defined ZMQ_HAVE_SHM
+    if (addr->protocol == "shm")
+        engine = new (std::nothrow)
+            shm_engine_t (fd, false, shared_options, endpoint);
+    else
+#endif
+    engine = new (std::nothrow)
+        stream_engine_t (fd, shared_options, endpoint);
     alloc_assert (engine);
 
     //  Attach the engine to the corresponding session object.
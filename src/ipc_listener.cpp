@@ -26,6 +26,7 @@
 #include <string.h>
 
 #include "stream_engine.hpp"
+#include "shm_engine.hpp"
 #include "ipc_address.hpp"
 #include "io_thread.hpp"
 #include "session_base.hpp"
@@ -51,9 +52,10 @@
 #endif
 
 zmq::ipc_listener_t::ipc_listener_t (io_thread_t *io_thread_,
-      socket_base_t *socket_, const options_t &options_) :
+      socket_base_t *socket_, const shared_options_t &options_, bool shm_) :
     own_t (io_thread_, options_),
     io_object_t (io_thread_),
+    shm (shm_),
     has_file (false),
     s (retired_fd),
     socket (socket_)
@@ -91,8 +93,15 @@ void zmq::ipc_listener_t::in_event ()
     }
 
     //  Create the engine object for this connection.
-    stream_engine_t *engine = new (std::nothrow)
-        stream_engine_t (fd, options, endpoint);
+    i_engine *engine;
+#if defined ZMQ_HAVE_SHM
+    if (shm)
+        engine = new (std::nothrow)
+            shm_engine_t (fd, true, shared_options, endpoint);
+    else
+#endif
+    engine = new (std::nothrow)
+        stream_engine_t (fd, shared_options, endpoint);
     alloc_assert (engine);
 
     //  Choose I/O thread to run connecter in. Given that we are already
@@ -102,7 +111,7 @@ void zmq::ipc_listener_t::in_event ()
 
     //  Create and launch a session object. 
     session_base_t *session = session_base_t::create (io_thread, false, socket,
-        options, NULL);
+        shared_options, NULL);
     errno_assert (session);
     session->inc_seqnum ();
     launch_child (session);
@@ -125,7 +134,10 @@ int zmq::ipc_listener_t::get_address (std::string &addr_)
     }
 
     ipc_address_t addr ((struct sockaddr *) &ss, sl);
-    return addr.to_string (addr_);
+    rc = addr.to_string (addr_);
+    if (rc == 0 && shm)
+        addr_.replace (0, 3, "shm");
+    return rc;
 }
 
 int zmq::ipc_listener_t::set_address (const char *addr_)
@@ -160,6 +172,8 @@ int zmq::ipc_listener_t::set_address (const char *addr_)
         return -1;
 
     address.to_string (endpoint);
+    if (shm)
+        endpoint.replace (0, 3, "shm");
 
     //  Bind the socket to the file path.
     rc = bind (s, address.addr (), address.addrlen ());
@@ -41,8 +41,11 @@ namespace zmq
     {
     public:
 
+        //  If 'shm_' is true, the accepted connections are handed over to
+        //  the shm:// transport instead of carrying the messages themselves.
         ipc_listener_t (zmq::io_thread_t *io_thread_,
-            zmq::socket_base_t *socket_, const options_t &options_);
+            zmq::socket_base_t *socket_, const shared_options_t &options_,
+            bool shm_ = false);
         ~ipc_listener_t ();
 
         //  Set address to listen on.
@@ -74,6 +77,9 @@ namespace zmq
         //  if the connection was dropped while waiting in the listen backlog.
         fd_t accept ();
 
+        //  True iff this is a listener of the shm:// transport.
+        const bool shm;
+
         //  True, if the undelying file for UNIX domain socket exists.
         bool has_file;
 
@@ -0,0 +1,239 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "lz4_codec.hpp"
+#include "stdint.hpp"
+
+#include <string.h>
+
+namespace
+{
+    //  Matches are at least 'min_match' bytes long.
+    const size_t min_match = 4;
+
+    //  The last match has to start at least 'match_limit' bytes before
+    //  the end of the input and the last 'last_literals' bytes are always
+    //  literals, as decoders of the format expect.
+    const size_t match_limit = 12;
+    const size_t last_literals = 5;
+
+    //  Matches can refer at most 'max_offset' bytes back.
+    const size_t max_offset = 65535;
+
+    //  The compressor finds matches using a hash table of the positions
+    //  of 4-byte sequences with 2^hash_log entries.
+    const int hash_log = 12;
+
+    inline uint32_t read_uint32 (const unsigned char *ptr_)
+    {
+        uint32_t value;
+        memcpy (&value, ptr_, sizeof value);
+        return value;
+    }
+
+    inline uint32_t hash (uint32_t sequence_)
+    {
+        return (sequence_ * 2654435761U) >> (32 - hash_log);
+    }
+
+    inline unsigned char *put_length (unsigned char *op_, size_t length_)
+    {
+        while (length_ >= 255) {
+            *op_++ = 255;
+            length_ -= 255;
+        }
+        *op_++ = static_cast <unsigned char> (length_);
+        return op_;
+    }
+
+    inline int get_length (const unsigned char *&ip_,
+        const unsigned char *ip_end_, size_t &length_)
+    {
+        unsigned char byte;
+        do {
+            if (ip_ == ip_end_)
+                return -1;
+            byte = *ip_++;
+            length_ += byte;
+        } while (byte == 255);
+        return 0;
+    }
+
+    //  Writes a sequence of 'literals_' literal bytes, followed by a match
+    //  of 'match_length_' bytes at 'offset_' bytes back, unless
+    //  'match_length_' is zero. Returns NULL if the sequence does not fit
+    //  into the output buffer.
+    unsigned char *put_sequence (unsigned char *op_, unsigned char *op_end_,
+        const unsigned char *literals_, size_t literal_count_,
+        size_t offset_, size_t match_length_)
+    {
+        const size_t needed = 1 + literal_count_ / 255 + 1 + literal_count_ +
+            (match_length_ ? 2 + match_length_ / 255 + 1 : 0);
+        if (needed > static_cast <size_t> (op_end_ - op_))
+            return NULL;
+
+        unsigned char *token = op_++;
+        if (literal_count_ >= 15) {
+            *token = 15 << 4;
+            op_ = put_length (op_, literal_count_ - 15);
+        }
+        else
+            *token = static_cast <unsigned char> (literal_count_ << 4);
+        memcpy (op_, literals_, literal_count_);
+        op_ += literal_count_;
+
+        if (match_length_) {
+            *op_++ = static_cast <unsigned char> (offset_ & 0xff);
+            *op_++ = static_cast <unsigned char> (offset_ >> 8);
+            const size_t length = match_length_ - min_match;
+            if (length >= 15) {
+                *token |= 15;
+                op_ = put_length (op_, length - 15);
+            }
+            else
+                *token |= static_cast <unsigned char> (length);
+        }
+        return op_;
+    }
+}
+
+size_t zmq::lz4_compress_bound (size_t size_)
+{
+    return size_ + size_ / 255 + 16;
+}
+
+size_t zmq::lz4_decompress_bound (size_t size_)
+{
+    //  Each byte of a match length adds at most 255 bytes of output.
+    const size_t max = ((size_t) -1 - 16) / 255;
+    return size_ > max ? (size_t) -1 : size_ * 255 + 16;
+}
+
+size_t zmq::lz4_compress (const unsigned char *src_, size_t size_,
+    unsigned char *dst_, size_t capacity_)
+{
+    const unsigned char *const end = src_ + size_;
+    const unsigned char *anchor = src_;
+    unsigned char *op = dst_;
+    unsigned char *const op_end = dst_ + capacity_;
+
+    if (size_ > match_limit) {
+        uint32_t table [1 << hash_log];
+        memset (table, 0, sizeof table);
+
+        const unsigned char *const limit = end - match_limit;
+        const unsigned char *ip = src_ + 1;
+
+        //  The longer no match is found, the larger steps the search takes,
+        //  so that incompressible data is skipped quickly.
+        size_t attempts = 1 << 6;
+
+        while (ip < limit) {
+            const uint32_t sequence = read_uint32 (ip);
+            const uint32_t h = hash (sequence);
+            const unsigned char *ref = src_ + table [h];
+            table [h] = static_cast <uint32_t> (ip - src_);
+
+            if (ref >= ip || static_cast <size_t> (ip - ref) > max_offset ||
+                  read_uint32 (ref) != sequence) {
+                ip += attempts++ >> 6;
+                continue;
+            }
+            attempts = 1 << 6;
+
+            //  Extend the match backwards over the pending literals...
+            while (ip > anchor && ref > src_ && ip [-1] == ref [-1]) {
+                ip--;
+                ref--;
+            }
+
+            //  ... and forwards, leaving the last literals alone.
+            const unsigned char *match_end = ip + min_match;
+            const unsigned char *ref_end = ref + min_match;
+            while (match_end < end - last_literals && *match_end == *ref_end) {
+                match_end++;
+                ref_end++;
+            }
+
+            op = put_sequence (op, op_end, anchor, ip - anchor,
+                ip - ref, match_end - ip);
+            if (!op)
+                return 0;
+            ip = anchor = match_end;
+        }
+    }
+
+    //  The block ends with the remaining bytes as literals.
+    op = put_sequence (op, op_end, anchor, end - anchor, 0, 0);
+    if (!op)
+        return 0;
+    return op - dst_;
+}
+
+int zmq::lz4_decompress (const unsigned char *src_, size_t src_size_,
+    unsigned char *dst_, size_t size_)
+{
+    const unsigned char *ip = src_;
+    const unsigned char *const ip_end = src_ + src_size_;
+    unsigned char *op = dst_;
+    unsigned char *const op_end = dst_ + size_;
+
+    while (ip < ip_end) {
+        const unsigned char token = *ip++;
+
+        //  Copy the literals.
+        size_t length = token >> 4;
+        if (length == 15 && get_length (ip, ip_end, length) == -1)
+            return -1;
+        if (length > static_cast <size_t> (ip_end - ip) ||
+              length > static_cast <size_t> (op_end - op))
+            return -1;
+        memcpy (op, ip, length);
+        ip += length;
+        op += length;
+
+        //  The last sequence has no match.
+        if (ip == ip_end)
+            break;
+
+        //  Copy the match. It may overlap with the bytes it produces, in
+        //  which case it repeats the last 'offset' bytes.
+        if (ip_end - ip < 2)
+            return -1;
+        const size_t offset = ip [0] | (ip [1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast <size_t> (op - dst_))
+            return -1;
+        length = token & 0x0f;
+        if (length == 15 && get_length (ip, ip_end, length) == -1)
+            return -1;
+        length += min_match;
+        if (length > static_cast <size_t> (op_end - op))
+            return -1;
+        const unsigned char *ref = op - offset;
+        if (offset >= length)
+            memcpy (op, ref, length);
+        else
+            for (size_t i = 0; i != length; i++)
+                op [i] = ref [i];
+        op += length;
+    }
+
+    return op == op_end ? 0 : -1;
+}
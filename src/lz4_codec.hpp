@@ -0,0 +1,52 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_LZ4_CODEC_HPP_INCLUDED__
+#define __ZMQ_LZ4_CODEC_HPP_INCLUDED__
+
+#include <stddef.h>
+
+namespace zmq
+{
+
+    //  Bundled implementation of the LZ4 block format, used to compress
+    //  message frames on the wire (see ZMQ_COMPRESSION_THRESHOLD).
+
+    //  Returns the maximal size of the compressed form of 'size_' bytes.
+    size_t lz4_compress_bound (size_t size_);
+
+    //  Returns the maximal size 'size_' bytes of compressed data can
+    //  decompress to.
+    size_t lz4_decompress_bound (size_t size_);
+
+    //  Compresses 'size_' bytes at 'src_' into the buffer at 'dst_', which
+    //  has room for 'capacity_' bytes. Returns the size of the compressed
+    //  data or 0 if it does not fit into the buffer.
+    size_t lz4_compress (const unsigned char *src_, size_t size_,
+        unsigned char *dst_, size_t capacity_);
+
+    //  Decompresses the 'src_size_' bytes long block at 'src_' into exactly
+    //  'size_' bytes at 'dst_'. Returns 0 on success and -1 if the block
+    //  is malformed or does not decompress to 'size_' bytes.
+    int lz4_decompress (const unsigned char *src_, size_t src_size_,
+        unsigned char *dst_, size_t size_);
+
+}
+
+#endif
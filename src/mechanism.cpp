@@ -18,12 +18,16 @@
 */
 
 #include <string.h>
+#include <vector>
 
 #include "mechanism.hpp"
 #include "options.hpp"
 #include "msg.hpp"
 #include "err.hpp"
 #include "wire.hpp"
+#include "session_base.hpp"
+#include "ctx.hpp"
+#include "zap_cache.hpp"
 
 zmq::mechanism_t::mechanism_t (const options_t &options_) :
     options (options_)
@@ -34,6 +38,28 @@ zmq::mechanism_t::~mechanism_t ()
 {
 }
 
+int zmq::mechanism_t::encode_batch (msg_t *msgs_, size_t count_,
+    crypto_pool_t *)
+{
+    for (size_t i = 0; i != count_; i++)
+        if (encode (&msgs_ [i]) == -1)
+            return -1;
+    return 0;
+}
+
+int zmq::mechanism_t::decode_batch (msg_t *msgs_, size_t count_,
+    crypto_pool_t *)
+{
+    for (size_t i = 0; i != count_; i++)
+        if (decode (&msgs_ [i]) == -1)
+            return -1;
+    return 0;
+}
+
+const char zmq::mechanism_t::compression_property [] = "X-Compression";
+const char zmq::mechanism_t::fd_passing_property [] = "X-Fd-Passing";
+const char zmq::mechanism_t::gap_notices_property [] = "X-Gap-Notices";
+
 void zmq::mechanism_t::set_peer_identity (const void *id_ptr, size_t id_size)
 {
     identity = blob_t (static_cast <const unsigned char*> (id_ptr), id_size);
@@ -60,6 +86,27 @@ zmq::blob_t zmq::mechanism_t::get_user_id () const
     return user_id;
 }
 
+bool zmq::mechanism_t::peer_accepts_compression () const
+{
+    const metadata_t::dict_t::const_iterator it =
+        zmtp_properties.find (compression_property);
+    return it != zmtp_properties.end () && it->second == "LZ4";
+}
+
+bool zmq::mechanism_t::peer_accepts_fd_passing () const
+{
+    const metadata_t::dict_t::const_iterator it =
+        zmtp_properties.find (fd_passing_property);
+    return it != zmtp_properties.end () && it->second == "memfd";
+}
+
+bool zmq::mechanism_t::peer_accepts_gap_notices () const
+{
+    const metadata_t::dict_t::const_iterator it =
+        zmtp_properties.find (gap_notices_property);
+    return it != zmtp_properties.end () && it->second == "1";
+}
+
 const char *zmq::mechanism_t::socket_type_string (int socket_type) const
 {
     static const char *names [] = {"PAIR", "PUB", "SUB", "REQ", "REP",
@@ -182,3 +229,60 @@ bool zmq::mechanism_t::check_socket_type (const std::string& type_) const
     }
     return false;
 }
+
+bool zmq::mechanism_t::find_zap_reply (session_base_t *session_,
+    const std::string &peer_address_, const char *mechanism_,
+    const std::string *credentials_, size_t credentials_count_,
+    std::string &status_code_)
+{
+    zap_request.clear ();
+    zap_cache_t *cache = session_->get_ctx ()->get_zap_cache ();
+    if (!cache->enabled ())
+        return false;
+
+    std::vector <std::string> frames;
+    frames.push_back (options.zap_domain);
+    frames.push_back (peer_address_);
+    frames.push_back (std::string ((const char *) options.identity,
+        options.identity_size));
+    frames.push_back (mechanism_);
+    frames.insert (frames.end (), credentials_,
+        credentials_ + credentials_count_);
+
+    for (size_t i = 0; i != frames.size (); i++) {
+        unsigned char size [4];
+        put_uint32 (size, static_cast <uint32_t> (frames [i].size ()));
+        zap_request.append ((const char *) size, sizeof size);
+        zap_request.append (frames [i]);
+    }
+
+    zap_cache_t::reply_t reply;
+    if (!cache->get (zap_request, reply))
+        return false;
+
+    status_code_ = reply.status_code;
+    set_user_id (reply.user_id.data (), reply.user_id.size ());
+
+    //  The metadata parsed fine when the reply was cached.
+    const int rc = parse_metadata (
+        (const unsigned char *) reply.metadata.data (),
+        reply.metadata.size (), true);
+    zmq_assert (rc == 0);
+    return true;
+}
+
+void zmq::mechanism_t::cache_zap_reply (session_base_t *session_,
+    msg_t *reply_)
+{
+    if (zap_request.empty ())
+        return;
+
+    zap_cache_t::reply_t reply;
+    reply.status_code.assign (
+        static_cast <const char *> (reply_ [3].data ()), reply_ [3].size ());
+    reply.user_id.assign (
+        static_cast <const char *> (reply_ [5].data ()), reply_ [5].size ());
+    reply.metadata.assign (
+        static_cast <const char *> (reply_ [6].data ()), reply_ [6].size ());
+    session_->get_ctx ()->get_zap_cache ()->put (zap_request, reply);
+}
@@ -32,6 +32,8 @@ namespace zmq
     //  Different mechanism extedns this class.
 
     class msg_t;
+    class crypto_pool_t;
+    class session_base_t;
 
     class mechanism_t
     {
@@ -57,6 +59,17 @@ namespace zmq
 
         virtual int decode (msg_t *) { return 0; }
 
+        //  Encode and decode count_ messages in one go. If pool_ is not
+        //  NULL, the messages may be processed in parallel by its threads.
+        //  Return -1 if any of the messages failed.
+        virtual int encode_batch (msg_t *msgs_, size_t count_,
+            crypto_pool_t *pool_);
+        virtual int decode_batch (msg_t *msgs_, size_t count_,
+            crypto_pool_t *pool_);
+
+        //  Returns true iff the batches are worth processing in parallel.
+        virtual bool parallel_codec () const { return false; }
+
         //  Notifies mechanism about availability of ZAP message.
         virtual int zap_msg_available () { return 0; }
 
@@ -79,6 +92,18 @@ namespace zmq
             return zap_properties;
         }
 
+        //  Returns true iff the peer offered LZ4 compression of message
+        //  frames in its handshake metadata.
+        bool peer_accepts_compression () const;
+
+        //  Returns true iff the peer offered to accept large messages
+        //  as memfds in its handshake metadata.
+        bool peer_accepts_fd_passing () const;
+
+        //  Returns true iff the peer offered to accept notices of the
+        //  messages dropped on the way to it in its handshake metadata.
+        bool peer_accepts_gap_notices () const;
+
     protected:
 
         //  Only used to identify the socket for the Socket-Type
@@ -88,6 +113,21 @@ namespace zmq
         size_t add_property (unsigned char *ptr, const char *name,
             const void *value, size_t value_len) const;
 
+        //  Name of the property offering compression of message frames
+        //  (ZMQ_COMPRESSION_THRESHOLD). Its value names the codec.
+        static const char compression_property [];
+
+        //  Name of the property offering to accept messages as file
+        //  descriptors (ZMQ_IPC_FD_THRESHOLD). Its value names the kind.
+        //  Only the mechanisms without encryption offer it, as the
+        //  contents of passed memfds would bypass the encryption.
+        static const char fd_passing_property [];
+
+        //  Name of the property subscribers offer to accept GAP commands
+        //  with, telling them how many messages the publisher dropped
+        //  (ZMQ_XPUB_SEQUENCE).
+        static const char gap_notices_property [];
+
         //  Parses a metadata.
         //  Metadata consists of a list of properties consisting of
         //  name and value as size-specified strings.
@@ -105,13 +145,29 @@ namespace zmq
         virtual int property (const std::string& name_,
                               const void *value_, size_t length_);
 
+        //  Looks up the reply to the ZAP request with the given address,
+        //  mechanism and credentials frames in the context's cache
+        //  (ZMQ_ZAP_CACHE_TTL). If there is one, takes over its user id
+        //  and metadata, stores its status code in status_code_ and
+        //  returns true; the mechanism then skips the ZAP request.
+        bool find_zap_reply (session_base_t *session_,
+            const std::string &peer_address_, const char *mechanism_,
+            const std::string *credentials_, size_t credentials_count_,
+            std::string &status_code_);
+
+        //  Caches the 7-frame ZAP reply to the request last looked up
+        //  with find_zap_reply.
+        void cache_zap_reply (session_base_t *session_, msg_t *reply_);
+
         //  Properties received from ZMTP peer.
         metadata_t::dict_t zmtp_properties;
 
         //  Properties received from ZAP server.
         metadata_t::dict_t zap_properties;
 
-        options_t options;
+        //  Options of the socket. These are owned by the engine, which
+        //  outlives the mechanism.
+        const options_t &options;
 
     private:
 
@@ -119,6 +175,10 @@ namespace zmq
 
         blob_t user_id;
 
+        //  The frames of the ZAP request last looked up in the cache,
+        //  each prefixed by its size. Empty if replies aren't cached.
+        std::string zap_request;
+
         //  Returns true iff socket associated with the mechanism
         //  is compatible with a given socket type 'type_'.
         bool check_socket_type (const std::string& type_) const;
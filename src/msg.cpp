@@ -45,6 +45,7 @@ int zmq::msg_t::init ()
     u.vsm.metadata = NULL;
     u.vsm.type = type_vsm;
     u.vsm.flags = 0;
+    u.vsm.group [0] = '\0';
     u.vsm.size = 0;
     file_desc = -1;
     return 0;
@@ -57,12 +58,14 @@ int zmq::msg_t::init_size (size_t size_)
         u.vsm.metadata = NULL;
         u.vsm.type = type_vsm;
         u.vsm.flags = 0;
+        u.vsm.group [0] = '\0';
         u.vsm.size = (unsigned char) size_;
     }
     else {
         u.lmsg.metadata = NULL;
         u.lmsg.type = type_lmsg;
         u.lmsg.flags = 0;
+        u.lmsg.group [0] = '\0';
         u.lmsg.content =
             (content_t*) malloc (sizeof (content_t) + size_);
         if (unlikely (!u.lmsg.content)) {
@@ -93,6 +96,7 @@ int zmq::msg_t::init_data (void *data_, size_t size_, msg_free_fn *ffn_,
         u.cmsg.metadata = NULL;
         u.cmsg.type = type_cmsg;
         u.cmsg.flags = 0;
+        u.cmsg.group [0] = '\0';
         u.cmsg.data = data_;
         u.cmsg.size = size_;
     }
@@ -100,6 +104,7 @@ int zmq::msg_t::init_data (void *data_, size_t size_, msg_free_fn *ffn_,
         u.lmsg.metadata = NULL;
         u.lmsg.type = type_lmsg;
         u.lmsg.flags = 0;
+        u.lmsg.group [0] = '\0';
         u.lmsg.content = (content_t*) malloc (sizeof (content_t));
         if (!u.lmsg.content) {
             errno = ENOMEM;
@@ -121,6 +126,7 @@ int zmq::msg_t::init_delimiter ()
     u.delimiter.metadata = NULL;
     u.delimiter.type = type_delimiter;
     u.delimiter.flags = 0;
+    u.delimiter.group [0] = '\0';
     return 0;
 }
 
@@ -250,6 +256,27 @@ size_t zmq::msg_t::size ()
     }
 }
 
+void zmq::msg_t::shrink (size_t new_size_)
+{
+    //  Check the validity of the message.
+    zmq_assert (check ());
+    zmq_assert (new_size_ <= size ());
+
+    switch (u.base.type) {
+    case type_vsm:
+        u.vsm.size = (unsigned char) new_size_;
+        break;
+    case type_lmsg:
+        u.lmsg.content->size = new_size_;
+        break;
+    case type_cmsg:
+        u.cmsg.size = new_size_;
+        break;
+    default:
+        zmq_assert (false);
+    }
+}
+
 unsigned char zmq::msg_t::flags ()
 {
     return u.base.flags;
@@ -322,6 +349,29 @@ bool zmq::msg_t::is_cmsg ()
     return u.base.type == type_cmsg;
 }
 
+const char *zmq::msg_t::group ()
+{
+    return u.base.group;
+}
+
+int zmq::msg_t::set_group (const char *group_)
+{
+    return set_group (group_, strlen (group_));
+}
+
+int zmq::msg_t::set_group (const char *group_, size_t length_)
+{
+    if (length_ > ZMQ_GROUP_MAX_LENGTH) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memcpy (u.base.group, group_, length_);
+    u.base.group [length_] = '\0';
+
+    return 0;
+}
+
 void zmq::msg_t::add_refs (int refs_)
 {
     zmq_assert (refs_ >= 0);
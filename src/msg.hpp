@@ -23,6 +23,7 @@
 #include <stddef.h>
 #include <stdio.h>
 
+#include "../include/zmq.h"
 #include "config.hpp"
 #include "atomic_counter.hpp"
 #include "metadata.hpp"
@@ -50,6 +51,8 @@ namespace zmq
         {
             more = 1,           //  Followed by more parts
             command = 2,        //  Command frame (see ZMTP spec)
+            compressed = 4,     //  Body is compressed (ZMQ_COMPRESSION_THRESHOLD)
+            passed_fd = 8,      //  Body is passed as a memfd (ZMQ_IPC_FD_THRESHOLD)
             credential = 32,
             identity = 64,
             shared = 128
@@ -66,6 +69,9 @@ namespace zmq
         int copy (msg_t &src_);
         void *data ();
         size_t size ();
+        //  Reduces the size of a message that has not been sent or
+        //  shared yet to 'new_size_' bytes.
+        void shrink (size_t new_size_);
         unsigned char flags ();
         void set_flags (unsigned char flags_);
         void reset_flags (unsigned char flags_);
@@ -79,6 +85,9 @@ namespace zmq
         bool is_delimiter () const;
         bool is_vsm ();
         bool is_cmsg ();
+        const char *group ();
+        int set_group (const char *group_);
+        int set_group (const char *group_, size_t length_);
 
         //  After calling this function you can copy the message in POD-style
         //  refs_ times. No need to call copy.
@@ -93,7 +102,12 @@ namespace zmq
         //  Size in bytes of the largest message that is still copied around
         //  rather than being reference-counted.
         enum { msg_t_size = 64 };
-        enum { max_vsm_size = msg_t_size - (8 + sizeof (metadata_t *) + 3) };
+
+        //  Room for the RADIO/DISH group of the message, including
+        //  the terminating zero.
+        enum { group_size = ZMQ_GROUP_MAX_LENGTH + 1 };
+        enum { max_vsm_size =
+            msg_t_size - (8 + sizeof (metadata_t *) + 3 + group_size) };
 
         //  Shared message buffer. Message data are either allocated in one
         //  continuous block along with this structure - thus avoiding one
@@ -136,13 +150,16 @@ namespace zmq
         union {
             struct {
                 metadata_t *metadata;
-                unsigned char unused [msg_t_size - (8 + sizeof (metadata_t *) + 2)];
+                unsigned char unused
+                    [msg_t_size - (8 + sizeof (metadata_t *) + group_size + 2)];
+                char group [group_size];
                 unsigned char type;
                 unsigned char flags;
             } base;
             struct {
                 metadata_t *metadata;
                 unsigned char data [max_vsm_size];
+                char group [group_size];
                 unsigned char size;
                 unsigned char type;
                 unsigned char flags;
@@ -150,7 +167,9 @@ namespace zmq
             struct {
                 metadata_t *metadata;
                 content_t *content;
-                unsigned char unused [msg_t_size - (8 + sizeof (metadata_t *) + sizeof (content_t*) + 2)];
+                unsigned char unused [msg_t_size - (8 + sizeof (metadata_t *) +
+                    sizeof (content_t*) + group_size + 2)];
+                char group [group_size];
                 unsigned char type;
                 unsigned char flags;
             } lmsg;
@@ -159,13 +178,17 @@ namespace zmq
                 void* data;
                 size_t size;
                 unsigned char unused
-                    [msg_t_size - (8 + sizeof (metadata_t *) + sizeof (void*) + sizeof (size_t) + 2)];
+                    [msg_t_size - (8 + sizeof (metadata_t *) + sizeof (void*) +
+                    sizeof (size_t) + group_size + 2)];
+                char group [group_size];
                 unsigned char type;
                 unsigned char flags;
             } cmsg;
             struct {
                 metadata_t *metadata;
-                unsigned char unused [msg_t_size - (8 + sizeof (metadata_t *) + 2)];
+                unsigned char unused
+                    [msg_t_size - (8 + sizeof (metadata_t *) + group_size + 2)];
+                char group [group_size];
                 unsigned char type;
                 unsigned char flags;
             } delimiter;
@@ -17,10 +17,13 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+
 #include <stdlib.h>
+#include <string.h>
 
 #include <new>
 #include <algorithm>
+#include <functional>
 
 #include "platform.hpp"
 #if defined ZMQ_HAVE_WINDOWS
@@ -32,399 +35,409 @@
 #include "mtrie.hpp"
 
 zmq::mtrie_t::mtrie_t () :
-    pipes (0),
-    min (0),
-    count (0),
-    live_nodes (0)
+    root (new_node (NULL, NULL, 0))
 {
 }
 
 zmq::mtrie_t::~mtrie_t ()
 {
-    if (pipes) {
-        delete pipes;
-        pipes = 0;
-    }
-
-    if (count == 1) {
-        zmq_assert (next.node);
-        delete next.node;
-        next.node = 0;
-    }
-    else 
-    if (count > 1) {
-        for (unsigned short i = 0; i != count; ++i)
-            delete next.table [i];
-        free (next.table);
-    }
+    delete_tree (root);
 }
 
 bool zmq::mtrie_t::add (unsigned char *prefix_, size_t size_, pipe_t *pipe_)
 {
-    return add_helper (prefix_, size_, pipe_);
-}
+    //  Find the node for the prefix, creating it if needed.
+    node_t *node = root;
+    size_t pos = 0;
+    while (pos < size_) {
+        node_t *child = find_child (node, prefix_ [pos]);
+        if (!child) {
+            child = new_node (node, prefix_ + pos, size_ - pos);
+            add_child (node, child);
+            node = child;
+            break;
+        }
 
-bool zmq::mtrie_t::add_helper (unsigned char *prefix_, size_t size_,
-    pipe_t *pipe_)
-{
-    //  We are at the node corresponding to the prefix. We are done.
-    if (!size_) {
-        bool result = !pipes;
-        if (!pipes) {
-            pipes = new (std::nothrow) pipes_t;
-            alloc_assert (pipes);
+        size_t common = 1;
+        const size_t max = std::min ((size_t) child->label_size, size_ - pos);
+        while (common < max && child->label [common] == prefix_ [pos + common])
+            common++;
+
+        //  The prefix branches off in the middle of the child's label.
+        //  Split the child in two.
+        if (common < child->label_size) {
+            node_t *middle = new_node (node, child->label, common);
+            replace_child (node, middle);
+            set_label (child, child->label + common,
+                child->label_size - common);
+            child->parent = middle;
+            add_child (middle, child);
+            child = middle;
         }
-        pipes->insert (pipe_);
-        return result;
+
+        node = child;
+        pos += common;
     }
 
-    unsigned char c = *prefix_;
-    if (c < min || c >= min + count) {
+    const bool result = node->pipe_count == 0;
 
-        //  The character is out of range of currently handled
-        //  charcters. We have to extend the table.
-        if (!count) {
-            min = c;
-            count = 1;
-            next.node = NULL;
-        }
-        else 
-        if (count == 1) {
-            unsigned char oldc = min;
-            mtrie_t *oldp = next.node;
-            count = (min < c ? c - min : min - c) + 1;
-            next.table = (mtrie_t**)
-                malloc (sizeof (mtrie_t*) * count);
-            alloc_assert (next.table);
-            for (unsigned short i = 0; i != count; ++i)
-                next.table [i] = 0;
-            min = std::min (min, c);
-            next.table [oldc - min] = oldp;
-        }
-        else 
-        if (min < c) {
-            //  The new character is above the current character range.
-            unsigned short old_count = count;
-            count = c - min + 1;
-            next.table = (mtrie_t**) realloc (next.table,
-                sizeof (mtrie_t*) * count);
-            alloc_assert (next.table);
-            for (unsigned short i = old_count; i != count; i++)
-                next.table [i] = NULL;
-        }
-        else {
-            //  The new character is below the current character range.
-            unsigned short old_count = count;
-            count = (min + old_count) - c;
-            next.table = (mtrie_t**) realloc (next.table,
-                sizeof (mtrie_t*) * count);
-            alloc_assert (next.table);
-            memmove (next.table + min - c, next.table,
-                old_count * sizeof (mtrie_t*));
-            for (unsigned short i = 0; i != min - c; i++)
-                next.table [i] = NULL;
-            min = c;
-        }
-    }
+    const size_t index = pipe_position (node, pipe_);
+    if (index < node->pipe_count && node->pipes [index].pipe == pipe_)
+        return result;
 
-    //  If next node does not exist, create one.
-    if (count == 1) {
-        if (!next.node) {
-            next.node = new (std::nothrow) mtrie_t;
-            alloc_assert (next.node);
-            ++live_nodes;
-        }
-        return next.node->add_helper (prefix_ + 1, size_ - 1, pipe_);
-    }
-    else {
-        if (!next.table [c - min]) {
-            next.table [c - min] = new (std::nothrow) mtrie_t;
-            alloc_assert (next.table [c - min]);
-            ++live_nodes;
-        }
-        return next.table [c - min]->add_helper (prefix_ + 1, size_ - 1, pipe_);
+    if (node->pipe_count == node->pipe_capacity) {
+        const uint32_t capacity = node->pipe_capacity * 2;
+        entry_t *pipes = (entry_t*) malloc (sizeof (entry_t) * capacity);
+        alloc_assert (pipes);
+        memcpy (pipes, node->pipes, sizeof (entry_t) * node->pipe_count);
+        if (node->pipes != &node->single_pipe)
+            free (node->pipes);
+        node->pipes = pipes;
+        node->pipe_capacity = capacity;
     }
-}
+    memmove (node->pipes + index + 1, node->pipes + index,
+        sizeof (entry_t) * (node->pipe_count - index));
+    node->pipe_count++;
+
+    std::vector <node_t*> &nodes = pipe_nodes [pipe_];
+    node->pipes [index].pipe = pipe_;
+    node->pipes [index].position = static_cast <uint32_t> (nodes.size ());
+    nodes.push_back (node);
 
+    return result;
+}
 
 void zmq::mtrie_t::rm (pipe_t *pipe_,
     void (*func_) (unsigned char *data_, size_t size_, void *arg_),
     void *arg_)
 {
+    const pipe_nodes_t::iterator it = pipe_nodes.find (pipe_);
+    if (it == pipe_nodes.end ())
+        return;
+    std::vector <node_t*> nodes;
+    nodes.swap (it->second);
+    pipe_nodes.erase (it);
+
     unsigned char *buff = NULL;
-    rm_helper (pipe_, &buff, 0, 0, func_, arg_);
+    size_t maxbuffsize = 0;
+
+    for (size_t i = 0; i != nodes.size (); i++) {
+        node_t *node = nodes [i];
+        const size_t index = pipe_position (node, pipe_);
+        zmq_assert (index < node->pipe_count
+            && node->pipes [index].pipe == pipe_);
+        remove_pipe (node, index);
+        if (node->pipe_count != 0)
+            continue;
+
+        //  Nobody is subscribed to the topic anymore. Spell it out from
+        //  the labels on the way to the root.
+        size_t size = 0;
+        for (node_t *n = node; n != root; n = n->parent)
+            size += n->label_size;
+        if (!buff || size > maxbuffsize) {
+            maxbuffsize = size + 256;
+            buff = (unsigned char*) realloc (buff, maxbuffsize);
+            alloc_assert (buff);
+        }
+        size_t pos = size;
+        for (node_t *n = node; n != root; n = n->parent) {
+            pos -= n->label_size;
+            memcpy (buff + pos, n->label, n->label_size);
+        }
+        func_ (buff, size, arg_);
+
+        //  The nodes still to visit have the pipe, so they stay.
+        prune (node);
+    }
+
     free (buff);
 }
 
-void zmq::mtrie_t::rm_helper (pipe_t *pipe_, unsigned char **buff_,
-    size_t buffsize_, size_t maxbuffsize_,
-    void (*func_) (unsigned char *data_, size_t size_, void *arg_),
-    void *arg_)
+bool zmq::mtrie_t::rm (unsigned char *prefix_, size_t size_, pipe_t *pipe_)
 {
-    //  Remove the subscription from this node.
-    if (pipes && pipes->erase (pipe_) && pipes->empty ()) {
-        func_ (*buff_, buffsize_, arg_);
-        delete pipes;
-        pipes = 0;
+    node_t *node = root;
+    size_t pos = 0;
+    while (pos < size_) {
+        node_t *child = find_child (node, prefix_ [pos]);
+        if (!child
+        ||  child->label_size > size_ - pos
+        ||  memcmp (child->label, prefix_ + pos, child->label_size) != 0)
+            return false;
+        node = child;
+        pos += child->label_size;
     }
 
-    //  Adjust the buffer.
-    if (buffsize_ >= maxbuffsize_) {
-        maxbuffsize_ = buffsize_ + 256;
-        *buff_ = (unsigned char*) realloc (*buff_, maxbuffsize_);
-        alloc_assert (*buff_);
-    }
+    const size_t index = pipe_position (node, pipe_);
+    if (index == node->pipe_count || node->pipes [index].pipe != pipe_)
+        return false;
 
-    //  If there are no subnodes in the trie, return.
-    if (count == 0)
-        return;
+    unlink (node, index);
+    const bool result = node->pipe_count == 0;
+    prune (node);
+    return result;
+}
 
-    //  If there's one subnode (optimisation).
-    if (count == 1) {
-        (*buff_) [buffsize_] = min;
-        buffsize_++;
-        next.node->rm_helper (pipe_, buff_, buffsize_, maxbuffsize_,
-            func_, arg_);
-
-        //  Prune the node if it was made redundant by the removal
-        if (next.node->is_redundant ()) {
-            delete next.node;
-            next.node = 0;
-            count = 0;
-            --live_nodes;
-            zmq_assert (live_nodes == 0);
-        }
-        return;
-    }
+void zmq::mtrie_t::match (unsigned char *data_, size_t size_,
+    void (*func_) (pipe_t *pipe_, void *arg_), void *arg_)
+{
+    const node_t *current = root;
+    while (true) {
 
-    //  If there are multiple subnodes.
-    //
-    //  New min non-null character in the node table after the removal
-    unsigned char new_min = min + count - 1;
-    //  New max non-null character in the node table after the removal
-    unsigned char new_max = min;
-    for (unsigned short c = 0; c != count; c++) {
-        (*buff_) [buffsize_] = min + c;
-        if (next.table [c]) {
-            next.table [c]->rm_helper (pipe_, buff_, buffsize_ + 1,
-                maxbuffsize_, func_, arg_);
-
-            //  Prune redundant nodes from the mtrie
-            if (next.table [c]->is_redundant ()) {
-                delete next.table [c];
-                next.table [c] = 0;
-
-                zmq_assert (live_nodes > 0);
-                --live_nodes;
-            }
-            else {
-                //  The node is not redundant, so it's a candidate for being
-                //  the new min/max node.
-                //
-                //  We loop through the node array from left to right, so the
-                //  first non-null, non-redundant node encountered is the new
-                //  minimum index. Conversely, the last non-redundant, non-null
-                //  node encountered is the new maximum index.
-                if (c + min < new_min)
-                    new_min = c + min;
-                if (c + min > new_max)
-                    new_max = c + min;
-            }
-        }
-    }
+        //  Signal the pipes attached to this node.
+        for (size_t i = 0; i != current->pipe_count; i++)
+            func_ (current->pipes [i].pipe, arg_);
 
-    zmq_assert (count > 1);
+        //  If we are at the end of the message, there's nothing more to match.
+        if (!size_)
+            break;
 
-    //  Free the node table if it's no longer used.
-    if (live_nodes == 0) {
-        free (next.table);
-        next.table = NULL;
-        count = 0;
-    }
-    //  Compact the node table if possible
-    else 
-    if (live_nodes == 1) {
-        //  If there's only one live node in the table we can
-        //  switch to using the more compact single-node
-        //  representation
-        zmq_assert (new_min == new_max);
-        zmq_assert (new_min >= min && new_min < min + count);
-        mtrie_t *node = next.table [new_min - min];
-        zmq_assert (node);
-        free (next.table);
-        next.node = node;
-        count = 1;
-        min = new_min;
+        //  Move on if the message goes on with the label of a child.
+        const node_t *child = find_child (const_cast <node_t*> (current),
+            data_ [0]);
+        if (!child
+        ||  child->label_size > size_
+        ||  memcmp (child->label, data_, child->label_size) != 0)
+            break;
+        current = child;
+        data_ += child->label_size;
+        size_ -= child->label_size;
     }
-    else
-    if (new_min > min || new_max < min + count - 1) {
-        zmq_assert (new_max - new_min + 1 > 1);
+}
 
-        mtrie_t **old_table = next.table;
-        zmq_assert (new_min > min || new_max < min + count - 1);
-        zmq_assert (new_min >= min);
-        zmq_assert (new_max <= min + count - 1);
-        zmq_assert (new_max - new_min + 1 < count);
+zmq::mtrie_t::node_t *zmq::mtrie_t::new_node (node_t *parent_,
+    const unsigned char *label_, size_t size_)
+{
+    node_t *node = new (std::nothrow) node_t;
+    alloc_assert (node);
+    node->parent = parent_;
+    node->label = node->inline_label;
+    node->label_size = 0;
+    node->children = NULL;
+    node->child_count = 0;
+    node->child_capacity = 0;
+    node->pipes = &node->single_pipe;
+    node->pipe_count = 0;
+    node->pipe_capacity = 1;
+    set_label (node, label_, size_);
+    return node;
+}
 
-        count = new_max - new_min + 1;
-        next.table = (mtrie_t**) malloc (sizeof (mtrie_t*) * count);
-        alloc_assert (next.table);
+void zmq::mtrie_t::delete_node (node_t *node_)
+{
+    if (node_->label != node_->inline_label)
+        free (node_->label);
+    if (node_->pipes != &node_->single_pipe)
+        free (node_->pipes);
+    free (node_->children);
+    delete node_;
+}
 
-        memmove (next.table, old_table + (new_min - min),
-                 sizeof (mtrie_t*) * count);
-        free (old_table);
+void zmq::mtrie_t::delete_tree (node_t *node_)
+{
+    for (unsigned short i = 0; i != node_->child_count; i++)
+        delete_tree (node_->children [i]);
+    delete_node (node_);
+}
 
-        min = new_min;
+void zmq::mtrie_t::set_label (node_t *node_, const unsigned char *label_,
+    size_t size_)
+{
+    //  The new label may be a part of the old one.
+    if (size_ <= inline_label_size) {
+        if (size_)
+            memmove (node_->inline_label, label_, size_);
+        if (node_->label != node_->inline_label)
+            free (node_->label);
+        node_->label = node_->inline_label;
+    }
+    else
+    if (node_->label != node_->inline_label && size_ <= node_->label_size)
+        memmove (node_->label, label_, size_);
+    else {
+        unsigned char *label = (unsigned char*) malloc (size_);
+        alloc_assert (label);
+        memcpy (label, label_, size_);
+        if (node_->label != node_->inline_label)
+            free (node_->label);
+        node_->label = label;
     }
+    node_->label_size = static_cast <uint32_t> (size_);
 }
 
-bool zmq::mtrie_t::rm (unsigned char *prefix_, size_t size_, pipe_t *pipe_)
+unsigned char *zmq::mtrie_t::child_bytes (node_t *node_)
 {
-    return rm_helper (prefix_, size_, pipe_);
+    return (unsigned char*) (node_->children + node_->child_capacity);
 }
 
-bool zmq::mtrie_t::rm_helper (unsigned char *prefix_, size_t size_,
-    pipe_t *pipe_)
+size_t zmq::mtrie_t::child_position (node_t *node_, unsigned char c_)
 {
-    if (!size_) {
-        if (pipes) {
-            pipes_t::size_type erased = pipes->erase (pipe_);
-            zmq_assert (erased == 1);
-            if (pipes->empty ()) {
-                delete pipes;
-                pipes = 0;
-            }
-        }
-        return !pipes;
+    const unsigned char *bytes = child_bytes (node_);
+    size_t low = 0;
+    size_t high = node_->child_count;
+    if (high <= linear_search_max) {
+        while (low < high && bytes [low] < c_)
+            low++;
+        return low;
     }
+    while (low < high) {
+        const size_t middle = (low + high) / 2;
+        if (bytes [middle] < c_)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
 
-    unsigned char c = *prefix_;
-    if (!count || c < min || c >= min + count)
-        return false;
-
-    mtrie_t *next_node =
-        count == 1 ? next.node : next.table [c - min];
-
-    if (!next_node)
-        return false;
-
-    bool ret = next_node->rm_helper (prefix_ + 1, size_ - 1, pipe_);
-
-    if (next_node->is_redundant ()) {
-        delete next_node;
-        zmq_assert (count > 0);
+zmq::mtrie_t::node_t *zmq::mtrie_t::find_child (node_t *node_,
+    unsigned char c_)
+{
+    const size_t pos = child_position (node_, c_);
+    if (pos < node_->child_count && child_bytes (node_) [pos] == c_)
+        return node_->children [pos];
+    return NULL;
+}
 
-        if (count == 1) {
-            next.node = 0;
-            count = 0;
-            --live_nodes;
-            zmq_assert (live_nodes == 0);
-        }
-        else {
-            next.table [c - min] = 0;
-            zmq_assert (live_nodes > 1);
-            --live_nodes;
-
-            //  Compact the table if possible
-            if (live_nodes == 1) {
-                //  If there's only one live node in the table we can
-                //  switch to using the more compact single-node
-                //  representation
-                unsigned short i;
-                for (i = 0; i < count; ++i)
-                    if (next.table [i])
-                        break;
-
-                zmq_assert (i < count);
-                min += i;
-                count = 1;
-                mtrie_t *oldp = next.table [i];
-                free (next.table);
-                next.node = oldp;
-            }
-            else
-            if (c == min) {
-                //  We can compact the table "from the left"
-                unsigned short i;
-                for (i = 1; i < count; ++i)
-                    if (next.table [i])
-                        break;
-
-                zmq_assert (i < count);
-                min += i;
-                count -= i;
-                mtrie_t **old_table = next.table;
-                next.table = (mtrie_t**) malloc (sizeof (mtrie_t*) * count);
-                alloc_assert (next.table);
-                memmove (next.table, old_table + i, sizeof (mtrie_t*) * count);
-                free (old_table);
-            }
-            else
-            if (c == min + count - 1) {
-                //  We can compact the table "from the right"
-                unsigned short i;
-                for (i = 1; i < count; ++i)
-                    if (next.table [count - 1 - i])
-                        break;
-
-                zmq_assert (i < count);
-                count -= i;
-                mtrie_t **old_table = next.table;
-                next.table = (mtrie_t**) malloc (sizeof (mtrie_t*) * count);
-                alloc_assert (next.table);
-                memmove (next.table, old_table, sizeof (mtrie_t*) * count);
-                free (old_table);
-            }
+void zmq::mtrie_t::add_child (node_t *node_, node_t *child_)
+{
+    const unsigned char c = child_->label [0];
+    const size_t pos = child_position (node_, c);
+
+    if (node_->child_count == node_->child_capacity) {
+        const unsigned short capacity = node_->child_capacity
+            ? std::min (node_->child_capacity * 2, 256) : 2;
+        node_t **children = (node_t**)
+            malloc ((sizeof (node_t*) + 1) * capacity);
+        alloc_assert (children);
+        if (node_->child_count) {
+            memcpy (children, node_->children,
+                sizeof (node_t*) * node_->child_count);
+            memcpy (children + capacity, child_bytes (node_),
+                node_->child_count);
         }
+        free (node_->children);
+        node_->children = children;
+        node_->child_capacity = capacity;
     }
 
-    return ret;
+    unsigned char *bytes = child_bytes (node_);
+    const size_t moved = node_->child_count - pos;
+    memmove (node_->children + pos + 1, node_->children + pos,
+        sizeof (node_t*) * moved);
+    memmove (bytes + pos + 1, bytes + pos, moved);
+    node_->children [pos] = child_;
+    bytes [pos] = c;
+    node_->child_count++;
 }
 
-void zmq::mtrie_t::match (unsigned char *data_, size_t size_,
-    void (*func_) (pipe_t *pipe_, void *arg_), void *arg_)
+void zmq::mtrie_t::replace_child (node_t *node_, node_t *child_)
 {
-    mtrie_t *current = this;
-    while (true) {
+    const size_t pos = child_position (node_, child_->label [0]);
+    zmq_assert (pos < node_->child_count
+        && child_bytes (node_) [pos] == child_->label [0]);
+    node_->children [pos] = child_;
+}
 
-        //  Signal the pipes attached to this node.
-        if (current->pipes) {
-            for (pipes_t::iterator it = current->pipes->begin ();
-                  it != current->pipes->end (); ++it)
-                func_ (*it, arg_);
-        }
+void zmq::mtrie_t::remove_child (node_t *node_, node_t *child_)
+{
+    const size_t pos = child_position (node_, child_->label [0]);
+    zmq_assert (pos < node_->child_count && node_->children [pos] == child_);
+
+    if (node_->child_count == 1) {
+        free (node_->children);
+        node_->children = NULL;
+        node_->child_count = 0;
+        node_->child_capacity = 0;
+        return;
+    }
 
-        //  If we are at the end of the message, there's nothing more to match.
-        if (!size_)
-            break;
+    unsigned char *bytes = child_bytes (node_);
+    const size_t moved = node_->child_count - pos - 1;
+    memmove (node_->children + pos, node_->children + pos + 1,
+        sizeof (node_t*) * moved);
+    memmove (bytes + pos, bytes + pos + 1, moved);
+    node_->child_count--;
+}
 
-        //  If there are no subnodes in the trie, return.
-        if (current->count == 0)
-            break;
+size_t zmq::mtrie_t::pipe_position (const node_t *node_,
+    const pipe_t *pipe_)
+{
+    std::less <const pipe_t*> less;
+    size_t low = 0;
+    size_t high = node_->pipe_count;
+    while (low < high) {
+        const size_t middle = (low + high) / 2;
+        if (less (node_->pipes [middle].pipe, pipe_))
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
 
-        //  If there's one subnode (optimisation).
-		if (current->count == 1) {
-            if (data_ [0] != current->min)
-                break;
-            current = current->next.node;
-            data_++;
-            size_--;
-		    continue;
-		}
-
-		//  If there are multiple subnodes.
-        if (data_ [0] < current->min || data_ [0] >=
-              current->min + current->count)
-            break;
-        if (!current->next.table [data_ [0] - current->min])
-            break;
-        current = current->next.table [data_ [0] - current->min];
-        data_++;
-        size_--;
+void zmq::mtrie_t::remove_pipe (node_t *node_, size_t index_)
+{
+    memmove (node_->pipes + index_, node_->pipes + index_ + 1,
+        sizeof (entry_t) * (node_->pipe_count - index_ - 1));
+    node_->pipe_count--;
+
+    if (node_->pipe_count == 0 && node_->pipes != &node_->single_pipe) {
+        free (node_->pipes);
+        node_->pipes = &node_->single_pipe;
+        node_->pipe_capacity = 1;
     }
 }
 
-bool zmq::mtrie_t::is_redundant () const
+void zmq::mtrie_t::unlink (node_t *node_, size_t index_)
 {
-    return !pipes && live_nodes == 0;
+    pipe_t *pipe = node_->pipes [index_].pipe;
+    const uint32_t position = node_->pipes [index_].position;
+
+    //  Fill the node's place in the pipe's list with the last node.
+    const pipe_nodes_t::iterator it = pipe_nodes.find (pipe);
+    zmq_assert (it != pipe_nodes.end ());
+    std::vector <node_t*> &nodes = it->second;
+    node_t *last = nodes.back ();
+    if (last != node_) {
+        nodes [position] = last;
+        last->pipes [pipe_position (last, pipe)].position = position;
+    }
+    nodes.pop_back ();
+    if (nodes.empty ())
+        pipe_nodes.erase (it);
+
+    remove_pipe (node_, index_);
+}
+
+void zmq::mtrie_t::prune (node_t *node_)
+{
+    while (node_ != root && node_->pipe_count == 0) {
+        node_t *parent = node_->parent;
+
+        if (node_->child_count == 0) {
+            remove_child (parent, node_);
+            delete_node (node_);
+            node_ = parent;
+            continue;
+        }
+
+        //  A node with a single child and no pipes doesn't branch. The
+        //  child takes its place, so that nodes with pipes never move.
+        if (node_->child_count == 1) {
+            node_t *child = node_->children [0];
+            const size_t size = node_->label_size + child->label_size;
+            unsigned char *label = (unsigned char*) malloc (size);
+            alloc_assert (label);
+            memcpy (label, node_->label, node_->label_size);
+            memcpy (label + node_->label_size, child->label,
+                child->label_size);
+            set_label (child, label, size);
+            free (label);
+            child->parent = parent;
+            replace_child (parent, child);
+            delete_node (node_);
+        }
+        break;
+    }
 }
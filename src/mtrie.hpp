@@ -21,7 +21,8 @@
 #define __ZMQ_MTRIE_HPP_INCLUDED__
 
 #include <stddef.h>
-#include <set>
+#include <map>
+#include <vector>
 
 #include "stdint.hpp"
 
@@ -30,7 +31,12 @@ namespace zmq
 
     class pipe_t;
 
-    //  Multi-trie. Each node in the trie is a set of pointers to pipes.
+    //  Multi-trie. Maps subscription prefixes to the sets of pipes
+    //  subscribed to them. The trie is path-compressed: a node stands
+    //  for a whole run of bytes no other subscription branches off from,
+    //  so there are at most two nodes per subscription. Each pipe keeps
+    //  the list of nodes it is subscribed at, so that removing a pipe
+    //  takes time proportional to its own subscriptions.
 
     class mtrie_t
     {
@@ -60,26 +66,84 @@ namespace zmq
 
     private:
 
-        bool add_helper (unsigned char *prefix_, size_t size_,
-            zmq::pipe_t *pipe_);
-        void rm_helper (zmq::pipe_t *pipe_, unsigned char **buff_,
-            size_t buffsize_, size_t maxbuffsize_,
-            void (*func_) (unsigned char *data_, size_t size_, void *arg_),
-            void *arg_);
-        bool rm_helper (unsigned char *prefix_, size_t size_,
-            zmq::pipe_t *pipe_);
-        bool is_redundant () const;
-
-        typedef std::set <zmq::pipe_t*> pipes_t;
-        pipes_t *pipes;
-
-        unsigned char min;
-        unsigned short count;
-        unsigned short live_nodes;
-        union {
-            class mtrie_t *node;
-            class mtrie_t **table;
-        } next;
+        //  A pipe subscribed at a node, along with the position of the
+        //  node in the pipe's list of nodes.
+        struct entry_t
+        {
+            zmq::pipe_t *pipe;
+            uint32_t position;
+        };
+
+        enum {
+            //  Labels up to this size are stored within the node.
+            inline_label_size = 16,
+
+            //  Nodes with more children than this find them by binary
+            //  rather than linear search.
+            linear_search_max = 8
+        };
+
+        //  The members match looks at come first, to share a cache line.
+        struct node_t
+        {
+            //  The bytes leading to this node from its parent.
+            unsigned char *label;
+
+            //  Children sorted by the first byte of their labels. The
+            //  array of child_capacity pointers is followed by the array
+            //  of those first bytes.
+            node_t **children;
+
+            //  Pipes subscribed to the node's prefix, sorted by address.
+            //  Points to single_pipe until there is more than one.
+            entry_t *pipes;
+
+            uint32_t label_size;
+            uint32_t pipe_count;
+            unsigned short child_count;
+            unsigned short child_capacity;
+            uint32_t pipe_capacity;
+
+            node_t *parent;
+            unsigned char inline_label [inline_label_size];
+            entry_t single_pipe;
+        };
+
+        static node_t *new_node (node_t *parent_,
+            const unsigned char *label_, size_t size_);
+        static void delete_node (node_t *node_);
+        static void delete_tree (node_t *node_);
+        static void set_label (node_t *node_,
+            const unsigned char *label_, size_t size_);
+
+        static unsigned char *child_bytes (node_t *node_);
+        static size_t child_position (node_t *node_, unsigned char c_);
+        static node_t *find_child (node_t *node_, unsigned char c_);
+        static void add_child (node_t *node_, node_t *child_);
+        static void replace_child (node_t *node_, node_t *child_);
+        static void remove_child (node_t *node_, node_t *child_);
+
+        //  Returns the index of the pipe in the node's array, or the index
+        //  it would be inserted at if it's not there.
+        static size_t pipe_position (const node_t *node_,
+            const zmq::pipe_t *pipe_);
+
+        //  Removes the pipe at the index from the node's array.
+        static void remove_pipe (node_t *node_, size_t index_);
+
+        //  Removes the pipe at the index from the node, and the node from
+        //  the pipe's list of nodes.
+        void unlink (node_t *node_, size_t index_);
+
+        //  Removes the node if it's not needed anymore, merging nodes
+        //  that no longer branch.
+        void prune (node_t *node_);
+
+        node_t *root;
+
+        //  For each pipe, the nodes it is subscribed at.
+        typedef std::map <zmq::pipe_t*, std::vector <node_t*> > pipe_nodes_t;
+        pipe_nodes_t pipe_nodes;
 
         mtrie_t (const mtrie_t&);
         const mtrie_t &operator = (const mtrie_t&);
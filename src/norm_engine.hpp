@@ -45,6 +45,7 @@ namespace zmq
             virtual void restart_output ();
 
             virtual void zap_msg_available () {};
+            virtual bool flush () { return false; }
             
             // i_poll_events interface implementation.
             // (we only need in_event() for NormEvent notification)
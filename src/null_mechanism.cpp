@@ -48,9 +48,18 @@ zmq::null_mechanism_t::null_mechanism_t (session_base_t *session_,
 {
     //  NULL mechanism only uses ZAP if there's a domain defined
     //  This prevents ZAP requests on naive sockets
-    if (options.zap_domain.size () > 0
-    &&  session->zap_connect () == 0)
-        zap_connected = true;
+    if (options.zap_domain.size () > 0) {
+        std::string cached_status_code;
+        if (find_zap_reply (session, peer_address, "NULL", NULL, 0,
+                cached_status_code)) {
+            memcpy (status_code, cached_status_code.data (),
+                sizeof status_code);
+            zap_reply_received = true;
+        }
+        else
+        if (session->zap_connect () == 0)
+            zap_connected = true;
+    }
 }
 
 zmq::null_mechanism_t::~null_mechanism_t ()
@@ -108,6 +117,18 @@ int zmq::null_mechanism_t::next_handshake_command (msg_t *msg_)
     ||  options.type == ZMQ_ROUTER)
         ptr += add_property (ptr, "Identity", options.identity, options.identity_size);
 
+    //  Add compression property
+    if (options.compression_threshold >= 0)
+        ptr += add_property (ptr, compression_property, "LZ4", 3);
+
+    //  Add gap notices property
+    if (options.type == ZMQ_SUB || options.type == ZMQ_XSUB)
+        ptr += add_property (ptr, gap_notices_property, "1", 1);
+
+    //  Add file descriptor passing property
+    if (options.ipc_fd_threshold >= 0)
+        ptr += add_property (ptr, fd_passing_property, "memfd", 5);
+
     const size_t command_size = ptr - command_buffer;
     const int rc = msg_->init_size (command_size);
     errno_assert (rc == 0);
@@ -337,6 +358,8 @@ int zmq::null_mechanism_t::receive_and_process_zap_reply ()
     //  Process metadata frame
     rc = parse_metadata (static_cast <const unsigned char*> (msg [6].data ()),
                          msg [6].size (), true);
+    if (rc == 0)
+        cache_zap_reply (session, msg);
 
 error:
     for (int i = 0; i < 7; i++) {
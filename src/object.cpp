@@ -131,6 +131,10 @@ void zmq::object_t::process_command (command_t &cmd_)
         process_seqnum ();
         break;
 
+    case command_t::resolved:
+        process_resolved (cmd_.args.resolved.request);
+        break;
+
     case command_t::done:
     default:
         zmq_assert (false);
@@ -175,9 +179,10 @@ void zmq::object_t::destroy_socket (socket_base_t *socket_)
     ctx->destroy_socket (socket_);
 }
 
-zmq::io_thread_t *zmq::object_t::choose_io_thread (uint64_t affinity_)
+zmq::io_thread_t *zmq::object_t::choose_io_thread (uint64_t affinity_,
+    const std::vector <io_thread_t*> *taken_)
 {
-    return ctx->choose_io_thread (affinity_);
+    return ctx->choose_io_thread (affinity_, taken_);
 }
 
 void zmq::object_t::send_stop ()
@@ -415,6 +420,11 @@ void zmq::object_t::process_reaped ()
     zmq_assert (false);
 }
 
+void zmq::object_t::process_resolved (resolve_request_t *)
+{
+    zmq_assert (false);
+}
+
 void zmq::object_t::process_seqnum ()
 {
     zmq_assert (false);
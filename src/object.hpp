@@ -21,6 +21,7 @@
 #define __ZMQ_OBJECT_HPP_INCLUDED__
 
 #include <string>
+#include <vector>
 #include "stdint.hpp"
 
 namespace zmq
@@ -36,6 +37,7 @@ namespace zmq
     class session_base_t;
     class io_thread_t;
     class own_t;
+    struct resolve_request_t;
 
     //  Base class for all objects that participate in inter-thread
     //  communication.
@@ -75,7 +77,8 @@ namespace zmq
         void log (const char *format_, ...);
 
         //  Chooses least loaded I/O thread.
-        zmq::io_thread_t *choose_io_thread (uint64_t affinity_);
+        zmq::io_thread_t *choose_io_thread (uint64_t affinity_,
+            const std::vector <zmq::io_thread_t*> *taken_ = NULL);
 
         //  Derived object can use these functions to send commands
         //  to other objects.
@@ -117,6 +120,7 @@ namespace zmq
         virtual void process_term_ack ();
         virtual void process_reap (zmq::socket_base_t *socket_);
         virtual void process_reaped ();
+        virtual void process_resolved (zmq::resolve_request_t *request_);
 
         //  Special handler called after a command that requires a seqnum
         //  was processed. The implementation should catch up with its counter
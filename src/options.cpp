@@ -18,8 +18,10 @@
 */
 
 #include <string.h>
+#include <new>
 
 #include "options.hpp"
+#include "config.hpp"
 #include "err.hpp"
 #include "../include/zmq_utils.h"
 
@@ -33,6 +35,16 @@ zmq::options_t::options_t () :
     multicast_hops (1),
     sndbuf (0),
     rcvbuf (0),
+    in_batch_size (zmq::in_batch_size),
+    out_batch_size (zmq::out_batch_size),
+    batch_adaptive (false),
+    snd_delay (0),
+    compression_threshold (-1),
+    heartbeat_interval (0),
+    heartbeat_timeout (-1),
+    heartbeat_ttl (0),
+    ipc_fd_threshold (-1),
+    connect_stripes (1),
     tos (0),
     type (-1),
     linger (-1),
@@ -53,9 +65,13 @@ zmq::options_t::options_t () :
     tcp_keepalive_cnt (-1),
     tcp_keepalive_idle (-1),
     tcp_keepalive_intvl (-1),
+    tcp_fastopen (false),
     mechanism (ZMQ_NULL),
     as_server (0),
+    curve_aead (true),
+    curve_ticket_ttl (0),
     gss_plaintext (false),
+    tls_verify (true),
     socket_id (0),
     conflate (false),
     handshake_ivl (30000)
@@ -130,6 +146,77 @@ int zmq::options_t::setsockopt (int option_, const void *optval_,
             }
             break;
 
+        case ZMQ_IN_BATCH_SIZE:
+            if (is_int && value > 0 && value <= max_batch_size) {
+                in_batch_size = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_OUT_BATCH_SIZE:
+            if (is_int && value > 0 && value <= max_batch_size) {
+                out_batch_size = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_BATCH_ADAPTIVE:
+            if (is_int && (value == 0 || value == 1)) {
+                batch_adaptive = (value != 0);
+                return 0;
+            }
+            break;
+
+        case ZMQ_SNDDELAY:
+            if (is_int && value >= 0) {
+                snd_delay = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_COMPRESSION_THRESHOLD:
+            if (is_int && value >= -1) {
+                compression_threshold = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_HEARTBEAT_IVL:
+            if (is_int && value >= 0) {
+                heartbeat_interval = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_HEARTBEAT_TTL:
+            //  The TTL travels in deciseconds in a 16-bit field.
+            if (is_int && value >= 0 && value <= 6553500) {
+                heartbeat_ttl = (uint16_t) (value / 100);
+                return 0;
+            }
+            break;
+
+        case ZMQ_HEARTBEAT_TIMEOUT:
+            if (is_int && value >= 0) {
+                heartbeat_timeout = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_IPC_FD_THRESHOLD:
+            if (is_int && value >= -1) {
+                ipc_fd_threshold = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_CONNECT_STRIPES:
+            if (is_int && value >= 1) {
+                connect_stripes = value;
+                return 0;
+            }
+            break;
+
         case ZMQ_TOS:
             if (is_int && value >= 0) {
                 tos = value;
@@ -250,6 +337,13 @@ int zmq::options_t::setsockopt (int option_, const void *optval_,
             }
             break;
 
+        case ZMQ_TCP_FASTOPEN:
+            if (is_int && (value == 0 || value == 1)) {
+                tcp_fastopen = (value != 0);
+                return 0;
+            }
+            break;
+
         case ZMQ_IMMEDIATE:
             if (is_int && (value == 0 || value == 1)) {
                 immediate = value;
@@ -450,6 +544,20 @@ int zmq::options_t::setsockopt (int option_, const void *optval_,
                 }
             }
             break;
+
+        case ZMQ_CURVE_AEAD:
+            if (is_int && (value == 0 || value == 1)) {
+                curve_aead = (value != 0);
+                return 0;
+            }
+            break;
+
+        case ZMQ_CURVE_TICKET_TTL:
+            if (is_int && value >= 0) {
+                curve_ticket_ttl = value;
+                return 0;
+            }
+            break;
 #       endif
 
         case ZMQ_CONFLATE:
@@ -494,6 +602,28 @@ int zmq::options_t::setsockopt (int option_, const void *optval_,
             break;
 #       endif
 
+        //  If OpenSSL isn't available, these options provoke EINVAL
+#       ifdef ZMQ_HAVE_TLS
+        case ZMQ_TLS_CERT:
+            tls_cert.assign ((const char *) optval_, optvallen_);
+            return 0;
+
+        case ZMQ_TLS_KEY:
+            tls_key.assign ((const char *) optval_, optvallen_);
+            return 0;
+
+        case ZMQ_TLS_CA:
+            tls_ca.assign ((const char *) optval_, optvallen_);
+            return 0;
+
+        case ZMQ_TLS_VERIFY:
+            if (is_int && (value == 0 || value == 1)) {
+                tls_verify = (value != 0);
+                return 0;
+            }
+            break;
+#       endif
+
         case ZMQ_HANDSHAKE_IVL:
             if (is_int && value >= 0) {
                 handshake_ivl = value;
@@ -595,6 +725,76 @@ int zmq::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
             }
             break;
 
+        case ZMQ_IN_BATCH_SIZE:
+            if (is_int) {
+                *value = in_batch_size;
+                return 0;
+            }
+            break;
+
+        case ZMQ_OUT_BATCH_SIZE:
+            if (is_int) {
+                *value = out_batch_size;
+                return 0;
+            }
+            break;
+
+        case ZMQ_BATCH_ADAPTIVE:
+            if (is_int) {
+                *value = batch_adaptive;
+                return 0;
+            }
+            break;
+
+        case ZMQ_SNDDELAY:
+            if (is_int) {
+                *value = snd_delay;
+                return 0;
+            }
+            break;
+
+        case ZMQ_COMPRESSION_THRESHOLD:
+            if (is_int) {
+                *value = compression_threshold;
+                return 0;
+            }
+            break;
+
+        case ZMQ_HEARTBEAT_IVL:
+            if (is_int) {
+                *value = heartbeat_interval;
+                return 0;
+            }
+            break;
+
+        case ZMQ_HEARTBEAT_TTL:
+            if (is_int) {
+                *value = heartbeat_ttl * 100;
+                return 0;
+            }
+            break;
+
+        case ZMQ_HEARTBEAT_TIMEOUT:
+            if (is_int) {
+                *value = heartbeat_timeout;
+                return 0;
+            }
+            break;
+
+        case ZMQ_IPC_FD_THRESHOLD:
+            if (is_int) {
+                *value = ipc_fd_threshold;
+                return 0;
+            }
+            break;
+
+        case ZMQ_CONNECT_STRIPES:
+            if (is_int) {
+                *value = connect_stripes;
+                return 0;
+            }
+            break;
+
         case ZMQ_TOS:
             if (is_int) {
                 *value = tos;
@@ -723,6 +923,13 @@ int zmq::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
             }
             break;
 
+        case ZMQ_TCP_FASTOPEN:
+            if (is_int) {
+                *value = tcp_fastopen;
+                return 0;
+            }
+            break;
+
         case ZMQ_MECHANISM:
             if (is_int) {
                 *value = mechanism;
@@ -805,6 +1012,20 @@ int zmq::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
                 return 0;
             }
             break;
+
+        case ZMQ_CURVE_AEAD:
+            if (is_int) {
+                *value = curve_aead;
+                return 0;
+            }
+            break;
+
+        case ZMQ_CURVE_TICKET_TTL:
+            if (is_int) {
+                *value = curve_ticket_ttl;
+                return 0;
+            }
+            break;
 #       endif
 
         case ZMQ_CONFLATE:
@@ -847,6 +1068,39 @@ int zmq::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
             break;
 #endif
 
+#if defined ZMQ_HAVE_TLS
+        case ZMQ_TLS_CERT:
+            if (*optvallen_ >= tls_cert.size () + 1) {
+                memcpy (optval_, tls_cert.c_str (), tls_cert.size () + 1);
+                *optvallen_ = tls_cert.size () + 1;
+                return 0;
+            }
+            break;
+
+        case ZMQ_TLS_KEY:
+            if (*optvallen_ >= tls_key.size () + 1) {
+                memcpy (optval_, tls_key.c_str (), tls_key.size () + 1);
+                *optvallen_ = tls_key.size () + 1;
+                return 0;
+            }
+            break;
+
+        case ZMQ_TLS_CA:
+            if (*optvallen_ >= tls_ca.size () + 1) {
+                memcpy (optval_, tls_ca.c_str (), tls_ca.size () + 1);
+                *optvallen_ = tls_ca.size () + 1;
+                return 0;
+            }
+            break;
+
+        case ZMQ_TLS_VERIFY:
+            if (is_int) {
+                *value = tls_verify;
+                return 0;
+            }
+            break;
+#endif
+
         case ZMQ_HANDSHAKE_IVL:
             if (is_int) {
                 *value = handshake_ivl;
@@ -874,3 +1128,60 @@ int zmq::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
     errno = EINVAL;
     return -1;
 }
+
+zmq::shared_options_t::snapshot_t::snapshot_t (const options_t &options_) :
+    options (options_),
+    ref_cnt (1)
+{
+}
+
+zmq::shared_options_t::shared_options_t () :
+    snapshot (NULL)
+{
+}
+
+zmq::shared_options_t::shared_options_t (const options_t &options_)
+{
+    snapshot = new (std::nothrow) snapshot_t (options_);
+    alloc_assert (snapshot);
+}
+
+zmq::shared_options_t::shared_options_t (const shared_options_t &other_) :
+    snapshot (other_.snapshot)
+{
+    if (snapshot)
+        snapshot->ref_cnt.add (1);
+}
+
+const zmq::shared_options_t &zmq::shared_options_t::operator = (
+    const shared_options_t &other_)
+{
+    if (other_.snapshot)
+        other_.snapshot->ref_cnt.add (1);
+    reset ();
+    snapshot = other_.snapshot;
+    return *this;
+}
+
+zmq::shared_options_t::~shared_options_t ()
+{
+    reset ();
+}
+
+const zmq::options_t &zmq::shared_options_t::get () const
+{
+    zmq_assert (snapshot);
+    return snapshot->options;
+}
+
+bool zmq::shared_options_t::empty () const
+{
+    return snapshot == NULL;
+}
+
+void zmq::shared_options_t::reset ()
+{
+    if (snapshot && !snapshot->ref_cnt.sub (1))
+        delete snapshot;
+    snapshot = NULL;
+}
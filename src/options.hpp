@@ -27,6 +27,7 @@
 #include "stddef.h"
 #include "stdint.hpp"
 #include "tcp_address.hpp"
+#include "atomic_counter.hpp"
 #include "../include/zmq.h"
 
 #if defined ZMQ_HAVE_SO_PEERCRED || defined ZMQ_HAVE_LOCAL_PEERCRED
@@ -71,6 +72,46 @@ namespace zmq
         int sndbuf;
         int rcvbuf;
 
+        //  Size of the batches of data stream engines read from and write
+        //  to the underlying connection, in bytes.
+        int in_batch_size;
+        int out_batch_size;
+
+        //  If true, stream engines adapt the size of their batches to the
+        //  traffic instead of using in_batch_size and out_batch_size.
+        bool batch_adaptive;
+
+        //  Maximum time, in milliseconds, stream engines hold back a batch
+        //  of outgoing messages that is not yet full. 0 means messages are
+        //  written as soon as they are available.
+        int snd_delay;
+
+        //  Frames of at least this many bytes are compressed on the wire
+        //  if the peer supports it. -1 disables compression altogether.
+        int compression_threshold;
+
+        //  Interval, in milliseconds, between PING commands sent to the
+        //  peer. 0 disables heartbeats.
+        int heartbeat_interval;
+
+        //  Time, in milliseconds, to wait for any traffic from the peer
+        //  after sending a PING before the connection is considered dead.
+        //  -1 means the heartbeat interval is used.
+        int heartbeat_timeout;
+
+        //  Time, in deciseconds, the peer should wait for traffic from us
+        //  before considering the connection dead, as announced in PINGs.
+        uint16_t heartbeat_ttl;
+
+        //  Messages of at least this many bytes are handed over to peers
+        //  on UNIX domain sockets as memfds if they support it. -1
+        //  disables passing file descriptors altogether.
+        int ipc_fd_threshold;
+
+        //  Number of TCP connections opened for each endpoint connected
+        //  to by socket types that spread messages across their peers.
+        int connect_stripes;
+
         // Type of service (containing DSCP and ECN socket options)
         int tos;
 
@@ -130,6 +171,12 @@ namespace zmq
         int tcp_keepalive_idle;
         int tcp_keepalive_intvl;
 
+        //  If true, TCP connections are opened with TCP Fast Open and
+        //  stream engines send their whole greeting and first handshake
+        //  command without waiting for the peer's greeting. Peers have
+        //  to speak ZMTP/3.0 then.
+        bool tcp_fastopen;
+
         // TCP accept() filters
         typedef std::vector <tcp_address_mask_t> tcp_accept_filters_t;
         tcp_accept_filters_t tcp_accept_filters;
@@ -165,6 +212,14 @@ namespace zmq
         uint8_t curve_secret_key [CURVE_KEYSIZE];
         uint8_t curve_server_key [CURVE_KEYSIZE];
 
+        //  If true, CURVE connections negotiate a faster cipher for the
+        //  messages than the MESSAGE command's, if both ends have one.
+        bool curve_aead;
+
+        //  Lifetime in milliseconds of the tickets CURVE servers hand out
+        //  to let clients resume their session, 0 for no tickets.
+        int curve_ticket_ttl;
+
         //  Principals for GSSAPI mechanism
         std::string gss_principal;
         std::string gss_service_principal;
@@ -172,6 +227,16 @@ namespace zmq
         //  If true, gss encryption will be disabled
         bool gss_plaintext;
 
+        //  Certificate chain, private key and trusted certificates, PEM
+        //  encoded, for the tls:// transport.
+        std::string tls_cert;
+        std::string tls_key;
+        std::string tls_ca;
+
+        //  If false, the certificate and host name of the peer are not
+        //  verified.
+        bool tls_verify;
+
         //  ID of the socket.
         int socket_id;
 
@@ -186,6 +251,49 @@ namespace zmq
         int handshake_ivl;
 
     };
+
+    //  Reference-counted, read-only copy of socket options. A socket takes
+    //  a snapshot of its options when it binds or connects and all the
+    //  objects created for the endpoint and its connections (listeners,
+    //  connecters, sessions and engines) share it instead of keeping
+    //  copies of their own. Snapshots are never modified; once the
+    //  socket's options change, subsequent endpoints get a new snapshot.
+
+    class shared_options_t
+    {
+    public:
+
+        //  Creates an empty handle.
+        shared_options_t ();
+
+        //  Takes a snapshot of options_.
+        explicit shared_options_t (const options_t &options_);
+
+        shared_options_t (const shared_options_t &other_);
+        const shared_options_t &operator = (const shared_options_t &other_);
+        ~shared_options_t ();
+
+        //  Returns the options. Must not be called on an empty handle.
+        const options_t &get () const;
+
+        //  Returns true if the handle doesn't refer to any snapshot.
+        bool empty () const;
+
+        //  Drops the reference to the snapshot, if any.
+        void reset ();
+
+    private:
+
+        struct snapshot_t
+        {
+            snapshot_t (const options_t &options_);
+
+            options_t options;
+            atomic_counter_t ref_cnt;
+        };
+
+        snapshot_t *snapshot;
+    };
 }
 
 #endif
@@ -21,8 +21,10 @@
 #include "err.hpp"
 #include "io_thread.hpp"
 
-zmq::own_t::own_t (class ctx_t *parent_, uint32_t tid_) :
+zmq::own_t::own_t (class ctx_t *parent_, uint32_t tid_,
+      const options_t &options_) :
     object_t (parent_, tid_),
+    options (options_),
     terminating (false),
     sent_seqnum (0),
     processed_seqnum (0),
@@ -31,9 +33,11 @@ zmq::own_t::own_t (class ctx_t *parent_, uint32_t tid_) :
 {
 }
 
-zmq::own_t::own_t (io_thread_t *io_thread_, const options_t &options_) :
+zmq::own_t::own_t (io_thread_t *io_thread_,
+      const shared_options_t &options_) :
     object_t (io_thread_),
-    options (options_),
+    shared_options (options_),
+    options (shared_options.get ()),
     terminating (false),
     sent_seqnum (0),
     processed_seqnum (0),
@@ -45,11 +45,13 @@ namespace zmq
         //  It'll be supplied later on when the object is plugged in.
 
         //  The object is not living within an I/O thread. It has it's own
-        //  thread outside of 0MQ infrastructure.
-        own_t (zmq::ctx_t *parent_, uint32_t tid_);
+        //  thread outside of 0MQ infrastructure. It keeps its options in
+        //  options_, which has to live as long as the object does.
+        own_t (zmq::ctx_t *parent_, uint32_t tid_, const options_t &options_);
 
-        //  The object is living within I/O thread.
-        own_t (zmq::io_thread_t *io_thread_, const options_t &options_);
+        //  The object is living within I/O thread. It shares the options
+        //  snapshot with the other objects created for the same endpoint.
+        own_t (zmq::io_thread_t *io_thread_, const shared_options_t &options_);
 
         //  When another owned object wants to send command to this object
         //  it calls this function to let it know it should not shut down
@@ -95,8 +97,12 @@ namespace zmq
         //  is to be delayed.
         virtual void process_destroy ();
 
+        //  Snapshot of the socket's options that 'options' refers to.
+        //  Empty for objects not living in I/O threads.
+        shared_options_t shared_options;
+
         //  Socket options associated with this object.
-        options_t options;
+        const options_t &options;
 
     private:
 
@@ -59,6 +59,7 @@ namespace zmq
         void restart_input ();
         void restart_output ();
         void zap_msg_available () {}
+        bool flush () { return false; }
 
         //  i_poll_events interface implementation.
         void in_event ();
@@ -105,7 +105,7 @@ void zmq::pipe_t::set_identity (const blob_t &identity_)
     identity = identity_;
 }
 
-zmq::blob_t zmq::pipe_t::get_identity ()
+const zmq::blob_t &zmq::pipe_t::get_identity () const
 {
     return identity;
 }
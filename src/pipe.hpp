@@ -76,7 +76,7 @@ namespace zmq
 
         //  Pipe endpoint can store an opaque ID to be used by its clients.
         void set_identity (const blob_t &identity_);
-        blob_t get_identity ();
+        const blob_t &get_identity () const;
 
         blob_t get_credential () const;
 
@@ -169,6 +169,18 @@ int zmq::plain_client_t::produce_initiate (msg_t *msg_) const
         ptr += add_property (
             ptr, "Identity", options.identity, options.identity_size);
 
+    //  Add compression property
+    if (options.compression_threshold >= 0)
+        ptr += add_property (ptr, compression_property, "LZ4", 3);
+
+    //  Add gap notices property
+    if (options.type == ZMQ_SUB || options.type == ZMQ_XSUB)
+        ptr += add_property (ptr, gap_notices_property, "1", 1);
+
+    //  Add file descriptor passing property
+    if (options.ipc_fd_threshold >= 0)
+        ptr += add_property (ptr, fd_passing_property, "memfd", 5);
+
     const size_t command_size = ptr - command_buffer;
     const int rc = msg_->init_size (command_size);
     errno_assert (rc == 0);
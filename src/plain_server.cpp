@@ -181,6 +181,16 @@ int zmq::plain_server_t::process_hello (msg_t *msg_)
         return -1;
     }
 
+    //  Skip the request if the handler has recently answered it.
+    const std::string credentials [] = { username, password };
+    if (find_zap_reply (session, peer_address, "PLAIN",
+            credentials, 2, status_code)) {
+        state = status_code == "200"
+            ? sending_welcome
+            : sending_error;
+        return 0;
+    }
+
     //  Use ZAP protocol (RFC 27) to authenticate the user.
     int rc = session->zap_connect ();
     if (rc == 0) {
@@ -249,6 +259,18 @@ int zmq::plain_server_t::produce_ready (msg_t *msg_) const
         ptr += add_property (
             ptr, "Identity", options.identity, options.identity_size);
 
+    //  Add compression property
+    if (options.compression_threshold >= 0)
+        ptr += add_property (ptr, compression_property, "LZ4", 3);
+
+    //  Add gap notices property
+    if (options.type == ZMQ_SUB || options.type == ZMQ_XSUB)
+        ptr += add_property (ptr, gap_notices_property, "1", 1);
+
+    //  Add file descriptor passing property
+    if (options.ipc_fd_threshold >= 0)
+        ptr += add_property (ptr, fd_passing_property, "memfd", 5);
+
     const size_t command_size = ptr - command_buffer;
     const int rc = msg_->init_size (command_size);
     errno_assert (rc == 0);
@@ -419,6 +441,8 @@ int zmq::plain_server_t::receive_and_process_zap_reply ()
     //  Process metadata frame
     rc = parse_metadata (static_cast <const unsigned char*> (msg [6].data ()),
                          msg [6].size (), true);
+    if (rc == 0)
+        cache_zap_reply (session, msg);
 
 error:
     for (int i = 0; i < 7; i++) {
@@ -0,0 +1,68 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "radio.hpp"
+#include "pipe.hpp"
+#include "err.hpp"
+#include "msg.hpp"
+
+zmq::radio_t::radio_t (class ctx_t *parent_, uint32_t tid_, int sid_) :
+    socket_base_t (parent_, tid_, sid_)
+{
+    options.type = ZMQ_RADIO;
+}
+
+zmq::radio_t::~radio_t ()
+{
+}
+
+void zmq::radio_t::xattach_pipe (pipe_t *pipe_, bool subscribe_to_all_)
+{
+    // subscribe_to_all_ is unused
+    (void) subscribe_to_all_;
+
+    zmq_assert (pipe_);
+    dist.attach (pipe_);
+}
+
+void zmq::radio_t::xwrite_activated (pipe_t *pipe_)
+{
+    dist.activated (pipe_);
+}
+
+void zmq::radio_t::xpipe_terminated (pipe_t *pipe_)
+{
+    dist.pipe_terminated (pipe_);
+}
+
+int zmq::radio_t::xsend (msg_t *msg_)
+{
+    //  Each message travels on its own, so there are no multipart ones.
+    if (msg_->flags () & msg_t::more) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return dist.send_to_all (msg_);
+}
+
+bool zmq::radio_t::xhas_out ()
+{
+    return dist.has_out ();
+}
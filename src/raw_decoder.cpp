@@ -28,28 +28,23 @@
 #include "raw_decoder.hpp"
 #include "err.hpp"
 
-zmq::raw_decoder_t::raw_decoder_t (size_t bufsize_) :
-    bufsize (bufsize_)
+zmq::raw_decoder_t::raw_decoder_t (size_t bufsize_, batch_pool_t *pool_) :
+    buffer (bufsize_, pool_)
 {
     int rc = in_progress.init ();
     errno_assert (rc == 0);
-
-    buffer = (unsigned char *) malloc (bufsize);
-    alloc_assert (buffer);
 }
 
 zmq::raw_decoder_t::~raw_decoder_t ()
 {
     int rc = in_progress.close ();
     errno_assert (rc == 0);
-
-    free (buffer);
 }
 
 void zmq::raw_decoder_t::get_buffer (unsigned char **data_, size_t *size_)
 {
-    *data_ = buffer;
-    *size_ = bufsize;
+    *data_ = buffer.data ();
+    *size_ = buffer.size ();
 }
 
 int zmq::raw_decoder_t::decode (const uint8_t *data_, size_t size_,
@@ -61,3 +56,13 @@ int zmq::raw_decoder_t::decode (const uint8_t *data_, size_t size_,
     bytes_used_ = size_;
     return 1;
 }
+
+void zmq::raw_decoder_t::resize_buffer (size_t bufsize_)
+{
+    buffer.resize (bufsize_);
+}
+
+void zmq::raw_decoder_t::release_buffer ()
+{
+    buffer.release ();
+}
@@ -24,6 +24,7 @@
 #include "msg.hpp"
 #include "i_decoder.hpp"
 #include "stdint.hpp"
+#include "batch_pool.hpp"
 
 namespace zmq
 {
@@ -34,7 +35,7 @@ namespace zmq
     {
     public:
 
-        raw_decoder_t (size_t bufsize_);
+        raw_decoder_t (size_t bufsize_, batch_pool_t *pool_ = NULL);
         virtual ~raw_decoder_t ();
 
         //  i_decoder interface.
@@ -46,15 +47,16 @@ namespace zmq
 
         virtual msg_t *msg () { return &in_progress; }
 
+        virtual void resize_buffer (size_t bufsize_);
+
+        virtual void release_buffer ();
 
     private:
 
 
         msg_t in_progress;
 
-        const size_t bufsize;
-
-        unsigned char *buffer;
+        batch_buffer_t buffer;
 
         raw_decoder_t (const raw_decoder_t&);
         void operator = (const raw_decoder_t&);
@@ -44,7 +44,7 @@ namespace zmq
     {
     public:
 
-        raw_encoder_t (size_t bufsize_);
+        raw_encoder_t (size_t bufsize_, batch_pool_t *pool_ = NULL);
         ~raw_encoder_t ();
 
     private:
@@ -239,7 +239,7 @@ int zmq::req_t::recv_reply_pipe (msg_t *msg_)
 }
 
 zmq::req_session_t::req_session_t (io_thread_t *io_thread_, bool connect_,
-      socket_base_t *socket_, const options_t &options_,
+      socket_base_t *socket_, const shared_options_t &options_,
       address_t *addr_) :
     session_base_t (io_thread_, connect_, socket_, options_, addr_),
     state (bottom)
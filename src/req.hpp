@@ -86,7 +86,7 @@ namespace zmq
     public:
 
         req_session_t (zmq::io_thread_t *io_thread_, bool connect_,
-            zmq::socket_base_t *socket_, const options_t &options_,
+            zmq::socket_base_t *socket_, const shared_options_t &options_,
             address_t *addr_);
         ~req_session_t ();
 
@@ -0,0 +1,267 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <new>
+#include <algorithm>
+#include <string.h>
+
+#include "../include/zmq.h"
+#include "resolver.hpp"
+#include "command.hpp"
+#include "object.hpp"
+#include "config.hpp"
+#include "ctx.hpp"
+#include "err.hpp"
+
+#ifdef ZMQ_HAVE_WINDOWS
+#include "windows.hpp"
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#endif
+
+zmq::resolver_t::resolver_t (class ctx_t *ctx_) :
+    ctx (ctx_),
+    stopping (false)
+{
+}
+
+zmq::resolver_t::~resolver_t ()
+{
+    //  Ask the workers to stop. Busy workers will notice once they are
+    //  done with the current lookup.
+    sync.lock ();
+    stopping = true;
+    for (workers_t::size_type i = 0; i != workers.size (); i++)
+        if (workers [i]->idle) {
+            workers [i]->idle = false;
+            workers [i]->signaler.send ();
+        }
+    sync.unlock ();
+
+    for (workers_t::size_type i = 0; i != workers.size (); i++) {
+        workers [i]->thread.stop ();
+        delete workers [i];
+    }
+
+    //  All the requesters are gone by now, so the remaining requests
+    //  have been cancelled.
+    zmq_assert (queue.empty ());
+    zmq_assert (running.empty ());
+}
+
+int zmq::resolver_t::resolve (const std::string &address_, bool ipv6_,
+    tcp_addresses_t *addrs_, object_t *requester_,
+    resolve_request_t **request_)
+{
+    //  Resolving numeric addresses is cheap, do it straight away.
+    if (is_numeric (address_))
+        return tcp_address_t::resolve_all (address_.c_str (), ipv6_,
+            *addrs_);
+
+    scoped_lock_t locker (sync);
+
+    //  Use the result of a recent lookup if there is one.
+    cache_t::iterator it = cache.find (cache_key (address_, ipv6_));
+    if (it != cache.end ()) {
+        if (it->second.expiry > clock.now_ms ()) {
+            *addrs_ = it->second.addresses;
+            return 0;
+        }
+        cache.erase (it);
+    }
+
+    resolve_request_t *request = new (std::nothrow) resolve_request_t ();
+    alloc_assert (request);
+    request->address = address_;
+    request->ipv6 = ipv6_;
+    request->requester = requester_;
+    request->rc = -1;
+    request->error = 0;
+    queue.push_back (request);
+
+    //  Wake up an idle worker. If there's none, start a new one unless
+    //  there are enough of them already.
+    workers_t::iterator w = workers.begin ();
+    while (w != workers.end () && !(*w)->idle)
+        ++w;
+    if (w != workers.end ()) {
+        (*w)->idle = false;
+        (*w)->signaler.send ();
+    }
+    else
+    if (workers.size () < (size_t) max_resolver_threads) {
+        worker_t *worker = new (std::nothrow) worker_t ();
+        alloc_assert (worker);
+        worker->resolver = this;
+        worker->idle = false;
+        workers.push_back (worker);
+        ctx->start_thread (worker->thread, worker_routine, worker);
+    }
+
+    *request_ = request;
+    errno = EINPROGRESS;
+    return -1;
+}
+
+bool zmq::resolver_t::cancel (resolve_request_t *request_)
+{
+    scoped_lock_t locker (sync);
+
+    //  The request is still waiting for a worker.
+    queue_t::iterator q = std::find (queue.begin (), queue.end (), request_);
+    if (q != queue.end ()) {
+        queue.erase (q);
+        delete request_;
+        return true;
+    }
+
+    //  The lookup is in progress. The worker will drop the request
+    //  once it's done.
+    requests_t::iterator r =
+        std::find (running.begin (), running.end (), request_);
+    if (r != running.end ()) {
+        running.erase (r);
+        return true;
+    }
+
+    //  The result is on its way to the requester.
+    return false;
+}
+
+void zmq::resolver_t::worker_routine (void *arg_)
+{
+    worker_t *worker = (worker_t*) arg_;
+    worker->resolver->loop (worker);
+}
+
+void zmq::resolver_t::loop (worker_t *worker_)
+{
+    sync.lock ();
+    while (!stopping) {
+
+        //  Wait till there's something to do.
+        if (queue.empty ()) {
+            worker_->idle = true;
+            sync.unlock ();
+            int rc = worker_->signaler.wait (-1);
+            while (rc == -1 && errno == EINTR)
+                rc = worker_->signaler.wait (-1);
+            errno_assert (rc == 0);
+            worker_->signaler.recv ();
+            sync.lock ();
+            continue;
+        }
+
+        resolve_request_t *request = queue.front ();
+        queue.pop_front ();
+        running.push_back (request);
+        sync.unlock ();
+
+        //  Do the lookup without holding the lock.
+        request->rc = tcp_address_t::resolve_all (request->address.c_str (),
+            request->ipv6, request->result);
+        request->error = request->rc == 0 ? 0 : errno;
+
+        sync.lock ();
+        requests_t::iterator it =
+            std::find (running.begin (), running.end (), request);
+
+        //  The requester is not interested in the result any more.
+        if (it == running.end ()) {
+            delete request;
+            continue;
+        }
+        running.erase (it);
+
+        if (request->rc == 0)
+            cache_result (request);
+
+        //  Send the result to the requester. This is done with the lock
+        //  held so that the requester cannot cancel the request meanwhile.
+        command_t cmd;
+        cmd.destination = request->requester;
+        cmd.type = command_t::resolved;
+        cmd.args.resolved.request = request;
+        ctx->send_command (request->requester->get_tid (), cmd);
+    }
+    sync.unlock ();
+}
+
+bool zmq::resolver_t::is_numeric (const std::string &address_)
+{
+    //  The address may be preceded by a source address.
+    const std::string::size_type src_delimiter = address_.rfind (';');
+    if (src_delimiter != std::string::npos)
+        return is_numeric (address_.substr (0, src_delimiter)) &&
+            is_numeric (address_.substr (src_delimiter + 1));
+
+    //  Leave malformed addresses to tcp_address_t to report.
+    const std::string::size_type delimiter = address_.rfind (':');
+    if (delimiter == std::string::npos)
+        return true;
+    std::string host = address_.substr (0, delimiter);
+    if (host.size () >= 2 && host [0] == '[' && host [host.size () - 1] == ']')
+        host = host.substr (1, host.size () - 2);
+
+    addrinfo req;
+    memset (&req, 0, sizeof req);
+    req.ai_family = AF_UNSPEC;
+    req.ai_socktype = SOCK_STREAM;
+    req.ai_flags = AI_NUMERICHOST;
+    addrinfo *res;
+    if (getaddrinfo (host.c_str (), NULL, &req, &res) != 0)
+        return false;
+    freeaddrinfo (res);
+    return true;
+}
+
+std::string zmq::resolver_t::cache_key (const std::string &address_,
+    bool ipv6_)
+{
+    return (ipv6_ ? "6:" : "4:") + address_;
+}
+
+void zmq::resolver_t::cache_result (const resolve_request_t *request_)
+{
+    const int ttl = ctx->get (ZMQ_RESOLVER_CACHE_TTL);
+    if (ttl <= 0)
+        return;
+
+    const uint64_t now = clock.now_ms ();
+
+    //  Make room for the new entry. Drop the expired entries first and
+    //  if that doesn't help, start afresh.
+    if (cache.size () >= (size_t) resolver_cache_size) {
+        cache_t::iterator it = cache.begin ();
+        while (it != cache.end ())
+            if (it->second.expiry <= now)
+                cache.erase (it++);
+            else
+                ++it;
+        if (cache.size () >= (size_t) resolver_cache_size)
+            cache.clear ();
+    }
+
+    cache_entry_t &entry =
+        cache [cache_key (request_->address, request_->ipv6)];
+    entry.addresses = request_->result;
+    entry.expiry = now + ttl;
+}
@@ -0,0 +1,159 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_RESOLVER_HPP_INCLUDED__
+#define __ZMQ_RESOLVER_HPP_INCLUDED__
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "stdint.hpp"
+#include "clock.hpp"
+#include "mutex.hpp"
+#include "signaler.hpp"
+#include "thread.hpp"
+#include "tcp_address.hpp"
+
+namespace zmq
+{
+
+    class ctx_t;
+    class object_t;
+
+    //  Host name lookup done on behalf of an I/O object. The object gets
+    //  the request back by the 'resolved' command and deallocates it.
+
+    struct resolve_request_t
+    {
+        //  Address to resolve, in the format accepted by tcp_address_t.
+        std::string address;
+        bool ipv6;
+
+        //  Object to send the result to.
+        object_t *requester;
+
+        //  0 if the address was resolved, otherwise -1 with the errno
+        //  value in 'error'.
+        int rc;
+        int error;
+
+        //  The addresses the host name maps to, in the order they should
+        //  be tried.
+        tcp_addresses_t result;
+    };
+
+    //  Resolves TCP addresses for connecters so that slow name lookups
+    //  don't stall the I/O threads. Numeric addresses are resolved right
+    //  away. Host names are looked up by a small pool of worker threads,
+    //  started on demand, and the results are cached for the number of
+    //  milliseconds given by the ZMQ_RESOLVER_CACHE_TTL context option.
+
+    class resolver_t
+    {
+    public:
+
+        resolver_t (zmq::ctx_t *ctx_);
+
+        //  Waits for the lookups that are in progress to finish.
+        ~resolver_t ();
+
+        //  Resolves remote TCP address address_ into addrs_, which gets
+        //  all the addresses the host name maps to. Returns 0 on
+        //  success, -1 with errno set if the address cannot be resolved.
+        //  If the address has to be looked up in the background, returns
+        //  -1 with errno set to EINPROGRESS and stores the pending request
+        //  in request_. The result is sent to requester_ later on.
+        int resolve (const std::string &address_, bool ipv6_,
+            tcp_addresses_t *addrs_, object_t *requester_,
+            resolve_request_t **request_);
+
+        //  Cancels a pending request. Returns false if the result has been
+        //  sent already, in which case the requester has to wait for it.
+        bool cancel (resolve_request_t *request_);
+
+    private:
+
+        struct worker_t
+        {
+            resolver_t *resolver;
+            thread_t thread;
+
+            //  Used to wake up the worker when it is idle.
+            signaler_t signaler;
+
+            //  True iff the worker waits for the signaler.
+            bool idle;
+        };
+
+        struct cache_entry_t
+        {
+            tcp_addresses_t addresses;
+            uint64_t expiry;
+        };
+
+        //  Main routine of the worker threads.
+        static void worker_routine (void *arg_);
+        void loop (worker_t *worker_);
+
+        //  Returns true if all the host names in address_ are numeric,
+        //  i.e. resolving it doesn't involve a lookup.
+        static bool is_numeric (const std::string &address_);
+
+        //  Returns the cache key for the address.
+        static std::string cache_key (const std::string &address_,
+            bool ipv6_);
+
+        //  Adds the result of a lookup to the cache. Called with 'sync'
+        //  locked.
+        void cache_result (const resolve_request_t *request_);
+
+        zmq::ctx_t *ctx;
+
+        //  Synchronises access to all the members below.
+        mutex_t sync;
+
+        //  Requests waiting for a worker.
+        typedef std::deque <resolve_request_t*> queue_t;
+        queue_t queue;
+
+        //  Requests being looked up. Cancelled requests are removed from
+        //  here and destroyed by the worker doing the lookup.
+        typedef std::vector <resolve_request_t*> requests_t;
+        requests_t running;
+
+        typedef std::vector <worker_t*> workers_t;
+        workers_t workers;
+
+        //  Addresses resolved recently.
+        typedef std::map <std::string, cache_entry_t> cache_t;
+        cache_t cache;
+        clock_t clock;
+
+        //  Set when the resolver is being destroyed.
+        bool stopping;
+
+        resolver_t (const resolver_t&);
+        const resolver_t &operator = (const resolver_t&);
+    };
+
+}
+
+#endif
@@ -20,12 +20,13 @@
 #ifndef __ZMQ_ROUTER_HPP_INCLUDED__
 #define __ZMQ_ROUTER_HPP_INCLUDED__
 
-#include <map>
+#include <set>
 
 #include "socket_base.hpp"
 #include "session_base.hpp"
 #include "stdint.hpp"
 #include "blob.hpp"
+#include "identity_map.hpp"
 #include "msg.hpp"
 #include "fq.hpp"
 
@@ -35,7 +36,6 @@ namespace zmq
     class ctx_t;
     class pipe_t;
 
-    //  TODO: This class uses O(n) scheduling. Rewrite it to use O(1) algorithm.
     class router_t :
         public socket_base_t
     {
@@ -95,7 +95,7 @@ namespace zmq
         std::set <pipe_t*> anonymous_pipes;
 
         //  Outbound pipes indexed by the peer IDs.
-        typedef std::map <blob_t, outpipe_t> outpipes_t;
+        typedef identity_map_t <outpipe_t> outpipes_t;
         outpipes_t outpipes;
 
         //  The pipe we are currently writing to.
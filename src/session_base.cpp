@@ -26,6 +26,7 @@
 #include "ipc_connecter.hpp"
 #include "tipc_connecter.hpp"
 #include "socks_connecter.hpp"
+#include "udp_engine.hpp"
 #include "pgm_sender.hpp"
 #include "pgm_receiver.hpp"
 #include "address.hpp"
@@ -35,11 +36,11 @@
 #include "req.hpp"
 
 zmq::session_base_t *zmq::session_base_t::create (class io_thread_t *io_thread_,
-    bool active_, class socket_base_t *socket_, const options_t &options_,
-    address_t *addr_)
+    bool active_, class socket_base_t *socket_,
+    const shared_options_t &options_, address_t *addr_)
 {
     session_base_t *s = NULL;
-    switch (options_.type) {
+    switch (options_.get ().type) {
     case ZMQ_REQ:
         s = new (std::nothrow) req_session_t (io_thread_, active_,
             socket_, options_, addr_);
@@ -55,6 +56,8 @@ zmq::session_base_t *zmq::session_base_t::create (class io_thread_t *io_thread_,
     case ZMQ_PULL:
     case ZMQ_PAIR:
     case ZMQ_STREAM:
+    case ZMQ_RADIO:
+    case ZMQ_DISH:
         s = new (std::nothrow) session_base_t (io_thread_, active_,
             socket_, options_, addr_);
         break;
@@ -67,15 +70,18 @@ zmq::session_base_t *zmq::session_base_t::create (class io_thread_t *io_thread_,
 }
 
 zmq::session_base_t::session_base_t (class io_thread_t *io_thread_,
-      bool active_, class socket_base_t *socket_, const options_t &options_,
-      address_t *addr_) :
+      bool active_, class socket_base_t *socket_,
+      const shared_options_t &options_, address_t *addr_) :
     own_t (io_thread_, options_),
     io_object_t (io_thread_),
     active (active_),
     pipe (NULL),
     zap_pipe (NULL),
     incomplete_in (false),
+    gap_notices (false),
     pending (false),
+    linger (0),
+    flushing (false),
     engine (NULL),
     socket (socket_),
     io_thread (io_thread_),
@@ -113,16 +119,34 @@ void zmq::session_base_t::attach_pipe (pipe_t *pipe_)
 
 int zmq::session_base_t::pull_msg (msg_t *msg_)
 {
-    if (!pipe || !pipe->read (msg_)) {
-        errno = EAGAIN;
-        return -1;
-    }
+    do {
+        if (!pipe || !pipe->read (msg_)) {
+            errno = EAGAIN;
+            return -1;
+        }
+
+        //  GAP commands are the only ones sockets write. Drop them unless
+        //  the engine can deliver them.
+        if (unlikely (!gap_notices && (msg_->flags () & msg_t::command))) {
+            int rc = msg_->close ();
+            errno_assert (rc == 0);
+            rc = msg_->init ();
+            errno_assert (rc == 0);
+            continue;
+        }
+        break;
+    } while (true);
 
     incomplete_in = msg_->flags () & msg_t::more ? true : false;
 
     return 0;
 }
 
+void zmq::session_base_t::set_gap_notices (bool enabled_)
+{
+    gap_notices = enabled_;
+}
+
 int zmq::session_base_t::push_msg (msg_t *msg_)
 {
     if (pipe && pipe->write (msg_)) {
@@ -206,14 +230,9 @@ void zmq::session_base_t::pipe_terminated (pipe_t *pipe_)
              || pipe_ == zap_pipe
              || terminating_pipes.count (pipe_) == 1);
 
-    if (pipe_ == pipe) {
+    if (pipe_ == pipe)
         // If this is our current pipe, remove it
         pipe = NULL;
-        if (has_linger_timer) {
-            cancel_timer (linger_timer_id);
-            has_linger_timer = false;
-        }
-    }
     else
     if (pipe_ == zap_pipe)
         zap_pipe = NULL;
@@ -230,11 +249,14 @@ void zmq::session_base_t::pipe_terminated (pipe_t *pipe_)
     }
 
     //  If we are waiting for pending messages to be sent, at this point
-    //  we are sure that there will be no more messages and we can proceed
-    //  with termination safely.
+    //  we are sure that there will be no more messages. The engine may
+    //  still hold some it took from the pipe; give it what is left of
+    //  the linger period to write them out.
     if (pending && !pipe && !zap_pipe && terminating_pipes.empty ()) {
-        pending = false;
-        own_t::process_term (0);
+        if (engine && linger != 0 && engine->flush ())
+            flushing = true;
+        else
+            finish_term ();
     }
 }
 
@@ -384,6 +406,13 @@ void zmq::session_base_t::engine_error (
 {
     //  Engine is dead. Let's forget about it.
     engine = NULL;
+    gap_notices = false;
+
+    //  The rest of the messages can't be written out anyway.
+    if (flushing) {
+        finish_term ();
+        return;
+    }
 
     //  Remove any half-done messages from the pipes.
     if (pipe)
@@ -414,6 +443,24 @@ void zmq::session_base_t::engine_error (
         zap_pipe->check_read ();
 }
 
+void zmq::session_base_t::engine_flushed ()
+{
+    zmq_assert (flushing);
+    engine = NULL;
+    finish_term ();
+}
+
+void zmq::session_base_t::finish_term ()
+{
+    if (has_linger_timer) {
+        cancel_timer (linger_timer_id);
+        has_linger_timer = false;
+    }
+    flushing = false;
+    pending = false;
+    own_t::process_term (0);
+}
+
 void zmq::session_base_t::process_term (int linger_)
 {
     zmq_assert (!pending);
@@ -427,6 +474,7 @@ void zmq::session_base_t::process_term (int linger_)
     }
 
     pending = true;
+    linger = linger_;
 
     if (pipe != NULL) {
         //  If there's finite linger value, delay the termination.
@@ -459,9 +507,15 @@ void zmq::session_base_t::timer_event (int id_)
     zmq_assert (id_ == linger_timer_id);
     has_linger_timer = false;
 
+    //  Drop whatever the engine hasn't written out yet.
+    if (flushing) {
+        finish_term ();
+        return;
+    }
+
     //  Ask pipe to terminate even though there may be pending messages in it.
-    zmq_assert (pipe);
-    pipe->terminate (false);
+    if (pipe)
+        pipe->terminate (false);
 }
 
 void zmq::session_base_t::reconnect ()
@@ -470,7 +524,7 @@ void zmq::session_base_t::reconnect ()
     //  and reestablish later on
     if (pipe && options.immediate == 1
         && addr->protocol != "pgm" && addr->protocol != "epgm"
-        && addr->protocol != "norm") {
+        && addr->protocol != "norm" && addr->protocol != "udp") {
         pipe->hiccup ();
         pipe->terminate (false);
         terminating_pipes.insert (pipe);
@@ -500,20 +554,21 @@ void zmq::session_base_t::start_connecting (bool wait_)
 
     //  Create the connecter object.
 
-    if (addr->protocol == "tcp") {
-        if (!options.socks_proxy_address.empty()) {
+    if (addr->protocol == "tcp" || addr->protocol == "tls") {
+        if (!options.socks_proxy_address.empty() && addr->protocol == "tcp") {
             address_t *proxy_address = new (std::nothrow)
                 address_t ("tcp", options.socks_proxy_address);
             alloc_assert (proxy_address);
             socks_connecter_t *connecter =
                 new (std::nothrow) socks_connecter_t (
-                    io_thread, this, options, addr, proxy_address, wait_);
+                    io_thread, this, shared_options, addr, proxy_address,
+                    wait_);
             alloc_assert (connecter);
             launch_child (connecter);
         }
         else {
             tcp_connecter_t *connecter = new (std::nothrow)
-                tcp_connecter_t (io_thread, this, options, addr, wait_);
+                tcp_connecter_t (io_thread, this, shared_options, addr, wait_);
             alloc_assert (connecter);
             launch_child (connecter);
         }
@@ -521,9 +576,9 @@ void zmq::session_base_t::start_connecting (bool wait_)
     }
 
 #if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
-    if (addr->protocol == "ipc") {
+    if (addr->protocol == "ipc" || addr->protocol == "shm") {
         ipc_connecter_t *connecter = new (std::nothrow) ipc_connecter_t (
-            io_thread, this, options, addr, wait_);
+            io_thread, this, shared_options, addr, wait_);
         alloc_assert (connecter);
         launch_child (connecter);
         return;
@@ -532,13 +587,33 @@ void zmq::session_base_t::start_connecting (bool wait_)
 #if defined ZMQ_HAVE_TIPC
     if (addr->protocol == "tipc") {
         tipc_connecter_t *connecter = new (std::nothrow) tipc_connecter_t (
-            io_thread, this, options, addr, wait_);
+            io_thread, this, shared_options, addr, wait_);
         alloc_assert (connecter);
         launch_child (connecter);
         return;
     }
 #endif
 
+#if !defined ZMQ_HAVE_WINDOWS
+    if (addr->protocol == "udp") {
+        zmq_assert (options.type == ZMQ_RADIO || options.type == ZMQ_DISH);
+
+        //  As with PGM, there is no concept of 'connect' with UDP. RADIO
+        //  sockets send datagrams to the address, DISH sockets receive
+        //  datagrams sent to it.
+        udp_engine_t *engine = new (std::nothrow) udp_engine_t (
+            shared_options);
+        alloc_assert (engine);
+
+        int rc = engine->init (addr, options.type == ZMQ_RADIO,
+            options.type == ZMQ_DISH);
+        errno_assert (rc == 0);
+
+        send_attach (this, engine);
+        return;
+    }
+#endif
+
 #ifdef ZMQ_HAVE_OPENPGM
 
     //  Both PGM and EPGM transports are using the same infrastructure.
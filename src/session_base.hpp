@@ -48,7 +48,7 @@ namespace zmq
         //  Create a session of the particular type.
         static session_base_t *create (zmq::io_thread_t *io_thread_,
             bool active_, zmq::socket_base_t *socket_,
-            const options_t &options_, address_t *addr_);
+            const shared_options_t &options_, address_t *addr_);
 
         //  To be used once only, when creating the session.
         void attach_pipe (zmq::pipe_t *pipe_);
@@ -57,6 +57,7 @@ namespace zmq
         virtual void reset ();
         void flush ();
         void engine_error (zmq::stream_engine_t::error_reason_t reason);
+        void engine_flushed ();
 
         //  i_pipe_events interface implementation.
         void read_activated (zmq::pipe_t *pipe_);
@@ -76,6 +77,10 @@ namespace zmq
         //  longer used.
         int pull_msg (msg_t *msg_);
 
+        //  Tells whether the engine forwards GAP commands to the peer.
+        //  If not, pull_msg drops them.
+        void set_gap_notices (bool enabled_);
+
         //  Receives message from ZAP socket.
         //  Returns 0 on success; -1 otherwise.
         //  The caller is responsible for freeing the message.
@@ -91,7 +96,7 @@ namespace zmq
     protected:
 
         session_base_t (zmq::io_thread_t *io_thread_, bool active_,
-            zmq::socket_base_t *socket_, const options_t &options_,
+            zmq::socket_base_t *socket_, const shared_options_t &options_,
             address_t *addr_);
         virtual ~session_base_t ();
 
@@ -109,6 +114,10 @@ namespace zmq
         //  i_poll_events handlers.
         void timer_event (int id_);
 
+        //  Completes the termination once the pipes are gone and the
+        //  engine wrote out what it could.
+        void finish_term ();
+
         //  Remove any half processed messages. Flush unflushed messages.
         //  Call this function when engine disconnect to get rid of leftovers.
         void clean_pipes ();
@@ -130,10 +139,21 @@ namespace zmq
         //  is still in the in pipe.
         bool incomplete_in;
 
+        //  True iff the engine forwards GAP commands written by
+        //  the socket.
+        bool gap_notices;
+
         //  True if termination have been suspended to push the pending
         //  messages to the network.
         bool pending;
 
+        //  Linger period the session was asked to terminate with.
+        int linger;
+
+        //  True if termination waits for the engine to write out the
+        //  messages it has taken from the pipe.
+        bool flushing;
+
         //  The protocol I/O engine connected to the session.
         zmq::i_engine *engine;
 
@@ -0,0 +1,734 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_SHM
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <stdio.h>
+#include <string.h>
+#include <new>
+#include <sstream>
+
+#include "shm_engine.hpp"
+#include "io_thread.hpp"
+#include "session_base.hpp"
+#include "socket_base.hpp"
+#include "v2_encoder.hpp"
+#include "v2_decoder.hpp"
+#include "null_mechanism.hpp"
+#include "metadata.hpp"
+#include "config.hpp"
+#include "err.hpp"
+#include "ip.hpp"
+#include "likely.hpp"
+#include "wire.hpp"
+
+//  Returns true iff 'fd_' refers to an eventfd.
+static bool is_eventfd (zmq::fd_t fd_)
+{
+    char path [32];
+    sprintf (path, "/proc/self/fd/%d", fd_);
+    char target [32];
+    const ssize_t len = readlink (path, target, sizeof target);
+    static const char expected [] = "anon_inode:[eventfd]";
+    return len == (ssize_t) sizeof expected - 1
+        && memcmp (target, expected, len) == 0;
+}
+
+zmq::shm_engine_t::shm_engine_t (fd_t fd_, bool as_server_,
+      const shared_options_t &options_, const std::string &endpoint_) :
+    s (fd_),
+    as_server (as_server_),
+    region (NULL),
+    region_size (0),
+    wake_fd (retired_fd),
+    peer_wake_fd (retired_fd),
+    wake_fd_polled (false),
+    encoder (NULL),
+    decoder (NULL),
+    session (NULL),
+    shared_options (options_),
+    options (shared_options.get ()),
+    endpoint (endpoint_),
+    plugged (false),
+    next_msg (NULL),
+    process_msg (NULL),
+    mechanism (NULL),
+    metadata (NULL),
+    input_stopped (false),
+    output_stopped (false),
+    peer_gone (false),
+    has_handshake_timer (false),
+    socket (NULL)
+{
+    int rc = tx_msg.init ();
+    errno_assert (rc == 0);
+
+    //  Put the socket into non-blocking mode.
+    unblock_socket (s);
+
+#if defined ZMQ_HAVE_SO_PEERCRED
+    struct ucred cred;
+    socklen_t size = sizeof (cred);
+    if (!getsockopt (s, SOL_SOCKET, SO_PEERCRED, &cred, &size)) {
+        std::ostringstream buf;
+        buf << ":" << cred.uid << ":" << cred.gid << ":" << cred.pid;
+        peer_address = buf.str ();
+    }
+#endif
+}
+
+zmq::shm_engine_t::~shm_engine_t ()
+{
+    zmq_assert (!plugged);
+
+    if (s != retired_fd) {
+        int rc = close (s);
+        errno_assert (rc == 0);
+        s = retired_fd;
+    }
+    if (wake_fd != retired_fd) {
+        int rc = close (wake_fd);
+        errno_assert (rc == 0);
+    }
+    if (peer_wake_fd != retired_fd) {
+        int rc = close (peer_wake_fd);
+        errno_assert (rc == 0);
+    }
+    if (region) {
+        int rc = munmap (region, region_size);
+        errno_assert (rc == 0);
+    }
+
+    int rc = tx_msg.close ();
+    errno_assert (rc == 0);
+
+    //  Drop reference to metadata and destroy it if we are
+    //  the only user.
+    if (metadata != NULL)
+        if (metadata->drop_ref ())
+            delete metadata;
+
+    delete encoder;
+    delete decoder;
+    delete mechanism;
+}
+
+void zmq::shm_engine_t::plug (io_thread_t *io_thread_,
+    session_base_t *session_)
+{
+    zmq_assert (!plugged);
+    plugged = true;
+
+    //  Connect to session object.
+    zmq_assert (!session);
+    zmq_assert (session_);
+    session = session_;
+    socket = session->get_socket ();
+
+    //  Connect to I/O threads poller object.
+    io_object_t::plug (io_thread_);
+    handle = add_fd (s);
+    set_pollin (handle);
+
+    //  The security mechanism may have been changed after the endpoint
+    //  has been set up. Refuse to run without it.
+    if (options.mechanism != ZMQ_NULL) {
+        error (stream_engine_t::protocol_error);
+        return;
+    }
+
+    //  Prevent the handshake from hanging on a peer that never sends
+    //  the region or never answers through it.
+    if (options.handshake_ivl > 0) {
+        add_timer (options.handshake_ivl, handshake_timer_id);
+        has_handshake_timer = true;
+    }
+
+    if (as_server) {
+        if (create_region () == -1) {
+            error (stream_engine_t::connection_error);
+            return;
+        }
+        start ();
+    }
+    else
+        in_event ();
+}
+
+void zmq::shm_engine_t::unplug ()
+{
+    zmq_assert (plugged);
+    plugged = false;
+
+    if (has_handshake_timer) {
+        cancel_timer (handshake_timer_id);
+        has_handshake_timer = false;
+    }
+
+    //  Cancel all fd subscriptions.
+    if (!peer_gone)
+        rm_fd (handle);
+    if (wake_fd_polled)
+        rm_fd (wake_handle);
+
+    //  Disconnect from I/O threads poller object.
+    io_object_t::unplug ();
+
+    session = NULL;
+}
+
+void zmq::shm_engine_t::terminate ()
+{
+    //  Whatever is in the outgoing ring stays readable for the peer
+    //  after we are gone.
+    unplug ();
+    delete this;
+}
+
+int zmq::shm_engine_t::create_region ()
+{
+    const fd_t memfd = memfd_create ("zmq-shm",
+        MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memfd == -1)
+        return -1;
+
+    //  Seal the size of the region, so that neither end can make the
+    //  other's accesses to it fault by truncating it.
+    const size_t capacity = shm_ring_size;
+    if (ftruncate (memfd, 2 * shm_ring_t::region_size (capacity)) == -1
+    ||  fcntl (memfd, F_ADD_SEALS,
+            F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == -1
+    ||  map_region (memfd, capacity) == -1) {
+        close (memfd);
+        return -1;
+    }
+
+    wake_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    peer_wake_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd == -1 || peer_wake_fd == -1) {
+        close (memfd);
+        return -1;
+    }
+
+    //  Send the capacity of the rings along with the descriptors of the
+    //  region and of the eventfds, ours first.
+    unsigned char size [4];
+    put_uint32 (size, (uint32_t) capacity);
+    struct iovec iov = {size, sizeof size};
+
+    const int fds [3] = {memfd, wake_fd, peer_wake_fd};
+    union {
+        char buf [CMSG_SPACE (sizeof fds)];
+        struct cmsghdr align;
+    } control;
+    memset (&control, 0, sizeof control);
+
+    struct msghdr msg;
+    memset (&msg, 0, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof control.buf;
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN (sizeof fds);
+    memcpy (CMSG_DATA (cmsg), fds, sizeof fds);
+
+    const ssize_t nbytes = sendmsg (s, &msg, MSG_NOSIGNAL);
+
+    //  The mapping keeps the region alive, the descriptor is not needed
+    //  any more.
+    int rc = close (memfd);
+    errno_assert (rc == 0);
+
+    return nbytes == (ssize_t) sizeof size ? 0 : -1;
+}
+
+int zmq::shm_engine_t::receive_region ()
+{
+    unsigned char size [4];
+    struct iovec iov = {size, sizeof size};
+
+    int fds [3];
+    union {
+        char buf [CMSG_SPACE (sizeof fds)];
+        struct cmsghdr align;
+    } control;
+
+    struct msghdr msg;
+    memset (&msg, 0, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof control.buf;
+
+    const ssize_t nbytes = recvmsg (s, &msg, MSG_CMSG_CLOEXEC);
+    if (nbytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    //  Anything but the capacity with three descriptors is a failure.
+    struct cmsghdr *cmsg = nbytes == (ssize_t) sizeof size ?
+        CMSG_FIRSTHDR (&msg) : NULL;
+    if (cmsg == NULL
+    ||  cmsg->cmsg_level != SOL_SOCKET
+    ||  cmsg->cmsg_type != SCM_RIGHTS
+    ||  cmsg->cmsg_len != CMSG_LEN (sizeof fds)) {
+        if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET
+        &&  cmsg->cmsg_type == SCM_RIGHTS) {
+            const int *received = (const int *) CMSG_DATA (cmsg);
+            const size_t count = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+            for (size_t i = 0; i != count; i++)
+                close (received [i]);
+        }
+        errno = EPROTO;
+        return -1;
+    }
+    memcpy (fds, CMSG_DATA (cmsg), sizeof fds);
+
+    //  The listener's eventfd is the one we signal.
+    peer_wake_fd = fds [1];
+    wake_fd = fds [2];
+
+    //  The I/O thread must never block on the peer's descriptors.
+    if (!is_eventfd (peer_wake_fd) || !is_eventfd (wake_fd)) {
+        close (fds [0]);
+        errno = EPROTO;
+        return -1;
+    }
+    unblock_socket (peer_wake_fd);
+    unblock_socket (wake_fd);
+
+    const uint32_t capacity = get_uint32 (size);
+    int rc = -1;
+    if (capacity != 0 && (capacity & (capacity - 1)) == 0)
+        rc = map_region (fds [0], capacity);
+    close (fds [0]);
+    if (rc == -1)
+        errno = EPROTO;
+    return rc;
+}
+
+int zmq::shm_engine_t::map_region (fd_t fd_, size_t capacity_)
+{
+    const size_t ring_size = shm_ring_t::region_size (capacity_);
+    if (ring_size > (size_t) -1 / 2) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    //  The region must be large enough for both rings and unable to
+    //  shrink while we have it mapped.
+    const int required = F_SEAL_SHRINK | F_SEAL_GROW;
+    const int seals = fcntl (fd_, F_GET_SEALS);
+    struct stat st;
+    if (seals == -1 || (seals & required) != required
+    ||  fstat (fd_, &st) == -1 || (uint64_t) st.st_size < 2 * ring_size) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    void *addr = mmap (NULL, 2 * ring_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED, fd_, 0);
+    if (addr == MAP_FAILED)
+        return -1;
+    region = addr;
+    region_size = 2 * ring_size;
+
+    //  The listening side writes to the first ring, the connecting side
+    //  to the second one.
+    unsigned char *first = static_cast <unsigned char *> (region);
+    unsigned char *second = first + ring_size;
+    tx.attach (as_server ? first : second, capacity_);
+    rx.attach (as_server ? second : first, capacity_);
+    return 0;
+}
+
+void zmq::shm_engine_t::start ()
+{
+    wake_handle = add_fd (wake_fd);
+    wake_fd_polled = true;
+    set_pollin (wake_handle);
+
+    encoder = new (std::nothrow) v2_encoder_t (options.out_batch_size);
+    alloc_assert (encoder);
+
+    decoder = new (std::nothrow) v2_decoder_t (
+        options.in_batch_size, options.maxmsgsize);
+    alloc_assert (decoder);
+
+    mechanism = new (std::nothrow)
+        null_mechanism_t (session, peer_address, options);
+    alloc_assert (mechanism);
+
+    next_msg = &shm_engine_t::next_handshake_command;
+    process_msg = &shm_engine_t::process_handshake_command;
+
+    produce ();
+    if (consume ())
+        session->flush ();
+}
+
+void zmq::shm_engine_t::in_event ()
+{
+    //  The connecting side waits for the region to arrive first.
+    if (unlikely (region == NULL)) {
+        if (receive_region () == -1) {
+            if (errno != EAGAIN)
+                error (stream_engine_t::connection_error);
+            return;
+        }
+        start ();
+        return;
+    }
+
+    //  Reset the eventfd. If it has not been signalled, the event came
+    //  from the socket, which carries nothing after the setup. There it
+    //  means that the peer has gone away.
+    uint64_t dummy;
+    if (read (wake_fd, &dummy, sizeof dummy) == -1 && !peer_gone) {
+        char c;
+        const ssize_t rc = recv (s, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (rc == 0 || (rc == -1 && errno != EAGAIN
+                                 && errno != EWOULDBLOCK)) {
+            peer_gone = true;
+            rm_fd (handle);
+        }
+    }
+
+    if (!input_stopped && !consume ())
+        return;
+    if (!output_stopped)
+        produce ();
+    session->flush ();
+}
+
+void zmq::shm_engine_t::timer_event (int id_)
+{
+    zmq_assert (id_ == handshake_timer_id);
+    has_handshake_timer = false;
+
+    //  handshake timer expired before handshake completed, so engine fails
+    error (stream_engine_t::timeout_error);
+}
+
+void zmq::shm_engine_t::restart_output ()
+{
+    if (unlikely (encoder == NULL || peer_gone))
+        return;
+
+    output_stopped = false;
+    produce ();
+}
+
+void zmq::shm_engine_t::restart_input ()
+{
+    zmq_assert (input_stopped);
+    zmq_assert (session != NULL);
+    zmq_assert (decoder != NULL);
+
+    int rc = (this->*process_msg) (decoder->msg ());
+    if (rc == -1) {
+        if (errno == EAGAIN)
+            session->flush ();
+        else
+            error (stream_engine_t::protocol_error);
+        return;
+    }
+
+    input_stopped = false;
+    if (consume ())
+        session->flush ();
+}
+
+void zmq::shm_engine_t::zap_msg_available ()
+{
+    zmq_assert (mechanism != NULL);
+
+    const int rc = mechanism->zap_msg_available ();
+    if (rc == -1) {
+        error (stream_engine_t::protocol_error);
+        return;
+    }
+    if (input_stopped)
+        restart_input ();
+    else
+    if (output_stopped)
+        restart_output ();
+}
+
+void zmq::shm_engine_t::produce ()
+{
+    bool produced = false;
+
+    while (true) {
+        unsigned char *ptr;
+        const size_t space = tx.free_space (&ptr);
+
+        //  The ring is full. Make sure the peer drains it and wait for
+        //  it to wake us up, unless it has made room meanwhile.
+        if (space == 0) {
+            if (produced && tx.reader_needs_wakeup ())
+                wake_peer ();
+            produced = false;
+            if (tx.wait_for_space ())
+                break;
+            continue;
+        }
+
+        const size_t nbytes = encoder->encode (&ptr, space);
+        if (nbytes == 0) {
+            if ((this->*next_msg) (&tx_msg) == -1) {
+                output_stopped = true;
+                break;
+            }
+            encoder->load_msg (&tx_msg);
+            continue;
+        }
+        tx.produce (nbytes);
+        produced = true;
+    }
+
+    if (produced && tx.reader_needs_wakeup ())
+        wake_peer ();
+}
+
+bool zmq::shm_engine_t::consume ()
+{
+    bool consumed = false;
+    int rc = 0;
+
+    while (true) {
+        const unsigned char *ptr;
+        const size_t size = rx.available (&ptr);
+
+        if (size == 0) {
+            if (consumed && rx.writer_needs_wakeup ())
+                wake_peer ();
+            consumed = false;
+
+            //  All the peer left behind has been delivered.
+            if (peer_gone) {
+                error (stream_engine_t::connection_error);
+                return false;
+            }
+            if (rx.wait_for_data ())
+                break;
+            continue;
+        }
+
+        size_t processed = 0;
+        rc = decoder->decode (ptr, size, processed);
+        zmq_assert (processed <= size);
+        rx.consume (processed);
+        consumed = true;
+        if (rc == -1)
+            break;
+        if (rc == 0)
+            continue;
+        rc = (this->*process_msg) (decoder->msg ());
+        if (rc == -1)
+            break;
+    }
+
+    if (consumed && rx.writer_needs_wakeup ())
+        wake_peer ();
+
+    //  Tear down the connection if we have failed to decode input data
+    //  or the session has rejected the message.
+    if (rc == -1) {
+        if (errno != EAGAIN) {
+            error (stream_engine_t::protocol_error);
+            return false;
+        }
+        input_stopped = true;
+    }
+    return true;
+}
+
+void zmq::shm_engine_t::wake_peer ()
+{
+    const uint64_t one = 1;
+    const ssize_t rc = write (peer_wake_fd, &one, sizeof one);
+
+    //  The counter of the eventfd can only overflow if the peer does
+    //  not read it, in which case it is awake anyway.
+    errno_assert (rc == sizeof one || errno == EAGAIN);
+}
+
+void zmq::shm_engine_t::error (stream_engine_t::error_reason_t reason_)
+{
+    zmq_assert (session);
+    socket->event_disconnected (endpoint, s);
+    session->flush ();
+    session->engine_error (reason_);
+    unplug ();
+    delete this;
+}
+
+int zmq::shm_engine_t::next_handshake_command (msg_t *msg_)
+{
+    zmq_assert (mechanism != NULL);
+
+    if (mechanism->status () == mechanism_t::ready) {
+        mechanism_ready ();
+        return pull_and_encode (msg_);
+    }
+    else
+    if (mechanism->status () == mechanism_t::error) {
+        errno = EPROTO;
+        return -1;
+    }
+    else {
+        const int rc = mechanism->next_handshake_command (msg_);
+        if (rc == 0)
+            msg_->set_flags (msg_t::command);
+        return rc;
+    }
+}
+
+int zmq::shm_engine_t::process_handshake_command (msg_t *msg_)
+{
+    zmq_assert (mechanism != NULL);
+    const int rc = mechanism->process_handshake_command (msg_);
+    if (rc == 0) {
+        if (mechanism->status () == mechanism_t::ready)
+            mechanism_ready ();
+        else
+        if (mechanism->status () == mechanism_t::error) {
+            errno = EPROTO;
+            return -1;
+        }
+        if (output_stopped)
+            restart_output ();
+    }
+
+    return rc;
+}
+
+void zmq::shm_engine_t::mechanism_ready ()
+{
+    if (has_handshake_timer) {
+        cancel_timer (handshake_timer_id);
+        has_handshake_timer = false;
+    }
+
+    if (options.recv_identity) {
+        msg_t identity;
+        mechanism->peer_identity (&identity);
+        const int rc = session->push_msg (&identity);
+        if (rc == -1 && errno == EAGAIN) {
+            // If the write is failing at this stage with
+            // an EAGAIN the pipe must be being shut down,
+            // so we can just bail out of the identity set.
+            return;
+        }
+        errno_assert (rc == 0);
+        session->flush ();
+    }
+
+    next_msg = &shm_engine_t::pull_and_encode;
+    process_msg = &shm_engine_t::write_credential;
+
+    //  Compile metadata.
+    typedef metadata_t::dict_t properties_t;
+    properties_t properties;
+
+    //  If we have a peer_address, add it to metadata
+    if (!peer_address.empty ())
+        properties.insert (std::make_pair ("Peer-Address", peer_address));
+
+    //  Add ZAP properties.
+    const properties_t& zap_properties = mechanism->get_zap_properties ();
+    properties.insert (zap_properties.begin (), zap_properties.end ());
+
+    //  Add ZMTP properties.
+    const properties_t& zmtp_properties = mechanism->get_zmtp_properties ();
+    properties.insert (zmtp_properties.begin (), zmtp_properties.end ());
+
+    zmq_assert (metadata == NULL);
+    if (!properties.empty ())
+        metadata = new (std::nothrow) metadata_t (properties);
+}
+
+int zmq::shm_engine_t::write_credential (msg_t *msg_)
+{
+    zmq_assert (mechanism != NULL);
+    zmq_assert (session != NULL);
+
+    const blob_t credential = mechanism->get_user_id ();
+    if (credential.size () > 0) {
+        msg_t msg;
+        int rc = msg.init_size (credential.size ());
+        zmq_assert (rc == 0);
+        memcpy (msg.data (), credential.data (), credential.size ());
+        msg.set_flags (msg_t::credential);
+        rc = session->push_msg (&msg);
+        if (rc == -1) {
+            rc = msg.close ();
+            errno_assert (rc == 0);
+            return -1;
+        }
+    }
+    process_msg = &shm_engine_t::decode_and_push;
+    return decode_and_push (msg_);
+}
+
+int zmq::shm_engine_t::pull_and_encode (msg_t *msg_)
+{
+    return session->pull_msg (msg_);
+}
+
+int zmq::shm_engine_t::decode_and_push (msg_t *msg_)
+{
+    //  There are no commands after the handshake on this transport.
+    if (msg_->flags () & msg_t::command) {
+        errno = EPROTO;
+        return -1;
+    }
+    if (metadata)
+        msg_->set_metadata (metadata);
+    if (session->push_msg (msg_) == -1) {
+        if (errno == EAGAIN)
+            process_msg = &shm_engine_t::push_one_then_decode_and_push;
+        return -1;
+    }
+    return 0;
+}
+
+int zmq::shm_engine_t::push_one_then_decode_and_push (msg_t *msg_)
+{
+    const int rc = session->push_msg (msg_);
+    if (rc == 0)
+        process_msg = &shm_engine_t::decode_and_push;
+    return rc;
+}
+
+#endif
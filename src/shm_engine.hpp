@@ -0,0 +1,199 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_SHM_ENGINE_HPP_INCLUDED__
+#define __ZMQ_SHM_ENGINE_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_SHM
+
+#include <stddef.h>
+#include <string>
+
+#include "fd.hpp"
+#include "i_engine.hpp"
+#include "io_object.hpp"
+#include "i_encoder.hpp"
+#include "i_decoder.hpp"
+#include "options.hpp"
+#include "shm_ring.hpp"
+#include "stream_engine.hpp"
+#include "msg.hpp"
+
+namespace zmq
+{
+
+    class io_thread_t;
+    class session_base_t;
+    class socket_base_t;
+    class mechanism_t;
+    class metadata_t;
+
+    //  Engine of the shm:// transport. Messages travel through a pair
+    //  of rings in a memory region shared by the two processes, one per
+    //  direction, framed the same way as ZMTP/3.0 traffic is and
+    //  starting with the READY commands of the NULL mechanism. The
+    //  region and the eventfds used for wakeups are created by the
+    //  listening side and passed over the UNIX domain socket the
+    //  connection was established with. The socket stays open for the
+    //  lifetime of the connection, so that either side notices when the
+    //  other one goes away.
+
+    class shm_engine_t : public io_object_t, public i_engine
+    {
+    public:
+
+        shm_engine_t (fd_t fd_, bool as_server_,
+            const shared_options_t &options_, const std::string &endpoint_);
+        ~shm_engine_t ();
+
+        //  i_engine interface implementation.
+        void plug (zmq::io_thread_t *io_thread_,
+           zmq::session_base_t *session_);
+        void terminate ();
+        void restart_input ();
+        void restart_output ();
+        void zap_msg_available ();
+        bool flush () { return false; }
+
+        //  i_poll_events interface implementation.
+        void in_event ();
+        void timer_event (int id_);
+
+    private:
+
+        //  Creates the shared region and the eventfds and passes them
+        //  to the peer.
+        int create_region ();
+
+        //  Receives the shared region and the eventfds from the peer.
+        //  Returns -1 with EAGAIN if they have not arrived yet.
+        int receive_region ();
+
+        //  Maps the region of two rings of 'capacity_' bytes shared
+        //  through 'fd_' and attaches to them.
+        int map_region (fd_t fd_, size_t capacity_);
+
+        //  Starts the handshake once the region is set up.
+        void start ();
+
+        //  Moves messages from the session into the outgoing ring.
+        void produce ();
+
+        //  Moves messages from the incoming ring to the session. Returns
+        //  false if the engine has been destroyed because of an error.
+        bool consume ();
+
+        //  Wakes the peer up.
+        void wake_peer ();
+
+        //  Destroys the engine after telling the session about the error.
+        void error (stream_engine_t::error_reason_t reason_);
+
+        void unplug ();
+
+        int next_handshake_command (msg_t *msg_);
+        int process_handshake_command (msg_t *msg_);
+        void mechanism_ready ();
+
+        int write_credential (msg_t *msg_);
+        int pull_and_encode (msg_t *msg_);
+        int decode_and_push (msg_t *msg_);
+        int push_one_then_decode_and_push (msg_t *msg_);
+
+        //  ID of the handshake timer.
+        enum {handshake_timer_id = 0x40};
+
+        //  UNIX domain socket the connection was established with.
+        fd_t s;
+        handle_t handle;
+
+        //  True iff we are the listening side, which creates the region.
+        const bool as_server;
+
+        //  Region shared with the peer, holding both rings.
+        void *region;
+        size_t region_size;
+
+        //  Rings carrying data to and from the peer.
+        shm_ring_t tx;
+        shm_ring_t rx;
+
+        //  Eventfd the peer signals to wake us up, and the one we signal
+        //  to wake the peer up.
+        fd_t wake_fd;
+        handle_t wake_handle;
+        fd_t peer_wake_fd;
+
+        //  True iff the eventfd has been registered with the poller.
+        bool wake_fd_polled;
+
+        msg_t tx_msg;
+        i_encoder *encoder;
+        i_decoder *decoder;
+
+        //  The session this engine is attached to.
+        zmq::session_base_t *session;
+
+        //  Options of the socket the engine belongs to.
+        shared_options_t shared_options;
+        const options_t &options;
+
+        //  String representation of endpoint.
+        std::string endpoint;
+
+        //  Credentials of the peer process, for ZAP and metadata.
+        std::string peer_address;
+
+        bool plugged;
+
+        int (shm_engine_t::*next_msg) (msg_t *msg_);
+        int (shm_engine_t::*process_msg) (msg_t *msg_);
+
+        mechanism_t *mechanism;
+
+        //  Metadata to be attached to received messages. May be NULL.
+        metadata_t *metadata;
+
+        //  True iff the session could not accept more messages.
+        bool input_stopped;
+
+        //  True iff the session had no messages for us.
+        bool output_stopped;
+
+        //  True iff the peer has closed the connection. We are still
+        //  going to deliver the messages it left in the ring.
+        bool peer_gone;
+
+        //  True iff the handshake timer is running.
+        bool has_handshake_timer;
+
+        //  Socket the engine belongs to.
+        zmq::socket_base_t *socket;
+
+        shm_engine_t (const shm_engine_t&);
+        const shm_engine_t &operator = (const shm_engine_t&);
+    };
+
+}
+
+#endif
+
+#endif
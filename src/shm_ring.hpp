@@ -0,0 +1,190 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_SHM_RING_HPP_INCLUDED__
+#define __ZMQ_SHM_RING_HPP_INCLUDED__
+
+#include <stddef.h>
+
+#include "stdint.hpp"
+#include "err.hpp"
+
+namespace zmq
+{
+
+    //  Single-producer, single-consumer ring of bytes in memory shared
+    //  by two processes (shm:// transport). The region starts with a
+    //  control block followed by the data. Positions grow monotonically
+    //  and are reduced modulo the capacity, a power of two, on access.
+    //
+    //  Neither side ever blocks in here. A consumer that finds the ring
+    //  empty, or a producer that finds it full, announces that it is
+    //  waiting and goes to sleep on its eventfd; the other side checks
+    //  the announcement after moving its position and wakes it up only
+    //  then, so busy rings need no system calls at all.
+
+    class shm_ring_t
+    {
+    public:
+
+        inline shm_ring_t () :
+            ctrl (NULL),
+            data (NULL),
+            capacity (0),
+            head (0),
+            tail (0)
+        {
+        }
+
+        //  Returns the size of the shared region of a ring with the given
+        //  capacity.
+        static inline size_t region_size (size_t capacity_)
+        {
+            return sizeof (ctrl_t) + capacity_;
+        }
+
+        //  Attaches to the ring at 'region_'. Fresh memory, as returned
+        //  from a newly truncated file, is an empty ring.
+        inline void attach (void *region_, size_t capacity_)
+        {
+            zmq_assert ((capacity_ & (capacity_ - 1)) == 0);
+            ctrl = static_cast <ctrl_t *> (region_);
+            data = static_cast <unsigned char *> (region_) + sizeof (ctrl_t);
+            capacity = capacity_;
+            head = __atomic_load_n (&ctrl->head, __ATOMIC_ACQUIRE);
+            tail = __atomic_load_n (&ctrl->tail, __ATOMIC_ACQUIRE);
+        }
+
+        //  Producer side.
+
+        //  Returns the size of the contiguous free space at '*ptr_'.
+        inline size_t free_space (unsigned char **ptr_)
+        {
+            tail = __atomic_load_n (&ctrl->tail, __ATOMIC_ACQUIRE);
+            const size_t offset = (size_t) (head & (capacity - 1));
+            const size_t space = capacity - (size_t) (head - tail);
+            *ptr_ = data + offset;
+            return space < capacity - offset ? space : capacity - offset;
+        }
+
+        //  Makes 'size_' bytes written to the free space available to
+        //  the consumer.
+        inline void produce (size_t size_)
+        {
+            head += size_;
+            __atomic_store_n (&ctrl->head, head, __ATOMIC_RELEASE);
+        }
+
+        //  Returns true iff the consumer is asleep waiting for data and
+        //  has to be woken up.
+        inline bool reader_needs_wakeup ()
+        {
+            __atomic_thread_fence (__ATOMIC_SEQ_CST);
+            return __atomic_load_n (&ctrl->reader_waiting, __ATOMIC_RELAXED)
+                && __atomic_exchange_n (&ctrl->reader_waiting, 0,
+                    __ATOMIC_ACQ_REL);
+        }
+
+        //  Announces that the producer is going to sleep until there is
+        //  free space. Returns false if space has been freed meanwhile,
+        //  in which case the producer should go on instead.
+        inline bool wait_for_space ()
+        {
+            __atomic_store_n (&ctrl->writer_waiting, 1, __ATOMIC_RELAXED);
+            __atomic_thread_fence (__ATOMIC_SEQ_CST);
+            if (head - __atomic_load_n (&ctrl->tail, __ATOMIC_ACQUIRE) <
+                  capacity) {
+                __atomic_store_n (&ctrl->writer_waiting, 0, __ATOMIC_RELAXED);
+                return false;
+            }
+            return true;
+        }
+
+        //  Consumer side.
+
+        //  Returns the size of the contiguous data available at '*ptr_'.
+        inline size_t available (const unsigned char **ptr_)
+        {
+            head = __atomic_load_n (&ctrl->head, __ATOMIC_ACQUIRE);
+            const size_t offset = (size_t) (tail & (capacity - 1));
+            const size_t size = (size_t) (head - tail);
+            *ptr_ = data + offset;
+            return size < capacity - offset ? size : capacity - offset;
+        }
+
+        //  Releases 'size_' bytes of data to the producer.
+        inline void consume (size_t size_)
+        {
+            tail += size_;
+            __atomic_store_n (&ctrl->tail, tail, __ATOMIC_RELEASE);
+        }
+
+        //  Returns true iff the producer is asleep waiting for space and
+        //  has to be woken up.
+        inline bool writer_needs_wakeup ()
+        {
+            __atomic_thread_fence (__ATOMIC_SEQ_CST);
+            return __atomic_load_n (&ctrl->writer_waiting, __ATOMIC_RELAXED)
+                && __atomic_exchange_n (&ctrl->writer_waiting, 0,
+                    __ATOMIC_ACQ_REL);
+        }
+
+        //  Announces that the consumer is going to sleep until there are
+        //  data. Returns false if data have arrived meanwhile, in which
+        //  case the consumer should go on instead.
+        inline bool wait_for_data ()
+        {
+            __atomic_store_n (&ctrl->reader_waiting, 1, __ATOMIC_RELAXED);
+            __atomic_thread_fence (__ATOMIC_SEQ_CST);
+            if (__atomic_load_n (&ctrl->head, __ATOMIC_ACQUIRE) != tail) {
+                __atomic_store_n (&ctrl->reader_waiting, 0, __ATOMIC_RELAXED);
+                return false;
+            }
+            return true;
+        }
+
+    private:
+
+        //  Control block at the start of the shared region. The fields
+        //  written by either side live on separate cache lines.
+        struct ctrl_t
+        {
+            uint64_t head;
+            uint32_t reader_waiting;
+            unsigned char pad1 [64 - sizeof (uint64_t) - sizeof (uint32_t)];
+            uint64_t tail;
+            uint32_t writer_waiting;
+            unsigned char pad2 [64 - sizeof (uint64_t) - sizeof (uint32_t)];
+        };
+
+        ctrl_t *ctrl;
+        unsigned char *data;
+        size_t capacity;
+
+        //  Local copies of the positions.
+        uint64_t head;
+        uint64_t tail;
+
+        shm_ring_t (const shm_ring_t&);
+        const shm_ring_t &operator = (const shm_ring_t&);
+    };
+
+}
+
+#endif
@@ -35,12 +35,14 @@
 #include <new>
 #include <string>
 #include <algorithm>
+#include <limits.h>
 
 #include "socket_base.hpp"
 #include "tcp_listener.hpp"
 #include "ipc_listener.hpp"
 #include "tipc_listener.hpp"
 #include "tcp_connecter.hpp"
+#include "tls.hpp"
 #include "io_thread.hpp"
 #include "session_base.hpp"
 #include "config.hpp"
@@ -53,6 +55,7 @@
 #include "address.hpp"
 #include "ipc_address.hpp"
 #include "tcp_address.hpp"
+#include "udp_address.hpp"
 #include "tipc_address.hpp"
 #ifdef ZMQ_HAVE_OPENPGM
 #include "pgm_socket.hpp"
@@ -70,6 +73,8 @@
 #include "xpub.hpp"
 #include "xsub.hpp"
 #include "stream.hpp"
+#include "radio.hpp"
+#include "dish.hpp"
 
 bool zmq::socket_base_t::check_tag ()
 {
@@ -117,6 +122,12 @@ zmq::socket_base_t *zmq::socket_base_t::create (int type_, class ctx_t *parent_,
         case ZMQ_STREAM:
             s = new (std::nothrow) stream_t (parent_, tid_, sid_);
             break;
+        case ZMQ_RADIO:
+            s = new (std::nothrow) radio_t (parent_, tid_, sid_);
+            break;
+        case ZMQ_DISH:
+            s = new (std::nothrow) dish_t (parent_, tid_, sid_);
+            break;
         default:
             errno = EINVAL;
             return NULL;
@@ -130,7 +141,7 @@ zmq::socket_base_t *zmq::socket_base_t::create (int type_, class ctx_t *parent_,
 }
 
 zmq::socket_base_t::socket_base_t (ctx_t *parent_, uint32_t tid_, int sid_) :
-    own_t (parent_, tid_),
+    own_t (parent_, tid_, options),
     tag (0xbaddecaf),
     ctx_terminated (false),
     destroyed (false),
@@ -196,6 +207,9 @@ int zmq::socket_base_t::check_protocol (const std::string &protocol_)
     &&  protocol_ != "pgm"
     &&  protocol_ != "epgm"
     &&  protocol_ != "tipc"
+    &&  protocol_ != "shm"
+    &&  protocol_ != "udp"
+    &&  protocol_ != "tls"
     &&  protocol_ != "norm") {
         errno = EPROTONOSUPPORT;
         return -1;
@@ -233,6 +247,37 @@ int zmq::socket_base_t::check_protocol (const std::string &protocol_)
     }
 #endif
 
+    //  TLS transport needs OpenSSL.
+#if !defined ZMQ_HAVE_TLS
+    if (protocol_ == "tls") {
+        errno = EPROTONOSUPPORT;
+        return -1;
+    }
+#endif
+
+    //  SHM transport needs memfd and eventfd, which are Linux only.
+    //  It neither carries the raw protocol of ZMQ_STREAM sockets nor
+    //  runs security mechanisms other than NULL.
+#if !defined ZMQ_HAVE_SHM
+    if (protocol_ == "shm") {
+        errno = EPROTONOSUPPORT;
+        return -1;
+    }
+#endif
+    if (protocol_ == "shm"
+    &&  (options.raw_socket || options.mechanism != ZMQ_NULL)) {
+        errno = ENOCOMPATPROTO;
+        return -1;
+    }
+
+    //  UDP transport is not available on Windows.
+#if defined ZMQ_HAVE_WINDOWS
+    if (protocol_ == "udp") {
+        errno = EPROTONOSUPPORT;
+        return -1;
+    }
+#endif
+
     //  Check whether socket type and transport protocol match.
     //  Specifically, multicast protocols can't be combined with
     //  bi-directional messaging patterns (socket types).
@@ -243,6 +288,15 @@ int zmq::socket_base_t::check_protocol (const std::string &protocol_)
         return -1;
     }
 
+    //  Datagrams carry RADIO/DISH messages only, and those sockets do
+    //  not speak ZMTP, which would lose the groups of the messages.
+    if ((protocol_ == "udp")
+    !=  (options.type == ZMQ_RADIO || options.type == ZMQ_DISH)
+    &&  protocol_ != "inproc") {
+        errno = ENOCOMPATPROTO;
+        return -1;
+    }
+
     //  Protocol is available.
     return 0;
 }
@@ -272,6 +326,9 @@ int zmq::socket_base_t::setsockopt (int option_, const void *optval_,
         return -1;
     }
 
+    //  Endpoints created from now on have to see the new value.
+    options_snapshot.reset ();
+
     //  First, check whether specific socket type overloads the option.
     int rc = xsetsockopt (option_, optval_, optvallen_);
     if (rc == 0 || errno != EINVAL)
@@ -338,9 +395,21 @@ int zmq::socket_base_t::getsockopt (int option_, void *optval_,
         return 0;
     }
 
+    //  Check whether specific socket type overloads the option.
+    int rc = xgetsockopt (option_, optval_, optvallen_);
+    if (rc == 0 || errno != EINVAL)
+        return rc;
+
     return options.getsockopt (option_, optval_, optvallen_);
 }
 
+const zmq::shared_options_t &zmq::socket_base_t::get_options_snapshot ()
+{
+    if (options_snapshot.empty ())
+        options_snapshot = shared_options_t (options);
+    return options_snapshot;
+}
+
 int zmq::socket_base_t::bind (const char *addr_)
 {
     if (unlikely (ctx_terminated)) {
@@ -369,9 +438,10 @@ int zmq::socket_base_t::bind (const char *addr_)
         return rc;
     }
 
-    if (protocol == "pgm" || protocol == "epgm" || protocol == "norm") {
+    if (protocol == "pgm" || protocol == "epgm" || protocol == "norm"
+    ||  protocol == "udp") {
         //  For convenience's sake, bind can be used interchageable with
-        //  connect for PGM, EPGM and NORM transports.
+        //  connect for PGM, EPGM, NORM and UDP transports.
         return connect (addr_);
     }
 
@@ -383,9 +453,14 @@ int zmq::socket_base_t::bind (const char *addr_)
         return -1;
     }
 
-    if (protocol == "tcp") {
+    if (protocol == "tcp" || protocol == "tls") {
+#if defined ZMQ_HAVE_TLS
+        //  The listening end is the TLS server, so it needs a certificate.
+        if (protocol == "tls" && tls_t::check_options (options, true, address) != 0)
+            return -1;
+#endif
         tcp_listener_t *listener = new (std::nothrow) tcp_listener_t (
-            io_thread, this, options);
+            io_thread, this, get_options_snapshot (), protocol == "tls");
         alloc_assert (listener);
         int rc = listener->set_address (address.c_str ());
         if (rc != 0) {
@@ -402,9 +477,9 @@ int zmq::socket_base_t::bind (const char *addr_)
     }
 
 #if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
-    if (protocol == "ipc") {
+    if (protocol == "ipc" || protocol == "shm") {
         ipc_listener_t *listener = new (std::nothrow) ipc_listener_t (
-            io_thread, this, options);
+            io_thread, this, get_options_snapshot (), protocol == "shm");
         alloc_assert (listener);
         int rc = listener->set_address (address.c_str ());
         if (rc != 0) {
@@ -423,7 +498,7 @@ int zmq::socket_base_t::bind (const char *addr_)
 #if defined ZMQ_HAVE_TIPC
     if (protocol == "tipc") {
          tipc_listener_t *listener = new (std::nothrow) tipc_listener_t (
-              io_thread, this, options);
+              io_thread, this, get_options_snapshot ());
          alloc_assert (listener);
          int rc = listener->set_address (address.c_str ());
          if (rc != 0) {
@@ -584,7 +659,14 @@ int zmq::socket_base_t::connect (const char *addr_)
     alloc_assert (paddr);
 
     //  Resolve address (if needed by the protocol)
-    if (protocol == "tcp") {
+    if (protocol == "tcp" || protocol == "tls") {
+#if defined ZMQ_HAVE_TLS
+        if (protocol == "tls"
+        &&  tls_t::check_options (options, false, address) != 0) {
+            delete paddr;
+            return -1;
+        }
+#endif
         //  Do some basic sanity checks on tcp:// address syntax
         //  - hostname starts with digit or letter, with embedded '-' or '.'
         //  - IPv6 address may contain hex chars and colons.
@@ -621,9 +703,21 @@ int zmq::socket_base_t::connect (const char *addr_)
         //  Defer resolution until a socket is opened
         paddr->resolved.tcp_addr = NULL;
     }
+    else
+    if (protocol == "udp") {
+        //  DISH sockets receive on the address, RADIO sockets send to it.
+        paddr->resolved.udp_addr = new (std::nothrow) udp_address_t ();
+        alloc_assert (paddr->resolved.udp_addr);
+        int rc = paddr->resolved.udp_addr->resolve (address.c_str (),
+            options.type == ZMQ_DISH);
+        if (rc != 0) {
+            delete paddr;
+            return -1;
+        }
+    }
 #if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
     else
-    if (protocol == "ipc") {
+    if (protocol == "ipc" || protocol == "shm") {
         paddr->resolved.ipc_addr = new (std::nothrow) ipc_address_t ();
         alloc_assert (paddr->resolved.ipc_addr);
         int rc = paddr->resolved.ipc_addr->resolve (address.c_str ());
@@ -660,9 +754,44 @@ int zmq::socket_base_t::connect (const char *addr_)
     }
 #endif
 
+    //  Socket types that spread messages across their peers can open
+    //  several TCP connections to the endpoint. Each one is a peer of its
+    //  own, running in a different I/O thread if possible. A peer that is
+    //  known by an explicit identity gets a single connection, as the
+    //  other end would reject the others as duplicates.
+    int stripes = 1;
+    if ((protocol == "tcp" || protocol == "tls")
+    &&  options.identity_size == 0 && connect_rid.empty ()
+    &&  (options.type == ZMQ_DEALER || options.type == ZMQ_ROUTER
+    ||   options.type == ZMQ_REQ || options.type == ZMQ_REP
+    ||   options.type == ZMQ_PUSH || options.type == ZMQ_PULL))
+        stripes = options.connect_stripes;
+
+    add_session (addr_, io_thread, paddr);
+
+    std::vector <io_thread_t*> taken (1, io_thread);
+    for (int i = 1; i < stripes; i++) {
+        io_thread = choose_io_thread (options.affinity, &taken);
+        zmq_assert (io_thread);
+        taken.push_back (io_thread);
+
+        paddr = new (std::nothrow) address_t (protocol, address);
+        alloc_assert (paddr);
+        paddr->resolved.tcp_addr = NULL;
+        add_session (addr_, io_thread, paddr);
+    }
+
+    return 0;
+}
+
+void zmq::socket_base_t::add_session (const char *addr_,
+    io_thread_t *io_thread_, address_t *paddr_)
+{
+    const std::string &protocol = paddr_->protocol;
+
     //  Create session.
-    session_base_t *session = session_base_t::create (io_thread, true, this,
-        options, paddr);
+    session_base_t *session = session_base_t::create (io_thread_, true, this,
+        get_options_snapshot (), paddr_);
     errno_assert (session);
 
     //  PGM does not support subscription forwarding; ask for all data to be
@@ -670,7 +799,8 @@ int zmq::socket_base_t::connect (const char *addr_)
     bool subscribe_to_all = protocol == "pgm" || protocol == "epgm" || protocol == "norm";
     pipe_t *newpipe = NULL;
 
-    if (options.immediate != 1 || subscribe_to_all) {
+    //  There is no connection to wait for with UDP either.
+    if (options.immediate != 1 || subscribe_to_all || protocol == "udp") {
         //  Create a bi-directional pipe.
         object_t *parents [2] = {this, session};
         pipe_t *new_pipes [2] = {NULL, NULL};
@@ -685,7 +815,7 @@ int zmq::socket_base_t::connect (const char *addr_)
         int hwms [2] = {conflate? -1 : options.sndhwm,
             conflate? -1 : options.rcvhwm};
         bool conflates [2] = {conflate, conflate};
-        rc = pipepair (parents, new_pipes, hwms, conflates);
+        int rc = pipepair (parents, new_pipes, hwms, conflates);
         errno_assert (rc == 0);
 
         //  Attach local end of the pipe to the socket object.
@@ -697,10 +827,9 @@ int zmq::socket_base_t::connect (const char *addr_)
     }
 
     //  Save last endpoint URI
-    paddr->to_string (last_endpoint);
+    paddr_->to_string (last_endpoint);
 
     add_endpoint (addr_, (own_t *) session, newpipe);
-    return 0;
 }
 
 void zmq::socket_base_t::add_endpoint (const char *addr_, own_t *endpoint_, pipe_t *pipe)
@@ -710,6 +839,36 @@ void zmq::socket_base_t::add_endpoint (const char *addr_, own_t *endpoint_, pipe
     endpoints.insert (endpoints_t::value_type (std::string (addr_), endpoint_pipe_t (endpoint_, pipe)));
 }
 
+int zmq::socket_base_t::join (const char *group_)
+{
+    if (unlikely (ctx_terminated)) {
+        errno = ETERM;
+        return -1;
+    }
+
+    if (unlikely (!group_)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return xjoin (group_);
+}
+
+int zmq::socket_base_t::leave (const char *group_)
+{
+    if (unlikely (ctx_terminated)) {
+        errno = ETERM;
+        return -1;
+    }
+
+    if (unlikely (!group_)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return xleave (group_);
+}
+
 int zmq::socket_base_t::term_endpoint (const char *addr_)
 {
     //  Check whether the library haven't been shut down yet.
@@ -1063,6 +1222,12 @@ int zmq::socket_base_t::xsetsockopt (int, const void *, size_t)
     return -1;
 }
 
+int zmq::socket_base_t::xgetsockopt (int, void *, size_t *)
+{
+    errno = EINVAL;
+    return -1;
+}
+
 bool zmq::socket_base_t::xhas_out ()
 {
     return false;
@@ -1085,6 +1250,18 @@ int zmq::socket_base_t::xrecv (msg_t *)
     return -1;
 }
 
+int zmq::socket_base_t::xjoin (const char *)
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
+int zmq::socket_base_t::xleave (const char *)
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
 zmq::blob_t zmq::socket_base_t::get_credential () const
 {
     return blob_t ();
@@ -1302,6 +1479,14 @@ void zmq::socket_base_t::event_disconnected (const std::string &addr_, int fd_)
         monitor_event (ZMQ_EVENT_DISCONNECTED, fd_, addr_);
 }
 
+void zmq::socket_base_t::event_messages_lost (const std::string &addr_,
+    uint64_t count_)
+{
+    if (monitor_events & ZMQ_EVENT_MESSAGES_LOST)
+        monitor_event (ZMQ_EVENT_MESSAGES_LOST,
+            count_ > INT_MAX ? INT_MAX : (int) count_, addr_);
+}
+
 //  Send a monitor event
 void zmq::socket_base_t::monitor_event (int event_, int value_, const std::string &addr_)
 {
@@ -47,6 +47,8 @@ namespace zmq
     class ctx_t;
     class msg_t;
     class pipe_t;
+    class io_thread_t;
+    struct address_t;
 
     class socket_base_t :
         public own_t,
@@ -78,6 +80,8 @@ namespace zmq
         int bind (const char *addr_);
         int connect (const char *addr_);
         int term_endpoint (const char *addr_);
+        int join (const char *group_);
+        int leave (const char *group_);
         int send (zmq::msg_t *msg_, int flags_);
         int recv (zmq::msg_t *msg_, int flags_);
         int close ();
@@ -120,6 +124,7 @@ namespace zmq
         void event_closed (const std::string &addr_, int fd_);
         void event_close_failed (const std::string &addr_, int fd_);
         void event_disconnected (const std::string &addr_, int fd_);
+        void event_messages_lost (const std::string &addr_, uint64_t count_);
 
     protected:
 
@@ -137,6 +142,11 @@ namespace zmq
         virtual int xsetsockopt (int option_, const void *optval_,
             size_t optvallen_);
 
+        //  The default implementation assumes there are no specific socket
+        //  options to read for the particular socket type.
+        virtual int xgetsockopt (int option_, void *optval_,
+            size_t *optvallen_);
+
         //  The default implementation assumes that send is not supported.
         virtual bool xhas_out ();
         virtual int xsend (zmq::msg_t *msg_);
@@ -145,6 +155,11 @@ namespace zmq
         virtual bool xhas_in ();
         virtual int xrecv (zmq::msg_t *msg_);
 
+        //  The default implementation assumes that groups are not
+        //  supported.
+        virtual int xjoin (const char *group_);
+        virtual int xleave (const char *group_);
+
         //  Returns the credential for the peer from which we have received
         //  the last message. If no message has been received yet,
         //  the function returns empty credential.
@@ -168,10 +183,27 @@ namespace zmq
         // Next assigned name on a zmq_connect() call used by ROUTER and STREAM socket types
         std::string connect_rid;
 
+        //  Options of the socket. These are the options own_t refers to.
+        options_t options;
+
     private:
+
+        //  Returns the snapshot of the socket's options to be shared by
+        //  the objects created for a new endpoint.
+        const shared_options_t &get_options_snapshot ();
+
+        //  Snapshot handed out to the last endpoint. It is reused until
+        //  the options change.
+        shared_options_t options_snapshot;
+
         //  Creates new endpoint ID and adds the endpoint to the map.
         void add_endpoint (const char *addr_, own_t *endpoint_, pipe_t *pipe);
 
+        //  Creates the session connecting to the address and adds it
+        //  as an endpoint.
+        void add_session (const char *addr_, zmq::io_thread_t *io_thread_,
+            zmq::address_t *paddr_);
+
         //  Map of open endpoints.
         typedef std::pair <own_t *, pipe_t*> endpoint_pipe_t;
         typedef std::multimap <std::string, endpoint_pipe_t> endpoints_t;
@@ -41,7 +41,7 @@
 #endif
 
 zmq::socks_connecter_t::socks_connecter_t (class io_thread_t *io_thread_,
-      class session_base_t *session_, const options_t &options_,
+      class session_base_t *session_, const shared_options_t &options_,
       address_t *addr_, address_t *proxy_addr_, bool delayed_start_) :
     own_t (io_thread_, options_),
     io_object_t (io_thread_),
@@ -142,7 +142,7 @@ void zmq::socks_connecter_t::in_event ()
 
                 //  Create the engine object for this connection.
                 stream_engine_t *engine = new (std::nothrow)
-                    stream_engine_t (s, options, endpoint);
+                    stream_engine_t (s, shared_options, endpoint);
                 alloc_assert (engine);
 
                 //  Attach the engine to the corresponding session object.
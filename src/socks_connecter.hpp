@@ -41,7 +41,7 @@ namespace zmq
         //  If 'delayed_start' is true connecter first waits for a while,
         //  then starts connection process.
         socks_connecter_t (zmq::io_thread_t *io_thread_,
-            zmq::session_base_t *session_, const options_t &options_,
+            zmq::session_base_t *session_, const shared_options_t &options_,
             address_t *addr_, address_t *proxy_addr_,  bool delayed_start_);
         ~socks_connecter_t ();
 
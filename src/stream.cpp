@@ -59,9 +59,8 @@ void zmq::stream_t::xattach_pipe (pipe_t *pipe_, bool subscribe_to_all_)
 
 void zmq::stream_t::xpipe_terminated (pipe_t *pipe_)
 {
-    outpipes_t::iterator it = outpipes.find (pipe_->get_identity ());
-    zmq_assert (it != outpipes.end ());
-    outpipes.erase (it);
+    const bool erased = outpipes.erase (pipe_->get_identity ());
+    zmq_assert (erased);
     fq.pipe_terminated (pipe_);
     if (pipe_ == current_out)
         current_out = NULL;
@@ -74,14 +73,10 @@ void zmq::stream_t::xread_activated (pipe_t *pipe_)
 
 void zmq::stream_t::xwrite_activated (pipe_t *pipe_)
 {
-    outpipes_t::iterator it;
-    for (it = outpipes.begin (); it != outpipes.end (); ++it)
-        if (it->second.pipe == pipe_)
-            break;
-
-    zmq_assert (it != outpipes.end ());
-    zmq_assert (!it->second.active);
-    it->second.active = true;
+    outpipe_t *outpipe = outpipes.find (pipe_->get_identity ());
+    zmq_assert (outpipe && outpipe->pipe == pipe_);
+    zmq_assert (!outpipe->active);
+    outpipe->active = true;
 }
 
 int zmq::stream_t::xsend (msg_t *msg_)
@@ -98,13 +93,13 @@ int zmq::stream_t::xsend (msg_t *msg_)
 
             //  Find the pipe associated with the identity stored in the prefix.
             //  If there's no such pipe return an error
-            blob_t identity ((unsigned char*) msg_->data (), msg_->size ());
-            outpipes_t::iterator it = outpipes.find (identity);
+            outpipe_t *outpipe = outpipes.find (
+                (unsigned char*) msg_->data (), msg_->size ());
 
-            if (it != outpipes.end ()) {
-                current_out = it->second.pipe;
+            if (outpipe) {
+                current_out = outpipe->pipe;
                 if (!current_out->check_write ()) {
-                    it->second.active = false;
+                    outpipe->active = false;
                     current_out = NULL;
                     errno = EAGAIN;
                     return -1;
@@ -218,7 +213,7 @@ int zmq::stream_t::xrecv (msg_t *msg_)
     //  We have received a frame with TCP data.
     //  Rather than sendig this frame, we keep it in prefetched
     //  buffer and send a frame with peer's ID.
-    blob_t identity = pipe->get_identity ();
+    const blob_t &identity = pipe->get_identity ();
     rc = msg_->init_size (identity.size ());
     errno_assert (rc == 0);
     memcpy (msg_->data (), identity.data (), identity.size ());
@@ -246,7 +241,7 @@ bool zmq::stream_t::xhas_in ()
     zmq_assert (pipe != NULL);
     zmq_assert ((prefetched_msg.flags () & msg_t::more) == 0);
 
-    blob_t identity = pipe->get_identity ();
+    const blob_t &identity = pipe->get_identity ();
     rc = prefetched_id.init_size (identity.size ());
     errno_assert (rc == 0);
     memcpy (prefetched_id.data (), identity.data (), identity.size ());
@@ -272,24 +267,23 @@ void zmq::stream_t::identify_peer (pipe_t *pipe_)
     unsigned char buffer [5];
     buffer [0] = 0;
     blob_t identity;
+    bool generated = false;
     if (connect_rid.length ()) {
         identity = blob_t ((unsigned char*) connect_rid.c_str(),
             connect_rid.length ());
         connect_rid.clear ();
-        outpipes_t::iterator it = outpipes.find (identity);
-        if (it != outpipes.end ()) 
-            zmq_assert(false);
+        zmq_assert (!outpipes.find (identity));
     }
     else {
         put_uint32 (buffer + 1, next_rid++);
         identity = blob_t (buffer, sizeof buffer);
+        generated = true;
         memcpy (options.identity, identity.data (), identity.size ());
         options.identity_size = identity.size ();
     }
     pipe_->set_identity (identity);
     //  Add the record into output pipes lookup table
     outpipe_t outpipe = {pipe_, true};
-    const bool ok = outpipes.insert (
-        outpipes_t::value_type (identity, outpipe)).second;
+    const bool ok = outpipes.insert (identity, outpipe, generated);
     zmq_assert (ok);
 }
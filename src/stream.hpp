@@ -20,9 +20,8 @@
 #ifndef __ZMQ_STREAM_HPP_INCLUDED__
 #define __ZMQ_STREAM_HPP_INCLUDED__
 
-#include <map>
-
 #include "router.hpp"
+#include "identity_map.hpp"
 
 namespace zmq
 {
@@ -75,7 +74,7 @@ namespace zmq
         };
 
         //  Outbound pipes indexed by the peer IDs.
-        typedef std::map <blob_t, outpipe_t> outpipes_t;
+        typedef identity_map_t <outpipe_t> outpipes_t;
         outpipes_t outpipes;
 
         //  The pipe we are currently writing to.
@@ -60,22 +60,34 @@
 #include "tcp.hpp"
 #include "likely.hpp"
 #include "wire.hpp"
-
-zmq::stream_engine_t::stream_engine_t (fd_t fd_, const options_t &options_,
-                                       const std::string &endpoint_) :
+#include "lz4_codec.hpp"
+#include "fd_passing.hpp"
+#include "tls.hpp"
+#include "ctx.hpp"
+#include "crypto_pool.hpp"
+
+zmq::stream_engine_t::stream_engine_t (fd_t fd_,
+                                       const shared_options_t &options_,
+                                       const std::string &endpoint_,
+                                       tls_t *tls_) :
     s (fd_),
     inpos (NULL),
     insize (0),
     decoder (NULL),
+    in_batch (options_.get ().in_batch_size, options_.get ().batch_adaptive),
     outpos (NULL),
     outsize (0),
     encoder (NULL),
+    out_batch (options_.get ().out_batch_size,
+        options_.get ().batch_adaptive),
+    batch_pool (NULL),
     metadata (NULL),
     handshaking (true),
     greeting_size (v2_greeting_size),
     greeting_bytes_read (0),
     session (NULL),
-    options (options_),
+    shared_options (options_),
+    options (shared_options.get ()),
     endpoint (endpoint_),
     plugged (false),
     next_msg (&stream_engine_t::identity_msg),
@@ -86,6 +98,27 @@ zmq::stream_engine_t::stream_engine_t (fd_t fd_, const options_t &options_,
     input_stopped (false),
     output_stopped (false),
     has_handshake_timer (false),
+    coalescing (false),
+    has_flush_timer (false),
+    flushing (false),
+    has_release_timer (false),
+    buffers_used (false),
+    compressing (false),
+    accepting_fds (false),
+    passing_fds (false),
+    tls (tls_),
+    tls_handshaking (tls_ != NULL),
+    crypto_pool (NULL),
+    crypto_out_pos (0),
+    crypto_in_pos (0),
+    crypto_in_decoded (0),
+    crypto_in_size (0),
+    crypto_in_stalled (false),
+    has_heartbeat_timer (false),
+    has_timeout_timer (false),
+    has_ttl_timer (false),
+    pong_context_size (0),
+    ping_pending (false),
     socket (NULL)
 {
     int rc = tx_msg.init ();
@@ -94,6 +127,18 @@ zmq::stream_engine_t::stream_engine_t (fd_t fd_, const options_t &options_,
     //  Put the socket into non-blocking mode.
     unblock_socket (s);
 
+#if defined ZMQ_HAVE_MEMFD
+    //  Messages can be passed as memfds over UNIX domain sockets. Only the
+    //  mechanisms without encryption offer that.
+    if (options.ipc_fd_threshold >= 0 && !options.raw_socket
+    &&  (options.mechanism == ZMQ_NULL || options.mechanism == ZMQ_PLAIN)) {
+        struct sockaddr_storage ss;
+        socklen_t sl = sizeof ss;
+        accepting_fds = getsockname (s, (struct sockaddr *) &ss, &sl) == 0
+                     && ss.ss_family == AF_UNIX;
+    }
+#endif
+
     int family = get_peer_ip_address (s, peer_address);
     if (family == 0)
         peer_address.clear();
@@ -149,15 +194,41 @@ zmq::stream_engine_t::~stream_engine_t ()
         s = retired_fd;
     }
 
+#if defined ZMQ_HAVE_MEMFD
+    //  Close the descriptors passed by the peer that we have not used
+    //  and the ones that we did not get to pass.
+    while (!received_fds.empty ()) {
+        close (received_fds.front ());
+        received_fds.pop_front ();
+    }
+    for (size_t i = 0; i != pending_fds.size (); i++)
+        close (pending_fds [i]);
+#endif
+
     int rc = tx_msg.close ();
     errno_assert (rc == 0);
 
+    //  Messages of the crypto batches that were not written or pushed.
+    //  The others are empty.
+    for (size_t i = 0; i != crypto_out.size (); i++) {
+        rc = crypto_out [i].close ();
+        errno_assert (rc == 0);
+    }
+    for (size_t i = 0; i != crypto_in.size (); i++) {
+        rc = crypto_in [i].close ();
+        errno_assert (rc == 0);
+    }
+
     //  Drop reference to metadata and destroy it if we are
     //  the only user.
     if (metadata != NULL)
         if (metadata->drop_ref ())
             delete metadata;
 
+#if defined ZMQ_HAVE_TLS
+    delete tls;
+#endif
+
     delete encoder;
     delete decoder;
     delete mechanism;
@@ -178,14 +249,17 @@ void zmq::stream_engine_t::plug (io_thread_t *io_thread_,
     //  Connect to I/O threads poller object.
     io_object_t::plug (io_thread_);
     handle = add_fd (s);
+    batch_pool = io_thread_->get_batch_pool ();
     io_error = false;
 
     if (options.raw_socket) {
         // no handshaking for raw sock, instantiate raw encoder and decoders
-        encoder = new (std::nothrow) raw_encoder_t (out_batch_size);
+        encoder = new (std::nothrow) raw_encoder_t (
+            out_batch.size (), batch_pool);
         alloc_assert (encoder);
 
-        decoder = new (std::nothrow) raw_decoder_t (in_batch_size);
+        decoder = new (std::nothrow) raw_decoder_t (
+            in_batch.size (), batch_pool);
         alloc_assert (decoder);
 
         // disable handshaking for raw socket
@@ -193,6 +267,7 @@ void zmq::stream_engine_t::plug (io_thread_t *io_thread_,
 
         next_msg = &stream_engine_t::pull_msg_from_session;
         process_msg = &stream_engine_t::push_msg_to_session;
+        coalescing = options.snd_delay > 0;
 
         if (options.raw_notify) {
             //  For raw sockets, send an initial 0-length message to the
@@ -215,6 +290,28 @@ void zmq::stream_engine_t::plug (io_thread_t *io_thread_,
         put_uint64 (&outpos [outsize], options.identity_size + 1);
         outsize += 8;
         outpos [outsize++] = 0x7f;
+
+        //  With TCP Fast Open the greeting travels with the SYN, so send
+        //  all of it right away instead of waiting for the peer's version.
+        //  The first handshake command follows as soon as the greeting is
+        //  written.
+        if (options.tcp_fastopen) {
+            outpos [outsize++] = 3;     //  Major version number
+            put_v3_greeting ();
+
+            encoder = new (std::nothrow) v2_encoder_t (
+                out_batch.size (), batch_pool);
+            alloc_assert (encoder);
+
+            decoder = new (std::nothrow) v2_decoder_t (
+                in_batch.size (), options.maxmsgsize, batch_pool);
+            alloc_assert (decoder);
+
+            const bool created = create_mechanism ();
+            zmq_assert (created);
+            next_msg = &stream_engine_t::next_handshake_command;
+            process_msg = &stream_engine_t::process_handshake_command;
+        }
     }
 
     set_pollin (handle);
@@ -234,6 +331,31 @@ void zmq::stream_engine_t::unplug ()
         has_handshake_timer = false;
     }
 
+    if (has_flush_timer) {
+        cancel_timer (flush_timer_id);
+        has_flush_timer = false;
+    }
+
+    if (has_release_timer) {
+        cancel_timer (release_timer_id);
+        has_release_timer = false;
+    }
+
+    if (has_heartbeat_timer) {
+        cancel_timer (heartbeat_ivl_timer_id);
+        has_heartbeat_timer = false;
+    }
+
+    if (has_timeout_timer) {
+        cancel_timer (heartbeat_timeout_timer_id);
+        has_timeout_timer = false;
+    }
+
+    if (has_ttl_timer) {
+        cancel_timer (heartbeat_ttl_timer_id);
+        has_ttl_timer = false;
+    }
+
     //  Cancel all fd subscriptions.
     if (!io_error)
         rm_fd (handle);
@@ -250,10 +372,35 @@ void zmq::stream_engine_t::terminate ()
     delete this;
 }
 
+bool zmq::stream_engine_t::flush ()
+{
+    //  Nothing taken from the session is waiting to be written.
+    if (io_error || handshaking || tls_handshaking
+    ||  (outsize == 0 && output_stopped && !has_flush_timer))
+        return false;
+
+    //  The session considers the messages in the write buffer, held back
+    //  by coalescing or not, as sent. Write them out without waiting for
+    //  more.
+    if (has_flush_timer) {
+        cancel_timer (flush_timer_id);
+        has_flush_timer = false;
+        out_batch.update (outsize);
+    }
+    flushing = true;
+    set_pollout (handle);
+    output_stopped = false;
+    return true;
+}
+
 void zmq::stream_engine_t::in_event ()
 {
     zmq_assert (!io_error);
 
+    if (unlikely (tls_handshaking))
+        if (!tls_handshake ())
+            return;
+
     //  If still handshaking, receive and process the greeting message.
     if (unlikely (handshaking))
         if (!handshake ())
@@ -268,45 +415,67 @@ void zmq::stream_engine_t::in_event ()
         return;
     }
 
-    //  If there's no data to process in the buffer...
-    if (!insize) {
+    int rc = 0;
+    bool read_ahead;
+
+    do {
+        read_ahead = false;
+
+        //  If there's no data to process in the buffer...
+        if (!insize) {
+
+            //  Retrieve the buffer and read as much data as possible.
+            //  Note that buffer can be arbitrarily large. However, we assume
+            //  the underlying TCP layer has fixed buffer size and thus the
+            //  number of bytes read will be always limited.
+            size_t bufsize = 0;
+            decoder->resize_buffer (in_batch.size ());
+            decoder->get_buffer (&inpos, &bufsize);
+            set_buffers_used ();
+
+            const int rc = read_data (inpos, bufsize);
+            if (rc == 0 || (rc == -1 && errno != EAGAIN)) {
+                //  Deliver the messages that arrived before.
+                if (!crypto_in.empty ())
+                    push_crypto_batch ();
+                error (connection_error);
+                return;
+            }
+            if (rc == -1) {
+                if (crypto_in.empty ())
+                    return;
+                break;
+            }
 
-        //  Retrieve the buffer and read as much data as possible.
-        //  Note that buffer can be arbitrarily large. However, we assume
-        //  the underlying TCP layer has fixed buffer size and thus the
-        //  number of bytes read will be always limited.
-        size_t bufsize = 0;
-        decoder->get_buffer (&inpos, &bufsize);
+            //  Adjust input size
+            insize = static_cast <size_t> (rc);
+            in_batch.update (insize);
 
-        const int rc = tcp_read (s, inpos, bufsize);
-        if (rc == 0) {
-            error (connection_error);
-            return;
-        }
-        if (rc == -1) {
-            if (errno != EAGAIN)
-                error (connection_error);
-            return;
+            //  A read that filled the buffer suggests that more data is
+            //  waiting. Read on to collect a batch worth decoding in
+            //  parallel.
+            read_ahead = crypto_pool != NULL && insize == bufsize;
         }
 
-        //  Adjust input size
-        insize = static_cast <size_t> (rc);
-    }
+        size_t processed = 0;
 
-    int rc = 0;
-    size_t processed = 0;
+        while (insize > 0) {
+            rc = decoder->decode (inpos, insize, processed);
+            zmq_assert (processed <= insize);
+            inpos += processed;
+            insize -= processed;
+            if (rc == 0 || rc == -1)
+                break;
+            rc = (this->*process_msg) (decoder->msg ());
+            if (rc == -1)
+                break;
+        }
+    } while (rc != -1 && read_ahead
+          && crypto_in.size () - crypto_in_decoded < crypto_batch_msgs
+          && crypto_in_size < crypto_batch_size);
 
-    while (insize > 0) {
-        rc = decoder->decode (inpos, insize, processed);
-        zmq_assert (processed <= insize);
-        inpos += processed;
-        insize -= processed;
-        if (rc == 0 || rc == -1)
-            break;
-        rc = (this->*process_msg) (decoder->msg ());
-        if (rc == -1)
-            break;
-    }
+    if (rc != -1 && !crypto_in.empty ())
+        rc = push_crypto_batch ();
 
     //  Tear down the connection if we have failed to decode input data
     //  or the session has rejected the message.
@@ -320,12 +489,28 @@ void zmq::stream_engine_t::in_event ()
     }
 
     session->flush ();
+
+#if defined ZMQ_HAVE_TLS
+    //  Records are decrypted as a whole. What did not fit into the buffer
+    //  is already off the socket, so the poller won't report it.
+    if (tls && !input_stopped && insize == 0 && tls->pending ())
+        in_event ();
+#endif
 }
 
 void zmq::stream_engine_t::out_event ()
 {
     zmq_assert (!io_error);
 
+    if (unlikely (tls_handshaking))
+        if (!tls_handshake ())
+            return;
+
+    //  The batch is being held back until it fills up
+    //  or the flush timer expires.
+    if (unlikely (has_flush_timer))
+        return;
+
     //  If write buffer is empty, try to read new data from the encoder.
     if (!outsize) {
 
@@ -337,27 +522,40 @@ void zmq::stream_engine_t::out_event ()
             return;
         }
 
+        //  Handshake commands are never held back, not even the ones
+        //  encoded together with the first messages.
+        const bool coalesce = coalescing;
+
+        encoder->resize_buffer (out_batch.size ());
         outpos = NULL;
         outsize = encoder->encode (&outpos, 0);
+        encode_batch ();
 
-        while (outsize < out_batch_size) {
-            if ((this->*next_msg) (&tx_msg) == -1)
-                break;
-            encoder->load_msg (&tx_msg);
-            unsigned char *bufptr = outpos + outsize;
-            size_t n = encoder->encode (&bufptr, out_batch_size - outsize);
-            zmq_assert (n > 0);
-            if (outpos == NULL)
-                outpos = bufptr;
-            outsize += n;
+        //  If there is no data to send, stop polling for output. If the
+        //  session waits for that, it can go now, and so can we.
+        if (outsize == 0) {
+            output_stopped = true;
+            reset_pollout (handle);
+            if (unlikely (flushing)) {
+                session->engine_flushed ();
+                unplug ();
+                delete this;
+            }
+            return;
         }
+        set_buffers_used ();
 
-        //  If there is no data to send, stop polling for output.
-        if (outsize == 0) {
+        //  When coalescing, a batch that is not full is held back to give
+        //  subsequent messages a chance to share the same write.
+        if (coalesce && !flushing && outsize < out_batch.size ()) {
+            add_timer (options.snd_delay, flush_timer_id);
+            has_flush_timer = true;
             output_stopped = true;
             reset_pollout (handle);
             return;
         }
+
+        out_batch.update (outsize);
     }
 
     //  If there are any data to write in write buffer, write as much as
@@ -365,13 +563,16 @@ void zmq::stream_engine_t::out_event ()
     //  arbitrarily large. However, we assume that underlying TCP layer has
     //  limited transmission buffer and thus the actual number of bytes
     //  written should be reasonably modest.
-    const int nbytes = tcp_write (s, outpos, outsize);
+    const int nbytes = write_data (outpos, outsize);
 
     //  IO error has occurred. We stop waiting for output events.
     //  The engine is not terminated until we detect input error;
-    //  this is necessary to prevent losing incoming messages.
+    //  this is necessary to prevent losing incoming messages. A session
+    //  waiting for the output to be written out can't get it anymore.
     if (nbytes == -1) {
         reset_pollout (handle);
+        if (unlikely (flushing))
+            error (connection_error);
         return;
     }
 
@@ -379,10 +580,16 @@ void zmq::stream_engine_t::out_event ()
     outsize -= nbytes;
 
     //  If we are still handshaking and there are no data
-    //  to send, stop polling for output.
+    //  to send, stop polling for output. If the handshake is
+    //  pipelined, go on with the first handshake command.
     if (unlikely (handshaking))
-        if (outsize == 0)
-            reset_pollout (handle);
+        if (outsize == 0) {
+            if (encoder == NULL)
+                reset_pollout (handle);
+            else
+            if (nbytes > 0)
+                out_event ();
+        }
 }
 
 void zmq::stream_engine_t::restart_output ()
@@ -391,6 +598,18 @@ void zmq::stream_engine_t::restart_output ()
         return;
 
     if (likely (output_stopped)) {
+
+        //  If a batch is being held back, add the new messages to it
+        //  and keep waiting unless the batch is full now.
+        if (has_flush_timer) {
+            encode_batch ();
+            if (outsize < out_batch.size ())
+                return;
+            cancel_timer (flush_timer_id);
+            has_flush_timer = false;
+            out_batch.update (outsize);
+        }
+
         set_pollout (handle);
         output_stopped = false;
     }
@@ -408,7 +627,10 @@ void zmq::stream_engine_t::restart_input ()
     zmq_assert (session != NULL);
     zmq_assert (decoder != NULL);
 
-    int rc = (this->*process_msg) (decoder->msg ());
+    //  With a crypto pool, the session refused a message of the batch.
+    int rc = crypto_in.empty ()
+           ? (this->*process_msg) (decoder->msg ())
+           : push_crypto_batch ();
     if (rc == -1) {
         if (errno == EAGAIN)
             session->flush ();
@@ -430,6 +652,9 @@ void zmq::stream_engine_t::restart_input ()
             break;
     }
 
+    if (rc != -1 && !crypto_in.empty ())
+        rc = push_crypto_batch ();
+
     if (rc == -1 && errno == EAGAIN)
         session->flush ();
     else
@@ -448,14 +673,30 @@ void zmq::stream_engine_t::restart_input ()
     }
 }
 
+void zmq::stream_engine_t::encode_batch ()
+{
+    const size_t batch_size = out_batch.size ();
+    while (outsize < batch_size) {
+        if ((this->*next_msg) (&tx_msg) == -1)
+            break;
+        encoder->load_msg (&tx_msg);
+        unsigned char *bufptr = outpos + outsize;
+        size_t n = encoder->encode (&bufptr, batch_size - outsize);
+        zmq_assert (n > 0);
+        if (outpos == NULL)
+            outpos = bufptr;
+        outsize += n;
+    }
+}
+
 bool zmq::stream_engine_t::handshake ()
 {
     zmq_assert (handshaking);
     zmq_assert (greeting_bytes_read < greeting_size);
     //  Receive the greeting.
     while (greeting_bytes_read < greeting_size) {
-        const int n = tcp_read (s, greeting_recv + greeting_bytes_read,
-                                greeting_size - greeting_bytes_read);
+        const int n = read_data (greeting_recv + greeting_bytes_read,
+                                 greeting_size - greeting_bytes_read);
         if (n == 0) {
             error (connection_error);
             return false;
@@ -484,6 +725,16 @@ bool zmq::stream_engine_t::handshake ()
         if (!(greeting_recv [9] & 0x01))
             break;
 
+        //  Our whole greeting has been sent already. Stop reading if the
+        //  peer turns out to use an older protocol.
+        if (options.tcp_fastopen) {
+            if (greeting_bytes_read > signature_size
+            &&  (greeting_recv [10] == ZMTP_1_0
+            ||   greeting_recv [10] == ZMTP_2_0))
+                break;
+            continue;
+        }
+
         //  The peer is using versioned protocol.
         //  Send the major version number.
         if (outpos + outsize == greeting_send + signature_size) {
@@ -501,31 +752,8 @@ bool zmq::stream_engine_t::handshake ()
                 if (greeting_recv [10] == ZMTP_1_0
                 ||  greeting_recv [10] == ZMTP_2_0)
                     outpos [outsize++] = options.type;
-                else {
-                    outpos [outsize++] = 0; //  Minor version number
-                    memset (outpos + outsize, 0, 20);
-
-                    zmq_assert (options.mechanism == ZMQ_NULL
-                            ||  options.mechanism == ZMQ_PLAIN
-                            ||  options.mechanism == ZMQ_CURVE
-                            ||  options.mechanism == ZMQ_GSSAPI);
-
-                    if (options.mechanism == ZMQ_NULL)
-                        memcpy (outpos + outsize, "NULL", 4);
-                    else
-                    if (options.mechanism == ZMQ_PLAIN)
-                        memcpy (outpos + outsize, "PLAIN", 5);
-                    else
-                    if (options.mechanism == ZMQ_GSSAPI)
-                        memcpy (outpos + outsize, "GSSAPI", 6);
-                    else
-                    if (options.mechanism == ZMQ_CURVE)
-                        memcpy (outpos + outsize, "CURVE", 5);
-                    outsize += 20;
-                    memset (outpos + outsize, 0, 32);
-                    outsize += 32;
-                    greeting_size = v3_greeting_size;
-                }
+                else
+                    put_v3_greeting ();
             }
         }
     }
@@ -533,6 +761,18 @@ bool zmq::stream_engine_t::handshake ()
     //  Position of the revision field in the greeting.
     const size_t revision_pos = 10;
 
+    //  Having sent the ZMTP/3.0 greeting already, we can't talk to older
+    //  peers. The codec and the mechanism are in place.
+    if (options.tcp_fastopen) {
+        if (greeting_recv [0] != 0xff || !(greeting_recv [9] & 0x01)
+        ||  greeting_recv [revision_pos] == ZMTP_1_0
+        ||  greeting_recv [revision_pos] == ZMTP_2_0
+        ||  !peer_mechanism_matches ()) {
+            error (protocol_error);
+            return false;
+        }
+    }
+    else
     //  Is the peer using ZMTP/1.0 with no revision number?
     //  If so, we send and receive rest of identity message
     if (greeting_recv [0] != 0xff || !(greeting_recv [9] & 0x01)) {
@@ -542,10 +782,12 @@ bool zmq::stream_engine_t::handshake ()
            return false;
         }
 
-        encoder = new (std::nothrow) v1_encoder_t (out_batch_size);
+        encoder = new (std::nothrow) v1_encoder_t (
+            out_batch.size (), batch_pool);
         alloc_assert (encoder);
 
-        decoder = new (std::nothrow) v1_decoder_t (in_batch_size, options.maxmsgsize);
+        decoder = new (std::nothrow) v1_decoder_t (
+            in_batch.size (), options.maxmsgsize, batch_pool);
         alloc_assert (decoder);
 
         //  We have already sent the message header.
@@ -590,11 +832,11 @@ bool zmq::stream_engine_t::handshake ()
         }
 
         encoder = new (std::nothrow) v1_encoder_t (
-            out_batch_size);
+            out_batch.size (), batch_pool);
         alloc_assert (encoder);
 
         decoder = new (std::nothrow) v1_decoder_t (
-            in_batch_size, options.maxmsgsize);
+            in_batch.size (), options.maxmsgsize, batch_pool);
         alloc_assert (decoder);
     }
     else
@@ -605,63 +847,24 @@ bool zmq::stream_engine_t::handshake ()
            return false;
         }
 
-        encoder = new (std::nothrow) v2_encoder_t (out_batch_size);
+        encoder = new (std::nothrow) v2_encoder_t (
+            out_batch.size (), batch_pool);
         alloc_assert (encoder);
 
         decoder = new (std::nothrow) v2_decoder_t (
-            in_batch_size, options.maxmsgsize);
+            in_batch.size (), options.maxmsgsize, batch_pool);
         alloc_assert (decoder);
     }
     else {
-        encoder = new (std::nothrow) v2_encoder_t (out_batch_size);
+        encoder = new (std::nothrow) v2_encoder_t (
+            out_batch.size (), batch_pool);
         alloc_assert (encoder);
 
         decoder = new (std::nothrow) v2_decoder_t (
-            in_batch_size, options.maxmsgsize);
+            in_batch.size (), options.maxmsgsize, batch_pool);
         alloc_assert (decoder);
 
-        if (options.mechanism == ZMQ_NULL
-        &&  memcmp (greeting_recv + 12, "NULL\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 20) == 0) {
-            mechanism = new (std::nothrow)
-                null_mechanism_t (session, peer_address, options);
-            alloc_assert (mechanism);
-        }
-        else
-        if (options.mechanism == ZMQ_PLAIN
-        &&  memcmp (greeting_recv + 12, "PLAIN\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 20) == 0) {
-            if (options.as_server)
-                mechanism = new (std::nothrow)
-                    plain_server_t (session, peer_address, options);
-            else
-                mechanism = new (std::nothrow)
-                    plain_client_t (options);
-            alloc_assert (mechanism);
-        }
-#ifdef HAVE_LIBSODIUM
-        else
-        if (options.mechanism == ZMQ_CURVE
-        &&  memcmp (greeting_recv + 12, "CURVE\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 20) == 0) {
-            if (options.as_server)
-                mechanism = new (std::nothrow)
-                    curve_server_t (session, peer_address, options);
-            else
-                mechanism = new (std::nothrow) curve_client_t (options);
-            alloc_assert (mechanism);
-        }
-#endif
-#ifdef HAVE_LIBGSSAPI_KRB5
-        else
-        if (options.mechanism == ZMQ_GSSAPI
-        &&  memcmp (greeting_recv + 12, "GSSAPI\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 20) == 0) {
-            if (options.as_server)
-                mechanism = new (std::nothrow)
-                    gssapi_server_t (session, peer_address, options);
-            else
-                mechanism = new (std::nothrow) gssapi_client_t (options);
-            alloc_assert (mechanism);
-        }
-#endif
-        else {
+        if (!peer_mechanism_matches () || !create_mechanism ()) {
             //  Temporary support for security debugging
             char mechanism [21];
             memcpy (mechanism, greeting_recv + 12, 20);
@@ -681,6 +884,11 @@ bool zmq::stream_engine_t::handshake ()
         process_msg = &stream_engine_t::process_handshake_command;
     }
 
+    //  Peers using ZMTP/1.0 or ZMTP/2.0 have no security handshake,
+    //  so messages may be coalesced from now on.
+    if (mechanism == NULL)
+        coalescing = options.snd_delay > 0;
+
     // Start polling for output if necessary.
     if (outsize == 0)
         set_pollout (handle);
@@ -697,6 +905,90 @@ bool zmq::stream_engine_t::handshake ()
     return true;
 }
 
+void zmq::stream_engine_t::put_v3_greeting ()
+{
+    outpos [outsize++] = 0; //  Minor version number
+    memset (outpos + outsize, 0, 20);
+    const char *name = mechanism_name ();
+    memcpy (outpos + outsize, name, strlen (name));
+    outsize += 20;
+    memset (outpos + outsize, 0, 32);
+    outsize += 32;
+    greeting_size = v3_greeting_size;
+}
+
+const char *zmq::stream_engine_t::mechanism_name () const
+{
+    zmq_assert (options.mechanism == ZMQ_NULL
+            ||  options.mechanism == ZMQ_PLAIN
+            ||  options.mechanism == ZMQ_CURVE
+            ||  options.mechanism == ZMQ_GSSAPI);
+
+    if (options.mechanism == ZMQ_NULL)
+        return "NULL";
+    else
+    if (options.mechanism == ZMQ_PLAIN)
+        return "PLAIN";
+    else
+    if (options.mechanism == ZMQ_GSSAPI)
+        return "GSSAPI";
+    else
+        return "CURVE";
+}
+
+bool zmq::stream_engine_t::peer_mechanism_matches () const
+{
+    unsigned char name [20];
+    memset (name, 0, sizeof name);
+    memcpy (name, mechanism_name (), strlen (mechanism_name ()));
+    return memcmp (greeting_recv + 12, name, sizeof name) == 0;
+}
+
+bool zmq::stream_engine_t::create_mechanism ()
+{
+    zmq_assert (mechanism == NULL);
+
+    if (options.mechanism == ZMQ_NULL)
+        mechanism = new (std::nothrow)
+            null_mechanism_t (session, peer_address, options);
+    else
+    if (options.mechanism == ZMQ_PLAIN) {
+        if (options.as_server)
+            mechanism = new (std::nothrow)
+                plain_server_t (session, peer_address, options);
+        else
+            mechanism = new (std::nothrow)
+                plain_client_t (options);
+    }
+#ifdef HAVE_LIBSODIUM
+    else
+    if (options.mechanism == ZMQ_CURVE) {
+        if (options.as_server)
+            mechanism = new (std::nothrow)
+                curve_server_t (session, peer_address, options,
+                    socket->get_ctx ()->get_curve_tickets ());
+        else
+            mechanism = new (std::nothrow) curve_client_t (options,
+                socket->get_ctx ()->get_curve_tickets ());
+    }
+#endif
+#ifdef HAVE_LIBGSSAPI_KRB5
+    else
+    if (options.mechanism == ZMQ_GSSAPI) {
+        if (options.as_server)
+            mechanism = new (std::nothrow)
+                gssapi_server_t (session, peer_address, options);
+        else
+            mechanism = new (std::nothrow) gssapi_client_t (options);
+    }
+#endif
+    else
+        return false;
+
+    alloc_assert (mechanism);
+    return true;
+}
+
 int zmq::stream_engine_t::identity_msg (msg_t *msg_)
 {
     int rc = msg_->init_size (options.identity_size);
@@ -802,6 +1094,22 @@ void zmq::stream_engine_t::mechanism_ready ()
 
     next_msg = &stream_engine_t::pull_and_encode;
     process_msg = &stream_engine_t::write_credential;
+    coalescing = options.snd_delay > 0;
+    compressing = options.compression_threshold >= 0
+               && mechanism->peer_accepts_compression ();
+    passing_fds = accepting_fds && mechanism->peer_accepts_fd_passing ();
+    session->set_gap_notices (mechanism->peer_accepts_gap_notices ());
+
+    //  Spread encryption and decryption across the context's crypto
+    //  threads, if it has any.
+    if (mechanism->parallel_codec ()
+    &&  socket->get_ctx ()->get (ZMQ_CRYPTO_THREADS) > 0)
+        crypto_pool = socket->get_ctx ()->get_crypto_pool ();
+
+    if (options.heartbeat_interval > 0) {
+        add_timer (options.heartbeat_interval, heartbeat_ivl_timer_id);
+        has_heartbeat_timer = true;
+    }
 
     //  Compile metadata.
     typedef metadata_t::dict_t properties_t;
@@ -855,16 +1163,38 @@ int zmq::stream_engine_t::write_credential (msg_t *msg_)
             return -1;
         }
     }
-    process_msg = &stream_engine_t::decode_and_push;
-    return decode_and_push (msg_);
+    if (crypto_pool)
+        process_msg = &stream_engine_t::queue_for_decode;
+    else
+        process_msg = &stream_engine_t::decode_and_push;
+    return (this->*process_msg) (msg_);
 }
 
 int zmq::stream_engine_t::pull_and_encode (msg_t *msg_)
 {
     zmq_assert (mechanism != NULL);
 
+    if (crypto_pool) {
+        if (crypto_out_pos == crypto_out.size ()
+        &&  encode_crypto_batch () == -1)
+            return -1;
+        const int rc = msg_->move (crypto_out [crypto_out_pos++]);
+        errno_assert (rc == 0);
+        return 0;
+    }
+
+    //  All the descriptors passed with a write must belong to frames
+    //  in that write, so the batch ends when there are too many.
+    if (passing_fds && pending_fds.size () == max_passed_fds) {
+        errno = EAGAIN;
+        return -1;
+    }
     if (session->pull_msg (msg_) == -1)
         return -1;
+    if (passing_fds && pass_msg (msg_) == -1)
+        return -1;
+    if (compressing && compress_msg (msg_) == -1)
+        return -1;
     if (mechanism->encode (msg_) == -1)
         return -1;
     return 0;
@@ -876,16 +1206,460 @@ int zmq::stream_engine_t::decode_and_push (msg_t *msg_)
 
     if (mechanism->decode (msg_) == -1)
         return -1;
+    return push_decoded (msg_);
+}
+
+int zmq::stream_engine_t::push_decoded (msg_t *msg_)
+{
+    //  Any traffic shows that the peer is still alive.
+    if (has_timeout_timer) {
+        cancel_timer (heartbeat_timeout_timer_id);
+        has_timeout_timer = false;
+    }
+    if (has_ttl_timer) {
+        cancel_timer (heartbeat_ttl_timer_id);
+        has_ttl_timer = false;
+    }
+
+    if (msg_->flags () & msg_t::command)
+        return process_command_message (msg_);
+    if ((msg_->flags () & msg_t::compressed) && decompress_msg (msg_) == -1)
+        return -1;
+    if ((msg_->flags () & msg_t::passed_fd) && receive_passed_msg (msg_) == -1)
+        return -1;
     if (metadata)
         msg_->set_metadata (metadata);
     if (session->push_msg (msg_) == -1) {
         if (errno == EAGAIN)
-            process_msg = &stream_engine_t::push_one_then_decode_and_push;
+            stall_input ();
         return -1;
     }
     return 0;
 }
 
+void zmq::stream_engine_t::stall_input ()
+{
+    if (crypto_pool)
+        crypto_in_stalled = true;
+    else
+        process_msg = &stream_engine_t::push_one_then_decode_and_push;
+}
+
+int zmq::stream_engine_t::encode_crypto_batch ()
+{
+    //  The messages of the previous batch have all been moved out.
+    crypto_out.clear ();
+    crypto_out_pos = 0;
+
+    size_t size = 0;
+    while (crypto_out.size () < crypto_batch_msgs
+       &&  size < crypto_batch_size) {
+        msg_t msg;
+        int rc = msg.init ();
+        errno_assert (rc == 0);
+        if (session->pull_msg (&msg) == -1)
+            break;
+        if (compressing) {
+            rc = compress_msg (&msg);
+            errno_assert (rc == 0);
+        }
+        size += msg.size ();
+        crypto_out.push_back (msg);
+    }
+
+    //  Errno is set by the failed pull.
+    if (crypto_out.empty ())
+        return -1;
+
+    return mechanism->encode_batch (&crypto_out [0], crypto_out.size (),
+        size >= crypto_parallel_size ? crypto_pool : NULL);
+}
+
+int zmq::stream_engine_t::encode_command (msg_t *msg_)
+{
+    if (mechanism->encode (msg_) == -1)
+        return -1;
+
+    //  Messages encoded ahead have lower nonces, so they go first.
+    if (crypto_out_pos < crypto_out.size ()) {
+        crypto_out.push_back (*msg_);
+        int rc = msg_->init ();
+        errno_assert (rc == 0);
+        rc = msg_->move (crypto_out [crypto_out_pos++]);
+        errno_assert (rc == 0);
+    }
+    return 0;
+}
+
+int zmq::stream_engine_t::queue_for_decode (msg_t *msg_)
+{
+    crypto_in_size += msg_->size ();
+    crypto_in.push_back (*msg_);
+    const int rc = msg_->init ();
+    errno_assert (rc == 0);
+    return 0;
+}
+
+int zmq::stream_engine_t::push_crypto_batch ()
+{
+    const size_t count = crypto_in.size () - crypto_in_decoded;
+    if (count > 0) {
+        if (mechanism->decode_batch (&crypto_in [crypto_in_decoded], count,
+              crypto_in_size >= crypto_parallel_size ? crypto_pool : NULL)
+              == -1)
+            return -1;
+        crypto_in_decoded = crypto_in.size ();
+        crypto_in_size = 0;
+    }
+
+    for (; crypto_in_pos != crypto_in.size (); crypto_in_pos++) {
+        msg_t *msg = &crypto_in [crypto_in_pos];
+        if (crypto_in_stalled) {
+            if (session->push_msg (msg) == -1)
+                return -1;
+            crypto_in_stalled = false;
+        }
+        else
+        if (push_decoded (msg) == -1)
+            return -1;
+    }
+
+    crypto_in.clear ();
+    crypto_in_pos = 0;
+    crypto_in_decoded = 0;
+    return 0;
+}
+
+int zmq::stream_engine_t::compress_msg (msg_t *msg_)
+{
+    const size_t size = msg_->size ();
+    if (size < (size_t) options.compression_threshold
+    ||  size <= 4 || size > 0xffffffff
+    ||  (msg_->flags () & (msg_t::command | msg_t::passed_fd)))
+        return 0;
+
+    //  The compressed body starts with the size of the original one.
+    //  There is no point in keeping a compressed form that is not
+    //  smaller than the original.
+    msg_t compressed;
+    int rc = compressed.init_size (size - 1);
+    errno_assert (rc == 0);
+    unsigned char *data = (unsigned char *) compressed.data ();
+    const size_t compressed_size = lz4_compress (
+        (unsigned char *) msg_->data (), size, data + 4, size - 5);
+    if (compressed_size == 0) {
+        rc = compressed.close ();
+        errno_assert (rc == 0);
+        return 0;
+    }
+    put_uint32 (data, (uint32_t) size);
+    compressed.shrink (4 + compressed_size);
+    compressed.set_flags ((msg_->flags () & msg_t::more) | msg_t::compressed);
+
+    rc = msg_->move (compressed);
+    errno_assert (rc == 0);
+    return 0;
+}
+
+int zmq::stream_engine_t::decompress_msg (msg_t *msg_)
+{
+    //  Compressed frames are only sent to peers that offered to accept
+    //  them, so anything else is a protocol violation.
+    if (options.compression_threshold < 0 || msg_->size () < 4) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    const unsigned char *data = (unsigned char *) msg_->data ();
+    const uint64_t size = get_uint32 (data);
+    if (options.maxmsgsize >= 0 && size > (uint64_t) options.maxmsgsize) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    //  Don't let a small frame claim an arbitrarily large size.
+    if (size > lz4_decompress_bound (msg_->size () - 4)) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    msg_t decompressed;
+    int rc = decompressed.init_size ((size_t) size);
+    if (unlikely (rc)) {
+        errno_assert (errno == ENOMEM);
+        return -1;
+    }
+    rc = lz4_decompress (data + 4, msg_->size () - 4,
+        (unsigned char *) decompressed.data (), (size_t) size);
+    if (rc == -1) {
+        rc = decompressed.close ();
+        errno_assert (rc == 0);
+        errno = EPROTO;
+        return -1;
+    }
+    decompressed.set_flags (msg_->flags () & msg_t::more);
+
+    rc = msg_->move (decompressed);
+    errno_assert (rc == 0);
+    return 0;
+}
+
+int zmq::stream_engine_t::pass_msg (msg_t *msg_)
+{
+#if defined ZMQ_HAVE_MEMFD
+    const size_t size = msg_->size ();
+    if (size < (size_t) options.ipc_fd_threshold || size == 0
+    ||  (msg_->flags () & msg_t::command))
+        return 0;
+
+    //  If the memfd cannot be created, the message is sent as it is.
+    const fd_t fd = memfd_from_data (msg_->data (), size);
+    if (fd == -1)
+        return 0;
+    pending_fds.push_back (fd);
+
+    //  The frame carries the size of the message, the body travels
+    //  as the descriptor passed with it.
+    const unsigned char flags = msg_->flags () & msg_t::more;
+    int rc = msg_->close ();
+    errno_assert (rc == 0);
+    rc = msg_->init_size (8);
+    errno_assert (rc == 0);
+    put_uint64 ((unsigned char *) msg_->data (), size);
+    msg_->set_flags (flags | msg_t::passed_fd);
+#else
+    (void) msg_;
+#endif
+    return 0;
+}
+
+int zmq::stream_engine_t::receive_passed_msg (msg_t *msg_)
+{
+    //  Descriptors are only passed to peers that offered to accept them
+    //  and each frame comes with exactly one of them.
+    if (received_fds.empty () || msg_->size () != 8) {
+        errno = EPROTO;
+        return -1;
+    }
+
+#if defined ZMQ_HAVE_MEMFD
+    const fd_t fd = received_fds.front ();
+    received_fds.pop_front ();
+
+    const uint64_t size = get_uint64 ((unsigned char *) msg_->data ());
+    if (options.maxmsgsize >= 0 && size > (uint64_t) options.maxmsgsize) {
+        close (fd);
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    void *data = NULL;
+    if (size > 0 && size <= (uint64_t) (size_t) -1)
+        data = map_memfd (fd, (size_t) size);
+    close (fd);
+    if (data == NULL) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    const unsigned char flags = msg_->flags () & msg_t::more;
+    int rc = msg_->close ();
+    errno_assert (rc == 0);
+    rc = msg_->init_data (data, (size_t) size, unmap_memfd,
+        reinterpret_cast <void *> ((size_t) size));
+    errno_assert (rc == 0);
+    msg_->set_flags (flags);
+    return 0;
+#else
+    errno = EPROTO;
+    return -1;
+#endif
+}
+
+bool zmq::stream_engine_t::tls_handshake ()
+{
+#if defined ZMQ_HAVE_TLS
+    zmq_assert (tls_handshaking);
+    if (tls->handshake () == 0) {
+        tls_handshaking = false;
+
+        //  The greeting is waiting to be sent.
+        set_pollout (handle);
+        return true;
+    }
+    if (errno != EAGAIN) {
+        error (protocol_error);
+        return false;
+    }
+
+    //  Don't spin on a writable socket while waiting for the peer.
+    if (tls->want_write ())
+        set_pollout (handle);
+    else
+        reset_pollout (handle);
+#endif
+    return false;
+}
+
+int zmq::stream_engine_t::read_data (void *data_, size_t size_)
+{
+#if defined ZMQ_HAVE_TLS
+    if (tls)
+        return tls->read (data_, size_);
+#endif
+#if defined ZMQ_HAVE_MEMFD
+    if (accepting_fds) {
+        fd_t fds [max_passed_fds];
+        size_t nfds = 0;
+        const int rc = ipc_read_fds (s, data_, size_, fds, &nfds);
+        received_fds.insert (received_fds.end (), fds, fds + nfds);
+
+        //  A peer passing descriptors without the frames referring to
+        //  them is trying to make us run out of descriptors.
+        if (received_fds.size () > max_queued_fds) {
+            errno = EPROTO;
+            return -1;
+        }
+        return rc;
+    }
+#endif
+    return tcp_read (s, data_, size_);
+}
+
+int zmq::stream_engine_t::write_data (const void *data_, size_t size_)
+{
+#if defined ZMQ_HAVE_TLS
+    if (tls)
+        return tls->write (data_, size_);
+#endif
+#if defined ZMQ_HAVE_MEMFD
+    //  The descriptors go with the first byte written, so they arrive
+    //  no later than the frames referring to them.
+    if (!pending_fds.empty ()) {
+        const int nbytes = ipc_write_fds (s, data_, size_,
+            &pending_fds [0], pending_fds.size ());
+        if (nbytes > 0) {
+            for (size_t i = 0; i != pending_fds.size (); i++)
+                close (pending_fds [i]);
+            pending_fds.clear ();
+        }
+        return nbytes;
+    }
+#endif
+    return tcp_write (s, data_, size_);
+}
+
+int zmq::stream_engine_t::process_command_message (msg_t *msg_)
+{
+    const size_t size = msg_->size ();
+    const unsigned char *data = (unsigned char *) msg_->data ();
+
+    int rc;
+    if (size >= 5 && memcmp (data, "\4PING", 5) == 0)
+        rc = process_ping_message (msg_);
+    else
+    if (size >= 5 && memcmp (data, "\4PONG", 5) == 0)
+        //  Receiving the PONG has already stopped the timeout timer.
+        rc = 0;
+    else
+    if (size >= 4 && memcmp (data, "\3GAP", 4) == 0
+    &&  (options.type == ZMQ_SUB || options.type == ZMQ_XSUB))
+        rc = process_gap_message (msg_);
+    else {
+        errno = EPROTO;
+        rc = -1;
+    }
+
+    if (rc == 0) {
+        rc = msg_->close ();
+        errno_assert (rc == 0);
+        rc = msg_->init ();
+        errno_assert (rc == 0);
+    }
+    return rc;
+}
+
+int zmq::stream_engine_t::process_gap_message (msg_t *msg_)
+{
+    if (msg_->size () != 12) {
+        errno = EPROTO;
+        return -1;
+    }
+    const unsigned char *data = (unsigned char *) msg_->data ();
+    socket->event_messages_lost (endpoint, get_uint64 (data + 4));
+
+    //  The socket counts the lost messages in the order they were lost.
+    if (session->push_msg (msg_) == -1) {
+        if (errno == EAGAIN)
+            stall_input ();
+        return -1;
+    }
+    return 0;
+}
+
+int zmq::stream_engine_t::produce_ping_message (msg_t *msg_)
+{
+    next_msg = &stream_engine_t::pull_and_encode;
+
+    //  PING carries the TTL we want the peer to apply, in deciseconds,
+    //  and an empty context.
+    int rc = msg_->init_size (7);
+    errno_assert (rc == 0);
+    msg_->set_flags (msg_t::command);
+    unsigned char *data = (unsigned char *) msg_->data ();
+    memcpy (data, "\4PING", 5);
+    put_uint16 (data + 5, options.heartbeat_ttl);
+
+    return encode_command (msg_);
+}
+
+int zmq::stream_engine_t::produce_pong_message (msg_t *msg_)
+{
+    if (ping_pending) {
+        next_msg = &stream_engine_t::produce_ping_message;
+        ping_pending = false;
+    }
+    else
+        next_msg = &stream_engine_t::pull_and_encode;
+
+    int rc = msg_->init_size (5 + pong_context_size);
+    errno_assert (rc == 0);
+    msg_->set_flags (msg_t::command);
+    unsigned char *data = (unsigned char *) msg_->data ();
+    memcpy (data, "\4PONG", 5);
+    memcpy (data + 5, pong_context, pong_context_size);
+
+    return encode_command (msg_);
+}
+
+int zmq::stream_engine_t::process_ping_message (msg_t *msg_)
+{
+    const size_t size = msg_->size ();
+    if (size < 7 || size > 7 + sizeof pong_context) {
+        errno = EPROTO;
+        return -1;
+    }
+    const unsigned char *data = (unsigned char *) msg_->data ();
+
+    //  If the peer asks for it, consider it dead when it stays silent
+    //  for longer than its TTL.
+    const uint16_t ttl = get_uint16 (data + 5);
+    if (ttl > 0 && !has_ttl_timer) {
+        add_timer (ttl * 100, heartbeat_ttl_timer_id);
+        has_ttl_timer = true;
+    }
+
+    pong_context_size = size - 7;
+    memcpy (pong_context, data + 7, pong_context_size);
+
+    //  Our own PING, if one is waiting, goes out after the PONG.
+    if (next_msg == &stream_engine_t::produce_ping_message)
+        ping_pending = true;
+    next_msg = &stream_engine_t::produce_pong_message;
+    restart_output ();
+    return 0;
+}
+
 int zmq::stream_engine_t::push_one_then_decode_and_push (msg_t *msg_)
 {
     const int rc = session->push_msg (msg_);
@@ -939,8 +1713,106 @@ void zmq::stream_engine_t::set_handshake_timer ()
     }
 }
 
+void zmq::stream_engine_t::set_buffers_used ()
+{
+    buffers_used = true;
+    if (!has_release_timer) {
+        add_timer (batch_release_ivl, release_timer_id);
+        has_release_timer = true;
+    }
+}
+
+void zmq::stream_engine_t::release_buffers ()
+{
+    bool pending = false;
+
+    //  The decoder's buffer can go once all data in it have been decoded.
+    if (decoder) {
+        if (insize == 0)
+            decoder->release_buffer ();
+        else
+            pending = true;
+    }
+
+    //  The encoder's buffer can go once all data in it have been written.
+    if (encoder) {
+        if (outsize == 0)
+            encoder->release_buffer ();
+        else
+            pending = true;
+    }
+
+    //  Try again later if some of the data are still there.
+    if (pending) {
+        add_timer (batch_release_ivl, release_timer_id);
+        has_release_timer = true;
+    }
+}
+
 void zmq::stream_engine_t::timer_event (int id_)
 {
+    if (id_ == release_timer_id) {
+        has_release_timer = false;
+
+        //  Release the buffers only if the engine has been idle
+        //  for the whole interval.
+        if (buffers_used) {
+            buffers_used = false;
+            add_timer (batch_release_ivl, release_timer_id);
+            has_release_timer = true;
+        }
+        else
+            release_buffers ();
+        return;
+    }
+
+    if (id_ == flush_timer_id) {
+        has_flush_timer = false;
+
+        //  The delay has expired, send the batch as it is.
+        out_batch.update (outsize);
+        set_pollout (handle);
+        output_stopped = false;
+        out_event ();
+        return;
+    }
+
+    if (id_ == heartbeat_ivl_timer_id) {
+        add_timer (options.heartbeat_interval, heartbeat_ivl_timer_id);
+
+        //  Send a PING and expect traffic from the peer within the
+        //  timeout. While input is stopped we read nothing, so there is
+        //  nothing to expect.
+        const int timeout = options.heartbeat_timeout == -1 ?
+            options.heartbeat_interval : options.heartbeat_timeout;
+        if (timeout > 0 && !has_timeout_timer && !input_stopped) {
+            add_timer (timeout, heartbeat_timeout_timer_id);
+            has_timeout_timer = true;
+        }
+
+        //  Don't drop a PONG that is yet to be sent, queue behind it.
+        if (next_msg == &stream_engine_t::produce_pong_message)
+            ping_pending = true;
+        else
+            next_msg = &stream_engine_t::produce_ping_message;
+        restart_output ();
+        return;
+    }
+
+    if (id_ == heartbeat_timeout_timer_id || id_ == heartbeat_ttl_timer_id) {
+        if (id_ == heartbeat_timeout_timer_id)
+            has_timeout_timer = false;
+        else
+            has_ttl_timer = false;
+
+        //  The peer has been silent for too long, assume it is dead.
+        //  While input is stopped its traffic may just be waiting for
+        //  us to read it though.
+        if (!input_stopped)
+            error (timeout_error);
+        return;
+    }
+
     zmq_assert (id_ == handshake_timer_id);
     has_handshake_timer = false;
 
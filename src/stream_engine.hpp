@@ -21,6 +21,8 @@
 #define __ZMQ_STREAM_ENGINE_HPP_INCLUDED__
 
 #include <stddef.h>
+#include <deque>
+#include <vector>
 
 #include "fd.hpp"
 #include "i_engine.hpp"
@@ -31,6 +33,8 @@
 #include "socket_base.hpp"
 #include "../include/zmq.h"
 #include "metadata.hpp"
+#include "adaptive_batch.hpp"
+#include "batch_pool.hpp"
 
 namespace zmq
 {
@@ -45,6 +49,8 @@ namespace zmq
     class msg_t;
     class session_base_t;
     class mechanism_t;
+    class tls_t;
+    class crypto_pool_t;
 
     //  This engine handles any socket with SOCK_STREAM semantics,
     //  e.g. TCP socket or an UNIX domain socket.
@@ -59,8 +65,10 @@ namespace zmq
             timeout_error
         };
 
-        stream_engine_t (fd_t fd_, const options_t &options_, 
-                         const std::string &endpoint);
+        //  If 'tls_' is not NULL, the connection runs over TLS. The engine
+        //  takes ownership of it.
+        stream_engine_t (fd_t fd_, const shared_options_t &options_,
+                         const std::string &endpoint, tls_t *tls_ = NULL);
         ~stream_engine_t ();
 
         //  i_engine interface implementation.
@@ -70,6 +78,7 @@ namespace zmq
         void restart_input ();
         void restart_output ();
         void zap_msg_available ();
+        bool flush ();
 
         //  i_poll_events interface implementation.
         void in_event ();
@@ -90,6 +99,24 @@ namespace zmq
         //  Detects the protocol used by the peer.
         bool handshake ();
 
+        //  Advances the TLS handshake preceding the greeting. Returns
+        //  true once it is done.
+        bool tls_handshake ();
+
+        //  Appends the ZMTP/3.0 part of the greeting, following the major
+        //  version number, to the write buffer.
+        void put_v3_greeting ();
+
+        //  Returns the name of our security mechanism.
+        const char *mechanism_name () const;
+
+        //  Returns true if the peer's greeting names our mechanism.
+        bool peer_mechanism_matches () const;
+
+        //  Creates the security mechanism. Returns false if the mechanism
+        //  is not supported by this build.
+        bool create_mechanism ();
+
         int identity_msg (msg_t *msg_);
         int process_identity_msg (msg_t *msg_);
 
@@ -99,11 +126,67 @@ namespace zmq
         int pull_msg_from_session (msg_t *msg_);
         int push_msg_to_session (msg_t *msg);
 
+        //  Encodes messages from the session into the write buffer
+        //  until the batch is full or there are no more messages.
+        void encode_batch ();
+
         int write_credential (msg_t *msg_);
         int pull_and_encode (msg_t *msg_);
         int decode_and_push (msg_t *msg_);
         int push_one_then_decode_and_push (msg_t *msg_);
 
+        //  Second half of decode_and_push, for a decoded message.
+        int push_decoded (msg_t *msg_);
+
+        //  Makes the engine retry pushing the current message to the
+        //  session once it can take it.
+        void stall_input ();
+
+        //  With a crypto pool, messages are encoded and decoded in batches.
+        //  Pulls a batch of messages from the session and encodes them.
+        int encode_crypto_batch ();
+
+        //  Encodes a command, keeping it behind the batch encoded ahead.
+        int encode_command (msg_t *msg_);
+
+        //  Queues a received message to be decoded with the batch.
+        int queue_for_decode (msg_t *msg_);
+
+        //  Decodes the queued messages and pushes them to the session.
+        int push_crypto_batch ();
+
+        //  Replaces the message by its compressed form if it is large
+        //  enough and the compressed form is smaller.
+        int compress_msg (msg_t *msg_);
+
+        //  Replaces a compressed message by its original form.
+        int decompress_msg (msg_t *msg_);
+
+        //  Replaces the message by a reference to a memfd holding its
+        //  body if it is large enough.
+        int pass_msg (msg_t *msg_);
+
+        //  Replaces a reference to a memfd by a message mapping it.
+        int receive_passed_msg (msg_t *msg_);
+
+        //  Reads and writes data like tcp_read and tcp_write, receiving
+        //  and sending passed file descriptors along with them, or
+        //  through the TLS layer.
+        int read_data (void *data_, size_t size_);
+        int write_data (const void *data_, size_t size_);
+
+        //  Handles a command frame received after the handshake.
+        int process_command_message (msg_t *msg_);
+
+        //  Heartbeat commands (ZMQ_HEARTBEAT_IVL and friends).
+        int produce_ping_message (msg_t *msg_);
+        int produce_pong_message (msg_t *msg_);
+        int process_ping_message (msg_t *msg_);
+
+        //  Reports the messages the publisher dropped (ZMQ_XPUB_SEQUENCE)
+        //  and passes the GAP command on to the socket.
+        int process_gap_message (msg_t *msg_);
+
         void mechanism_ready ();
 
         int write_subscription_msg (msg_t *msg_);
@@ -113,6 +196,14 @@ namespace zmq
 
         void set_handshake_timer();
 
+        //  Notes that the batch buffers are in use and makes sure
+        //  the engine checks back later whether they still are.
+        void set_buffers_used ();
+
+        //  Gives the batch buffers that hold no pending data back
+        //  to the I/O thread's pool.
+        void release_buffers ();
+
         //  Underlying socket.
         fd_t s;
 
@@ -126,10 +217,16 @@ namespace zmq
         unsigned char *inpos;
         size_t insize;
         i_decoder *decoder;
+        adaptive_batch_t in_batch;
 
         unsigned char *outpos;
         size_t outsize;
         i_encoder *encoder;
+        adaptive_batch_t out_batch;
+
+        //  Pool of the I/O thread the engine is plugged into. Batch
+        //  buffers of the encoder and decoder are taken from here.
+        batch_pool_t *batch_pool;
 
         //  Metadata to be attached to received messages. May be NULL.
         metadata_t *metadata;
@@ -160,7 +257,10 @@ namespace zmq
         //  The session this engine is attached to.
         zmq::session_base_t *session;
 
-        options_t options;
+        //  Options of the socket the engine belongs to, shared with its
+        //  session and the listener or connecter that created it.
+        shared_options_t shared_options;
+        const options_t &options;
 
         // String representation of endpoint
         std::string endpoint;
@@ -192,6 +292,101 @@ namespace zmq
         //  True is linger timer is running.
         bool has_handshake_timer;
 
+        //  True iff batches that are not full are held back for up to
+        //  options.snd_delay milliseconds before being written.
+        bool coalescing;
+
+        //  ID of the timer that flushes a batch held back by coalescing.
+        enum {flush_timer_id = 0x41};
+
+        //  True iff a batch is being held back, i.e. the flush timer
+        //  is running.
+        bool has_flush_timer;
+
+        //  True iff the session waits for the output to be written out
+        //  before it terminates.
+        bool flushing;
+
+        //  ID of the timer that releases the batch buffers of an idle
+        //  engine.
+        enum {release_timer_id = 0x42};
+
+        //  True iff the release timer is running.
+        bool has_release_timer;
+
+        //  True iff the batch buffers were used since the release
+        //  timer was started.
+        bool buffers_used;
+
+        //  True iff both ends offered compression in the handshake,
+        //  so that large frames are sent compressed.
+        bool compressing;
+
+        //  True iff we offered to accept messages as memfds and the
+        //  connection is a UNIX domain socket.
+        bool accepting_fds;
+
+        //  True iff additionally the peer offered the same, so that
+        //  large messages are passed as memfds.
+        bool passing_fds;
+
+        //  TLS layer of a tls:// connection, NULL otherwise.
+        tls_t *tls;
+
+        //  True until the TLS handshake is done.
+        bool tls_handshaking;
+
+        //  Threads encoding and decoding batches of messages of this
+        //  connection in parallel, NULL if it encodes and decodes one
+        //  message at a time.
+        crypto_pool_t *crypto_pool;
+
+        //  Batch of encoded messages, those from crypto_out_pos on are
+        //  still to be written.
+        std::vector <msg_t> crypto_out;
+        size_t crypto_out_pos;
+
+        //  Batch of received messages. The first crypto_in_decoded ones
+        //  are decoded, those before crypto_in_pos have been pushed to the
+        //  session already. crypto_in_size is the size of the messages
+        //  still to be decoded.
+        std::vector <msg_t> crypto_in;
+        size_t crypto_in_pos;
+        size_t crypto_in_decoded;
+        size_t crypto_in_size;
+
+        //  True iff the message at crypto_in_pos has been processed but
+        //  the session couldn't take it.
+        bool crypto_in_stalled;
+
+        //  Descriptors passed by the peer for frames not decoded yet.
+        std::deque <fd_t> received_fds;
+
+        //  Descriptors of frames in the batch, to be passed with the next
+        //  write.
+        std::vector <fd_t> pending_fds;
+
+        //  IDs of the heartbeat timers: the interval between PINGs, the
+        //  time to wait for traffic after a PING and the TTL announced by
+        //  the peer.
+        enum {
+            heartbeat_ivl_timer_id = 0x43,
+            heartbeat_timeout_timer_id = 0x44,
+            heartbeat_ttl_timer_id = 0x45
+        };
+
+        //  True iff the respective heartbeat timer is running.
+        bool has_heartbeat_timer;
+        bool has_timeout_timer;
+        bool has_ttl_timer;
+
+        //  Context of the last PING received, to be echoed in the PONG.
+        unsigned char pong_context [16];
+        size_t pong_context_size;
+
+        //  True iff a PING is due but has to wait for a PONG to go first.
+        bool ping_pending;
+
         // Socket
         zmq::socket_base_t *socket;
 
@@ -149,6 +149,28 @@ void zmq::tune_tcp_keepalives (fd_t s_, int keepalive_, int keepalive_cnt_, int
 #endif // ZMQ_HAVE_SO_KEEPALIVE
 }
 
+void zmq::set_tcp_fastopen_listener (fd_t s_, int queue_len_)
+{
+    //  The kernel may not support fast open or have it disabled, in which
+    //  case the socket works as usual.
+#if defined TCP_FASTOPEN && !defined ZMQ_HAVE_WINDOWS
+    setsockopt (s_, IPPROTO_TCP, TCP_FASTOPEN, &queue_len_, sizeof (int));
+#else
+    (void) s_;
+    (void) queue_len_;
+#endif
+}
+
+void zmq::set_tcp_fastopen_connect (fd_t s_)
+{
+#if defined TCP_FASTOPEN_CONNECT && !defined ZMQ_HAVE_WINDOWS
+    int flag = 1;
+    setsockopt (s_, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &flag, sizeof (int));
+#else
+    (void) s_;
+#endif
+}
+
 int zmq::tcp_write (fd_t s_, const void *data_, size_t size_)
 {
 #ifdef ZMQ_HAVE_WINDOWS
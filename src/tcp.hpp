@@ -37,6 +37,16 @@ namespace zmq
     //  Tunes TCP keep-alives
     void tune_tcp_keepalives (fd_t s_, int keepalive_, int keepalive_cnt_, int keepalive_idle_, int keepalive_intvl_);
 
+    //  Enables TCP Fast Open on a listening socket, allowing for up to
+    //  queue_len_ pending fast open requests. Does nothing if the platform
+    //  doesn't support it.
+    void set_tcp_fastopen_listener (fd_t s_, int queue_len_);
+
+    //  Enables TCP Fast Open on a socket to be connected. The connection
+    //  is established when the first data are written then, so that they
+    //  travel with the SYN. Does nothing if the platform doesn't support it.
+    void set_tcp_fastopen_connect (fd_t s_);
+
     //  Writes data to the socket. Returns the number of bytes actually
     //  written (even zero is to be considered to be a success). In case
     //  of error or orderly shutdown by the other peer -1 is returned.
@@ -302,7 +302,8 @@ int zmq::tcp_address_t::resolve_interface (const char *interface_, bool ipv6_, b
     return 0;
 }
 
-int zmq::tcp_address_t::resolve_hostname (const char *hostname_, bool ipv6_, bool is_src_)
+int zmq::tcp_address_t::resolve_hostname (const char *hostname_, bool ipv6_,
+    bool is_src_, std::vector <tcp_address_t> *alternatives_)
 {
     //  Set up the query.
 #if defined ZMQ_HAVE_OPENVMS && defined __ia64 && __INITIAL_POINTER_SIZE == 64
@@ -313,8 +314,12 @@ int zmq::tcp_address_t::resolve_hostname (const char *hostname_, bool ipv6_, boo
     memset (&req, 0, sizeof req);
 
     //  Choose IPv4 or IPv6 protocol family. Note that IPv6 allows for
-    //  IPv4-in-IPv6 addresses.
+    //  IPv4-in-IPv6 addresses. When all the addresses are requested, ask
+    //  for both families so that each of them can be tried natively. This
+    //  is not done if there's a source address, which fixes the family.
     req.ai_family = ipv6_? AF_INET6: AF_INET;
+    if (ipv6_ && alternatives_ && !_has_src_addr)
+        req.ai_family = AF_UNSPEC;
 
     //  Need to choose one to avoid duplicate results from getaddrinfo() - this
     //  doesn't really matter, since it's not included in the addr-output.
@@ -357,6 +362,26 @@ int zmq::tcp_address_t::resolve_hostname (const char *hostname_, bool ipv6_, boo
     else
         memcpy (&address, res->ai_addr, res->ai_addrlen);
 
+    //  Store the other results, alternating the address families.
+    if (alternatives_) {
+        std::vector <const addrinfo*> same, other;
+        for (const addrinfo *ai = res->ai_next; ai; ai = ai->ai_next) {
+            zmq_assert ((size_t) ai->ai_addrlen <= sizeof address);
+            if (ai->ai_family == res->ai_family)
+                same.push_back (ai);
+            else
+                other.push_back (ai);
+        }
+        alternatives_->clear ();
+        for (size_t i = 0, j = 0; i < same.size () || j < other.size ();) {
+            const addrinfo *ai = j < other.size () &&
+                (i >= same.size () || j <= i) ? other [j++] : same [i++];
+            alternatives_->push_back (*this);
+            memcpy (&alternatives_->back ().address, ai->ai_addr,
+                ai->ai_addrlen);
+        }
+    }
+
     freeaddrinfo (res);
 
     return 0;
@@ -387,7 +412,8 @@ zmq::tcp_address_t::~tcp_address_t ()
 {
 }
 
-int zmq::tcp_address_t::resolve (const char *name_, bool local_, bool ipv6_, bool is_src_)
+int zmq::tcp_address_t::resolve (const char *name_, bool local_, bool ipv6_,
+    bool is_src_, std::vector <tcp_address_t> *alternatives_)
 {
     if (!is_src_) {
         // Test the ';' to know if we have a source address in name_
@@ -437,7 +463,8 @@ int zmq::tcp_address_t::resolve (const char *name_, bool local_, bool ipv6_, boo
     if (local_)
         rc = resolve_interface (addr_str.c_str (), ipv6_, is_src_);
     else
-        rc = resolve_hostname (addr_str.c_str (), ipv6_, is_src_);
+        rc = resolve_hostname (addr_str.c_str (), ipv6_, is_src_,
+            is_src_? NULL: alternatives_);
     if (rc != 0)
         return -1;
 
@@ -455,10 +482,43 @@ int zmq::tcp_address_t::resolve (const char *name_, bool local_, bool ipv6_, boo
             address.ipv4.sin_port = htons (port);
     }
 
+    //  Local names resolve to a single address.
+    if (alternatives_) {
+        if (local_ || is_src_)
+            alternatives_->clear ();
+        for (size_t i = 0; i != alternatives_->size (); i++) {
+            tcp_address_t &alternative = (*alternatives_) [i];
+            if (alternative.address.generic.sa_family == AF_INET6)
+                alternative.address.ipv6.sin6_port = htons (port);
+            else
+                alternative.address.ipv4.sin_port = htons (port);
+        }
+    }
+
+    return 0;
+}
+
+int zmq::tcp_address_t::resolve_all (const char *name_, bool ipv6_,
+    std::vector <tcp_address_t> &addrs_)
+{
+    tcp_address_t primary;
+    std::vector <tcp_address_t> alternatives;
+    const int rc = primary.resolve (name_, false, ipv6_, false, &alternatives);
+    if (rc != 0)
+        return -1;
+    addrs_.clear ();
+    addrs_.reserve (alternatives.size () + 1);
+    addrs_.push_back (primary);
+    addrs_.insert (addrs_.end (), alternatives.begin (), alternatives.end ());
     return 0;
 }
 
 int zmq::tcp_address_t::to_string (std::string &addr_)
+{
+    return to_string (addr_, "tcp");
+}
+
+int zmq::tcp_address_t::to_string (std::string &addr_, const char *protocol_)
 {
     if (address.generic.sa_family != AF_INET
     &&  address.generic.sa_family != AF_INET6) {
@@ -477,12 +537,12 @@ int zmq::tcp_address_t::to_string (std::string &addr_)
 
     if (address.generic.sa_family == AF_INET6) {
         std::stringstream s;
-        s << "tcp://[" << hbuf << "]:" << ntohs (address.ipv6.sin6_port);
+        s << protocol_ << "://[" << hbuf << "]:" << ntohs (address.ipv6.sin6_port);
         addr_ = s.str ();
     }
     else {
         std::stringstream s;
-        s << "tcp://" << hbuf << ":" << ntohs (address.ipv4.sin_port);
+        s << protocol_ << "://" << hbuf << ":" << ntohs (address.ipv4.sin_port);
         addr_ = s.str ();
     }
     return 0;
@@ -20,6 +20,8 @@
 #ifndef __ZMQ_TCP_ADDRESS_HPP_INCLUDED__
 #define __ZMQ_TCP_ADDRESS_HPP_INCLUDED__
 
+#include <vector>
+
 #include "platform.hpp"
 
 #if defined ZMQ_HAVE_WINDOWS
@@ -44,11 +46,25 @@ namespace zmq
         //  strcuture. If 'local' is true, names are resolved as local interface
         //  names. If it is false, names are resolved as remote hostnames.
         //  If 'ipv6' is true, the name may resolve to IPv6 address.
-        int resolve (const char *name_, bool local_, bool ipv6_, bool is_src_ = false);
+        //  If 'alternatives_' is not NULL, the other addresses a remote
+        //  hostname maps to are stored there.
+        int resolve (const char *name_, bool local_, bool ipv6_,
+            bool is_src_ = false,
+            std::vector <tcp_address_t> *alternatives_ = NULL);
+
+        //  Resolves remote address into all the addresses its hostname
+        //  maps to. The address families alternate, starting with the one
+        //  getaddrinfo() prefers, so that connecters trying the addresses
+        //  in order reach both families early (RFC 8305).
+        static int resolve_all (const char *name_, bool ipv6_,
+            std::vector <tcp_address_t> &addrs_);
 
         //  The opposite to resolve()
         virtual int to_string (std::string &addr_);
 
+        //  Same, for the transports running over TCP other than tcp://.
+        int to_string (std::string &addr_, const char *protocol_);
+
 #if defined ZMQ_HAVE_WINDOWS
         unsigned short family () const;
 #else
@@ -64,7 +80,8 @@ namespace zmq
     protected:
         int resolve_nic_name (const char *nic_, bool ipv6_, bool is_src_ = false);
         int resolve_interface (const char *interface_, bool ipv6_, bool is_src_ = false);
-        int resolve_hostname (const char *hostname_, bool ipv6_, bool is_src_ = false);
+        int resolve_hostname (const char *hostname_, bool ipv6_, bool is_src_ = false,
+            std::vector <tcp_address_t> *alternatives_ = NULL);
 
         union {
             sockaddr generic;
@@ -80,6 +97,8 @@ namespace zmq
         bool _has_src_addr;
     };
 
+    typedef std::vector <tcp_address_t> tcp_addresses_t;
+
     class tcp_address_mask_t : public tcp_address_t
     {
     public:
@@ -19,6 +19,7 @@
 
 #include <new>
 #include <string>
+#include <algorithm>
 
 #include "tcp_connecter.hpp"
 #include "stream_engine.hpp"
@@ -31,6 +32,10 @@
 #include "address.hpp"
 #include "tcp_address.hpp"
 #include "session_base.hpp"
+#include "resolver.hpp"
+#include "config.hpp"
+#include "ctx.hpp"
+#include "tls.hpp"
 
 #if defined ZMQ_HAVE_WINDOWS
 #include "windows.hpp"
@@ -49,29 +54,42 @@
 #endif
 
 zmq::tcp_connecter_t::tcp_connecter_t (class io_thread_t *io_thread_,
-      class session_base_t *session_, const options_t &options_,
+      class session_base_t *session_, const shared_options_t &options_,
       address_t *addr_, bool delayed_start_) :
     own_t (io_thread_, options_),
     io_object_t (io_thread_),
     addr (addr_),
-    s (retired_fd),
-    handle_valid (false),
+    request (NULL),
+    io_thread (io_thread_),
+    next_address (0),
+    attempt_timer_started (false),
     delayed_start (delayed_start_),
     timer_started (false),
     session (session_),
-    current_reconnect_ivl (options.reconnect_ivl)
+    current_reconnect_ivl (options.reconnect_ivl),
+    tls_context (NULL)
 {
     zmq_assert (addr);
-    zmq_assert (addr->protocol == "tcp");
+    zmq_assert (addr->protocol == "tcp" || addr->protocol == "tls");
     addr->to_string (endpoint);
     socket = session->get_socket ();
+
+    //  The options have been checked when connecting.
+#if defined ZMQ_HAVE_TLS
+    if (addr->protocol == "tls")
+        tls_context = tls_context_t::create (options, false);
+#endif
 }
 
 zmq::tcp_connecter_t::~tcp_connecter_t ()
 {
     zmq_assert (!timer_started);
-    zmq_assert (!handle_valid);
-    zmq_assert (s == retired_fd);
+    zmq_assert (!attempt_timer_started);
+    zmq_assert (!request);
+    zmq_assert (attempts.empty ());
+#if defined ZMQ_HAVE_TLS
+    delete tls_context;
+#endif
 }
 
 void zmq::tcp_connecter_t::process_plug ()
@@ -89,38 +107,96 @@ void zmq::tcp_connecter_t::process_term (int linger_)
         timer_started = false;
     }
 
-    if (handle_valid) {
-        rm_fd (handle);
-        handle_valid = false;
+    //  If the result of the lookup is on its way already, wait for it
+    //  before shutting down.
+    if (request) {
+        if (!get_ctx ()->get_resolver ()->cancel (request))
+            register_term_acks (1);
+        else
+            request = NULL;
     }
 
-    if (s != retired_fd)
-        close ();
+    stop_attempts ();
 
     own_t::process_term (linger_);
 }
 
-void zmq::tcp_connecter_t::in_event ()
+void zmq::tcp_connecter_t::process_resolved (resolve_request_t *request_)
 {
-    //  We are not polling for incoming data, so we are actually called
-    //  because of error here. However, we can get error on out event as well
-    //  on some platforms, so we'll simply handle both events in the same way.
-    out_event ();
+    zmq_assert (request_ == request);
+    request = NULL;
+
+    if (is_terminating ()) {
+        delete request_;
+        unregister_term_ack ();
+        return;
+    }
+
+    if (request_->rc == 0)
+        start_attempts (request_->result);
+    else {
+        errno = request_->error;
+        add_reconnect_timer ();
+    }
+    delete request_;
 }
 
-void zmq::tcp_connecter_t::out_event ()
+void zmq::tcp_connecter_t::timer_event (int id_)
 {
-    rm_fd (handle);
-    handle_valid = false;
+    if (id_ == attempt_timer_id) {
+        attempt_timer_started = false;
+        start_next_attempt ();
+        return;
+    }
 
-    const fd_t fd = connect ();
-    //  Handle the error condition by attempt to reconnect.
-    if (fd == retired_fd) {
-        close ();
-        add_reconnect_timer ();
+    zmq_assert (id_ == reconnect_timer_id);
+    timer_started = false;
+    start_connecting ();
+}
+
+void zmq::tcp_connecter_t::attempt_finished (attempt_t *attempt_)
+{
+    const fd_t fd = attempt_->release ();
+    const bool connected = connect (fd);
+
+    attempts_t::iterator it =
+        std::find (attempts.begin (), attempts.end (), attempt_);
+    zmq_assert (it != attempts.end ());
+    attempts.erase (it);
+
+    //  Handle the error condition by moving on to the next address
+    //  straight away. Once all of them have failed, attempt to reconnect.
+    if (!connected) {
+        close (fd);
+        if (attempt_timer_started) {
+            cancel_timer (attempt_timer_id);
+            attempt_timer_started = false;
+        }
+        start_next_attempt ();
+        if (attempts.empty () && !attempt_timer_started)
+            add_reconnect_timer ();
+        delete attempt_;
         return;
     }
 
+    //  The first attempt to succeed wins, abandon the others.
+    set_address (attempt_->address);
+    delete attempt_;
+    stop_attempts ();
+
+    //  Should setting up TLS fail, treat it like a failed connect.
+    tls_t *tls = NULL;
+#if defined ZMQ_HAVE_TLS
+    if (addr->protocol == "tls") {
+        tls = tls_t::create (fd, tls_context, addr->address);
+        if (!tls) {
+            close (fd);
+            add_reconnect_timer ();
+            return;
+        }
+    }
+#endif
+
     tune_tcp_socket (fd);
     tune_tcp_keepalives (fd, options.tcp_keepalive, options.tcp_keepalive_cnt, options.tcp_keepalive_idle, options.tcp_keepalive_intvl);
 
@@ -129,7 +205,7 @@ void zmq::tcp_connecter_t::out_event ()
 
     //  Create the engine object for this connection.
     stream_engine_t *engine = new (std::nothrow)
-        stream_engine_t (fd, options, endpoint);
+        stream_engine_t (fd, shared_options, endpoint, tls);
     alloc_assert (engine);
 
     //  Attach the engine to the corresponding session object.
@@ -141,40 +217,90 @@ void zmq::tcp_connecter_t::out_event ()
     socket->event_connected (endpoint, fd);
 }
 
-void zmq::tcp_connecter_t::timer_event (int id_)
+void zmq::tcp_connecter_t::start_connecting ()
 {
-    zmq_assert (id_ == reconnect_timer_id);
-    timer_started = false;
-    start_connecting ();
+    //  Resolve the address. Host names are looked up in the background,
+    //  we'll get the result by the 'resolved' command.
+    tcp_addresses_t resolved;
+    const int rc = get_ctx ()->get_resolver ()->resolve (addr->address,
+        options.ipv6, &resolved, this, &request);
+    if (rc == -1 && errno == EINPROGRESS)
+        return;
+    if (rc != 0) {
+        add_reconnect_timer ();
+        return;
+    }
+
+    start_attempts (resolved);
 }
 
-void zmq::tcp_connecter_t::start_connecting ()
+void zmq::tcp_connecter_t::start_attempts (tcp_addresses_t &addresses_)
 {
-    //  Open the connecting socket.
-    const int rc = open ();
-
-    //  Connect may succeed in synchronous manner.
-    if (rc == 0) {
-        handle = add_fd (s);
-        handle_valid = true;
-        out_event ();
+    zmq_assert (!addresses_.empty ());
+    addresses.swap (addresses_);
+    next_address = 0;
+
+    start_next_attempt ();
+    if (attempts.empty () && !attempt_timer_started)
+        add_reconnect_timer ();
+}
+
+void zmq::tcp_connecter_t::start_next_attempt ()
+{
+    while (next_address < addresses.size ()) {
+        const tcp_address_t &address = addresses [next_address++];
+
+        //  Open the connecting socket.
+        fd_t fd = retired_fd;
+        const int rc = open (address, fd);
+
+        //  Handle any error condition by trying the next address.
+        if (rc == -1 && errno != EINPROGRESS) {
+            if (fd != retired_fd)
+                close (fd);
+            continue;
+        }
+
+        //  Connection establishment may be delayed. Poll for its
+        //  completion. If connect has succeeded in synchronous manner,
+        //  the socket is writable and the attempt finishes straight away.
+        attempt_t *attempt = new (std::nothrow)
+            attempt_t (io_thread, this, fd, address);
+        alloc_assert (attempt);
+        attempts.push_back (attempt);
+        if (rc == -1)
+            socket->event_connect_delayed (endpoint, EINPROGRESS);
+
+        //  Give the attempt a head start before trying the next address.
+        if (next_address < addresses.size ()) {
+            add_timer (connect_attempt_delay, attempt_timer_id);
+            attempt_timer_started = true;
+        }
+        return;
     }
+}
 
-    //  Connection establishment may be delayed. Poll for its completion.
-    else
-    if (rc == -1 && errno == EINPROGRESS) {
-        handle = add_fd (s);
-        handle_valid = true;
-        set_pollout (handle);
-        socket->event_connect_delayed (endpoint, zmq_errno());
+void zmq::tcp_connecter_t::stop_attempts ()
+{
+    if (attempt_timer_started) {
+        cancel_timer (attempt_timer_id);
+        attempt_timer_started = false;
     }
 
-    //  Handle any other error condition by eventual reconnect.
-    else {
-        if (s != retired_fd)
-            close ();
-        add_reconnect_timer ();
+    for (attempts_t::size_type i = 0; i != attempts.size (); i++) {
+        close (attempts [i]->release ());
+        delete attempts [i];
     }
+    attempts.clear ();
+    addresses.clear ();
+}
+
+void zmq::tcp_connecter_t::set_address (const tcp_address_t &address_)
+{
+    if (addr->resolved.tcp_addr != NULL)
+        delete addr->resolved.tcp_addr;
+    addr->resolved.tcp_addr = new (std::nothrow) tcp_address_t (address_);
+    alloc_assert (addr->resolved.tcp_addr);
 }
 
 void zmq::tcp_connecter_t::add_reconnect_timer ()
@@ -201,71 +327,61 @@ int zmq::tcp_connecter_t::get_new_reconnect_ivl ()
     return interval;
 }
 
-int zmq::tcp_connecter_t::open ()
+int zmq::tcp_connecter_t::open (const tcp_address_t &address_, fd_t &s_)
 {
-    zmq_assert (s == retired_fd);
-
-    //  Resolve the address
-    if (addr->resolved.tcp_addr != NULL) {
-        delete addr->resolved.tcp_addr;
-        addr->resolved.tcp_addr = NULL;
-    }
-
-    addr->resolved.tcp_addr = new (std::nothrow) tcp_address_t ();
-    alloc_assert (addr->resolved.tcp_addr);
-    int rc = addr->resolved.tcp_addr->resolve (
-        addr->address.c_str (), false, options.ipv6);
-    if (rc != 0) {
-        delete addr->resolved.tcp_addr;
-        addr->resolved.tcp_addr = NULL;
-        return -1;
-    }
-    zmq_assert (addr->resolved.tcp_addr != NULL);
-    tcp_address_t * const tcp_addr = addr->resolved.tcp_addr;
+    const tcp_address_t * const tcp_addr = &address_;
+    int rc;
 
     //  Create the socket.
-    s = open_socket (tcp_addr->family (), SOCK_STREAM, IPPROTO_TCP);
+    s_ = open_socket (tcp_addr->family (), SOCK_STREAM, IPPROTO_TCP);
 #ifdef ZMQ_HAVE_WINDOWS
-    if (s == INVALID_SOCKET) {
+    if (s_ == INVALID_SOCKET) {
         errno = wsa_error_to_errno (WSAGetLastError ());
         return -1;
     }
 #else
-    if (s == -1)
+    if (s_ == -1)
         return -1;
 #endif
 
     //  On some systems, IPv4 mapping in IPv6 sockets is disabled by default.
     //  Switch it on in such cases.
     if (tcp_addr->family () == AF_INET6)
-        enable_ipv4_mapping (s);
+        enable_ipv4_mapping (s_);
 
     // Set the IP Type-Of-Service priority for this socket
     if (options.tos != 0)
-        set_ip_type_of_service (s, options.tos);
+        set_ip_type_of_service (s_, options.tos);
 
     // Set the socket to non-blocking mode so that we get async connect().
-    unblock_socket (s);
+    unblock_socket (s_);
 
     //  Set the socket buffer limits for the underlying socket.
     if (options.sndbuf != 0)
-        set_tcp_send_buffer (s, options.sndbuf);
+        set_tcp_send_buffer (s_, options.sndbuf);
     if (options.rcvbuf != 0)
-        set_tcp_receive_buffer (s, options.rcvbuf);
+        set_tcp_receive_buffer (s_, options.rcvbuf);
 
     // Set the IP Type-Of-Service for the underlying socket
     if (options.tos != 0)
-        set_ip_type_of_service (s, options.tos);
+        set_ip_type_of_service (s_, options.tos);
 
     // Set a source address for conversations
     if (tcp_addr->has_src_addr ()) {
-        rc = ::bind (s, tcp_addr->src_addr (), tcp_addr->src_addrlen ());
+        rc = ::bind (s_, tcp_addr->src_addr (), tcp_addr->src_addrlen ());
         if (rc == -1)
             return -1;
     }
 
+    //  Send the first data with the SYN if asked to. The connect then
+    //  completes straight away and the handshake happens on first write.
+    //  That would make the first of several addresses win without ever
+    //  reaching its peer, so only do it when there's a single address.
+    if (options.tcp_fastopen && addresses.size () == 1)
+        set_tcp_fastopen_connect (s_);
+
     //  Connect to the remote peer.
-    rc = ::connect (s, tcp_addr->addr (), tcp_addr->addrlen ());
+    rc = ::connect (s_, tcp_addr->addr (), tcp_addr->addrlen ());
 
     //  Connect was successfull immediately.
     if (rc == 0)
@@ -309,7 +425,7 @@ static int getWinsockConnectionError(zmq::fd_t& socket, int& error) {
 }
 #endif
 
-zmq::fd_t zmq::tcp_connecter_t::connect ()
+bool zmq::tcp_connecter_t::connect (fd_t s_)
 {
     //  Async connect has finished. Check whether an error occurred
     int err = 0;
@@ -322,9 +438,9 @@ zmq::fd_t zmq::tcp_connecter_t::connect ()
 #ifdef ZMQ_HAVE_BROKEN_WINCE
     // CE 4.2 and older do not support SO_ERROR, regardless
     // of what the MSDN will tell you!
-    const int rc = getWinsockConnectionError(s, err);
+    const int rc = getWinsockConnectionError(s_, err);
 #else
-    const int rc = getsockopt (s, SOL_SOCKET, SO_ERROR, (char*) &err, &len);
+    const int rc = getsockopt (s_, SOL_SOCKET, SO_ERROR, (char*) &err, &len);
 #endif
 
     //  Assert if the error was caused by 0MQ bug.
@@ -344,7 +460,7 @@ zmq::fd_t zmq::tcp_connecter_t::connect ()
         {
             wsa_assert_no (err);
         }
-        return retired_fd;
+        return false;
     }
 #else
     //  Following code should handle both Berkeley-derived socket
@@ -361,26 +477,53 @@ zmq::fd_t zmq::tcp_connecter_t::connect ()
             errno == ENETUNREACH ||
             errno == ENETDOWN ||
             errno == EINVAL);
-        return retired_fd;
+        return false;
     }
 #endif
 
-    //  Return the newly connected socket.
-    const fd_t result = s;
-    s = retired_fd;
-    return result;
+    return true;
 }
 
-void zmq::tcp_connecter_t::close ()
+void zmq::tcp_connecter_t::close (fd_t s_)
 {
-    zmq_assert (s != retired_fd);
+    zmq_assert (s_ != retired_fd);
 #ifdef ZMQ_HAVE_WINDOWS
-    const int rc = closesocket (s);
+    const int rc = closesocket (s_);
     wsa_assert (rc != SOCKET_ERROR);
 #else
-    const int rc = ::close (s);
+    const int rc = ::close (s_);
     errno_assert (rc == 0);
 #endif
-    socket->event_closed (endpoint, s);
-    s = retired_fd;
+    socket->event_closed (endpoint, s_);
+}
+
+zmq::tcp_connecter_t::attempt_t::attempt_t (io_thread_t *io_thread_,
+      tcp_connecter_t *connecter_, fd_t s_, const tcp_address_t &address_) :
+    io_object_t (io_thread_),
+    address (address_),
+    connecter (connecter_),
+    s (s_)
+{
+    handle = add_fd (s);
+    set_pollout (handle);
+}
+
+zmq::fd_t zmq::tcp_connecter_t::attempt_t::release ()
+{
+    rm_fd (handle);
+    return s;
+}
+
+void zmq::tcp_connecter_t::attempt_t::in_event ()
+{
+    //  We are not polling for incoming data, so we are actually called
+    //  because of error here. However, we can get error on out event as well
+    //  on some platforms, so we'll simply handle both events in the same way.
+    out_event ();
+}
+
+void zmq::tcp_connecter_t::attempt_t::out_event ()
+{
+    //  The connecter deallocates the attempt.
+    connecter->attempt_finished (this);
 }
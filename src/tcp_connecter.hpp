@@ -20,10 +20,13 @@
 #ifndef __TCP_CONNECTER_HPP_INCLUDED__
 #define __TCP_CONNECTER_HPP_INCLUDED__
 
+#include <vector>
+
 #include "fd.hpp"
 #include "own.hpp"
 #include "stdint.hpp"
 #include "io_object.hpp"
+#include "tcp_address.hpp"
 #include "../include/zmq.h"
 
 namespace zmq
@@ -32,6 +35,8 @@ namespace zmq
     class io_thread_t;
     class session_base_t;
     struct address_t;
+    struct resolve_request_t;
+    class tls_context_t;
 
     class tcp_connecter_t : public own_t, public io_object_t
     {
@@ -40,7 +45,7 @@ namespace zmq
         //  If 'delayed_start' is true connecter first waits for a while,
         //  then starts connection process.
         tcp_connecter_t (zmq::io_thread_t *io_thread_,
-            zmq::session_base_t *session_, const options_t &options_,
+            zmq::session_base_t *session_, const shared_options_t &options_,
             address_t *addr_, bool delayed_start_);
         ~tcp_connecter_t ();
 
@@ -49,18 +54,69 @@ namespace zmq
         //  ID of the timer used to delay the reconnection.
         enum {reconnect_timer_id = 1};
 
+        //  ID of the timer used to stagger the connection attempts.
+        enum {attempt_timer_id = 2};
+
+        //  Connection attempt to one of the addresses the host name maps
+        //  to. It is polled separately so that the connecter can tell
+        //  which of the parallel attempts has finished.
+        class attempt_t : public io_object_t
+        {
+        public:
+
+            attempt_t (zmq::io_thread_t *io_thread_,
+                tcp_connecter_t *connecter_, fd_t s_,
+                const tcp_address_t &address_);
+
+            //  Stops polling and hands the socket over to the caller.
+            fd_t release ();
+
+            const tcp_address_t address;
+
+        private:
+
+            //  i_poll_events interface implementation.
+            void in_event ();
+            void out_event ();
+
+            tcp_connecter_t *connecter;
+            fd_t s;
+            handle_t handle;
+
+            attempt_t (const attempt_t&);
+            const attempt_t &operator = (const attempt_t&);
+        };
+
         //  Handlers for incoming commands.
         void process_plug ();
         void process_term (int linger_);
+        void process_resolved (resolve_request_t *request_);
 
         //  Handlers for I/O events.
-        void in_event ();
-        void out_event ();
         void timer_event (int id_);
 
+        //  Called by the attempt when its connect has finished.
+        void attempt_finished (attempt_t *attempt_);
+
         //  Internal function to start the actual connection establishment.
+        //  Resolves the address first, which may complete asynchronously.
         void start_connecting ();
 
+        //  Starts connecting to the resolved addresses.
+        void start_attempts (tcp_addresses_t &addresses_);
+
+        //  Starts a connection attempt to the next address. Addresses that
+        //  fail straight away are skipped. If there are more addresses left,
+        //  the next attempt is started after 'connect_attempt_delay' ms
+        //  unless this one fails before.
+        void start_next_attempt ();
+
+        //  Stops the connection attempts in progress.
+        void stop_attempts ();
+
+        //  Stores the address that was connected to in 'addr'.
+        void set_address (const tcp_address_t &address_);
+
         //  Internal function to add a reconnect timer
         void add_reconnect_timer();
 
@@ -69,30 +125,38 @@ namespace zmq
         //  Returns the currently used interval
         int get_new_reconnect_ivl ();
 
-        //  Open TCP connecting socket. Returns -1 in case of error,
-        //  0 if connect was successfull immediately. Returns -1 with
-        //  EAGAIN errno if async connect was launched.
-        int open ();
+        //  Open TCP connecting socket to the address. Returns -1 in case of
+        //  error, 0 if connect was successfull immediately. Returns -1 with
+        //  EINPROGRESS errno if async connect was launched. The socket is
+        //  stored in s_ even if the call fails.
+        int open (const tcp_address_t &address_, fd_t &s_);
 
         //  Close the connecting socket.
-        void close ();
+        void close (fd_t s_);
 
-        //  Get the file descriptor of newly created connection. Returns
-        //  retired_fd if the connection was unsuccessfull.
-        fd_t connect ();
+        //  Check whether the async connect on s_ has succeeded. Returns
+        //  false if the connection was unsuccessfull.
+        bool connect (fd_t s_);
 
         //  Address to connect to. Owned by session_base_t.
         address_t *addr;
 
-        //  Underlying socket.
-        fd_t s;
+        //  Host name lookup in progress, if any.
+        resolve_request_t *request;
+
+        //  The I/O thread the attempts are polled by.
+        zmq::io_thread_t *io_thread;
 
-        //  Handle corresponding to the listening socket.
-        handle_t handle;
+        //  Addresses to connect to and the next one to try.
+        tcp_addresses_t addresses;
+        tcp_addresses_t::size_type next_address;
 
-        //  If true file descriptor is registered with the poller and 'handle'
-        //  contains valid value.
-        bool handle_valid;
+        //  Connection attempts in progress.
+        typedef std::vector <attempt_t*> attempts_t;
+        attempts_t attempts;
+
+        //  True iff the attempt timer has been started.
+        bool attempt_timer_started;
 
         //  If true, connecter is waiting a while before trying to connect.
         const bool delayed_start;
@@ -106,6 +170,9 @@ namespace zmq
         //  Current reconnect ivl, updated for backoff strategy
         int current_reconnect_ivl;
 
+        //  TLS settings for the connections made, for the tls:// transport.
+        tls_context_t *tls_context;
+
         // String representation of endpoint to connect to
         std::string endpoint;
 
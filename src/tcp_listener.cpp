@@ -32,6 +32,7 @@
 #include "ip.hpp"
 #include "tcp.hpp"
 #include "socket_base.hpp"
+#include "tls.hpp"
 
 #ifdef ZMQ_HAVE_WINDOWS
 #include "windows.hpp"
@@ -50,17 +51,28 @@
 #endif
 
 zmq::tcp_listener_t::tcp_listener_t (io_thread_t *io_thread_,
-      socket_base_t *socket_, const options_t &options_) :
+      socket_base_t *socket_, const shared_options_t &options_,
+      bool tls_) :
     own_t (io_thread_, options_),
     io_object_t (io_thread_),
     s (retired_fd),
-    socket (socket_)
+    socket (socket_),
+    tls (tls_),
+    tls_context (NULL)
 {
+    //  The options have been checked when binding.
+#if defined ZMQ_HAVE_TLS
+    if (tls)
+        tls_context = tls_context_t::create (options, true);
+#endif
 }
 
 zmq::tcp_listener_t::~tcp_listener_t ()
 {
     zmq_assert (s == retired_fd);
+#if defined ZMQ_HAVE_TLS
+    delete tls_context;
+#endif
 }
 
 void zmq::tcp_listener_t::process_plug ()
@@ -88,6 +100,25 @@ void zmq::tcp_listener_t::in_event ()
         return;
     }
 
+    //  Should setting up TLS fail, drop the connection.
+    tls_t *tls_layer = NULL;
+#if defined ZMQ_HAVE_TLS
+    if (tls) {
+        tls_layer = tls_t::create (fd, tls_context, std::string ());
+        if (!tls_layer) {
+            socket->event_accept_failed (endpoint, zmq_errno ());
+#ifdef ZMQ_HAVE_WINDOWS
+            int rc = closesocket (fd);
+            wsa_assert (rc != SOCKET_ERROR);
+#else
+            int rc = ::close (fd);
+            errno_assert (rc == 0);
+#endif
+            return;
+        }
+    }
+#endif
+
     tune_tcp_socket (fd);
     tune_tcp_keepalives (fd, options.tcp_keepalive, options.tcp_keepalive_cnt, options.tcp_keepalive_idle, options.tcp_keepalive_intvl);
 
@@ -96,7 +127,7 @@ void zmq::tcp_listener_t::in_event ()
 
     //  Create the engine object for this connection.
     stream_engine_t *engine = new (std::nothrow)
-        stream_engine_t (fd, options, endpoint);
+        stream_engine_t (fd, shared_options, endpoint, tls_layer);
     alloc_assert (engine);
 
     //  Choose I/O thread to run connecter in. Given that we are already
@@ -106,7 +137,7 @@ void zmq::tcp_listener_t::in_event ()
 
     //  Create and launch a session object.
     session_base_t *session = session_base_t::create (io_thread, false, socket,
-        options, NULL);
+        shared_options, NULL);
     errno_assert (session);
     session->inc_seqnum ();
     launch_child (session);
@@ -145,7 +176,7 @@ int zmq::tcp_listener_t::get_address (std::string &addr_)
     }
 
     tcp_address_t addr ((struct sockaddr *) &ss, sl);
-    return addr.to_string (addr_);
+    return addr.to_string (addr_, tls ? "tls" : "tcp");
 }
 
 int zmq::tcp_listener_t::set_address (const char *addr_)
@@ -218,7 +249,7 @@ int zmq::tcp_listener_t::set_address (const char *addr_)
     errno_assert (rc == 0);
 #endif
 
-    address.to_string (endpoint);
+    address.to_string (endpoint, tls ? "tls" : "tcp");
 
     //  Bind the socket to the network interface and port.
     rc = bind (s, address.addr (), address.addrlen ());
@@ -232,6 +263,10 @@ int zmq::tcp_listener_t::set_address (const char *addr_)
         goto error;
 #endif
 
+    //  Accept data carried by the SYN packets if asked to.
+    if (options.tcp_fastopen)
+        set_tcp_fastopen_listener (s, options.backlog);
+
     //  Listen for incoming connections.
     rc = listen (s, options.backlog);
 #ifdef ZMQ_HAVE_WINDOWS
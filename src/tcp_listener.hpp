@@ -32,13 +32,16 @@ namespace zmq
 
     class io_thread_t;
     class socket_base_t;
+    class tls_context_t;
 
     class tcp_listener_t : public own_t, public io_object_t
     {
     public:
 
+        //  With 'tls_' set, connections run over TLS (tls:// transport).
         tcp_listener_t (zmq::io_thread_t *io_thread_,
-            zmq::socket_base_t *socket_, const options_t &options_);
+            zmq::socket_base_t *socket_, const shared_options_t &options_,
+            bool tls_ = false);
         ~tcp_listener_t ();
 
         //  Set address to listen on.
@@ -77,6 +80,12 @@ namespace zmq
         //  Socket the listerner belongs to.
         zmq::socket_base_t *socket;
 
+        //  True for the tls:// transport.
+        const bool tls;
+
+        //  TLS settings for the connections accepted, if 'tls' is set.
+        tls_context_t *tls_context;
+
        // String representation of endpoint to bind to
         std::string endpoint;
 
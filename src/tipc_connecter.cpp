@@ -39,7 +39,7 @@
 #include <sys/socket.h>
 
 zmq::tipc_connecter_t::tipc_connecter_t (class io_thread_t *io_thread_,
-      class session_base_t *session_, const options_t &options_,
+      class session_base_t *session_, const shared_options_t &options_,
       const address_t *addr_, bool delayed_start_) :
     own_t (io_thread_, options_),
     io_object_t (io_thread_),
@@ -111,7 +111,8 @@ void zmq::tipc_connecter_t::out_event ()
         return;
     }
     //  Create the engine object for this connection.
-    stream_engine_t *engine = new (std::nothrow) stream_engine_t (fd, options, endpoint);
+    stream_engine_t *engine = new (std::nothrow) stream_engine_t (
+        fd, shared_options, endpoint);
     alloc_assert (engine);
 
     //  Attach the engine to the corresponding session object.
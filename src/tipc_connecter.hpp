@@ -43,7 +43,7 @@ namespace zmq
         //  If 'delayed_start' is true connecter first waits for a while,
         //  then starts connection process.
         tipc_connecter_t (zmq::io_thread_t *io_thread_,
-            zmq::session_base_t *session_, const options_t &options_,
+            zmq::session_base_t *session_, const shared_options_t &options_,
             const address_t *addr_, bool delayed_start_);
         ~tipc_connecter_t ();
 
@@ -40,7 +40,7 @@
 #include <linux/tipc.h>
 
 zmq::tipc_listener_t::tipc_listener_t (io_thread_t *io_thread_,
-      socket_base_t *socket_, const options_t &options_) :
+      socket_base_t *socket_, const shared_options_t &options_) :
     own_t (io_thread_, options_),
     io_object_t (io_thread_),
     s (retired_fd),
@@ -79,7 +79,8 @@ void zmq::tipc_listener_t::in_event ()
     }
 
     //  Create the engine object for this connection.
-    stream_engine_t *engine = new (std::nothrow) stream_engine_t (fd, options, endpoint);
+    stream_engine_t *engine = new (std::nothrow) stream_engine_t (
+        fd, shared_options, endpoint);
     alloc_assert (engine);
 
     //  Choose I/O thread to run connecter in. Given that we are already
@@ -89,7 +90,7 @@ void zmq::tipc_listener_t::in_event ()
 
     //  Create and launch a session object.
     session_base_t *session = session_base_t::create (io_thread, false, socket,
-        options, NULL);
+        shared_options, NULL);
     errno_assert (session);
     session->inc_seqnum ();
     launch_child (session);
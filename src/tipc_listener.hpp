@@ -43,7 +43,7 @@ namespace zmq
     public:
 
         tipc_listener_t (zmq::io_thread_t *io_thread_,
-            zmq::socket_base_t *socket_, const options_t &options_);
+            zmq::socket_base_t *socket_, const shared_options_t &options_);
         ~tipc_listener_t ();
 
         //  Set address to listen on.
@@ -0,0 +1,315 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_TLS
+
+#include <new>
+#include <limits.h>
+
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+#include "tls.hpp"
+#include "options.hpp"
+#include "err.hpp"
+
+zmq::tls_context_t *zmq::tls_context_t::create (const options_t &options_,
+    bool as_server_)
+{
+    //  Servers cannot do without a certificate.
+    if (as_server_ && (options_.tls_cert.empty () || options_.tls_key.empty ())) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    SSL_CTX *ctx = SSL_CTX_new (TLS_method ());
+    alloc_assert (ctx);
+    SSL_CTX_set_min_proto_version (ctx, TLS1_2_VERSION);
+
+    //  The engine retries writes with the rest of its batch, which may
+    //  have been moved in the meantime.
+    SSL_CTX_set_mode (ctx,
+        SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+    //  Prefer the ciphers the kernel can take over, then let OpenSSL
+    //  hand the keys over to the kernel after the handshake. Records are
+    //  still written through SSL_write, which leaves the encryption to
+    //  the kernel then.
+    int rc = SSL_CTX_set_cipher_list (ctx, "ECDHE+AESGCM:ECDHE+CHACHA20");
+    zmq_assert (rc == 1);
+#if defined SSL_OP_ENABLE_KTLS
+    SSL_CTX_set_options (ctx, SSL_OP_ENABLE_KTLS);
+#endif
+
+    //  Connections are long-lived and never resumed.
+    SSL_CTX_set_session_cache_mode (ctx, SSL_SESS_CACHE_OFF);
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    SSL_CTX_set_num_tickets (ctx, 0);
+#endif
+
+    bool valid = true;
+
+    //  Certificate, followed by the rest of its chain.
+    if (!options_.tls_cert.empty ()) {
+        BIO *bio = BIO_new_mem_buf (options_.tls_cert.data (),
+            (int) options_.tls_cert.size ());
+        alloc_assert (bio);
+        X509 *cert = PEM_read_bio_X509 (bio, NULL, NULL, NULL);
+        valid = cert && SSL_CTX_use_certificate (ctx, cert) == 1;
+        X509_free (cert);
+        while (valid) {
+            X509 *extra = PEM_read_bio_X509 (bio, NULL, NULL, NULL);
+            if (!extra)
+                break;
+            if (SSL_CTX_add_extra_chain_cert (ctx, extra) != 1) {
+                X509_free (extra);
+                valid = false;
+            }
+        }
+        BIO_free (bio);
+    }
+
+    if (valid && !options_.tls_key.empty ()) {
+        BIO *bio = BIO_new_mem_buf (options_.tls_key.data (),
+            (int) options_.tls_key.size ());
+        alloc_assert (bio);
+        EVP_PKEY *key = PEM_read_bio_PrivateKey (bio, NULL, NULL, NULL);
+        valid = key && SSL_CTX_use_PrivateKey (ctx, key) == 1
+             && SSL_CTX_check_private_key (ctx) == 1;
+        EVP_PKEY_free (key);
+        BIO_free (bio);
+    }
+
+    //  With trusted certificates given, the peer has to present
+    //  a certificate signed by one of them. Clients otherwise trust what
+    //  the system trusts.
+    if (valid && options_.tls_verify && !options_.tls_ca.empty ()) {
+        BIO *bio = BIO_new_mem_buf (options_.tls_ca.data (),
+            (int) options_.tls_ca.size ());
+        alloc_assert (bio);
+        X509_STORE *store = SSL_CTX_get_cert_store (ctx);
+        int count = 0;
+        while (valid) {
+            X509 *ca = PEM_read_bio_X509 (bio, NULL, NULL, NULL);
+            if (!ca)
+                break;
+            valid = X509_STORE_add_cert (store, ca) == 1;
+            X509_free (ca);
+            count++;
+        }
+        valid = valid && count > 0;
+        BIO_free (bio);
+        SSL_CTX_set_verify (ctx, SSL_VERIFY_PEER
+            | (as_server_ ? SSL_VERIFY_FAIL_IF_NO_PEER_CERT : 0), NULL);
+    }
+    else
+    if (valid && options_.tls_verify && !as_server_) {
+        //  Without any trusted certificate no server passes, which is
+        //  what the handshake reports then.
+        SSL_CTX_set_default_verify_paths (ctx);
+        SSL_CTX_set_verify (ctx, SSL_VERIFY_PEER, NULL);
+    }
+
+    //  Reading PEM data stops with an error in the queue.
+    ERR_clear_error ();
+
+    if (!valid) {
+        SSL_CTX_free (ctx);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    tls_context_t *context = new (std::nothrow)
+        tls_context_t (ctx, as_server_, options_.tls_verify);
+    alloc_assert (context);
+    return context;
+}
+
+zmq::tls_context_t::tls_context_t (SSL_CTX *ctx_, bool as_server_,
+      bool verify_) :
+    ctx (ctx_),
+    as_server (as_server_),
+    verify (verify_)
+{
+}
+
+zmq::tls_context_t::~tls_context_t ()
+{
+    //  Connections still open hold their own references.
+    SSL_CTX_free (ctx);
+}
+
+zmq::tls_t *zmq::tls_t::create (fd_t fd_, tls_context_t *context_,
+    const std::string &address_)
+{
+    if (!context_) {
+        errno = EINVAL;
+        return NULL;
+    }
+    SSL *ssl = SSL_new (context_->ctx);
+    alloc_assert (ssl);
+    if (!context_->as_server && context_->verify
+    &&  set_host (ssl, address_) != 0) {
+        SSL_free (ssl);
+        errno = EINVAL;
+        return NULL;
+    }
+    int rc = SSL_set_fd (ssl, (int) fd_);
+    zmq_assert (rc == 1);
+    if (context_->as_server)
+        SSL_set_accept_state (ssl);
+    else
+        SSL_set_connect_state (ssl);
+
+    tls_t *tls = new (std::nothrow) tls_t (fd_, ssl);
+    alloc_assert (tls);
+    return tls;
+}
+
+int zmq::tls_t::check_options (const options_t &options_, bool as_server_,
+    const std::string &address_)
+{
+    tls_context_t *context = tls_context_t::create (options_, as_server_);
+    if (!context)
+        return -1;
+    int rc = 0;
+    if (!as_server_ && options_.tls_verify) {
+        SSL *ssl = SSL_new (context->ctx);
+        alloc_assert (ssl);
+        rc = set_host (ssl, address_);
+        SSL_free (ssl);
+    }
+    delete context;
+    if (rc != 0)
+        errno = EINVAL;
+    return rc;
+}
+
+int zmq::tls_t::set_host (SSL *ssl_, const std::string &address_)
+{
+    //  The address is [source;]host:port, IPv6 hosts within brackets.
+    std::string host = address_.substr (address_.find (';') + 1);
+    const size_t colon = host.rfind (':');
+    if (colon == std::string::npos)
+        return -1;
+    host.resize (colon);
+    if (host.size () >= 2 && host [0] == '['
+    &&  host [host.size () - 1] == ']')
+        host = host.substr (1, host.size () - 2);
+    if (host.empty ())
+        return -1;
+
+    //  Addresses are checked against the IP addresses the certificate
+    //  lists, names against its DNS names, and sent along as SNI.
+    X509_VERIFY_PARAM *param = SSL_get0_param (ssl_);
+    if (X509_VERIFY_PARAM_set1_ip_asc (param, host.c_str ()) == 1)
+        return 0;
+    if (SSL_set1_host (ssl_, host.c_str ()) != 1
+    ||  SSL_set_tlsext_host_name (ssl_, host.c_str ()) != 1)
+        return -1;
+    return 0;
+}
+
+zmq::tls_t::tls_t (fd_t fd_, SSL *ssl_) :
+    s (fd_),
+    ssl (ssl_),
+    last_error (SSL_ERROR_NONE)
+{
+}
+
+zmq::tls_t::~tls_t ()
+{
+    SSL_free (ssl);
+}
+
+int zmq::tls_t::handshake ()
+{
+    ERR_clear_error ();
+    const int rc = SSL_do_handshake (ssl);
+    if (rc == 1) {
+        last_error = SSL_ERROR_NONE;
+        return 0;
+    }
+
+    last_error = SSL_get_error (ssl, rc);
+    if (last_error == SSL_ERROR_WANT_READ
+    ||  last_error == SSL_ERROR_WANT_WRITE)
+        errno = EAGAIN;
+    else
+        errno = EPROTO;
+    return -1;
+}
+
+bool zmq::tls_t::want_write () const
+{
+    return last_error == SSL_ERROR_WANT_WRITE;
+}
+
+int zmq::tls_t::read (void *data_, size_t size_)
+{
+    if (size_ > INT_MAX)
+        size_ = INT_MAX;
+
+    ERR_clear_error ();
+    const int rc = SSL_read (ssl, data_, (int) size_);
+    if (rc > 0)
+        return rc;
+
+    switch (SSL_get_error (ssl, rc)) {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            errno = EAGAIN;
+            return -1;
+        case SSL_ERROR_ZERO_RETURN:
+            return 0;
+        default:
+            errno = ECONNRESET;
+            return -1;
+    }
+}
+
+int zmq::tls_t::write (const void *data_, size_t size_)
+{
+    if (size_ > INT_MAX)
+        size_ = INT_MAX;
+
+    ERR_clear_error ();
+    const int rc = SSL_write (ssl, data_, (int) size_);
+    if (rc > 0)
+        return rc;
+
+    switch (SSL_get_error (ssl, rc)) {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+bool zmq::tls_t::pending () const
+{
+    return SSL_pending (ssl) > 0;
+}
+
+#endif
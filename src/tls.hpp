@@ -0,0 +1,132 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_TLS_HPP_INCLUDED__
+#define __ZMQ_TLS_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_TLS
+
+#include <stddef.h>
+#include <string>
+
+#include <openssl/ssl.h>
+
+#include "fd.hpp"
+
+namespace zmq
+{
+
+    struct options_t;
+
+    //  Certificates and settings of the TLS end, built from the options
+    //  once and shared by all the connections of a listener or connecter.
+
+    class tls_context_t
+    {
+    public:
+
+        //  Returns NULL with errno set to EINVAL if the options do not make
+        //  a valid configuration for the given end.
+        static tls_context_t *create (const options_t &options_,
+            bool as_server_);
+
+        ~tls_context_t ();
+
+    private:
+
+        tls_context_t (SSL_CTX *ctx_, bool as_server_, bool verify_);
+
+        SSL_CTX *ctx;
+        const bool as_server;
+
+        //  True if the server's host name is to be checked.
+        const bool verify;
+
+        friend class tls_t;
+
+        tls_context_t (const tls_context_t&);
+        const tls_context_t &operator = (const tls_context_t&);
+    };
+
+    //  TLS layer of a tls:// connection. The listening end is the TLS
+    //  server. Unless ZMQ_TLS_VERIFY is off, the connecting end checks
+    //  the server's certificate against ZMQ_TLS_CA, or the system's
+    //  trusted certificates if that is not set, and against the host
+    //  name of the endpoint.
+
+    class tls_t
+    {
+    public:
+
+        //  Creates the TLS state for a connection. Connecting ends pass
+        //  the address they connect to, for its host name to be checked.
+        //  Returns NULL with errno set to EINVAL if there is no context or
+        //  the address holds no host.
+        static tls_t *create (fd_t fd_, tls_context_t *context_,
+            const std::string &address_);
+
+        //  Returns -1 with errno set to EINVAL if the options do not make
+        //  a valid configuration for the given end and address.
+        static int check_options (const options_t &options_,
+            bool as_server_, const std::string &address_);
+
+        ~tls_t ();
+
+        //  Advances the handshake. Returns 0 once it is done, -1 with
+        //  errno set to EAGAIN while it is in progress.
+        int handshake ();
+
+        //  True if the handshake is waiting for the socket to become
+        //  writable rather than readable.
+        bool want_write () const;
+
+        //  Same as tcp_read and tcp_write respectively.
+        int read (void *data_, size_t size_);
+        int write (const void *data_, size_t size_);
+
+        //  True if decrypted data is waiting to be read. The socket
+        //  does not signal it.
+        bool pending () const;
+
+    private:
+
+        tls_t (fd_t fd_, SSL *ssl_);
+
+        //  Makes the connection check that the server's certificate was
+        //  issued for the host of the address. Returns -1 if the address
+        //  holds no host.
+        static int set_host (SSL *ssl_, const std::string &address_);
+
+        fd_t s;
+        SSL *ssl;
+
+        //  Result of the last handshake step.
+        int last_error;
+
+        tls_t (const tls_t&);
+        const tls_t &operator = (const tls_t&);
+    };
+
+}
+
+#endif
+
+#endif
@@ -17,9 +17,10 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+
 #include <stdlib.h>
+#include <string.h>
 
-#include <new>
 #include <algorithm>
 
 #include "platform.hpp"
@@ -30,305 +31,414 @@
 #include "err.hpp"
 #include "trie.hpp"
 
-zmq::trie_t::trie_t () :
-    refcnt (0),
-    min (0),
-    count (0),
-    live_nodes (0)
+zmq::trie_t::trie_t ()
 {
+    new_node (0);
 }
 
 zmq::trie_t::~trie_t ()
 {
-    if (count == 1) {
-        zmq_assert (next.node);
-        delete next.node;
-        next.node = 0;
-    }
-    else
-    if (count > 1) {
-        for (unsigned short i = 0; i != count; ++i)
-            delete next.table [i];
-        free (next.table);
+    for (index_t i = 0; i != nodes.size (); i++) {
+        if (nodes [i].label_size > inline_label_size)
+            free (nodes [i].label);
+        if (nodes [i].child_capacity > 1)
+            free (nodes [i].children);
     }
 }
 
 bool zmq::trie_t::add (unsigned char *prefix_, size_t size_)
 {
-    //  We are at the node corresponding to the prefix. We are done.
-    if (!size_) {
-        ++refcnt;
-        return refcnt == 1;
-    }
-
-    unsigned char c = *prefix_;
-    if (c < min || c >= min + count) {
-
-        //  The character is out of range of currently handled
-        //  charcters. We have to extend the table.
-        if (!count) {
-            min = c;
-            count = 1;
-            next.node = NULL;
-        }
-        else
-        if (count == 1) {
-            unsigned char oldc = min;
-            trie_t *oldp = next.node;
-            count = (min < c ? c - min : min - c) + 1;
-            next.table = (trie_t**)
-                malloc (sizeof (trie_t*) * count);
-            alloc_assert (next.table);
-            for (unsigned short i = 0; i != count; ++i)
-                next.table [i] = 0;
-            min = std::min (min, c);
-            next.table [oldc - min] = oldp;
-        }
-        else
-        if (min < c) {
-            //  The new character is above the current character range.
-            unsigned short old_count = count;
-            count = c - min + 1;
-            next.table = (trie_t**) realloc ((void*) next.table,
-                sizeof (trie_t*) * count);
-            zmq_assert (next.table);
-            for (unsigned short i = old_count; i != count; i++)
-                next.table [i] = NULL;
+    //  Find the node for the prefix, creating it if needed.
+    index_t current = 0;
+    size_t pos = 0;
+    while (pos < size_) {
+        index_t child = find_child (nodes [current], prefix_ [pos]);
+        if (!child) {
+            child = new_node (current);
+            set_label (nodes [child], prefix_ + pos, size_ - pos);
+            add_child (current, child);
+            current = child;
+            break;
         }
-        else {
-
-            //  The new character is below the current character range.
-            unsigned short old_count = count;
-            count = (min + old_count) - c;
-            next.table = (trie_t**) realloc ((void*) next.table,
-                sizeof (trie_t*) * count);
-            zmq_assert (next.table);
-            memmove (next.table + min - c, next.table,
-                old_count * sizeof (trie_t*));
-            for (unsigned short i = 0; i != min - c; i++)
-                next.table [i] = NULL;
-            min = c;
-        }
-    }
 
-    //  If next node does not exist, create one.
-    if (count == 1) {
-        if (!next.node) {
-            next.node = new (std::nothrow) trie_t;
-            alloc_assert (next.node);
-            ++live_nodes;
-            zmq_assert (live_nodes == 1);
-        }
-        return next.node->add (prefix_ + 1, size_ - 1);
-    }
-    else {
-        if (!next.table [c - min]) {
-            next.table [c - min] = new (std::nothrow) trie_t;
-            alloc_assert (next.table [c - min]);
-            ++live_nodes;
-            zmq_assert (live_nodes > 1);
+        const unsigned char *label = get_label (nodes [child]);
+        const size_t label_size = nodes [child].label_size;
+        size_t common = 1;
+        const size_t max = std::min (label_size, size_ - pos);
+        while (common < max && label [common] == prefix_ [pos + common])
+            common++;
+
+        //  The prefix branches off in the middle of the child's label.
+        //  Split the child in two.
+        if (common < label_size) {
+            const index_t middle = new_node (current);
+            node_t &node = nodes [child];
+            set_label (nodes [middle], get_label (node), common);
+            set_label (node, get_label (node) + common, label_size - common);
+            node.parent = middle;
+            replace_child (current, middle);
+            add_child (middle, child);
+            child = middle;
         }
-        return next.table [c - min]->add (prefix_ + 1, size_ - 1);
+
+        current = child;
+        pos += common;
     }
+
+    nodes [current].refcnt++;
+    return nodes [current].refcnt == 1;
 }
 
 bool zmq::trie_t::rm (unsigned char *prefix_, size_t size_)
 {
-    //  TODO: Shouldn't an error be reported if the key does not exist?
-    if (!size_) {
-        if (!refcnt)
+    index_t current = 0;
+    size_t pos = 0;
+    while (pos < size_) {
+        const index_t child = find_child (nodes [current], prefix_ [pos]);
+        if (!child)
+            return false;
+        const node_t &node = nodes [child];
+        if (node.label_size > size_ - pos
+        ||  memcmp (get_label (node), prefix_ + pos, node.label_size) != 0)
             return false;
-        refcnt--;
-        return refcnt == 0;
+        current = child;
+        pos += node.label_size;
     }
-    unsigned char c = *prefix_;
-    if (!count || c < min || c >= min + count)
-        return false;
 
-    trie_t *next_node =
-        count == 1 ? next.node : next.table [c - min];
-
-    if (!next_node)
+    if (nodes [current].refcnt == 0)
+        return false;
+    nodes [current].refcnt--;
+    if (nodes [current].refcnt != 0)
         return false;
 
-    bool ret = next_node->rm (prefix_ + 1, size_ - 1);
-
-    //  Prune redundant nodes
-    if (next_node->is_redundant ()) {
-        delete next_node;
-        zmq_assert (count > 0);
-
-        if (count == 1) {
-            //  The just pruned node is was the only live node
-            next.node = 0;
-            count = 0;
-            --live_nodes;
-            zmq_assert (live_nodes == 0);
-        }
-        else {
-            next.table [c - min] = 0;
-            zmq_assert (live_nodes > 1);
-            --live_nodes;
-
-            //  Compact the table if possible
-            if (live_nodes == 1) {
-                //  We can switch to using the more compact single-node
-                //  representation since the table only contains one live node
-                trie_t *node = 0;
-                //  Since we always compact the table the pruned node must
-                //  either be the left-most or right-most ptr in the node
-                //  table
-                if (c == min) {
-                    //  The pruned node is the left-most node ptr in the
-                    //  node table => keep the right-most node
-                    node = next.table [count - 1];
-                    min += count - 1;
-                }
-                else
-                if (c == min + count - 1) {
-                    //  The pruned node is the right-most node ptr in the
-                    //  node table => keep the left-most node
-                    node = next.table [0];
-                }
-                zmq_assert (node);
-                free (next.table);
-                next.node = node;
-                count = 1;
-            }
-            else
-            if (c == min) {
-                //  We can compact the table "from the left".
-                //  Find the left-most non-null node ptr, which we'll use as
-                //  our new min
-                unsigned char new_min = min;
-                for (unsigned short i = 1; i < count; ++i) {
-                    if (next.table [i]) {
-                        new_min = i + min;
-                        break;
-                    }
-                }
-                zmq_assert (new_min != min);
-
-                trie_t **old_table = next.table;
-                zmq_assert (new_min > min);
-                zmq_assert (count > new_min - min);
-
-                count = count - (new_min - min);
-                next.table = (trie_t**) malloc (sizeof (trie_t*) * count);
-                alloc_assert (next.table);
-
-                memmove (next.table, old_table + (new_min - min),
-                        sizeof (trie_t*) * count);
-                free (old_table);
-
-                min = new_min;
-            }
-            else
-            if (c == min + count - 1) {
-                //  We can compact the table "from the right".
-                //  Find the right-most non-null node ptr, which we'll use to
-                //  determine the new table size
-                unsigned short new_count = count;
-                for (unsigned short i = 1; i < count; ++i) {
-                    if (next.table [count - 1 - i]) {
-                        new_count = count - i;
-                        break;
-                    }
-                }
-                zmq_assert (new_count != count);
-                count = new_count;
-
-                trie_t **old_table = next.table;
-                next.table = (trie_t**) malloc (sizeof (trie_t*) * count);
-                alloc_assert (next.table);
-
-                memmove (next.table, old_table, sizeof (trie_t*) * count);
-                free (old_table);
-            }
-        }
-    }
-    return ret;
+    prune (current);
+    return true;
 }
 
 bool zmq::trie_t::check (unsigned char *data_, size_t size_)
 {
-    //  This function is on critical path. It deliberately doesn't use
-    //  recursion to get a bit better performance.
-    trie_t *current = this;
+    const node_t *base = &nodes [0];
+    const node_t *current = base;
     while (true) {
 
         //  We've found a corresponding subscription!
         if (current->refcnt)
             return true;
 
-        //  We've checked all the data and haven't found matching subscription.
+        //  We've checked all the data and haven't found matching
+        //  subscription.
         if (!size_)
             return false;
 
-        //  If there's no corresponding slot for the first character
-        //  of the prefix, the message does not match.
-        unsigned char c = *data_;
-        if (c < current->min || c >= current->min + current->count)
+        //  Move on if the message goes on with the label of a child.
+        const index_t child = find_child (*const_cast <node_t*> (current),
+            data_ [0]);
+        if (!child)
             return false;
-
-        //  Move to the next character.
-        if (current->count == 1)
-            current = current->next.node;
-        else {
-            current = current->next.table [c - current->min];
-            if (!current)
-                return false;
-        }
-        data_++;
-        size_--;
+        current = base + child;
+        if (current->label_size > size_
+        ||  memcmp (get_label (*current), data_, current->label_size) != 0)
+            return false;
+        data_ += current->label_size;
+        size_ -= current->label_size;
     }
 }
 
 void zmq::trie_t::apply (void (*func_) (unsigned char *data_, size_t size_,
     void *arg_), void *arg_)
 {
-    unsigned char *buff = NULL;
-    apply_helper (&buff, 0, 0, func_, arg_);
+    size_t maxbuffsize = 256;
+    unsigned char *buff = (unsigned char*) malloc (maxbuffsize);
+    alloc_assert (buff);
+    apply_helper (0, &buff, 0, &maxbuffsize, func_, arg_);
     free (buff);
 }
 
-void zmq::trie_t::apply_helper (
-    unsigned char **buff_, size_t buffsize_, size_t maxbuffsize_,
+void zmq::trie_t::apply_helper (index_t index_,
+    unsigned char **buff_, size_t buffsize_, size_t *maxbuffsize_,
     void (*func_) (unsigned char *data_, size_t size_, void *arg_), void *arg_)
 {
+    //  Append the node's label to the buffer.
+    const size_t label_size = nodes [index_].label_size;
+    if (buffsize_ + label_size > *maxbuffsize_) {
+        *maxbuffsize_ = buffsize_ + label_size + 256;
+        *buff_ = (unsigned char*) realloc (*buff_, *maxbuffsize_);
+        alloc_assert (*buff_);
+    }
+    memcpy (*buff_ + buffsize_, get_label (nodes [index_]), label_size);
+    buffsize_ += label_size;
+
     //  If this node is a subscription, apply the function.
-    if (refcnt)
+    if (nodes [index_].refcnt)
         func_ (*buff_, buffsize_, arg_);
 
-    //  Adjust the buffer.
-    if (buffsize_ >= maxbuffsize_) {
-        maxbuffsize_ = buffsize_ + 256;
-        *buff_ = (unsigned char*) realloc (*buff_, maxbuffsize_);
-        zmq_assert (*buff_);
+    const unsigned short count =
+        nodes [index_].child_capacity == table_size ?
+            (unsigned short) table_size : nodes [index_].child_count;
+    for (unsigned short i = 0; i != count; i++) {
+        const index_t child = get_children (nodes [index_]) [i];
+        if (child)
+            apply_helper (child, buff_, buffsize_, maxbuffsize_, func_, arg_);
     }
+}
+
+zmq::trie_t::index_t zmq::trie_t::new_node (index_t parent_)
+{
+    index_t index;
+    if (free_nodes.empty ()) {
+        index = static_cast <index_t> (nodes.size ());
+        nodes.push_back (node_t ());
+    }
+    else {
+        index = free_nodes.back ();
+        free_nodes.pop_back ();
+    }
+
+    node_t &node = nodes [index];
+    node.refcnt = 0;
+    node.label_size = 0;
+    node.children = NULL;
+    node.child_count = 0;
+    node.child_capacity = 0;
+    node.parent = parent_;
+    return index;
+}
+
+void zmq::trie_t::delete_node (index_t index_)
+{
+    node_t &node = nodes [index_];
+    if (node.label_size > inline_label_size)
+        free (node.label);
+    if (node.child_capacity > 1)
+        free (node.children);
+    node.label_size = 0;
+    node.child_capacity = 0;
+    free_nodes.push_back (index_);
+
+    //  Give the memory back once the trie is empty.
+    if (free_nodes.size () == nodes.size () - 1) {
+        nodes.resize (1);
+        std::vector <index_t> ().swap (free_nodes);
+    }
+}
 
-    //  If there are no subnodes in the trie, return.
-    if (count == 0)
+const unsigned char *zmq::trie_t::get_label (const node_t &node_)
+{
+    return node_.label_size > inline_label_size ?
+        node_.label : node_.inline_label;
+}
+
+void zmq::trie_t::set_label (node_t &node_, const unsigned char *label_,
+    size_t size_)
+{
+    //  The new label may be a part of the old one.
+    unsigned char *old_label =
+        node_.label_size > inline_label_size ? node_.label : NULL;
+    if (size_ <= inline_label_size) {
+        if (size_)
+            memmove (node_.inline_label, label_, size_);
+    }
+    else {
+        unsigned char *label = (unsigned char*) malloc (size_);
+        alloc_assert (label);
+        memcpy (label, label_, size_);
+        node_.label = label;
+    }
+    free (old_label);
+    node_.label_size = static_cast <uint32_t> (size_);
+}
+
+zmq::trie_t::index_t *zmq::trie_t::get_children (node_t &node_)
+{
+    return node_.child_capacity > 1 ? node_.children : node_.single_child;
+}
+
+unsigned char *zmq::trie_t::child_bytes (node_t &node_)
+{
+    return (unsigned char*) (get_children (node_) + node_.child_capacity);
+}
+
+size_t zmq::trie_t::child_position (node_t &node_, unsigned char c_)
+{
+    const unsigned char *bytes = child_bytes (node_);
+    size_t low = 0;
+    size_t high = node_.child_count;
+    if (high <= linear_search_max) {
+        while (low < high && bytes [low] < c_)
+            low++;
+        return low;
+    }
+    while (low < high) {
+        const size_t middle = (low + high) / 2;
+        if (bytes [middle] < c_)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+zmq::trie_t::index_t zmq::trie_t::find_child (node_t &node_,
+    unsigned char c_)
+{
+    if (node_.child_capacity == table_size)
+        return node_.children [c_];
+    const size_t pos = child_position (node_, c_);
+    if (pos < node_.child_count && child_bytes (node_) [pos] == c_)
+        return get_children (node_) [pos];
+    return 0;
+}
+
+void zmq::trie_t::add_child (index_t index_, index_t child_)
+{
+    const unsigned char c = get_label (nodes [child_]) [0];
+    node_t &node = nodes [index_];
+
+    //  Past max_child_capacity children, switch to a table indexed by
+    //  the first byte.
+    if (node.child_capacity == max_child_capacity
+    &&  node.child_count == max_child_capacity) {
+        index_t *table = (index_t*) calloc (table_size, sizeof (index_t));
+        alloc_assert (table);
+        const unsigned char *bytes = child_bytes (node);
+        for (unsigned short i = 0; i != node.child_count; i++)
+            table [bytes [i]] = node.children [i];
+        free (node.children);
+        node.children = table;
+        node.child_capacity = table_size;
+    }
+    if (node.child_capacity == table_size) {
+        node.children [c] = child_;
+        node.child_count++;
         return;
+    }
+
+    const size_t pos = child_position (node, c);
+    if (node.child_count == node.child_capacity) {
+        const unsigned short capacity = node.child_capacity
+            ? node.child_capacity * 2 : 1;
+        index_t *children = node.single_child;
+        if (capacity > 1) {
+            children = (index_t*) malloc ((sizeof (index_t) + 1) * capacity);
+            alloc_assert (children);
+        }
+        if (node.child_count) {
+            memcpy (children, get_children (node),
+                sizeof (index_t) * node.child_count);
+            memcpy (children + capacity, child_bytes (node),
+                node.child_count);
+        }
+        if (node.child_capacity > 1)
+            free (node.children);
+        if (capacity > 1)
+            node.children = children;
+        node.child_capacity = capacity;
+    }
+
+    index_t *children = get_children (node);
+    unsigned char *bytes = child_bytes (node);
+    const size_t moved = node.child_count - pos;
+    memmove (children + pos + 1, children + pos, sizeof (index_t) * moved);
+    memmove (bytes + pos + 1, bytes + pos, moved);
+    children [pos] = child_;
+    bytes [pos] = c;
+    node.child_count++;
+}
 
-    //  If there's one subnode (optimisation).
-    if (count == 1) {
-        (*buff_) [buffsize_] = min;
-        buffsize_++;
-        next.node->apply_helper (buff_, buffsize_, maxbuffsize_, func_, arg_);
+void zmq::trie_t::replace_child (index_t index_, index_t child_)
+{
+    const unsigned char c = get_label (nodes [child_]) [0];
+    node_t &node = nodes [index_];
+    if (node.child_capacity == table_size) {
+        zmq_assert (node.children [c]);
+        node.children [c] = child_;
         return;
     }
+    const size_t pos = child_position (node, c);
+    zmq_assert (pos < node.child_count && child_bytes (node) [pos] == c);
+    get_children (node) [pos] = child_;
+}
 
-    //  If there are multiple subnodes.
-    for (unsigned short c = 0; c != count; c++) {
-        (*buff_) [buffsize_] = min + c;
-        if (next.table [c])
-            next.table [c]->apply_helper (buff_, buffsize_ + 1, maxbuffsize_,
-                func_, arg_);
+void zmq::trie_t::remove_child (index_t index_, index_t child_)
+{
+    const unsigned char c = get_label (nodes [child_]) [0];
+    node_t &node = nodes [index_];
+
+    if (node.child_count == 1) {
+        if (node.child_capacity > 1)
+            free (node.children);
+        node.children = NULL;
+        node.child_count = 0;
+        node.child_capacity = 0;
+        return;
+    }
+
+    if (node.child_capacity == table_size) {
+        zmq_assert (node.children [c] == child_);
+        node.children [c] = 0;
+        node.child_count--;
+
+        //  Switch back to the sorted array once there are few children.
+        if (node.child_count == max_child_capacity / 2) {
+            index_t *children = (index_t*)
+                malloc ((sizeof (index_t) + 1) * max_child_capacity);
+            alloc_assert (children);
+            unsigned char *bytes = (unsigned char*)
+                (children + max_child_capacity);
+            unsigned short pos = 0;
+            for (unsigned short i = 0; i != table_size; i++)
+                if (node.children [i]) {
+                    children [pos] = node.children [i];
+                    bytes [pos] = (unsigned char) i;
+                    pos++;
+                }
+            free (node.children);
+            node.children = children;
+            node.child_capacity = max_child_capacity;
+        }
+        return;
     }
+
+    const size_t pos = child_position (node, c);
+    zmq_assert (pos < node.child_count && get_children (node) [pos] == child_);
+    index_t *children = get_children (node);
+    unsigned char *bytes = child_bytes (node);
+    const size_t moved = node.child_count - pos - 1;
+    memmove (children + pos, children + pos + 1, sizeof (index_t) * moved);
+    memmove (bytes + pos, bytes + pos + 1, moved);
+    node.child_count--;
 }
 
-bool zmq::trie_t::is_redundant () const
+void zmq::trie_t::prune (index_t index_)
 {
-    return refcnt == 0 && live_nodes == 0;
+    while (index_ != 0 && nodes [index_].refcnt == 0) {
+        const index_t parent = nodes [index_].parent;
+
+        if (nodes [index_].child_count == 0) {
+            remove_child (parent, index_);
+            delete_node (index_);
+            index_ = parent;
+            continue;
+        }
+
+        //  A node with a single child and no subscription doesn't branch.
+        //  The child takes its place.
+        if (nodes [index_].child_count == 1) {
+            node_t &node = nodes [index_];
+            const index_t child = get_children (node) [0];
+            node_t &child_node = nodes [child];
+            const size_t size = node.label_size + child_node.label_size;
+            unsigned char *label = (unsigned char*) malloc (size);
+            alloc_assert (label);
+            memcpy (label, get_label (node), node.label_size);
+            memcpy (label + node.label_size, get_label (child_node),
+                child_node.label_size);
+            set_label (child_node, label, size);
+            free (label);
+            child_node.parent = parent;
+            replace_child (parent, child);
+            delete_node (index_);
+        }
+        break;
+    }
 }
@@ -21,12 +21,20 @@
 #define __ZMQ_TRIE_HPP_INCLUDED__
 
 #include <stddef.h>
+#include <vector>
 
 #include "stdint.hpp"
 
 namespace zmq
 {
 
+    //  Set of subscriptions, each with a reference count, that messages
+    //  are checked against. Like mtrie_t the trie is path-compressed,
+    //  each node standing for a whole run of bytes. It is also flat: the
+    //  nodes live in a single array and refer to one another by index,
+    //  and short labels and single children are stored within the nodes,
+    //  so that checking a message touches few cache lines.
+
     class trie_t
     {
     public:
@@ -51,20 +59,79 @@ namespace zmq
 
     private:
 
-        void apply_helper (
-            unsigned char **buff_, size_t buffsize_, size_t maxbuffsize_,
+        enum {
+            //  Labels up to this size are stored within the node.
+            inline_label_size = 16,
+
+            //  Nodes with more children than this find them by binary
+            //  rather than linear search.
+            linear_search_max = 8,
+
+            //  Nodes with more children than this find them in a table
+            //  indexed by their first byte.
+            max_child_capacity = 64,
+            table_size = 256
+        };
+
+        //  The root is node 0, so no node has it as a child.
+        typedef uint32_t index_t;
+
+        struct node_t
+        {
+            //  Number of subscriptions to the node's prefix.
+            uint32_t refcnt;
+
+            //  Number of bytes leading to this node from its parent.
+            uint32_t label_size;
+
+            //  Indices of the children sorted by the first byte of their
+            //  labels, followed by those first bytes, or the table of
+            //  children once there are many. The block of a single child
+            //  is stored within the node.
+            union {
+                index_t *children;
+                index_t single_child [2];
+            };
+            unsigned short child_count;
+            unsigned short child_capacity;
+
+            index_t parent;
+
+            union {
+                unsigned char *label;
+                unsigned char inline_label [inline_label_size];
+            };
+        };
+
+        //  Returns a new node. Allocating nodes may move the others.
+        index_t new_node (index_t parent_);
+        void delete_node (index_t index_);
+
+        static const unsigned char *get_label (const node_t &node_);
+        static void set_label (node_t &node_, const unsigned char *label_,
+            size_t size_);
+
+        static index_t *get_children (node_t &node_);
+        static unsigned char *child_bytes (node_t &node_);
+        static size_t child_position (node_t &node_, unsigned char c_);
+        static index_t find_child (node_t &node_, unsigned char c_);
+        void add_child (index_t index_, index_t child_);
+        void replace_child (index_t index_, index_t child_);
+        void remove_child (index_t index_, index_t child_);
+
+        //  Removes the node if it's not needed anymore, merging nodes
+        //  that no longer branch.
+        void prune (index_t index_);
+
+        void apply_helper (index_t index_,
+            unsigned char **buff_, size_t buffsize_, size_t *maxbuffsize_,
             void (*func_) (unsigned char *data_, size_t size_, void *arg_),
             void *arg_);
-        bool is_redundant () const;
-
-        uint32_t refcnt;
-        unsigned char min;
-        unsigned short count;
-        unsigned short live_nodes;
-        union {
-            class trie_t *node;
-            class trie_t **table;
-        } next;
+
+        std::vector <node_t> nodes;
+
+        //  Unused entries of the array.
+        std::vector <index_t> free_nodes;
 
         trie_t (const trie_t&);
         const trie_t &operator = (const trie_t&);
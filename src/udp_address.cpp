@@ -0,0 +1,165 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string>
+#include <string.h>
+#include <stdlib.h>
+
+#include "udp_address.hpp"
+#include "tcp_address.hpp"
+#include "platform.hpp"
+#include "stdint.hpp"
+#include "err.hpp"
+
+#ifdef ZMQ_HAVE_WINDOWS
+#include "windows.hpp"
+#else
+#include <sys/types.h>
+#include <arpa/inet.h>
+#endif
+
+zmq::udp_address_t::udp_address_t () :
+    is_multicast (false)
+{
+    memset (&bind_address, 0, sizeof bind_address);
+    memset (&dest_address, 0, sizeof dest_address);
+    multicast.s_addr = htonl (INADDR_ANY);
+    iface.s_addr = htonl (INADDR_ANY);
+}
+
+zmq::udp_address_t::~udp_address_t ()
+{
+}
+
+int zmq::udp_address_t::resolve (const char *name_, bool bind_)
+{
+    //  Find the interface part, if any.
+    const char *src_delimiter = strrchr (name_, ';');
+    if (src_delimiter) {
+        const std::string iface_str (name_, src_delimiter - name_);
+        if (iface_str == "*")
+            iface.s_addr = htonl (INADDR_ANY);
+        else
+        if (inet_pton (AF_INET, iface_str.c_str (), &iface) != 1) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    //  Find the ':' at end that separates address from the port number.
+    const char *addr_start = src_delimiter ? src_delimiter + 1 : name_;
+    const char *delimiter = strrchr (addr_start, ':');
+    if (!delimiter) {
+        errno = EINVAL;
+        return -1;
+    }
+    const std::string addr_str (addr_start, delimiter - addr_start);
+    const std::string port_str (delimiter + 1);
+
+    //  Datagrams are sent to a well-known port, so there is no wildcard.
+    const uint16_t port = (uint16_t) atoi (port_str.c_str ());
+    if (port == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    in_addr ip;
+    if (bind_ && addr_str == "*")
+        ip.s_addr = htonl (INADDR_ANY);
+    else
+    if (inet_pton (AF_INET, addr_str.c_str (), &ip) != 1) {
+        //  Not a literal address, look the host name up.
+        tcp_address_t resolved;
+        if (resolved.resolve (addr_start, bind_, false) != 0)
+            return -1;
+        if (resolved.family () != AF_INET) {
+            errno = EINVAL;
+            return -1;
+        }
+        ip = ((const sockaddr_in *) resolved.addr ())->sin_addr;
+    }
+
+    is_multicast = IN_MULTICAST (ntohl (ip.s_addr));
+    if (is_multicast)
+        multicast = ip;
+    else
+    if (src_delimiter) {
+        //  Interface only makes sense for multicast.
+        errno = EINVAL;
+        return -1;
+    }
+
+    //  Receiving sockets bound to the group address get datagrams sent
+    //  to that group only. Windows does not allow that.
+    bind_address.sin_family = AF_INET;
+    bind_address.sin_port = htons (port);
+#if defined ZMQ_HAVE_WINDOWS
+    bind_address.sin_addr.s_addr = is_multicast ? htonl (INADDR_ANY) : ip.s_addr;
+#else
+    bind_address.sin_addr = ip;
+#endif
+
+    dest_address.sin_family = AF_INET;
+    dest_address.sin_port = htons (port);
+    dest_address.sin_addr = ip;
+
+    address = name_;
+    return 0;
+}
+
+int zmq::udp_address_t::to_string (std::string &addr_)
+{
+    addr_ = "udp://" + address;
+    return 0;
+}
+
+bool zmq::udp_address_t::is_mcast () const
+{
+    return is_multicast;
+}
+
+const sockaddr *zmq::udp_address_t::bind_addr () const
+{
+    return (const sockaddr *) &bind_address;
+}
+
+socklen_t zmq::udp_address_t::bind_addrlen () const
+{
+    return (socklen_t) sizeof bind_address;
+}
+
+const sockaddr *zmq::udp_address_t::dest_addr () const
+{
+    return (const sockaddr *) &dest_address;
+}
+
+socklen_t zmq::udp_address_t::dest_addrlen () const
+{
+    return (socklen_t) sizeof dest_address;
+}
+
+const in_addr zmq::udp_address_t::multicast_ip () const
+{
+    return multicast;
+}
+
+const in_addr zmq::udp_address_t::interface_ip () const
+{
+    return iface;
+}
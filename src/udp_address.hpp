@@ -0,0 +1,84 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_UDP_ADDRESS_HPP_INCLUDED__
+#define __ZMQ_UDP_ADDRESS_HPP_INCLUDED__
+
+#include <string>
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include "windows.hpp"
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+
+namespace zmq
+{
+
+    //  Address of a udp:// endpoint. DISH sockets receive datagrams sent
+    //  to the address, joining the group if it is a multicast one; RADIO
+    //  sockets send datagrams to it. The address may be preceded by
+    //  the IPv4 address of the interface to use for multicast, separated
+    //  by a semicolon.
+
+    class udp_address_t
+    {
+    public:
+
+        udp_address_t ();
+        ~udp_address_t ();
+
+        //  Translates textual address into the address structures. If
+        //  'bind_' is true, the address is the one to receive datagrams
+        //  on, and may be '*' to receive on all interfaces.
+        int resolve (const char *name_, bool bind_);
+
+        //  The opposite to resolve()
+        int to_string (std::string &addr_);
+
+        bool is_mcast () const;
+
+        //  Address to bind the socket to when receiving.
+        const sockaddr *bind_addr () const;
+        socklen_t bind_addrlen () const;
+
+        //  Address to send datagrams to.
+        const sockaddr *dest_addr () const;
+        socklen_t dest_addrlen () const;
+
+        //  Multicast group, and the interface to join it or send to it on.
+        const in_addr multicast_ip () const;
+        const in_addr interface_ip () const;
+
+    private:
+
+        sockaddr_in bind_address;
+        sockaddr_in dest_address;
+        in_addr multicast;
+        in_addr iface;
+        bool is_multicast;
+        std::string address;
+    };
+
+}
+
+#endif
@@ -0,0 +1,349 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "platform.hpp"
+
+#if !defined ZMQ_HAVE_WINDOWS
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <new>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "udp_engine.hpp"
+#include "session_base.hpp"
+#include "socket_base.hpp"
+#include "address.hpp"
+#include "ip.hpp"
+#include "msg.hpp"
+#include "likely.hpp"
+#include "err.hpp"
+
+zmq::udp_engine_t::udp_engine_t (const shared_options_t &options_) :
+    fd (retired_fd),
+    handle (NULL),
+    send_enabled (false),
+    recv_enabled (false),
+    buffers (NULL),
+    out_count (0),
+    out_sent (0),
+    dropping (false),
+    session (NULL),
+    shared_options (options_),
+    options (shared_options.get ())
+{
+}
+
+zmq::udp_engine_t::~udp_engine_t ()
+{
+    if (fd != retired_fd) {
+        int rc = close (fd);
+        errno_assert (rc == 0);
+        fd = retired_fd;
+    }
+    free (buffers);
+}
+
+int zmq::udp_engine_t::init (address_t *address_, bool send_, bool recv_)
+{
+    zmq_assert (address_ && address_->resolved.udp_addr);
+    zmq_assert (send_ ^ recv_);
+    send_enabled = send_;
+    recv_enabled = recv_;
+
+    address = *address_->resolved.udp_addr;
+    return address.to_string (endpoint);
+}
+
+void zmq::udp_engine_t::plug (io_thread_t *io_thread_,
+    session_base_t *session_)
+{
+    zmq_assert (!session);
+    zmq_assert (session_);
+    session = session_;
+
+    //  Connect to I/O threads poller object.
+    io_object_t::plug (io_thread_);
+
+    buffers = (unsigned char *) malloc (
+        udp_batch_size * udp_max_datagram_size);
+    alloc_assert (buffers);
+    memset (headers, 0, sizeof headers);
+    for (int i = 0; i != udp_batch_size; i++) {
+        iovecs [i].iov_base = buffers + i * udp_max_datagram_size;
+        iovecs [i].iov_len = udp_max_datagram_size;
+        headers [i].msg_hdr.msg_iov = &iovecs [i];
+        headers [i].msg_hdr.msg_iovlen = 1;
+        if (send_enabled) {
+            headers [i].msg_hdr.msg_name = (void *) address.dest_addr ();
+            headers [i].msg_hdr.msg_namelen = address.dest_addrlen ();
+        }
+    }
+
+    //  Without a socket messages are dropped as soon as they arrive,
+    //  so that they do not hold up the termination of the socket.
+    if (open () != 0) {
+        session->get_socket ()->event_bind_failed (endpoint, zmq_errno ());
+        restart_output ();
+        return;
+    }
+
+    handle = add_fd (fd);
+    if (send_enabled)
+        set_pollout (handle);
+    if (recv_enabled)
+        set_pollin (handle);
+}
+
+int zmq::udp_engine_t::open ()
+{
+    fd = open_socket (AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd == retired_fd)
+        return -1;
+    unblock_socket (fd);
+
+    if (options.tos != 0)
+        set_ip_type_of_service (fd, options.tos);
+
+    int rc = 0;
+    if (send_enabled) {
+        if (options.sndbuf != 0)
+            rc = setsockopt (fd, SOL_SOCKET, SO_SNDBUF,
+                &options.sndbuf, sizeof options.sndbuf);
+        if (rc == 0 && address.is_mcast ()) {
+            const int ttl = options.multicast_hops;
+            rc = setsockopt (fd, IPPROTO_IP, IP_MULTICAST_TTL,
+                &ttl, sizeof ttl);
+
+            //  Let other sockets on this host get the datagrams too.
+            const int loop = 1;
+            if (rc == 0)
+                rc = setsockopt (fd, IPPROTO_IP, IP_MULTICAST_LOOP,
+                    &loop, sizeof loop);
+
+            const in_addr iface = address.interface_ip ();
+            if (rc == 0 && iface.s_addr != htonl (INADDR_ANY))
+                rc = setsockopt (fd, IPPROTO_IP, IP_MULTICAST_IF,
+                    &iface, sizeof iface);
+        }
+    }
+    else {
+        if (options.rcvbuf != 0)
+            rc = setsockopt (fd, SOL_SOCKET, SO_RCVBUF,
+                &options.rcvbuf, sizeof options.rcvbuf);
+
+        //  Several sockets on the host may be members of the same group.
+        if (rc == 0 && address.is_mcast ()) {
+            const int reuse = 1;
+            rc = setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+                &reuse, sizeof reuse);
+        }
+
+        if (rc == 0)
+            rc = bind (fd, address.bind_addr (), address.bind_addrlen ());
+
+        if (rc == 0 && address.is_mcast ()) {
+            ip_mreq mreq;
+            mreq.imr_multiaddr = address.multicast_ip ();
+            mreq.imr_interface = address.interface_ip ();
+            rc = setsockopt (fd, IPPROTO_IP, IP_ADD_MEMBERSHIP,
+                &mreq, sizeof mreq);
+        }
+    }
+
+    if (rc != 0) {
+        const int err = errno;
+        rc = close (fd);
+        errno_assert (rc == 0);
+        fd = retired_fd;
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+void zmq::udp_engine_t::terminate ()
+{
+    if (fd != retired_fd)
+        rm_fd (handle);
+    io_object_t::unplug ();
+    session = NULL;
+    delete this;
+}
+
+void zmq::udp_engine_t::restart_input ()
+{
+    //  Datagrams the session has no room for are dropped, so input
+    //  is never stopped.
+}
+
+void zmq::udp_engine_t::restart_output ()
+{
+    if (unlikely (fd == retired_fd)) {
+        msg_t msg;
+        int rc = msg.init ();
+        errno_assert (rc == 0);
+        while (session->pull_msg (&msg) == 0) {
+            rc = msg.close ();
+            errno_assert (rc == 0);
+            rc = msg.init ();
+            errno_assert (rc == 0);
+        }
+        rc = msg.close ();
+        errno_assert (rc == 0);
+        return;
+    }
+
+    set_pollout (handle);
+    out_event ();
+}
+
+void zmq::udp_engine_t::out_event ()
+{
+    if (out_sent == out_count)
+        fill_batch ();
+
+    //  There are no messages to send. Stop polling for output until
+    //  the session has some.
+    if (out_count == 0) {
+        reset_pollout (handle);
+        return;
+    }
+
+    send_batch ();
+}
+
+void zmq::udp_engine_t::fill_batch ()
+{
+    out_count = 0;
+    out_sent = 0;
+
+    msg_t msg;
+    int rc = msg.init ();
+    errno_assert (rc == 0);
+
+    while (out_count < udp_batch_size) {
+        if (session->pull_msg (&msg) != 0) {
+            errno_assert (errno == EAGAIN);
+            break;
+        }
+
+        const bool more = (msg.flags () & msg_t::more) != 0;
+        const size_t group_size = strlen (msg.group ());
+        const size_t size = msg.size ();
+
+        //  Multipart messages and messages that do not fit into
+        //  a datagram are dropped.
+        if (!dropping && !more
+        &&  1 + group_size + size <= (size_t) udp_max_datagram_size) {
+            unsigned char *buffer = buffers + out_count * udp_max_datagram_size;
+            buffer [0] = (unsigned char) group_size;
+            memcpy (buffer + 1, msg.group (), group_size);
+            memcpy (buffer + 1 + group_size, msg.data (), size);
+            iovecs [out_count].iov_len = 1 + group_size + size;
+            out_count++;
+        }
+        dropping = more;
+
+        rc = msg.close ();
+        errno_assert (rc == 0);
+        rc = msg.init ();
+        errno_assert (rc == 0);
+    }
+
+    rc = msg.close ();
+    errno_assert (rc == 0);
+}
+
+int zmq::udp_engine_t::send_batch ()
+{
+    while (out_sent < out_count) {
+#if defined ZMQ_HAVE_SENDMMSG
+        int n = sendmmsg (fd, headers + out_sent, out_count - out_sent, 0);
+#else
+        int n = sendmsg (fd, &headers [out_sent].msg_hdr, 0) == -1 ? -1 : 1;
+#endif
+        if (n == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return -1;
+            if (errno == EINTR)
+                continue;
+
+            //  The datagram could not be sent, e.g. because there is no
+            //  route to the destination. Drop it as the network would.
+            errno_assert (errno != EBADF && errno != EFAULT
+                       && errno != ENOTSOCK);
+            n = 1;
+        }
+        out_sent += n;
+    }
+    return 0;
+}
+
+void zmq::udp_engine_t::in_event ()
+{
+#if defined ZMQ_HAVE_RECVMMSG
+    const int n = recvmmsg (fd, headers, udp_batch_size, 0, NULL);
+#else
+    const ssize_t nbytes = recvmsg (fd, &headers [0].msg_hdr, 0);
+    headers [0].msg_len = (unsigned int) nbytes;
+    const int n = nbytes == -1 ? -1 : 1;
+#endif
+    if (n == -1) {
+        //  Errors queued by ICMP messages are of no interest to us.
+        errno_assert (errno == EAGAIN || errno == EWOULDBLOCK
+                   || errno == EINTR || errno == ECONNREFUSED
+                   || errno == ENOMEM);
+        return;
+    }
+
+    for (int i = 0; i != n; i++) {
+        const unsigned char *buffer = buffers + i * udp_max_datagram_size;
+        const size_t size = headers [i].msg_len;
+
+        //  Drop datagrams that were truncated or are malformed.
+        if (headers [i].msg_hdr.msg_flags & MSG_TRUNC || size < 1)
+            continue;
+        const size_t group_size = buffer [0];
+        if (group_size > ZMQ_GROUP_MAX_LENGTH || 1 + group_size > size)
+            continue;
+
+        msg_t msg;
+        int rc = msg.init_size (size - 1 - group_size);
+        errno_assert (rc == 0);
+        rc = msg.set_group ((const char *) buffer + 1, group_size);
+        errno_assert (rc == 0);
+        memcpy (msg.data (), buffer + 1 + group_size, msg.size ());
+
+        //  The pipe is full. The datagram is lost.
+        rc = session->push_msg (&msg);
+        if (rc != 0) {
+            errno_assert (errno == EAGAIN);
+            rc = msg.close ();
+            errno_assert (rc == 0);
+        }
+    }
+
+    session->flush ();
+}
+
+#endif
@@ -0,0 +1,134 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_UDP_ENGINE_HPP_INCLUDED__
+#define __ZMQ_UDP_ENGINE_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+#if !defined ZMQ_HAVE_WINDOWS
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "fd.hpp"
+#include "io_object.hpp"
+#include "i_engine.hpp"
+#include "options.hpp"
+#include "udp_address.hpp"
+#include "config.hpp"
+
+namespace zmq
+{
+
+    class io_thread_t;
+    class session_base_t;
+    struct address_t;
+
+    //  Engine of the udp:// transport used by RADIO and DISH sockets.
+    //  Each message travels in a datagram of its own, made of a byte
+    //  holding the length of the group, the group and the body. Batches
+    //  of datagrams are moved with sendmmsg and recvmmsg where available.
+    //  Messages the session has no room for are dropped, as are those
+    //  the network drops.
+
+    class udp_engine_t : public io_object_t, public i_engine
+    {
+    public:
+
+        udp_engine_t (const shared_options_t &options_);
+        ~udp_engine_t ();
+
+        //  Sending engines send datagrams to the resolved address,
+        //  receiving ones receive the datagrams sent to it.
+        int init (address_t *address_, bool send_, bool recv_);
+
+        //  i_engine interface implementation.
+        void plug (zmq::io_thread_t *io_thread_,
+            zmq::session_base_t *session_);
+        void terminate ();
+        void restart_input ();
+        void restart_output ();
+        void zap_msg_available () {}
+        bool flush () { return false; }
+
+        //  i_poll_events interface implementation.
+        void in_event ();
+        void out_event ();
+
+    private:
+
+        //  Opens and sets up the socket. Returns -1 with errno set if
+        //  that fails.
+        int open ();
+
+        //  Fills the output batch with messages from the session.
+        void fill_batch ();
+
+        //  Sends as much of the output batch as the socket takes.
+        //  Returns -1 if the socket could not take more.
+        int send_batch ();
+
+        fd_t fd;
+        handle_t handle;
+
+        udp_address_t address;
+        std::string endpoint;
+
+        bool send_enabled;
+        bool recv_enabled;
+
+        //  Buffers and headers of a batch of datagrams. An engine either
+        //  sends or receives, never both.
+#if !defined ZMQ_HAVE_SENDMMSG && !defined ZMQ_HAVE_RECVMMSG
+        struct mmsghdr
+        {
+            msghdr msg_hdr;
+            unsigned int msg_len;
+        };
+#endif
+        unsigned char *buffers;
+        iovec iovecs [udp_batch_size];
+        mmsghdr headers [udp_batch_size];
+
+        //  Number of datagrams in the output batch and how many of them
+        //  have been sent.
+        int out_count;
+        int out_sent;
+
+        //  True iff the rest of the current multipart message is to be
+        //  dropped; RADIO sockets do not send them, but they may come
+        //  from elsewhere.
+        bool dropping;
+
+        session_base_t *session;
+
+        //  Options of the socket the engine belongs to.
+        shared_options_t shared_options;
+        const options_t &options;
+
+        udp_engine_t (const udp_engine_t&);
+        const udp_engine_t &operator = (const udp_engine_t&);
+    };
+
+}
+
+#endif
+
+#endif
@@ -32,8 +32,9 @@
 #include "wire.hpp"
 #include "err.hpp"
 
-zmq::v1_decoder_t::v1_decoder_t (size_t bufsize_, int64_t maxmsgsize_) :
-    decoder_base_t <v1_decoder_t> (bufsize_),
+zmq::v1_decoder_t::v1_decoder_t (size_t bufsize_, int64_t maxmsgsize_,
+      batch_pool_t *pool_) :
+    decoder_base_t <v1_decoder_t> (bufsize_, pool_),
     maxmsgsize (maxmsgsize_)
 {
     int rc = in_progress.init ();
@@ -30,7 +30,8 @@ namespace zmq
     {
     public:
 
-        v1_decoder_t (size_t bufsize_, int64_t maxmsgsize_);
+        v1_decoder_t (size_t bufsize_, int64_t maxmsgsize_,
+            batch_pool_t *pool_ = NULL);
         ~v1_decoder_t ();
 
         virtual msg_t *msg () { return &in_progress; }
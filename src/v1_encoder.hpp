@@ -30,7 +30,7 @@ namespace zmq
     {
     public:
 
-        v1_encoder_t (size_t bufsize_);
+        v1_encoder_t (size_t bufsize_, batch_pool_t *pool_ = NULL);
         ~v1_encoder_t ();
 
     private:
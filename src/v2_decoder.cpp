@@ -31,8 +31,9 @@
 #include "wire.hpp"
 #include "err.hpp"
 
-zmq::v2_decoder_t::v2_decoder_t (size_t bufsize_, int64_t maxmsgsize_) :
-    decoder_base_t <v2_decoder_t> (bufsize_),
+zmq::v2_decoder_t::v2_decoder_t (size_t bufsize_, int64_t maxmsgsize_,
+      batch_pool_t *pool_) :
+    decoder_base_t <v2_decoder_t> (bufsize_, pool_),
     msg_flags (0),
     maxmsgsize (maxmsgsize_)
 {
@@ -56,6 +57,10 @@ int zmq::v2_decoder_t::flags_ready ()
         msg_flags |= msg_t::more;
     if (tmpbuf [0] & v2_protocol_t::command_flag)
         msg_flags |= msg_t::command;
+    if (tmpbuf [0] & v2_protocol_t::compressed_flag)
+        msg_flags |= msg_t::compressed;
+    if (tmpbuf [0] & v2_protocol_t::passed_fd_flag)
+        msg_flags |= msg_t::passed_fd;
 
     //  The payload length is either one or eight bytes,
     //  depending on whether the 'large' bit is set.
@@ -22,8 +22,8 @@
 #include "likely.hpp"
 #include "wire.hpp"
 
-zmq::v2_encoder_t::v2_encoder_t (size_t bufsize_) :
-    encoder_base_t <v2_encoder_t> (bufsize_)
+zmq::v2_encoder_t::v2_encoder_t (size_t bufsize_, batch_pool_t *pool_) :
+    encoder_base_t <v2_encoder_t> (bufsize_, pool_)
 {
     //  Write 0 bytes to the batch and go to message_ready state.
     next_step (NULL, 0, &v2_encoder_t::message_ready, true);
@@ -44,6 +44,10 @@ void zmq::v2_encoder_t::message_ready ()
         protocol_flags |= v2_protocol_t::large_flag;
     if (in_progress->flags () & msg_t::command)
         protocol_flags |= v2_protocol_t::command_flag;
+    if (in_progress->flags () & msg_t::compressed)
+        protocol_flags |= v2_protocol_t::compressed_flag;
+    if (in_progress->flags () & msg_t::passed_fd)
+        protocol_flags |= v2_protocol_t::passed_fd_flag;
 
     //  Encode the message length. For messages less then 256 bytes,
     //  the length is encoded as 8-bit unsigned integer. For larger
@@ -30,7 +30,7 @@ namespace zmq
     {
     public:
 
-        v2_encoder_t (size_t bufsize_);
+        v2_encoder_t (size_t bufsize_, batch_pool_t *pool_ = NULL);
         virtual ~v2_encoder_t ();
 
     private:
@@ -31,7 +31,9 @@ namespace zmq
         {
             more_flag = 1,
             large_flag = 2,
-            command_flag = 4
+            command_flag = 4,
+            compressed_flag = 8,
+            passed_fd_flag = 16
         };
     };
 }
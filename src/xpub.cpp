@@ -116,7 +116,8 @@ void zmq::xpub_t::xwrite_activated (pipe_t *pipe_)
 int zmq::xpub_t::xsetsockopt (int option_, const void *optval_,
     size_t optvallen_)
 {	
-	if (option_ == ZMQ_XPUB_VERBOSE || option_ == ZMQ_XPUB_NODROP || option_ == ZMQ_XPUB_MANUAL)
+	if (option_ == ZMQ_XPUB_VERBOSE || option_ == ZMQ_XPUB_NODROP || option_ == ZMQ_XPUB_MANUAL
+	||  option_ == ZMQ_XPUB_SEQUENCE)
 	{
 		if (optvallen_ != sizeof(int) || *static_cast <const int*> (optval_) < 0) {
 			errno = EINVAL;
@@ -131,6 +132,9 @@ int zmq::xpub_t::xsetsockopt (int option_, const void *optval_,
 		else
 		if (option_ == ZMQ_XPUB_MANUAL)
 			manual = (*static_cast <const int*> (optval_) != 0);				
+		else
+		if (option_ == ZMQ_XPUB_SEQUENCE)
+			dist.set_gap_notices (*static_cast <const int*> (optval_) != 0);
 	}        
     else    
 	if (option_ == ZMQ_SUBSCRIBE && manual && last_pipe != NULL)	
@@ -21,11 +21,14 @@
 
 #include "xsub.hpp"
 #include "err.hpp"
+#include "likely.hpp"
+#include "wire.hpp"
 
 zmq::xsub_t::xsub_t (class ctx_t *parent_, uint32_t tid_, int sid_) :
     socket_base_t (parent_, tid_, sid_),
     has_message (false),
-    more (false)
+    more (false),
+    messages_lost (0)
 {
     options.type = ZMQ_XSUB;
 
@@ -143,6 +146,9 @@ int zmq::xsub_t::xrecv (msg_t *msg_)
         if (rc != 0)
             return -1;
 
+        if (!more && count_lost (msg_))
+            continue;
+
         //  Check whether the message matches at least one subscription.
         //  Non-initial parts of the message are passed 
         if (more || !options.filter || match (msg_)) {
@@ -184,6 +190,9 @@ bool zmq::xsub_t::xhas_in ()
             return false;
         }
 
+        if (count_lost (&message))
+            continue;
+
         //  Check whether the message matches at least one subscription.
         if (!options.filter || match (&message)) {
             has_message = true;
@@ -199,6 +208,28 @@ bool zmq::xsub_t::xhas_in ()
     }
 }
 
+int zmq::xsub_t::xgetsockopt (int option_, void *optval_, size_t *optvallen_)
+{
+    if (option_ == ZMQ_MESSAGES_LOST && *optvallen_ == sizeof (uint64_t)) {
+        *((uint64_t *) optval_) = messages_lost;
+        return 0;
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+bool zmq::xsub_t::count_lost (msg_t *msg_)
+{
+    if (likely (!(msg_->flags () & msg_t::command)))
+        return false;
+
+    //  Publishers write no other commands, and the engine has checked
+    //  the GAP commands coming from the network.
+    zmq_assert (msg_->size () == 12);
+    messages_lost += get_uint64 ((unsigned char *) msg_->data () + 4);
+    return true;
+}
+
 zmq::blob_t zmq::xsub_t::get_credential () const
 {
     return fq.get_credential ();
@@ -54,9 +54,14 @@ namespace zmq
         void xwrite_activated (zmq::pipe_t *pipe_);
         void xhiccuped (pipe_t *pipe_);
         void xpipe_terminated (zmq::pipe_t *pipe_);
+        int xgetsockopt (int option_, void *optval_, size_t *optvallen_);
 
     private:
 
+        //  If the message is a GAP command from the publisher, adds
+        //  the number of messages lost to the counter and returns true.
+        bool count_lost (zmq::msg_t *msg_);
+
         //  Check whether the message matches at least one subscription.
         bool match (zmq::msg_t *msg_);
 
@@ -83,6 +88,10 @@ namespace zmq
         //  there are following parts still waiting.
         bool more;
 
+        //  Number of messages publishers reported as dropped on the way
+        //  to us (ZMQ_MESSAGES_LOST).
+        uint64_t messages_lost;
+
         xsub_t (const xsub_t&);
         const xsub_t &operator = (const xsub_t&);
     };
@@ -0,0 +1,112 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "platform.hpp"
+
+#ifdef HAVE_LIBSODIUM
+#ifdef HAVE_TWEETNACL
+#include "tweetnacl_base.h"
+#else
+#include "sodium.h"
+#endif
+#endif
+
+#include "zap_cache.hpp"
+#include "ctx.hpp"
+#include "config.hpp"
+#include "err.hpp"
+
+zmq::zap_cache_t::zap_cache_t (ctx_t *ctx_) :
+    ctx (ctx_)
+{
+}
+
+zmq::zap_cache_t::~zap_cache_t ()
+{
+}
+
+bool zmq::zap_cache_t::enabled () const
+{
+    return ctx->get (ZMQ_ZAP_CACHE_TTL) > 0;
+}
+
+void zmq::zap_cache_t::put (const std::string &request_,
+    const reply_t &reply_)
+{
+    if (reply_.status_code != "200" && reply_.status_code != "400")
+        return;
+    const int ttl = ctx->get (ZMQ_ZAP_CACHE_TTL);
+    if (ttl <= 0)
+        return;
+
+    const std::string key = cache_key (request_);
+
+    scoped_lock_t locker (sync);
+
+    const uint64_t now = clock.now_ms ();
+
+    //  Make room for the new entry. Drop the expired entries first and
+    //  if that doesn't help, start afresh.
+    if (cache.size () >= (size_t) zap_cache_size
+    &&  cache.find (key) == cache.end ()) {
+        cache_t::iterator it = cache.begin ();
+        while (it != cache.end ())
+            if (it->second.expiry <= now)
+                cache.erase (it++);
+            else
+                ++it;
+        if (cache.size () >= (size_t) zap_cache_size)
+            cache.clear ();
+    }
+
+    entry_t &entry = cache [key];
+    entry.reply = reply_;
+    entry.expiry = now + ttl;
+}
+
+bool zmq::zap_cache_t::get (const std::string &request_, reply_t &reply_)
+{
+    const std::string key = cache_key (request_);
+
+    scoped_lock_t locker (sync);
+
+    const cache_t::iterator it = cache.find (key);
+    if (it == cache.end ())
+        return false;
+    if (it->second.expiry <= clock.now_ms ()) {
+        cache.erase (it);
+        return false;
+    }
+    reply_ = it->second.reply;
+    return true;
+}
+
+std::string zmq::zap_cache_t::cache_key (const std::string &request_)
+{
+#ifdef HAVE_LIBSODIUM
+    unsigned char hash [crypto_hash_BYTES];
+    const int rc = crypto_hash (hash,
+        (const unsigned char *) request_.data (), request_.size ());
+    zmq_assert (rc == 0);
+    return std::string ((const char *) hash, sizeof hash);
+#else
+    return request_;
+#endif
+}
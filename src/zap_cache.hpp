@@ -0,0 +1,96 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_ZAP_CACHE_HPP_INCLUDED__
+#define __ZMQ_ZAP_CACHE_HPP_INCLUDED__
+
+#include <map>
+#include <string>
+
+#include "stdint.hpp"
+#include "clock.hpp"
+#include "mutex.hpp"
+
+namespace zmq
+{
+
+    class ctx_t;
+
+    //  Replies of ZAP handlers kept for ZMQ_ZAP_CACHE_TTL milliseconds,
+    //  shared by the sockets of a context. A connection sending the same
+    //  request as an earlier one, i.e. the same domain, address, identity,
+    //  mechanism and credentials, gets the earlier reply without asking
+    //  the handler again. Only definite answers (200 and 400) are kept;
+    //  temporary (300) and internal (500) errors are always passed on.
+
+    class zap_cache_t
+    {
+    public:
+
+        struct reply_t
+        {
+            std::string status_code;
+            std::string user_id;
+            std::string metadata;
+        };
+
+        zap_cache_t (ctx_t *ctx_);
+        ~zap_cache_t ();
+
+        //  Returns true iff replies are to be cached.
+        bool enabled () const;
+
+        //  Stores the reply to the request, built of the request's
+        //  frames.
+        void put (const std::string &request_, const reply_t &reply_);
+
+        //  Looks up the reply to the request. Returns false if there is
+        //  none that is still valid.
+        bool get (const std::string &request_, reply_t &reply_);
+
+    private:
+
+        struct entry_t
+        {
+            reply_t reply;
+            uint64_t expiry;
+        };
+
+        //  Requests carry passwords in the clear, so they are kept as
+        //  hashes where possible.
+        static std::string cache_key (const std::string &request_);
+
+        ctx_t * const ctx;
+
+        //  Synchronises access to the members below.
+        mutex_t sync;
+
+        typedef std::map <std::string, entry_t> cache_t;
+        cache_t cache;
+
+        clock_t clock;
+
+        zap_cache_t (const zap_cache_t&);
+        const zap_cache_t &operator = (const zap_cache_t&);
+    };
+
+}
+
+#endif
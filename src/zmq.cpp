@@ -328,6 +328,26 @@ int zmq_disconnect (void *s_, const char *addr_)
     return s->term_endpoint (addr_);
 }
 
+int zmq_join (void *s_, const char *group_)
+{
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    zmq::socket_base_t *s = (zmq::socket_base_t *) s_;
+    return s->join (group_);
+}
+
+int zmq_leave (void *s_, const char *group_)
+{
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    zmq::socket_base_t *s = (zmq::socket_base_t *) s_;
+    return s->leave (group_);
+}
+
 // Sending functions.
 
 static int
@@ -663,6 +683,16 @@ const char *zmq_msg_gets (zmq_msg_t *msg_, const char *property_)
     }
 }
 
+int zmq_msg_set_group (zmq_msg_t *msg_, const char *group_)
+{
+    return ((zmq::msg_t*) msg_)->set_group (group_);
+}
+
+const char *zmq_msg_group (zmq_msg_t *msg_)
+{
+    return ((zmq::msg_t*) msg_)->group ();
+}
+
 // Polling.
 
 int zmq_poll (zmq_pollitem_t *items_, int nitems_, long timeout_)
@@ -1064,6 +1094,14 @@ int zmq_has (const char *capability)
     if (strcmp (capability, "ipc") == 0)
         return true;
 #endif
+#if defined (ZMQ_HAVE_SHM)
+    if (strcmp (capability, "shm") == 0)
+        return true;
+#endif
+#if !defined (ZMQ_HAVE_WINDOWS)
+    if (strcmp (capability, "udp") == 0)
+        return true;
+#endif
 #if defined (ZMQ_HAVE_OPENPGM)
     if (strcmp (capability, "pgm") == 0)
         return true;
@@ -1076,6 +1114,10 @@ int zmq_has (const char *capability)
     if (strcmp (capability, "norm") == 0)
         return true;
 #endif
+#if defined (ZMQ_HAVE_TLS)
+    if (strcmp (capability, "tls") == 0)
+        return true;
+#endif
 #if defined (HAVE_LIBSODIUM)
     if (strcmp (capability, "curve") == 0)
         return true;
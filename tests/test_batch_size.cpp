@@ -0,0 +1,206 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  The engines size their batches with this, it isn't exported.
+#include "../src/adaptive_batch.hpp"
+
+//  Sends messages of many different sizes from one socket to the other
+//  and checks that they arrive intact and in order.
+
+static void
+transfer (void *server, void *client)
+{
+    const int max_size = 100000;
+    char *buffer = (char *) malloc (max_size);
+    assert (buffer);
+    char *received = (char *) malloc (max_size);
+    assert (received);
+    for (int i = 0; i < max_size; i++)
+        buffer [i] = (char) (i * 7);
+
+    for (int size = 0; size < max_size; size = size * 3 + 1) {
+        int rc = zmq_send (client, buffer, size, 0);
+        assert (rc == size);
+    }
+    for (int size = 0; size < max_size; size = size * 3 + 1) {
+        int rc = zmq_recv (server, received, max_size, 0);
+        assert (rc == size);
+        assert (memcmp (buffer, received, size) == 0);
+    }
+
+    //  A burst of small messages.
+    for (int i = 0; i < 10000; i++) {
+        int rc = zmq_send (client, &i, sizeof (i), 0);
+        assert (rc == sizeof (i));
+    }
+    for (int i = 0; i < 10000; i++) {
+        int value;
+        int rc = zmq_recv (server, &value, sizeof (value), 0);
+        assert (rc == sizeof (value));
+        assert (value == i);
+    }
+
+    free (buffer);
+    free (received);
+}
+
+//  Checks that adaptive batches grow while they are filled up and
+//  shrink back once they stay mostly empty.
+static void
+test_adaptive_sizes ()
+{
+    zmq::adaptive_batch_t fixed (8192, false);
+    assert (fixed.size () == 8192);
+    fixed.update (8192);
+    fixed.update (0);
+    assert (fixed.size () == 8192);
+
+    zmq::adaptive_batch_t batch (8192, true);
+    assert (batch.size () == zmq::min_batch_size);
+
+    //  Under load every batch is full, the size doubles up to the cap.
+    size_t expected = zmq::min_batch_size;
+    while (expected < zmq::max_batch_size) {
+        batch.update (batch.size ());
+        expected *= 2;
+        assert (batch.size () == expected);
+    }
+    batch.update (batch.size ());
+    assert (batch.size () == zmq::max_batch_size);
+
+    //  Batches using a quarter or more keep the size...
+    for (int i = 0; i < 100; i++)
+        batch.update (zmq::max_batch_size / 4);
+    assert (batch.size () == zmq::max_batch_size);
+
+    //  ...and interrupt runs of nearly empty ones.
+    for (int i = 0; i < zmq::batch_shrink_threshold - 1; i++)
+        batch.update (10);
+    batch.update (zmq::max_batch_size / 4);
+    for (int i = 0; i < zmq::batch_shrink_threshold - 1; i++)
+        batch.update (10);
+    assert (batch.size () == zmq::max_batch_size);
+
+    //  When traffic dies down, the size halves after each run of
+    //  nearly empty batches until it is back at the minimum.
+    batch.update (10);
+    assert (batch.size () == zmq::max_batch_size / 2);
+    for (int i = 0; i < 1000; i++)
+        batch.update (10);
+    assert (batch.size () == zmq::min_batch_size);
+}
+
+static void
+test_batch_options (void *ctx, int in_batch_size, int out_batch_size,
+    int adaptive)
+{
+    void *server = zmq_socket (ctx, ZMQ_PULL);
+    assert (server);
+    int rc = zmq_setsockopt (server, ZMQ_IN_BATCH_SIZE,
+        &in_batch_size, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_setsockopt (server, ZMQ_BATCH_ADAPTIVE, &adaptive, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_bind (server, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_size = sizeof (endpoint);
+    rc = zmq_getsockopt (server, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+
+    void *client = zmq_socket (ctx, ZMQ_PUSH);
+    assert (client);
+    rc = zmq_setsockopt (client, ZMQ_OUT_BATCH_SIZE,
+        &out_batch_size, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_BATCH_ADAPTIVE, &adaptive, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_connect (client, endpoint);
+    assert (rc == 0);
+
+    transfer (server, client);
+
+    close_zero_linger (client);
+    close_zero_linger (server);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *socket = zmq_socket (ctx, ZMQ_DEALER);
+    assert (socket);
+
+    //  Check the defaults.
+    int value;
+    size_t value_size = sizeof (value);
+    int rc = zmq_getsockopt (socket, ZMQ_IN_BATCH_SIZE, &value, &value_size);
+    assert (rc == 0);
+    assert (value == 8192);
+    rc = zmq_getsockopt (socket, ZMQ_OUT_BATCH_SIZE, &value, &value_size);
+    assert (rc == 0);
+    assert (value == 8192);
+    rc = zmq_getsockopt (socket, ZMQ_BATCH_ADAPTIVE, &value, &value_size);
+    assert (rc == 0);
+    assert (value == 0);
+
+    //  Batch sizes must be positive and at most 256 kB.
+    value = 0;
+    rc = zmq_setsockopt (socket, ZMQ_IN_BATCH_SIZE, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_setsockopt (socket, ZMQ_OUT_BATCH_SIZE, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+    value = 262145;
+    rc = zmq_setsockopt (socket, ZMQ_IN_BATCH_SIZE, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_setsockopt (socket, ZMQ_OUT_BATCH_SIZE, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+    value = 2;
+    rc = zmq_setsockopt (socket, ZMQ_BATCH_ADAPTIVE, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+
+    value = 65536;
+    rc = zmq_setsockopt (socket, ZMQ_OUT_BATCH_SIZE, &value, sizeof (value));
+    assert (rc == 0);
+    rc = zmq_getsockopt (socket, ZMQ_OUT_BATCH_SIZE, &value, &value_size);
+    assert (rc == 0);
+    assert (value == 65536);
+
+    rc = zmq_close (socket);
+    assert (rc == 0);
+
+    test_adaptive_sizes ();
+
+    //  Tiny, default, large and adaptive batches must all deliver
+    //  the same data.
+    test_batch_options (ctx, 1, 1, 0);
+    test_batch_options (ctx, 100, 37, 0);
+    test_batch_options (ctx, 8192, 8192, 0);
+    test_batch_options (ctx, 262144, 262144, 0);
+    test_batch_options (ctx, 8192, 8192, 1);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -45,6 +45,12 @@ int main (void)
     assert (!zmq_has ("norm"));
 #endif
     
+#if defined (ZMQ_HAVE_TLS)
+    assert (zmq_has ("tls"));
+#else
+    assert (!zmq_has ("tls"));
+#endif
+
 #if defined (HAVE_LIBSODIUM)
     assert (zmq_has ("curve"));
 #else
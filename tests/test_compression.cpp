@@ -0,0 +1,243 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+#if defined (ZMQ_HAVE_WINDOWS)
+#   include <winsock2.h>
+#   include <ws2tcpip.h>
+#   define close closesocket
+#else
+#   include <sys/socket.h>
+#   include <netinet/in.h>
+#   include <arpa/inet.h>
+#   include <unistd.h>
+#endif
+
+//  Sends a multi-part message made of a large compressible frame, a small
+//  frame below the threshold and a large frame of pseudo-random bytes that
+//  do not compress, and checks that it arrives intact and carries the
+//  sender's compression offer in its metadata, if there was one.
+static void send_and_check (void *from_, void *to_, bool offered_)
+{
+    const size_t large_size = 100000;
+    char *text = (char *) malloc (large_size);
+    assert (text);
+    for (size_t i = 0; i < large_size; i++)
+        text [i] = "compressible text "[i % 18];
+    char *noise = (char *) malloc (large_size);
+    assert (noise);
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < large_size; i++) {
+        seed = seed * 1103515245 + 12345;
+        noise [i] = (char) (seed >> 24);
+    }
+
+    int rc = zmq_send (from_, text, large_size, ZMQ_SNDMORE);
+    assert (rc == (int) large_size);
+    rc = zmq_send (from_, "small", 5, ZMQ_SNDMORE);
+    assert (rc == 5);
+    rc = zmq_send (from_, noise, large_size, 0);
+    assert (rc == (int) large_size);
+
+    zmq_msg_t msg;
+    rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+
+    rc = zmq_msg_recv (&msg, to_, 0);
+    assert (rc == (int) large_size);
+    assert (memcmp (zmq_msg_data (&msg), text, large_size) == 0);
+    assert (zmq_msg_more (&msg));
+    const char *property = zmq_msg_gets (&msg, "X-Compression");
+    if (offered_)
+        assert (property && streq (property, "LZ4"));
+    else
+        assert (property == NULL);
+
+    rc = zmq_msg_recv (&msg, to_, 0);
+    assert (rc == 5);
+    assert (memcmp (zmq_msg_data (&msg), "small", 5) == 0);
+    assert (zmq_msg_more (&msg));
+
+    rc = zmq_msg_recv (&msg, to_, 0);
+    assert (rc == (int) large_size);
+    assert (memcmp (zmq_msg_data (&msg), noise, large_size) == 0);
+    assert (!zmq_msg_more (&msg));
+
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+    free (text);
+    free (noise);
+}
+
+//  A peer sending a tiny compressed frame that claims to decompress to
+//  almost 4 GB is disconnected rather than making the socket allocate it.
+static void test_bogus_size (void *ctx_)
+{
+    static const unsigned char greeting [64] = {
+        0xFF, 0, 0, 0, 0, 0, 0, 0, 1, 0x7F, 3, 0, 'N', 'U', 'L', 'L'
+    };
+    static const unsigned char ready [] =
+        "\4\61\5READY\13Socket-Type\0\0\0\6DEALER"
+        "\15X-Compression\0\0\0\3LZ4";
+    static const unsigned char frame [] =
+        "\10\14\xff\xff\xff\xf0\x1f\0\1\0\xff\xff\xff\xff";
+
+    void *server = zmq_socket (ctx_, ZMQ_DEALER);
+    assert (server);
+    int threshold = 0;
+    int rc = zmq_setsockopt (server, ZMQ_COMPRESSION_THRESHOLD,
+        &threshold, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_bind (server, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_size = sizeof endpoint;
+    rc = zmq_getsockopt (server, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+
+    int s = socket (AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    assert (s >= 0);
+    struct sockaddr_in address;
+    memset (&address, 0, sizeof address);
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = inet_addr ("127.0.0.1");
+    address.sin_port = htons (atoi (strrchr (endpoint, ':') + 1));
+    rc = connect (s, (struct sockaddr *) &address, sizeof address);
+    assert (rc == 0);
+    rc = send (s, (const char *) greeting, sizeof greeting, 0);
+    assert (rc == (int) sizeof greeting);
+    rc = send (s, (const char *) ready, sizeof ready - 1, 0);
+    assert (rc == (int) sizeof ready - 1);
+    rc = send (s, (const char *) frame, sizeof frame - 1, 0);
+    assert (rc == (int) sizeof frame - 1);
+
+    //  The socket sends its own greeting and READY, then hangs up.
+    char buffer [256];
+    do
+        rc = recv (s, buffer, sizeof buffer, 0);
+    while (rc > 0);
+
+    rc = zmq_recv (server, buffer, sizeof buffer, ZMQ_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+
+    close (s);
+    rc = zmq_close (server);
+    assert (rc == 0);
+}
+
+//  Connects a DEALER to a DEALER with the given compression thresholds and
+//  exchanges messages in both directions.
+static void test_exchange (void *ctx_, const char *endpoint_,
+    int server_threshold_, int client_threshold_, bool curve_)
+{
+    void *server = zmq_socket (ctx_, ZMQ_DEALER);
+    assert (server);
+    int rc = zmq_setsockopt (server, ZMQ_COMPRESSION_THRESHOLD,
+        &server_threshold_, sizeof (int));
+    assert (rc == 0);
+
+    void *client = zmq_socket (ctx_, ZMQ_DEALER);
+    assert (client);
+    rc = zmq_setsockopt (client, ZMQ_COMPRESSION_THRESHOLD,
+        &client_threshold_, sizeof (int));
+    assert (rc == 0);
+
+    if (curve_) {
+        char public_key [41];
+        char secret_key [41];
+        rc = zmq_curve_keypair (public_key, secret_key);
+        assert (rc == 0);
+        int as_server = 1;
+        rc = zmq_setsockopt (server, ZMQ_CURVE_SERVER, &as_server, sizeof (int));
+        assert (rc == 0);
+        rc = zmq_setsockopt (server, ZMQ_CURVE_SECRETKEY, secret_key, 40);
+        assert (rc == 0);
+        rc = zmq_setsockopt (client, ZMQ_CURVE_SERVERKEY, public_key, 40);
+        assert (rc == 0);
+        rc = zmq_curve_keypair (public_key, secret_key);
+        assert (rc == 0);
+        rc = zmq_setsockopt (client, ZMQ_CURVE_PUBLICKEY, public_key, 40);
+        assert (rc == 0);
+        rc = zmq_setsockopt (client, ZMQ_CURVE_SECRETKEY, secret_key, 40);
+        assert (rc == 0);
+    }
+
+    rc = zmq_bind (server, endpoint_);
+    assert (rc == 0);
+    rc = zmq_connect (client, endpoint_);
+    assert (rc == 0);
+
+    send_and_check (client, server, client_threshold_ >= 0);
+    send_and_check (server, client, server_threshold_ >= 0);
+
+    rc = zmq_close (client);
+    assert (rc == 0);
+    rc = zmq_close (server);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  Check the option.
+    void *socket = zmq_socket (ctx, ZMQ_DEALER);
+    assert (socket);
+    int value;
+    size_t value_size = sizeof (value);
+    int rc = zmq_getsockopt (socket, ZMQ_COMPRESSION_THRESHOLD,
+        &value, &value_size);
+    assert (rc == 0);
+    assert (value == -1);
+    value = -2;
+    rc = zmq_setsockopt (socket, ZMQ_COMPRESSION_THRESHOLD,
+        &value, sizeof (int));
+    assert (rc == -1 && errno == EINVAL);
+    value = 1024;
+    rc = zmq_setsockopt (socket, ZMQ_COMPRESSION_THRESHOLD,
+        &value, sizeof (int));
+    assert (rc == 0);
+    value = 0;
+    rc = zmq_getsockopt (socket, ZMQ_COMPRESSION_THRESHOLD,
+        &value, &value_size);
+    assert (rc == 0);
+    assert (value == 1024);
+    rc = zmq_close (socket);
+    assert (rc == 0);
+
+    //  Both ends compress.
+    test_exchange (ctx, "tcp://127.0.0.1:5572", 1024, 1024, false);
+    test_exchange (ctx, "tcp://127.0.0.1:5573", 0, 0, false);
+
+    //  Only one end offers compression, so none is used.
+    test_exchange (ctx, "tcp://127.0.0.1:5574", 1024, -1, false);
+    test_exchange (ctx, "tcp://127.0.0.1:5575", -1, 1024, false);
+
+    test_bogus_size (ctx);
+
+    //  Compression happens below CURVE encryption.
+    if (zmq_has ("curve"))
+        test_exchange (ctx, "tcp://127.0.0.1:5576", 1024, 1024, true);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
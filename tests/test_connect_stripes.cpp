@@ -0,0 +1,183 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+#include <set>
+#include <string>
+
+static void test_options (void *ctx)
+{
+    void *dealer = zmq_socket (ctx, ZMQ_DEALER);
+    assert (dealer);
+
+    int stripes;
+    size_t size = sizeof stripes;
+    int rc = zmq_getsockopt (dealer, ZMQ_CONNECT_STRIPES, &stripes, &size);
+    assert (rc == 0);
+    assert (stripes == 1);
+
+    stripes = 0;
+    rc = zmq_setsockopt (dealer, ZMQ_CONNECT_STRIPES, &stripes,
+        sizeof stripes);
+    assert (rc == -1 && errno == EINVAL);
+
+    stripes = 3;
+    rc = zmq_setsockopt (dealer, ZMQ_CONNECT_STRIPES, &stripes,
+        sizeof stripes);
+    assert (rc == 0);
+    rc = zmq_getsockopt (dealer, ZMQ_CONNECT_STRIPES, &stripes, &size);
+    assert (rc == 0);
+    assert (stripes == 3);
+
+    rc = zmq_close (dealer);
+    assert (rc == 0);
+}
+
+//  Messages sent by a DEALER with four stripes arrive at the ROUTER
+//  from four peers, whole, and the replies are merged again.
+static void test_striping (void *ctx)
+{
+    void *router = zmq_socket (ctx, ZMQ_ROUTER);
+    assert (router);
+    int rc = zmq_bind (router, "tcp://127.0.0.1:5585");
+    assert (rc == 0);
+
+    void *dealer = zmq_socket (ctx, ZMQ_DEALER);
+    assert (dealer);
+    int stripes = 4;
+    rc = zmq_setsockopt (dealer, ZMQ_CONNECT_STRIPES, &stripes,
+        sizeof stripes);
+    assert (rc == 0);
+    rc = zmq_connect (dealer, "tcp://127.0.0.1:5585");
+    assert (rc == 0);
+
+    const int count = 100;
+    for (int i = 0; i < count; i++) {
+        rc = zmq_send (dealer, &i, sizeof i, ZMQ_SNDMORE);
+        assert (rc == sizeof i);
+        rc = zmq_send (dealer, "body", 4, ZMQ_SNDMORE);
+        assert (rc == 4);
+        rc = zmq_send (dealer, &i, sizeof i, 0);
+        assert (rc == sizeof i);
+    }
+
+    std::set <std::string> peers;
+    for (int i = 0; i < count; i++) {
+        char identity [256];
+        int id_size = zmq_recv (router, identity, sizeof identity, 0);
+        assert (id_size > 0);
+        peers.insert (std::string (identity, id_size));
+
+        int first;
+        rc = zmq_recv (router, &first, sizeof first, 0);
+        assert (rc == sizeof first);
+        char body [4];
+        rc = zmq_recv (router, body, sizeof body, 0);
+        assert (rc == 4 && memcmp (body, "body", 4) == 0);
+        int last;
+        rc = zmq_recv (router, &last, sizeof last, 0);
+        assert (rc == sizeof last);
+        assert (last == first);
+
+        //  Reply through the connection the message came from.
+        rc = zmq_send (router, identity, id_size, ZMQ_SNDMORE);
+        assert (rc == id_size);
+        rc = zmq_send (router, &first, sizeof first, 0);
+        assert (rc == sizeof first);
+    }
+    assert (peers.size () == 4);
+
+    std::set <int> replies;
+    for (int i = 0; i < count; i++) {
+        int reply;
+        rc = zmq_recv (dealer, &reply, sizeof reply, 0);
+        assert (rc == sizeof reply);
+        replies.insert (reply);
+    }
+    assert ((int) replies.size () == count);
+
+    //  Disconnecting drops all the stripes.
+    rc = zmq_disconnect (dealer, "tcp://127.0.0.1:5585");
+    assert (rc == 0);
+    rc = zmq_send (dealer, "late", 4, ZMQ_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+
+    rc = zmq_close (dealer);
+    assert (rc == 0);
+    rc = zmq_close (router);
+    assert (rc == 0);
+}
+
+//  A DEALER with an explicit identity opens a single connection, so that
+//  the ROUTER gets all of its messages.
+static void test_identity (void *ctx)
+{
+    void *router = zmq_socket (ctx, ZMQ_ROUTER);
+    assert (router);
+    int rc = zmq_bind (router, "tcp://127.0.0.1:5586");
+    assert (rc == 0);
+
+    void *dealer = zmq_socket (ctx, ZMQ_DEALER);
+    assert (dealer);
+    int stripes = 4;
+    rc = zmq_setsockopt (dealer, ZMQ_CONNECT_STRIPES, &stripes,
+        sizeof stripes);
+    assert (rc == 0);
+    rc = zmq_setsockopt (dealer, ZMQ_IDENTITY, "abc", 3);
+    assert (rc == 0);
+    rc = zmq_connect (dealer, "tcp://127.0.0.1:5586");
+    assert (rc == 0);
+
+    const int count = 20;
+    for (int i = 0; i < count; i++) {
+        rc = zmq_send (dealer, &i, sizeof i, 0);
+        assert (rc == sizeof i);
+    }
+    for (int i = 0; i < count; i++) {
+        char identity [256];
+        int id_size = zmq_recv (router, identity, sizeof identity, 0);
+        assert (id_size == 3 && memcmp (identity, "abc", 3) == 0);
+        int value;
+        rc = zmq_recv (router, &value, sizeof value, 0);
+        assert (rc == sizeof value && value == i);
+    }
+
+    rc = zmq_close (dealer);
+    assert (rc == 0);
+    rc = zmq_close (router);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    int rc = zmq_ctx_set (ctx, ZMQ_IO_THREADS, 4);
+    assert (rc == 0);
+
+    test_options (ctx);
+    test_striping (ctx);
+    test_identity (ctx);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
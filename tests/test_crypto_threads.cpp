@@ -0,0 +1,154 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  Message i of a run has i % 5 + 1 parts, part j carries
+//  sizes [(i + j) % 8] bytes of (i + j) & 0xff.
+static const size_t sizes [] = {0, 1, 31, 32, 1000, 8192, 70000, 300000};
+
+static void send_run (void *socket, int count)
+{
+    for (int i = 0; i < count; i++) {
+        const int parts = i % 5 + 1;
+        for (int j = 0; j < parts; j++) {
+            const size_t size = sizes [(i + j) % 8];
+            zmq_msg_t msg;
+            int rc = zmq_msg_init_size (&msg, size);
+            assert (rc == 0);
+            memset (zmq_msg_data (&msg), (i + j) & 0xff, size);
+            rc = zmq_msg_send (&msg, socket, j < parts - 1 ? ZMQ_SNDMORE : 0);
+            assert (rc == (int) size);
+        }
+    }
+}
+
+static void recv_run (void *socket, int count)
+{
+    for (int i = 0; i < count; i++) {
+        const int parts = i % 5 + 1;
+        for (int j = 0; j < parts; j++) {
+            const size_t size = sizes [(i + j) % 8];
+            zmq_msg_t msg;
+            int rc = zmq_msg_init (&msg);
+            assert (rc == 0);
+            rc = zmq_msg_recv (&msg, socket, 0);
+            assert (rc == (int) size);
+            const unsigned char *data =
+                (const unsigned char *) zmq_msg_data (&msg);
+            for (size_t k = 0; k < size; k++)
+                assert (data [k] == ((i + j) & 0xff));
+            assert (zmq_msg_more (&msg) == (j < parts - 1));
+            rc = zmq_msg_close (&msg);
+            assert (rc == 0);
+        }
+    }
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    assert (zmq_ctx_get (ctx, ZMQ_CRYPTO_THREADS) == ZMQ_CRYPTO_THREADS_DFLT);
+    int rc = zmq_ctx_set (ctx, ZMQ_CRYPTO_THREADS, -1);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_ctx_set (ctx, ZMQ_CRYPTO_THREADS, 4);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_CRYPTO_THREADS) == 4);
+
+    char server_public [41];
+    char server_secret [41];
+    char client_public [41];
+    char client_secret [41];
+    rc = zmq_curve_keypair (server_public, server_secret);
+    assert (rc == 0);
+    rc = zmq_curve_keypair (client_public, client_secret);
+    assert (rc == 0);
+
+    void *server = zmq_socket (ctx, ZMQ_DEALER);
+    assert (server);
+    int as_server = 1;
+    rc = zmq_setsockopt (server, ZMQ_CURVE_SERVER, &as_server, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_setsockopt (server, ZMQ_CURVE_SECRETKEY, server_secret, 41);
+    assert (rc == 0);
+
+    void *client = zmq_socket (ctx, ZMQ_DEALER);
+    assert (client);
+    rc = zmq_setsockopt (client, ZMQ_CURVE_SERVERKEY, server_public, 41);
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_CURVE_PUBLICKEY, client_public, 41);
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_CURVE_SECRETKEY, client_secret, 41);
+    assert (rc == 0);
+
+    //  Heartbeats are encrypted between the batches of messages. Boxing
+    //  the large ones keeps the peer quiet for longer than the interval
+    //  on a busy host, which must not count as the peer being dead.
+    int ivl = 10;
+    rc = zmq_setsockopt (server, ZMQ_HEARTBEAT_IVL, &ivl, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_HEARTBEAT_IVL, &ivl, sizeof (int));
+    assert (rc == 0);
+    int timeout = 10000;
+    rc = zmq_setsockopt (server, ZMQ_HEARTBEAT_TIMEOUT, &timeout,
+        sizeof (int));
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_HEARTBEAT_TIMEOUT, &timeout,
+        sizeof (int));
+    assert (rc == 0);
+
+    //  A small receive queue makes the engine hold back decoded batches.
+    int hwm = 10;
+    rc = zmq_setsockopt (server, ZMQ_RCVHWM, &hwm, sizeof (int));
+    assert (rc == 0);
+
+    rc = zmq_bind (server, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_len = sizeof endpoint;
+    rc = zmq_getsockopt (server, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_len);
+    assert (rc == 0);
+    rc = zmq_connect (client, endpoint);
+    assert (rc == 0);
+
+    //  Both directions at once.
+    send_run (client, 200);
+    send_run (server, 200);
+    msleep (SETTLE_TIME);
+    recv_run (server, 200);
+    recv_run (client, 200);
+
+    //  The connection is still in step after idling with heartbeats.
+    msleep (SETTLE_TIME);
+    send_run (client, 20);
+    recv_run (server, 20);
+
+    rc = zmq_close (client);
+    assert (rc == 0);
+    rc = zmq_close (server);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,195 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+static char server_public [41];
+static char server_secret [41];
+static char client_public [41];
+static char client_secret [41];
+
+//  Message i of a run has i % 3 + 1 parts, part j carries
+//  sizes [(i + j) % 7] bytes of (i + j) & 0xff.
+static const size_t sizes [] = {0, 1, 15, 16, 17, 8192, 300000};
+
+static void send_run (void *socket, int count)
+{
+    for (int i = 0; i < count; i++) {
+        const int parts = i % 3 + 1;
+        for (int j = 0; j < parts; j++) {
+            const size_t size = sizes [(i + j) % 7];
+            zmq_msg_t msg;
+            int rc = zmq_msg_init_size (&msg, size);
+            assert (rc == 0);
+            memset (zmq_msg_data (&msg), (i + j) & 0xff, size);
+            rc = zmq_msg_send (&msg, socket, j < parts - 1 ? ZMQ_SNDMORE : 0);
+            assert (rc == (int) size);
+        }
+    }
+}
+
+//  Receives a run and returns the cipher the last message came with,
+//  or NULL.
+static const char *recv_run (void *socket, int count)
+{
+    static char cipher [64];
+    const char *result = NULL;
+    for (int i = 0; i < count; i++) {
+        const int parts = i % 3 + 1;
+        for (int j = 0; j < parts; j++) {
+            const size_t size = sizes [(i + j) % 7];
+            zmq_msg_t msg;
+            int rc = zmq_msg_init (&msg);
+            assert (rc == 0);
+            rc = zmq_msg_recv (&msg, socket, 0);
+            assert (rc == (int) size);
+            const unsigned char *data =
+                (const unsigned char *) zmq_msg_data (&msg);
+            for (size_t k = 0; k < size; k++)
+                assert (data [k] == ((i + j) & 0xff));
+            assert (zmq_msg_more (&msg) == (j < parts - 1));
+            const char *name = zmq_msg_gets (&msg, "X-Curve-Cipher");
+            if (name) {
+                assert (strlen (name) < sizeof cipher);
+                strcpy (cipher, name);
+                result = cipher;
+            }
+            else {
+                assert (errno == EINVAL);
+                result = NULL;
+            }
+            rc = zmq_msg_close (&msg);
+            assert (rc == 0);
+        }
+    }
+    return result;
+}
+
+//  Runs messages both ways between a server and a client with the given
+//  ZMQ_CURVE_AEAD settings and returns the cipher they agreed on, or
+//  NULL if they kept to MESSAGE commands.
+static const char *test_pair (void *ctx, int server_aead, int client_aead)
+{
+    void *server = zmq_socket (ctx, ZMQ_DEALER);
+    assert (server);
+    int as_server = 1;
+    int rc = zmq_setsockopt (server, ZMQ_CURVE_SERVER, &as_server,
+        sizeof (int));
+    assert (rc == 0);
+    rc = zmq_setsockopt (server, ZMQ_CURVE_SECRETKEY, server_secret, 41);
+    assert (rc == 0);
+    rc = zmq_setsockopt (server, ZMQ_CURVE_AEAD, &server_aead, sizeof (int));
+    assert (rc == 0);
+
+    void *client = zmq_socket (ctx, ZMQ_DEALER);
+    assert (client);
+    rc = zmq_setsockopt (client, ZMQ_CURVE_SERVERKEY, server_public, 41);
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_CURVE_PUBLICKEY, client_public, 41);
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_CURVE_SECRETKEY, client_secret, 41);
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_CURVE_AEAD, &client_aead, sizeof (int));
+    assert (rc == 0);
+
+    //  Heartbeats are sealed as well. The timeout is generous so that
+    //  large frames in slow builds don't take the connection down.
+    int ivl = 10;
+    int timeout = 10000;
+    rc = zmq_setsockopt (server, ZMQ_HEARTBEAT_IVL, &ivl, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_setsockopt (server, ZMQ_HEARTBEAT_TIMEOUT, &timeout, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_HEARTBEAT_IVL, &ivl, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_HEARTBEAT_TIMEOUT, &timeout, sizeof (int));
+    assert (rc == 0);
+
+    rc = zmq_bind (server, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_len = sizeof endpoint;
+    rc = zmq_getsockopt (server, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_len);
+    assert (rc == 0);
+    rc = zmq_connect (client, endpoint);
+    assert (rc == 0);
+
+    send_run (client, 50);
+    send_run (server, 50);
+    const char *server_cipher = recv_run (server, 50);
+    const char *client_cipher = recv_run (client, 50);
+
+    //  Both ends report the same cipher.
+    assert ((server_cipher == NULL) == (client_cipher == NULL));
+    if (server_cipher)
+        assert (streq (server_cipher, client_cipher));
+
+    //  The connection is still in step after idling with heartbeats.
+    msleep (SETTLE_TIME);
+    send_run (client, 10);
+    recv_run (server, 10);
+
+    rc = zmq_close (client);
+    assert (rc == 0);
+    rc = zmq_close (server);
+    assert (rc == 0);
+
+    return client_cipher;
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    int rc = zmq_curve_keypair (server_public, server_secret);
+    assert (rc == 0);
+    rc = zmq_curve_keypair (client_public, client_secret);
+    assert (rc == 0);
+
+    //  On by default, takes 0 or 1.
+    void *socket = zmq_socket (ctx, ZMQ_DEALER);
+    assert (socket);
+    int value = 0;
+    size_t value_len = sizeof value;
+    rc = zmq_getsockopt (socket, ZMQ_CURVE_AEAD, &value, &value_len);
+    assert (rc == 0 && value == 1);
+    value = 2;
+    rc = zmq_setsockopt (socket, ZMQ_CURVE_AEAD, &value, sizeof (int));
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_close (socket);
+    assert (rc == 0);
+
+    const char *cipher = test_pair (ctx, 1, 1);
+    assert (cipher);
+    assert (streq (cipher, "AES-256-GCM")
+        ||  streq (cipher, "CHACHA20-POLY1305"));
+
+    //  Either end can keep the connection on MESSAGE commands.
+    assert (test_pair (ctx, 0, 1) == NULL);
+    assert (test_pair (ctx, 1, 0) == NULL);
+    assert (test_pair (ctx, 0, 0) == NULL);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,389 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+#include <string>
+
+static char client_public [41];
+static char client_secret [41];
+static char server_public [41];
+static char server_secret [41];
+
+//  Number of ZAP requests the handler got
+static int zap_requests;
+
+static void zap_handler (void *handler)
+{
+    while (true) {
+        char *version = s_recv (handler);
+        if (!version)
+            break;          //  Terminating
+
+        char *sequence = s_recv (handler);
+        char *domain = s_recv (handler);
+        char *address = s_recv (handler);
+        char *identity = s_recv (handler);
+        char *mechanism = s_recv (handler);
+        uint8_t client_key [32];
+        int size = zmq_recv (handler, client_key, 32, 0);
+        assert (size == 32);
+
+        //  Resumed sessions are authenticated with the same key.
+        char client_key_text [41];
+        zmq_z85_encode (client_key_text, client_key, 32);
+        assert (streq (mechanism, "CURVE"));
+        assert (streq (client_key_text, client_public));
+        zap_requests++;
+
+        s_sendmore (handler, version);
+        s_sendmore (handler, sequence);
+        s_sendmore (handler, "200");
+        s_sendmore (handler, "OK");
+        s_sendmore (handler, "anonymous");
+        s_send     (handler, "");
+
+        free (version);
+        free (sequence);
+        free (domain);
+        free (address);
+        free (identity);
+        free (mechanism);
+    }
+    zmq_close (handler);
+}
+
+static void *create_server (void *ctx, int ttl, const char *endpoint)
+{
+    void *server = zmq_socket (ctx, ZMQ_DEALER);
+    assert (server);
+    int as_server = 1;
+    int rc = zmq_setsockopt (server, ZMQ_CURVE_SERVER, &as_server,
+        sizeof (int));
+    assert (rc == 0);
+    rc = zmq_setsockopt (server, ZMQ_CURVE_SECRETKEY, server_secret, 41);
+    assert (rc == 0);
+    rc = zmq_setsockopt (server, ZMQ_CURVE_TICKET_TTL, &ttl, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_bind (server, endpoint);
+    assert (rc == 0);
+    return server;
+}
+
+static void *create_client (void *ctx, const char *endpoint)
+{
+    void *client = zmq_socket (ctx, ZMQ_DEALER);
+    assert (client);
+    int rc = zmq_setsockopt (client, ZMQ_CURVE_SERVERKEY, server_public, 41);
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_CURVE_PUBLICKEY, client_public, 41);
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_CURVE_SECRETKEY, client_secret, 41);
+    assert (rc == 0);
+    int linger = 0;
+    rc = zmq_setsockopt (client, ZMQ_LINGER, &linger, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_connect (client, endpoint);
+    assert (rc == 0);
+    return client;
+}
+
+//  Receives a message and returns whether it came over a resumed session.
+static bool recv_resumed (void *socket, const char *expected)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    rc = zmq_msg_recv (&msg, socket, 0);
+    assert (rc == (int) strlen (expected));
+    assert (memcmp (zmq_msg_data (&msg), expected, rc) == 0);
+    const char *resumed = zmq_msg_gets (&msg, "X-Curve-Resumed");
+    assert (resumed || errno == EINVAL);
+    if (resumed)
+        assert (streq (resumed, "1"));
+    //  The ticket itself doesn't show.
+    assert (zmq_msg_gets (&msg, "X-Curve-Ticket") == NULL);
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+    return resumed != NULL;
+}
+
+//  Sends messages both ways and returns whether the session was resumed.
+static bool exchange (void *server, void *client)
+{
+    s_send (client, "ping");
+    const bool resumed = recv_resumed (server, "ping");
+    s_send (server, "pong");
+    assert (recv_resumed (client, "pong") == resumed);
+    return resumed;
+}
+
+//  Receives a routing id and a data frame from a ZMQ_STREAM socket.
+static void stream_recv (void *stream, std::string &id, std::string &data)
+{
+    char buffer [256];
+    int size = zmq_recv (stream, buffer, sizeof buffer, 0);
+    assert (size > 0 && size <= (int) sizeof buffer);
+    id.assign (buffer, size);
+
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    rc = zmq_msg_recv (&msg, stream, 0);
+    assert (rc >= 0);
+    data.assign ((const char *) zmq_msg_data (&msg), zmq_msg_size (&msg));
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+}
+
+static void stream_send (void *stream, const std::string &id,
+    const std::string &data)
+{
+    int rc = zmq_send (stream, id.data (), id.size (), ZMQ_SNDMORE);
+    assert (rc == (int) id.size ());
+    rc = zmq_send (stream, data.data (), data.size (), 0);
+    assert (rc == (int) data.size ());
+}
+
+//  A connection between a client and a server going through a pair of
+//  ZMQ_STREAM sockets, which record what the client sends.
+struct relay_t
+{
+    void *front;
+    void *back;
+    std::string client;
+    std::string server;
+    std::string recorded;
+};
+
+//  Passes data between the ends until receiver has a message.
+static void relay (relay_t *relay_, void *receiver)
+{
+    zmq_pollitem_t items [] = {
+        {relay_->front, 0, ZMQ_POLLIN, 0},
+        {relay_->back, 0, ZMQ_POLLIN, 0},
+        {receiver, 0, ZMQ_POLLIN, 0}
+    };
+    while (true) {
+        int rc = zmq_poll (items, 3, 5000);
+        assert (rc > 0);
+        if (items [2].revents & ZMQ_POLLIN)
+            return;
+
+        std::string id;
+        std::string data;
+        if (items [0].revents & ZMQ_POLLIN) {
+            stream_recv (relay_->front, id, data);
+            //  Empty frames tell of connects and disconnects.
+            if (!data.empty ()) {
+                relay_->recorded += data;
+                stream_send (relay_->back, relay_->server, data);
+            }
+        }
+        if (items [1].revents & ZMQ_POLLIN) {
+            stream_recv (relay_->back, id, data);
+            if (!data.empty ())
+                stream_send (relay_->front, relay_->client, data);
+        }
+    }
+}
+
+static void *create_stream (void *ctx)
+{
+    void *stream = zmq_socket (ctx, ZMQ_STREAM);
+    assert (stream);
+    int linger = 0;
+    int rc = zmq_setsockopt (stream, ZMQ_LINGER, &linger, sizeof (int));
+    assert (rc == 0);
+    int timeout = 5000;
+    rc = zmq_setsockopt (stream, ZMQ_RCVTIMEO, &timeout, sizeof (int));
+    assert (rc == 0);
+    int notify = 1;
+    rc = zmq_setsockopt (stream, ZMQ_STREAM_NOTIFY, &notify, sizeof (int));
+    assert (rc == 0);
+    return stream;
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    int rc = zmq_curve_keypair (client_public, client_secret);
+    assert (rc == 0);
+    rc = zmq_curve_keypair (server_public, server_secret);
+    assert (rc == 0);
+
+    //  Tickets are cached per context, keep the ends apart.
+    void *server_ctx = zmq_ctx_new ();
+    assert (server_ctx);
+    void *client_ctx = zmq_ctx_new ();
+    assert (client_ctx);
+
+    void *handler = zmq_socket (server_ctx, ZMQ_REP);
+    assert (handler);
+    rc = zmq_bind (handler, "inproc://zeromq.zap.01");
+    assert (rc == 0);
+    void *zap_thread = zmq_threadstart (&zap_handler, handler);
+
+    //  No tickets by default.
+    void *socket = zmq_socket (server_ctx, ZMQ_DEALER);
+    assert (socket);
+    int value = -1;
+    size_t value_len = sizeof value;
+    rc = zmq_getsockopt (socket, ZMQ_CURVE_TICKET_TTL, &value, &value_len);
+    assert (rc == 0 && value == 0);
+    rc = zmq_setsockopt (socket, ZMQ_CURVE_TICKET_TTL, &value, sizeof (int));
+    assert (rc == 0);
+    value = -1;
+    rc = zmq_setsockopt (socket, ZMQ_CURVE_TICKET_TTL, &value, sizeof (int));
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_close (socket);
+    assert (rc == 0);
+
+    //  The first connection does the full handshake, the next one
+    //  resumes its session, still going through ZAP.
+    const char *endpoint = "tcp://127.0.0.1:9561";
+    void *server = create_server (server_ctx, 60000, endpoint);
+    void *client = create_client (client_ctx, endpoint);
+    assert (!exchange (server, client));
+    rc = zmq_close (client);
+    assert (rc == 0);
+
+    client = create_client (client_ctx, endpoint);
+    assert (exchange (server, client));
+    assert (zap_requests == 2);
+
+    //  A restarted server with the same key takes the tickets it handed
+    //  out before, so the reconnecting client resumes.
+    rc = zmq_close (server);
+    assert (rc == 0);
+    msleep (SETTLE_TIME);
+    server = create_server (server_ctx, 60000, endpoint);
+    assert (exchange (server, client));
+    assert (zap_requests == 3);
+    rc = zmq_close (client);
+    assert (rc == 0);
+
+    //  Resumed sessions can do without the faster cipher too.
+    client = create_client (client_ctx, endpoint);
+    int aead = 0;
+    rc = zmq_setsockopt (client, ZMQ_CURVE_AEAD, &aead, sizeof (int));
+    assert (rc == 0);
+    assert (exchange (server, client));
+    rc = zmq_close (client);
+    assert (rc == 0);
+    rc = zmq_close (server);
+    assert (rc == 0);
+
+    //  Servers that don't hand out tickets turn them down. The client
+    //  then reconnects with the full handshake.
+    endpoint = "tcp://127.0.0.1:9562";
+    server = create_server (server_ctx, 0, endpoint);
+    for (int i = 0; i < 2; i++) {
+        client = create_client (client_ctx, endpoint);
+        assert (!exchange (server, client));
+        rc = zmq_close (client);
+        assert (rc == 0);
+    }
+    rc = zmq_close (server);
+    assert (rc == 0);
+
+    //  Expired tickets are not used.
+    endpoint = "tcp://127.0.0.1:9563";
+    server = create_server (server_ctx, 100, endpoint);
+    client = create_client (client_ctx, endpoint);
+    assert (!exchange (server, client));
+    rc = zmq_close (client);
+    assert (rc == 0);
+    msleep (300);
+    client = create_client (client_ctx, endpoint);
+    assert (!exchange (server, client));
+    rc = zmq_close (client);
+    assert (rc == 0);
+    rc = zmq_close (server);
+    assert (rc == 0);
+
+    //  A RESUME recorded on the way is turned down when played again,
+    //  without even asking the ZAP handler.
+    endpoint = "tcp://127.0.0.1:9564";
+    server = create_server (server_ctx, 60000, endpoint);
+    client = create_client (client_ctx, endpoint);
+    exchange (server, client);
+    rc = zmq_close (client);
+    assert (rc == 0);
+
+    relay_t recorder;
+    recorder.front = create_stream (client_ctx);
+    rc = zmq_bind (recorder.front, "tcp://127.0.0.1:9565");
+    assert (rc == 0);
+    recorder.back = create_stream (client_ctx);
+    rc = zmq_connect (recorder.back, endpoint);
+    assert (rc == 0);
+    std::string data;
+    stream_recv (recorder.back, recorder.server, data);
+    assert (data.empty ());
+
+    //  The server's greeting waits in back until the client shows up.
+    client = create_client (client_ctx, "tcp://127.0.0.1:9565");
+    stream_recv (recorder.front, recorder.client, data);
+    assert (data.empty ());
+    s_send (client, "ping");
+    relay (&recorder, server);
+    assert (recv_resumed (server, "ping"));
+    s_send (server, "pong");
+    relay (&recorder, client);
+    assert (recv_resumed (client, "pong"));
+    const int zap_requests_before = zap_requests;
+
+    void *replayer = create_stream (client_ctx);
+    rc = zmq_connect (replayer, endpoint);
+    assert (rc == 0);
+    std::string id;
+    stream_recv (replayer, id, data);
+    assert (data.empty ());
+    stream_send (replayer, id, recorder.recorded);
+
+    //  The server hangs up without answering with RESUMED.
+    std::string received;
+    do {
+        stream_recv (replayer, id, data);
+        received += data;
+    } while (!data.empty ());
+    assert (received.find ("RESUMED") == std::string::npos);
+    assert (zap_requests == zap_requests_before);
+
+    rc = zmq_close (replayer);
+    assert (rc == 0);
+    rc = zmq_close (client);
+    assert (rc == 0);
+    rc = zmq_close (recorder.front);
+    assert (rc == 0);
+    rc = zmq_close (recorder.back);
+    assert (rc == 0);
+    rc = zmq_close (server);
+    assert (rc == 0);
+
+    rc = zmq_ctx_term (client_ctx);
+    assert (rc == 0);
+    rc = zmq_ctx_term (server_ctx);
+    assert (rc == 0);
+    zmq_threadclose (zap_thread);
+
+    return 0;
+}
@@ -0,0 +1,206 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+#include <vector>
+
+#if defined (ZMQ_HAVE_WINDOWS)
+#   include <ws2tcpip.h>
+#else
+#   include <sys/socket.h>
+#   include <netinet/in.h>
+#   include <arpa/inet.h>
+#   include <netdb.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
+//  Returns true if 'localhost' maps to an address of the given family.
+static bool localhost_has (int family_)
+{
+    addrinfo req;
+    memset (&req, 0, sizeof req);
+    req.ai_family = family_;
+    req.ai_socktype = SOCK_STREAM;
+    addrinfo *res;
+    if (getaddrinfo ("localhost", NULL, &req, &res) != 0)
+        return false;
+    freeaddrinfo (res);
+    return true;
+}
+
+//  Binds to a single loopback address and connects to 'localhost'. If the
+//  host name maps to both ::1 and 127.0.0.1, one of the two addresses is
+//  dead and the connecter has to move on to the other one. Does nothing
+//  if the address is not available on this host.
+static void test_connect_via (void *ctx_, const char *bind_endpoint_)
+{
+    int ipv6 = 1;
+
+    void *rep = zmq_socket (ctx_, ZMQ_REP);
+    assert (rep);
+    int rc = zmq_setsockopt (rep, ZMQ_IPV6, &ipv6, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_bind (rep, bind_endpoint_);
+    if (rc != 0) {
+        rc = zmq_close (rep);
+        assert (rc == 0);
+        return;
+    }
+
+    void *req = zmq_socket (ctx_, ZMQ_REQ);
+    assert (req);
+    rc = zmq_setsockopt (req, ZMQ_IPV6, &ipv6, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_connect (req, "tcp://localhost:5568");
+    assert (rc == 0);
+
+    bounce (rep, req);
+
+    rc = zmq_close (req);
+    assert (rc == 0);
+    rc = zmq_close (rep);
+    assert (rc == 0);
+}
+
+#if !defined (ZMQ_HAVE_WINDOWS)
+//  Listens on the loopback address of the family with a full accept
+//  queue, so that the SYNs of further connects are dropped, as if the
+//  address was unreachable. Returns the sockets to close afterwards.
+static std::vector <int> blackhole (int family_, int port_)
+{
+    sockaddr_storage address;
+    memset (&address, 0, sizeof address);
+    socklen_t address_len;
+    if (family_ == AF_INET6) {
+        sockaddr_in6 *ipv6 = (sockaddr_in6 *) &address;
+        ipv6->sin6_family = AF_INET6;
+        ipv6->sin6_port = htons (port_);
+        ipv6->sin6_addr = in6addr_loopback;
+        address_len = sizeof (sockaddr_in6);
+    }
+    else {
+        sockaddr_in *ipv4 = (sockaddr_in *) &address;
+        ipv4->sin_family = AF_INET;
+        ipv4->sin_port = htons (port_);
+        ipv4->sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+        address_len = sizeof (sockaddr_in);
+    }
+
+    std::vector <int> sockets;
+    int listener = socket (family_, SOCK_STREAM, IPPROTO_TCP);
+    assert (listener != -1);
+    int flag = 1;
+    int rc = setsockopt (listener, SOL_SOCKET, SO_REUSEADDR, &flag,
+        sizeof flag);
+    assert (rc == 0);
+    rc = bind (listener, (sockaddr *) &address, address_len);
+    assert (rc == 0);
+    rc = listen (listener, 0);
+    assert (rc == 0);
+    sockets.push_back (listener);
+
+    //  Fill the queue. Connects past its length never complete.
+    for (int i = 0; i < 8; i++) {
+        int s = socket (family_, SOCK_STREAM, IPPROTO_TCP);
+        assert (s != -1);
+        rc = fcntl (s, F_SETFL, O_NONBLOCK);
+        assert (rc == 0);
+        rc = connect (s, (sockaddr *) &address, address_len);
+        assert (rc == 0 || errno == EINPROGRESS);
+        sockets.push_back (s);
+    }
+    msleep (SETTLE_TIME);
+    return sockets;
+}
+
+//  Connects to 'localhost' while one of its addresses doesn't answer at
+//  all and the other one is live. If the dead address is tried first,
+//  the connecter must move on to the live one after the stagger delay
+//  rather than wait for the first attempt to time out.
+static void test_unreachable (void *ctx_, int dead_family_, int port_)
+{
+    std::vector <int> dead = blackhole (dead_family_, port_);
+
+    char bind_endpoint [64];
+    sprintf (bind_endpoint, dead_family_ == AF_INET6
+        ? "tcp://127.0.0.1:%d" : "tcp://[::1]:%d", port_);
+    char connect_endpoint [64];
+    sprintf (connect_endpoint, "tcp://localhost:%d", port_);
+
+    int ipv6 = 1;
+    void *rep = zmq_socket (ctx_, ZMQ_REP);
+    assert (rep);
+    int rc = zmq_setsockopt (rep, ZMQ_IPV6, &ipv6, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_bind (rep, bind_endpoint);
+    assert (rc == 0);
+
+    void *req = zmq_socket (ctx_, ZMQ_REQ);
+    assert (req);
+    rc = zmq_setsockopt (req, ZMQ_IPV6, &ipv6, sizeof (int));
+    assert (rc == 0);
+
+    void *watch = zmq_stopwatch_start ();
+    rc = zmq_connect (req, connect_endpoint);
+    assert (rc == 0);
+    bounce (rep, req);
+
+    //  Well below the first SYN retransmission, a second or more.
+    assert (zmq_stopwatch_stop (watch) < 800000);
+
+    rc = zmq_close (req);
+    assert (rc == 0);
+    rc = zmq_close (rep);
+    assert (rc == 0);
+    for (size_t i = 0; i != dead.size (); i++)
+        close (dead [i]);
+}
+#endif
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  Don't let the cache hide the lookups.
+    int rc = zmq_ctx_set (ctx, ZMQ_RESOLVER_CACHE_TTL, 0);
+    assert (rc == 0);
+
+    if (localhost_has (AF_INET))
+        test_connect_via (ctx, "tcp://127.0.0.1:5568");
+    if (localhost_has (AF_INET6))
+        test_connect_via (ctx, "tcp://[::1]:5568");
+
+#if !defined (ZMQ_HAVE_WINDOWS)
+    //  Try with either address unreachable, so that it doesn't matter
+    //  which one the connecter starts with.
+    if (localhost_has (AF_INET) && localhost_has (AF_INET6)) {
+        test_unreachable (ctx, AF_INET6, 5569);
+        test_unreachable (ctx, AF_INET, 5570);
+    }
+#endif
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
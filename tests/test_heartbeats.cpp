@@ -0,0 +1,277 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+#if defined (ZMQ_HAVE_WINDOWS)
+#   include <winsock2.h>
+#   include <ws2tcpip.h>
+#   define close closesocket
+#else
+#   include <sys/socket.h>
+#   include <netinet/in.h>
+#   include <arpa/inet.h>
+#   include <unistd.h>
+#endif
+
+//  ZMTP/3.0 greeting of a NULL client followed by its READY command.
+static const unsigned char greeting [64] = {
+    0xFF, 0, 0, 0, 0, 0, 0, 0, 1, 0x7F, 3, 0, 'N', 'U', 'L', 'L'
+};
+static const unsigned char ready [] =
+    "\4\51\5READY\13Socket-Type\0\0\0\6DEALER\10Identity\0\0\0\0";
+
+//  Returns a monitor socket reporting disconnections of 'socket_'.
+static void *monitor_disconnects (void *ctx_, void *socket_,
+    const char *endpoint_)
+{
+    int rc = zmq_socket_monitor (socket_, endpoint_, ZMQ_EVENT_DISCONNECTED);
+    assert (rc == 0);
+    void *monitor = zmq_socket (ctx_, ZMQ_PAIR);
+    assert (monitor);
+    rc = zmq_connect (monitor, endpoint_);
+    assert (rc == 0);
+    int timeout = 3000;
+    rc = zmq_setsockopt (monitor, ZMQ_RCVTIMEO, &timeout, sizeof (int));
+    assert (rc == 0);
+    return monitor;
+}
+
+//  Returns true iff the monitor reports a disconnection.
+static bool disconnected (void *monitor_)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    rc = zmq_msg_recv (&msg, monitor_, 0);
+    if (rc == -1) {
+        assert (errno == EAGAIN);
+        rc = zmq_msg_close (&msg);
+        assert (rc == 0);
+        return false;
+    }
+    const uint16_t event = *(uint16_t *) zmq_msg_data (&msg);
+    assert (event == ZMQ_EVENT_DISCONNECTED);
+    rc = zmq_msg_recv (&msg, monitor_, 0);
+    assert (rc >= 0);
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+    return true;
+}
+
+//  Connects a raw TCP socket to the port and performs the ZMTP handshake
+//  of a DEALER over it.
+static int mock_peer (unsigned short port_)
+{
+    int s = socket (AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    assert (s >= 0);
+    struct sockaddr_in address;
+    memset (&address, 0, sizeof address);
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = inet_addr ("127.0.0.1");
+    address.sin_port = htons (port_);
+    int rc = connect (s, (struct sockaddr *) &address, sizeof address);
+    assert (rc == 0);
+    rc = send (s, (const char *) greeting, sizeof greeting, 0);
+    assert (rc == (int) sizeof greeting);
+    rc = send (s, (const char *) ready, sizeof ready - 1, 0);
+    assert (rc == (int) sizeof ready - 1);
+
+    //  Wait for the greeting and READY command of the socket, so that
+    //  the handshake is complete.
+    unsigned char buffer [512];
+    size_t received = 0;
+    while (received < sizeof greeting + 2
+       ||  received < sizeof greeting + 2 + buffer [sizeof greeting + 1]) {
+        rc = recv (s, (char *) buffer + received,
+            sizeof buffer - received, 0);
+        assert (rc > 0);
+        received += rc;
+    }
+    assert (buffer [sizeof greeting] == 4);
+    assert (memcmp (buffer + sizeof greeting + 2, "\5READY", 6) == 0);
+    return s;
+}
+
+//  A peer that stops responding is disconnected once the heartbeat
+//  timeout expires.
+static void test_heartbeat_timeout (void *ctx_)
+{
+    void *server = zmq_socket (ctx_, ZMQ_ROUTER);
+    assert (server);
+    int value = 50;
+    int rc = zmq_setsockopt (server, ZMQ_HEARTBEAT_IVL, &value, sizeof (int));
+    assert (rc == 0);
+    void *monitor = monitor_disconnects (ctx_, server,
+        "inproc://monitor-timeout");
+    rc = zmq_bind (server, "tcp://127.0.0.1:5577");
+    assert (rc == 0);
+
+    int s = mock_peer (5577);
+    assert (disconnected (monitor));
+
+    close (s);
+    rc = zmq_close (monitor);
+    assert (rc == 0);
+    rc = zmq_close (server);
+    assert (rc == 0);
+}
+
+//  A peer announcing a TTL in its PING is disconnected when it stays
+//  silent for longer, even though the socket sends no heartbeats itself.
+static void test_heartbeat_ttl (void *ctx_)
+{
+    void *server = zmq_socket (ctx_, ZMQ_ROUTER);
+    assert (server);
+    void *monitor = monitor_disconnects (ctx_, server,
+        "inproc://monitor-ttl");
+    int rc = zmq_bind (server, "tcp://127.0.0.1:5578");
+    assert (rc == 0);
+
+    int s = mock_peer (5578);
+    //  PING with a TTL of 1 decisecond and no context.
+    rc = send (s, "\4\7\4PING\0\1", 9, 0);
+    assert (rc == 9);
+    assert (disconnected (monitor));
+
+    close (s);
+    rc = zmq_close (monitor);
+    assert (rc == 0);
+    rc = zmq_close (server);
+    assert (rc == 0);
+}
+
+//  Live peers exchanging heartbeats stay connected and heartbeats do not
+//  show up as messages.
+static void test_heartbeat_alive (void *ctx_, const char *endpoint_,
+    bool curve_)
+{
+    void *server = zmq_socket (ctx_, ZMQ_ROUTER);
+    assert (server);
+    void *client = zmq_socket (ctx_, ZMQ_DEALER);
+    assert (client);
+    int rc = zmq_setsockopt (client, ZMQ_IDENTITY, "client", 6);
+    assert (rc == 0);
+
+    int ivl = 50;
+    int timeout = 200;
+    int ttl = 500;
+    void *sockets [] = {server, client};
+    for (int i = 0; i < 2; i++) {
+        rc = zmq_setsockopt (sockets [i], ZMQ_HEARTBEAT_IVL, &ivl,
+            sizeof (int));
+        assert (rc == 0);
+        rc = zmq_setsockopt (sockets [i], ZMQ_HEARTBEAT_TIMEOUT, &timeout,
+            sizeof (int));
+        assert (rc == 0);
+        rc = zmq_setsockopt (sockets [i], ZMQ_HEARTBEAT_TTL, &ttl,
+            sizeof (int));
+        assert (rc == 0);
+    }
+
+    if (curve_) {
+        char public_key [41];
+        char secret_key [41];
+        rc = zmq_curve_keypair (public_key, secret_key);
+        assert (rc == 0);
+        int as_server = 1;
+        rc = zmq_setsockopt (server, ZMQ_CURVE_SERVER, &as_server, sizeof (int));
+        assert (rc == 0);
+        rc = zmq_setsockopt (server, ZMQ_CURVE_SECRETKEY, secret_key, 40);
+        assert (rc == 0);
+        rc = zmq_setsockopt (client, ZMQ_CURVE_SERVERKEY, public_key, 40);
+        assert (rc == 0);
+        rc = zmq_curve_keypair (public_key, secret_key);
+        assert (rc == 0);
+        rc = zmq_setsockopt (client, ZMQ_CURVE_PUBLICKEY, public_key, 40);
+        assert (rc == 0);
+        rc = zmq_setsockopt (client, ZMQ_CURVE_SECRETKEY, secret_key, 40);
+        assert (rc == 0);
+    }
+
+    void *monitor = monitor_disconnects (ctx_, server,
+        curve_ ? "inproc://monitor-alive-curve" : "inproc://monitor-alive");
+    timeout = 1000;
+    rc = zmq_setsockopt (monitor, ZMQ_RCVTIMEO, &timeout, sizeof (int));
+    assert (rc == 0);
+
+    rc = zmq_bind (server, endpoint_);
+    assert (rc == 0);
+    rc = zmq_connect (client, endpoint_);
+    assert (rc == 0);
+
+    //  Many heartbeats pass while the monitor waits for a disconnection.
+    assert (!disconnected (monitor));
+
+    rc = zmq_send (client, "hello", 5, 0);
+    assert (rc == 5);
+    char buffer [16];
+    rc = zmq_recv (server, buffer, sizeof buffer, 0);
+    assert (rc == 6 && memcmp (buffer, "client", 6) == 0);
+    rc = zmq_recv (server, buffer, sizeof buffer, 0);
+    assert (rc == 5 && memcmp (buffer, "hello", 5) == 0);
+
+    rc = zmq_close (monitor);
+    assert (rc == 0);
+    close_zero_linger (client);
+    close_zero_linger (server);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  Check the options.
+    void *socket = zmq_socket (ctx, ZMQ_DEALER);
+    assert (socket);
+    int value;
+    size_t value_size = sizeof (value);
+    int rc = zmq_getsockopt (socket, ZMQ_HEARTBEAT_IVL, &value, &value_size);
+    assert (rc == 0 && value == 0);
+    rc = zmq_getsockopt (socket, ZMQ_HEARTBEAT_TIMEOUT, &value, &value_size);
+    assert (rc == 0 && value == -1);
+    rc = zmq_getsockopt (socket, ZMQ_HEARTBEAT_TTL, &value, &value_size);
+    assert (rc == 0 && value == 0);
+    value = -1;
+    rc = zmq_setsockopt (socket, ZMQ_HEARTBEAT_IVL, &value, sizeof (int));
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_setsockopt (socket, ZMQ_HEARTBEAT_TIMEOUT, &value, sizeof (int));
+    assert (rc == -1 && errno == EINVAL);
+    value = 6553600;
+    rc = zmq_setsockopt (socket, ZMQ_HEARTBEAT_TTL, &value, sizeof (int));
+    assert (rc == -1 && errno == EINVAL);
+    value = 1250;
+    rc = zmq_setsockopt (socket, ZMQ_HEARTBEAT_TTL, &value, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_getsockopt (socket, ZMQ_HEARTBEAT_TTL, &value, &value_size);
+    assert (rc == 0 && value == 1200);
+    rc = zmq_close (socket);
+    assert (rc == 0);
+
+    test_heartbeat_timeout (ctx);
+    test_heartbeat_ttl (ctx);
+    test_heartbeat_alive (ctx, "tcp://127.0.0.1:5579", false);
+    if (zmq_has ("curve"))
+        test_heartbeat_alive (ctx, "tcp://127.0.0.1:5580", true);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
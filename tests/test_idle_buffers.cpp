@@ -0,0 +1,138 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  The engines' buffers and their pool aren't exported.
+#include "../src/batch_pool.hpp"
+#include "../src/config.hpp"
+
+//  Checks that released buffers go to the pool, up to its limit, and
+//  that new buffers are taken from there.
+static void test_pool ()
+{
+    zmq::batch_pool_t pool;
+    assert (pool.size () == 0);
+
+    zmq::batch_buffer_t buffer (8192, &pool);
+    unsigned char *data = buffer.data ();
+    assert (data);
+    assert (pool.size () == 0);
+    buffer.release ();
+    assert (pool.size () == 8192);
+
+    //  A buffer of another size can't use it, one of the same size does.
+    zmq::batch_buffer_t other (1024, &pool);
+    assert (other.data () != data);
+    assert (pool.size () == 8192);
+    zmq::batch_buffer_t same (8192, &pool);
+    assert (same.data () == data);
+    assert (pool.size () == 0);
+
+    //  Released again, the buffer is taken when accessed next time.
+    same.release ();
+    assert (pool.size () == 8192);
+    assert (buffer.data () == data);
+    assert (pool.size () == 0);
+
+    //  Resizing gives the old buffer back.
+    buffer.resize (1024);
+    assert (pool.size () == 8192);
+    buffer.release ();
+    assert (pool.size () == 8192);
+
+    //  Whatever goes beyond the limit is freed.
+    const int count = zmq::batch_pool_size / zmq::max_batch_size + 2;
+    zmq::batch_buffer_t **large = new zmq::batch_buffer_t* [count];
+    for (int i = 0; i < count; i++) {
+        large [i] = new zmq::batch_buffer_t (zmq::max_batch_size, &pool);
+        assert (large [i]->data ());
+    }
+    for (int i = 0; i < count; i++)
+        delete large [i];
+    delete [] large;
+    assert (pool.size () <= (size_t) zmq::batch_pool_size);
+    assert (pool.size () > (size_t) zmq::batch_pool_size
+        - zmq::max_batch_size);
+
+    other.release ();
+}
+
+//  Sends a message of size_ bytes over from_ and checks that it arrives
+//  unchanged at to_.
+static void transfer (void *from_, void *to_, size_t size_)
+{
+    char *data = (char *) malloc (size_);
+    assert (data);
+    for (size_t i = 0; i < size_; i++)
+        data [i] = (char) i;
+    int rc = zmq_send (from_, data, size_, 0);
+    assert (rc == (int) size_);
+
+    zmq_msg_t msg;
+    rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    rc = zmq_msg_recv (&msg, to_, 0);
+    assert (rc == (int) size_);
+    assert (memcmp (zmq_msg_data (&msg), data, size_) == 0);
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+    free (data);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    test_pool ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *server = zmq_socket (ctx, ZMQ_REP);
+    assert (server);
+    int rc = zmq_bind (server, "tcp://127.0.0.1:5562");
+    assert (rc == 0);
+
+    void *client = zmq_socket (ctx, ZMQ_REQ);
+    assert (client);
+    rc = zmq_connect (client, "tcp://127.0.0.1:5562");
+    assert (rc == 0);
+
+    //  Engines give their batch buffers back after having been idle
+    //  for a whole release interval and take new ones when traffic
+    //  resumes. Check that both small and large (zero-copy) messages
+    //  survive that in both directions.
+    transfer (client, server, 10);
+    transfer (server, client, 100000);
+    msleep (2 * zmq::batch_release_ivl + 100);
+    transfer (client, server, 10);
+    transfer (server, client, 10);
+    transfer (client, server, 100000);
+    transfer (server, client, 100000);
+
+    rc = zmq_close (client);
+    assert (rc == 0);
+    rc = zmq_close (server);
+    assert (rc == 0);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
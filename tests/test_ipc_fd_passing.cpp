@@ -0,0 +1,180 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+#include <dirent.h>
+
+//  Returns true iff a memfd holding a passed message is mapped into the
+//  process.
+static bool memfd_mapped ()
+{
+    FILE *maps = fopen ("/proc/self/maps", "r");
+    assert (maps);
+    char line [512];
+    bool found = false;
+    while (fgets (line, sizeof line, maps))
+        if (strstr (line, "/memfd:zmq-msg"))
+            found = true;
+    fclose (maps);
+    return found;
+}
+
+//  Returns the number of open file descriptors of the process.
+static int count_fds ()
+{
+    DIR *dir = opendir ("/proc/self/fd");
+    assert (dir);
+    int count = 0;
+    while (readdir (dir))
+        count++;
+    closedir (dir);
+    return count;
+}
+
+//  Sends a multi-part message of a large and a small frame and checks
+//  that it arrives intact, with the large frame passed as a memfd iff
+//  'passed_' is true.
+static void send_and_check (void *from_, void *to_, bool passed_)
+{
+    const size_t large_size = 4 * 1024 * 1024 + 3;
+    char *data = (char *) malloc (large_size);
+    assert (data);
+    for (size_t i = 0; i < large_size; i++)
+        data [i] = (char) (i * 31 + 7);
+
+    int rc = zmq_send (from_, data, large_size, ZMQ_SNDMORE);
+    assert (rc == (int) large_size);
+    rc = zmq_send (from_, "small", 5, 0);
+    assert (rc == 5);
+
+    zmq_msg_t msg;
+    rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+
+    rc = zmq_msg_recv (&msg, to_, 0);
+    assert (rc == (int) large_size);
+    assert (memcmp (zmq_msg_data (&msg), data, large_size) == 0);
+    assert (zmq_msg_more (&msg));
+    assert (memfd_mapped () == passed_);
+
+    //  The received body is private to us.
+    memset (zmq_msg_data (&msg), 0, large_size);
+
+    zmq_msg_t small;
+    rc = zmq_msg_init (&small);
+    assert (rc == 0);
+    rc = zmq_msg_recv (&small, to_, 0);
+    assert (rc == 5);
+    assert (memcmp (zmq_msg_data (&small), "small", 5) == 0);
+    assert (!zmq_msg_more (&small));
+    rc = zmq_msg_close (&small);
+    assert (rc == 0);
+
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+    assert (!memfd_mapped ());
+    free (data);
+}
+
+//  Connects two PAIR sockets with the given thresholds and exchanges
+//  messages in both directions.
+static void test_exchange (void *ctx_, const char *endpoint_,
+    int bind_threshold_, int connect_threshold_, bool passed_)
+{
+    const int fds = count_fds ();
+
+    void *sb = zmq_socket (ctx_, ZMQ_PAIR);
+    assert (sb);
+    int rc = zmq_setsockopt (sb, ZMQ_IPC_FD_THRESHOLD, &bind_threshold_,
+        sizeof (int));
+    assert (rc == 0);
+    rc = zmq_bind (sb, endpoint_);
+    assert (rc == 0);
+
+    void *sc = zmq_socket (ctx_, ZMQ_PAIR);
+    assert (sc);
+    rc = zmq_setsockopt (sc, ZMQ_IPC_FD_THRESHOLD, &connect_threshold_,
+        sizeof (int));
+    assert (rc == 0);
+    rc = zmq_connect (sc, endpoint_);
+    assert (rc == 0);
+
+    bounce (sb, sc);
+    for (int i = 0; i < 3; i++) {
+        send_and_check (sc, sb, passed_);
+        send_and_check (sb, sc, passed_);
+    }
+
+    rc = zmq_close (sc);
+    assert (rc == 0);
+    rc = zmq_close (sb);
+    assert (rc == 0);
+
+    //  No descriptor is leaked. Sockets are closed in the background,
+    //  including the ones of the previous exchange.
+    for (int i = 0; i < 100 && count_fds () > fds; i++)
+        msleep (SETTLE_TIME);
+    assert (count_fds () <= fds);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  Check the option.
+    void *s = zmq_socket (ctx, ZMQ_PAIR);
+    assert (s);
+    int threshold;
+    size_t size = sizeof threshold;
+    int rc = zmq_getsockopt (s, ZMQ_IPC_FD_THRESHOLD, &threshold, &size);
+    assert (rc == 0);
+    assert (threshold == -1);
+    threshold = -2;
+    rc = zmq_setsockopt (s, ZMQ_IPC_FD_THRESHOLD, &threshold, sizeof threshold);
+    assert (rc == -1 && errno == EINVAL);
+    threshold = 65536;
+    rc = zmq_setsockopt (s, ZMQ_IPC_FD_THRESHOLD, &threshold, sizeof threshold);
+    assert (rc == 0);
+    rc = zmq_getsockopt (s, ZMQ_IPC_FD_THRESHOLD, &threshold, &size);
+    assert (rc == 0);
+    assert (threshold == 65536);
+    rc = zmq_close (s);
+    assert (rc == 0);
+
+#if defined ZMQ_HAVE_MEMFD
+    //  Both ends accept descriptors.
+    test_exchange (ctx, "ipc://@zmq-test-fd-passing", 65536, 65536, true);
+#endif
+
+    //  Either end does not.
+    test_exchange (ctx, "ipc://@zmq-test-fd-passing", 65536, -1, false);
+    test_exchange (ctx, "ipc://@zmq-test-fd-passing", -1, 65536, false);
+
+    //  Not on TCP.
+    test_exchange (ctx, "tcp://127.0.0.1:5581", 65536, 65536, false);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  Checks that the first message arriving at router_ comes from a peer
+//  with the given identity.
+static void recv_identity (void *router_, const char *identity_)
+{
+    char buffer [32];
+    int rc = zmq_recv (router_, buffer, sizeof (buffer), 0);
+    assert (rc == (int) strlen (identity_));
+    assert (memcmp (buffer, identity_, rc) == 0);
+    rc = zmq_recv (router_, buffer, sizeof (buffer), 0);
+    assert (rc == 5);
+    assert (memcmp (buffer, "hello", 5) == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *router_a = zmq_socket (ctx, ZMQ_ROUTER);
+    assert (router_a);
+    int rc = zmq_bind (router_a, "tcp://127.0.0.1:5564");
+    assert (rc == 0);
+
+    void *router_b = zmq_socket (ctx, ZMQ_ROUTER);
+    assert (router_b);
+    rc = zmq_bind (router_b, "tcp://127.0.0.1:5565");
+    assert (rc == 0);
+
+    void *router_c = zmq_socket (ctx, ZMQ_ROUTER);
+    assert (router_c);
+    rc = zmq_bind (router_c, "tcp://127.0.0.1:5566");
+    assert (rc == 0);
+
+    //  Endpoints share the options the socket had when they were
+    //  created. Options set later only apply to endpoints created
+    //  after that.
+    void *dealer = zmq_socket (ctx, ZMQ_DEALER);
+    assert (dealer);
+    rc = zmq_setsockopt (dealer, ZMQ_IDENTITY, "first", 5);
+    assert (rc == 0);
+    rc = zmq_connect (dealer, "tcp://127.0.0.1:5564");
+    assert (rc == 0);
+    rc = zmq_connect (dealer, "tcp://127.0.0.1:5565");
+    assert (rc == 0);
+    rc = zmq_setsockopt (dealer, ZMQ_IDENTITY, "second", 6);
+    assert (rc == 0);
+    rc = zmq_connect (dealer, "tcp://127.0.0.1:5566");
+    assert (rc == 0);
+
+    //  Messages are sent round-robin, one to each router.
+    for (int i = 0; i < 3; i++) {
+        rc = zmq_send (dealer, "hello", 5, 0);
+        assert (rc == 5);
+    }
+    recv_identity (router_a, "first");
+    recv_identity (router_b, "first");
+    recv_identity (router_c, "second");
+
+    rc = zmq_close (dealer);
+    assert (rc == 0);
+    rc = zmq_close (router_a);
+    assert (rc == 0);
+    rc = zmq_close (router_b);
+    assert (rc == 0);
+    rc = zmq_close (router_c);
+    assert (rc == 0);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,168 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  Groups are joined and left on DISH sockets only.
+static void test_join_leave (void *ctx)
+{
+    void *radio = zmq_socket (ctx, ZMQ_RADIO);
+    assert (radio);
+    void *dish = zmq_socket (ctx, ZMQ_DISH);
+    assert (dish);
+
+    int rc = zmq_join (radio, "Movies");
+    assert (rc == -1 && errno == ENOTSUP);
+
+    rc = zmq_join (dish, "Movies");
+    assert (rc == 0);
+    rc = zmq_join (dish, "Movies");
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_join (dish, "0123456789abcdef");
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_leave (dish, "TV");
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_leave (dish, "Movies");
+    assert (rc == 0);
+
+    zmq_msg_t msg;
+    rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    assert (strcmp (zmq_msg_group (&msg), "") == 0);
+    rc = zmq_msg_set_group (&msg, "0123456789abcdef");
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_msg_set_group (&msg, "0123456789abcde");
+    assert (rc == 0);
+    assert (strcmp (zmq_msg_group (&msg), "0123456789abcde") == 0);
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+
+    //  RADIO and DISH do not speak ZMTP, and other socket types do not
+    //  use datagrams.
+    rc = zmq_bind (radio, "tcp://127.0.0.1:5582");
+    assert (rc == -1 && errno == ENOCOMPATPROTO);
+    void *pub = zmq_socket (ctx, ZMQ_PUB);
+    assert (pub);
+    rc = zmq_connect (pub, "udp://127.0.0.1:5582");
+    assert (rc == -1 && errno == ENOCOMPATPROTO);
+    rc = zmq_connect (radio, "udp://127.0.0.1:*");
+    assert (rc == -1 && errno == EINVAL);
+
+    rc = zmq_close (pub);
+    assert (rc == 0);
+    rc = zmq_close (dish);
+    assert (rc == 0);
+    rc = zmq_close (radio);
+    assert (rc == 0);
+}
+
+static int send_to_group (void *s, const char *group, const char *body)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init_size (&msg, strlen (body));
+    assert (rc == 0);
+    memcpy (zmq_msg_data (&msg), body, strlen (body));
+    rc = zmq_msg_set_group (&msg, group);
+    assert (rc == 0);
+    rc = zmq_msg_send (&msg, s, 0);
+    if (rc == -1)
+        zmq_msg_close (&msg);
+    return rc;
+}
+
+static void recv_from_group (void *s, const char *group, const char *body)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    rc = zmq_msg_recv (&msg, s, 0);
+    assert (rc == (int) strlen (body));
+    assert (memcmp (zmq_msg_data (&msg), body, strlen (body)) == 0);
+    assert (strcmp (zmq_msg_group (&msg), group) == 0);
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+}
+
+//  DISH gets the messages of the groups it has joined only.
+static void test_groups (void *ctx, const char *endpoint)
+{
+    void *dish = zmq_socket (ctx, ZMQ_DISH);
+    assert (dish);
+    int timeout = 1000;
+    int rc = zmq_setsockopt (dish, ZMQ_RCVTIMEO, &timeout, sizeof timeout);
+    assert (rc == 0);
+    rc = zmq_bind (dish, endpoint);
+    assert (rc == 0);
+    rc = zmq_join (dish, "TV");
+    assert (rc == 0);
+    rc = zmq_join (dish, "Radio");
+    assert (rc == 0);
+
+    void *radio = zmq_socket (ctx, ZMQ_RADIO);
+    assert (radio);
+    rc = zmq_connect (radio, endpoint);
+    assert (rc == 0);
+
+    //  There are no multipart messages.
+    rc = zmq_send (radio, "A", 1, ZMQ_SNDMORE);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  With datagrams nothing tells us the DISH is ready to receive.
+    msleep (SETTLE_TIME);
+
+    for (int i = 0; i < 100; i++) {
+        rc = send_to_group (radio, "Movies", "Blade Runner");
+        assert (rc == 12);
+        rc = send_to_group (radio, i % 2 ? "TV" : "Radio", "News");
+        assert (rc == 4);
+    }
+    for (int i = 0; i < 100; i++)
+        recv_from_group (dish, i % 2 ? "TV" : "Radio", "News");
+
+    rc = zmq_leave (dish, "TV");
+    assert (rc == 0);
+    rc = send_to_group (radio, "TV", "Weather");
+    assert (rc == 7);
+    rc = send_to_group (radio, "Radio", "Sports");
+    assert (rc == 6);
+    recv_from_group (dish, "Radio", "Sports");
+
+    rc = zmq_close (radio);
+    assert (rc == 0);
+    rc = zmq_close (dish);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    assert (zmq_has ("udp"));
+
+    test_join_leave (ctx);
+    test_groups (ctx, "inproc://radio-dish");
+    test_groups (ctx, "udp://127.0.0.1:5582");
+    test_groups (ctx, "udp://127.0.0.1;239.0.0.1:5583");
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
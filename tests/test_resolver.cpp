@@ -0,0 +1,88 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  Connects a REQ socket to the endpoint and does a round-trip with rep_.
+static void bounce_via (void *ctx_, void *rep_, const char *endpoint_)
+{
+    void *req = zmq_socket (ctx_, ZMQ_REQ);
+    assert (req);
+    int rc = zmq_connect (req, endpoint_);
+    assert (rc == 0);
+    bounce (rep_, req);
+    rc = zmq_close (req);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  Check the context option.
+    int rc = zmq_ctx_get (ctx, ZMQ_RESOLVER_CACHE_TTL);
+    assert (rc == ZMQ_RESOLVER_CACHE_TTL_DFLT);
+    rc = zmq_ctx_set (ctx, ZMQ_RESOLVER_CACHE_TTL, -1);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_ctx_set (ctx, ZMQ_RESOLVER_CACHE_TTL, 60000);
+    assert (rc == 0);
+    rc = zmq_ctx_get (ctx, ZMQ_RESOLVER_CACHE_TTL);
+    assert (rc == 60000);
+
+    void *rep = zmq_socket (ctx, ZMQ_REP);
+    assert (rep);
+    rc = zmq_bind (rep, "tcp://127.0.0.1:5567");
+    assert (rc == 0);
+
+    //  The first connect looks the host name up in the background, the
+    //  second one finds it in the cache.
+    bounce_via (ctx, rep, "tcp://localhost:5567");
+    bounce_via (ctx, rep, "tcp://localhost:5567");
+
+    //  Numeric addresses are resolved right away.
+    bounce_via (ctx, rep, "tcp://127.0.0.1:5567");
+
+    //  Without the cache every connect does a lookup.
+    rc = zmq_ctx_set (ctx, ZMQ_RESOLVER_CACHE_TTL, 0);
+    assert (rc == 0);
+    bounce_via (ctx, rep, "tcp://localhost:5567");
+
+    //  Closing the socket cancels the lookups in progress.
+    for (int i = 0; i < 100; i++) {
+        void *dealer = zmq_socket (ctx, ZMQ_DEALER);
+        assert (dealer);
+        int linger = 0;
+        rc = zmq_setsockopt (dealer, ZMQ_LINGER, &linger, sizeof (linger));
+        assert (rc == 0);
+        rc = zmq_connect (dealer, "tcp://localhost:5567");
+        assert (rc == 0);
+        rc = zmq_close (dealer);
+        assert (rc == 0);
+    }
+
+    rc = zmq_close (rep);
+    assert (rc == 0);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
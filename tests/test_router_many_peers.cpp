@@ -0,0 +1,187 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  Checks that a ROUTER routes to many peers at once, with generated
+//  identities as well as short and long explicit ones, and that peers
+//  can go away and come back under the same identity.
+
+const int peer_count = 500;
+
+static void
+set_identity (void *dealer, int index)
+{
+    char identity [64];
+    if (index % 3 == 1)
+        sprintf (identity, "peer-%d", index);
+    else
+    if (index % 3 == 2)
+        sprintf (identity, "a-rather-long-identity-of-peer-%06d", index);
+    else
+        return;     //  The router generates one
+    int rc = zmq_setsockopt (dealer, ZMQ_IDENTITY, identity, strlen (identity));
+    assert (rc == 0);
+}
+
+static void *
+connect_peer (void *ctx, int index)
+{
+    void *dealer = zmq_socket (ctx, ZMQ_DEALER);
+    assert (dealer);
+    set_identity (dealer, index);
+    int rc = zmq_connect (dealer, "inproc://router");
+    assert (rc == 0);
+
+    char body [16];
+    sprintf (body, "%d", index);
+    rc = zmq_send (dealer, body, strlen (body), 0);
+    assert (rc == (int) strlen (body));
+    return dealer;
+}
+
+//  Receives a greeting and returns the index of the peer it came from,
+//  storing the peer's identity.
+static int
+recv_greeting (void *router, char *identity, int *identity_size)
+{
+    *identity_size = zmq_recv (router, identity, 255, 0);
+    assert (*identity_size > 0 && *identity_size < 256);
+    char body [16];
+    int rc = zmq_recv (router, body, sizeof body - 1, 0);
+    assert (rc > 0);
+    body [rc] = 0;
+    return atoi (body);
+}
+
+static void
+bounce_peer (void *router, void *dealer, const char *identity,
+             int identity_size, int index)
+{
+    char body [16];
+    sprintf (body, "%d", index);
+    int rc = zmq_send (router, identity, identity_size, ZMQ_SNDMORE);
+    assert (rc == identity_size);
+    rc = zmq_send (router, body, strlen (body), 0);
+    assert (rc == (int) strlen (body));
+
+    char reply [16];
+    rc = zmq_recv (dealer, reply, sizeof reply - 1, 0);
+    assert (rc == (int) strlen (body));
+    reply [rc] = 0;
+    assert (streq (reply, body));
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *router = zmq_socket (ctx, ZMQ_ROUTER);
+    assert (router);
+    int mandatory = 1;
+    int rc = zmq_setsockopt (router, ZMQ_ROUTER_MANDATORY,
+        &mandatory, sizeof (mandatory));
+    assert (rc == 0);
+    rc = zmq_bind (router, "inproc://router");
+    assert (rc == 0);
+
+    static void *dealers [peer_count];
+    static char identities [peer_count][256];
+    static int identity_sizes [peer_count];
+    int i;
+
+    //  Connect all the peers and learn their identities.
+    for (i = 0; i != peer_count; i++)
+        dealers [i] = connect_peer (ctx, i);
+    for (i = 0; i != peer_count; i++) {
+        char identity [256];
+        int identity_size;
+        const int index = recv_greeting (router, identity, &identity_size);
+        assert (index >= 0 && index < peer_count);
+        assert (identity_sizes [index] == 0);
+        memcpy (identities [index], identity, identity_size);
+        identity_sizes [index] = identity_size;
+        if (index % 3 == 0)
+            assert (identity_size == 5 && identity [0] == 0);
+    }
+
+    //  Route a message to each of them.
+    for (i = 0; i != peer_count; i++)
+        bounce_peer (router, dealers [i], identities [i],
+            identity_sizes [i], i);
+
+    //  Let every other peer go. The router forgets them once their pipes
+    //  are gone.
+    for (i = 1; i < peer_count; i += 2)
+        close_zero_linger (dealers [i]);
+    for (i = 1; i < peer_count; i += 2) {
+        int attempts = 0;
+        while (true) {
+            rc = zmq_send (router, identities [i], identity_sizes [i],
+                ZMQ_SNDMORE | ZMQ_DONTWAIT);
+            if (rc == -1 && errno == EHOSTUNREACH)
+                break;
+            if (rc == -1)
+                assert (errno == EAGAIN);
+            else {
+                rc = zmq_send (router, "", 0, 0);
+                assert (rc == 0);
+            }
+            assert (++attempts < 500);
+            msleep (10);
+
+            //  The pipe goes once the router has read all it got from it.
+            char buffer [1];
+            rc = zmq_recv (router, buffer, sizeof buffer, ZMQ_DONTWAIT);
+            assert (rc == -1 && errno == EAGAIN);
+        }
+    }
+
+    //  The remaining ones are still reachable.
+    for (i = 0; i < peer_count; i += 2)
+        bounce_peer (router, dealers [i], identities [i],
+            identity_sizes [i], i);
+
+    //  The peers with explicit identities come back under them.
+    for (i = 1; i < peer_count; i += 2) {
+        if (i % 3 == 0)
+            continue;
+        dealers [i] = connect_peer (ctx, i);
+        char identity [256];
+        int identity_size;
+        const int index = recv_greeting (router, identity, &identity_size);
+        assert (index == i);
+        assert (identity_size == identity_sizes [i]);
+        assert (memcmp (identity, identities [i], identity_size) == 0);
+        bounce_peer (router, dealers [i], identities [i],
+            identity_sizes [i], i);
+    }
+
+    for (i = 0; i != peer_count; i++)
+        if (i % 2 == 0 || i % 3 != 0)
+            close_zero_linger (dealers [i]);
+    close_zero_linger (router);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -141,6 +141,33 @@ int main (void)
     rc = zmq_connect (client, "tcp://localhost:9998");
     assert (rc == 0);
     bounce (server, client);
+
+    //  Empty and large messages are boxed and unboxed in place too
+    const size_t large = 100000;
+    char *content = (char *) malloc (large);
+    assert (content);
+    char *buffer = (char *) malloc (large);
+    assert (buffer);
+    for (size_t i = 0; i < large; i++)
+        content [i] = (char) i;
+    rc = zmq_send (client, content, 0, ZMQ_SNDMORE);
+    assert (rc == 0);
+    rc = zmq_send (client, content, large, 0);
+    assert (rc == (int) large);
+    rc = zmq_recv (server, buffer, large, 0);
+    assert (rc == 0);
+    rc = zmq_recv (server, buffer, large, 0);
+    assert (rc == (int) large);
+    assert (memcmp (buffer, content, large) == 0);
+    rc = zmq_send (server, buffer, large, 0);
+    assert (rc == (int) large);
+    memset (buffer, 0, large);
+    rc = zmq_recv (client, buffer, large, 0);
+    assert (rc == (int) large);
+    assert (memcmp (buffer, content, large) == 0);
+    free (content);
+    free (buffer);
+
     rc = zmq_close (client);
     assert (rc == 0);
 
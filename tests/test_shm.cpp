@@ -0,0 +1,289 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+//  Messages travel in both directions across the rings, including ones
+//  that do not fit into a ring at once.
+static void test_bounce (void *ctx)
+{
+    void *sb = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sb);
+    int rc = zmq_bind (sb, "shm://@zmq-test-shm");
+    assert (rc == 0);
+
+    char endpoint [200];
+    size_t size = sizeof endpoint;
+    rc = zmq_getsockopt (sb, ZMQ_LAST_ENDPOINT, endpoint, &size);
+    assert (rc == 0);
+    assert (strcmp (endpoint, "shm://@zmq-test-shm") == 0);
+
+    void *sc = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sc);
+    rc = zmq_connect (sc, "shm://@zmq-test-shm");
+    assert (rc == 0);
+
+    bounce (sb, sc);
+
+    const size_t large_size = 1024 * 1024 + 17;
+    unsigned char *large = (unsigned char *) malloc (large_size);
+    assert (large);
+    for (size_t i = 0; i < large_size; i++)
+        large [i] = (unsigned char) (i * 7);
+
+    for (int i = 0; i < 3; i++) {
+        rc = zmq_send (sc, "head", 4, ZMQ_SNDMORE);
+        assert (rc == 4);
+        rc = zmq_send (sc, large, large_size, 0);
+        assert (rc == (int) large_size);
+    }
+    for (int i = 0; i < 3; i++) {
+        zmq_msg_t msg;
+        rc = zmq_msg_init (&msg);
+        assert (rc == 0);
+        rc = zmq_msg_recv (&msg, sb, 0);
+        assert (rc == 4);
+        assert (zmq_msg_more (&msg));
+        rc = zmq_msg_recv (&msg, sb, 0);
+        assert (rc == (int) large_size);
+        assert (memcmp (zmq_msg_data (&msg), large, large_size) == 0);
+        assert (!zmq_msg_more (&msg));
+        rc = zmq_msg_close (&msg);
+        assert (rc == 0);
+    }
+    free (large);
+
+    rc = zmq_close (sc);
+    assert (rc == 0);
+    rc = zmq_close (sb);
+    assert (rc == 0);
+}
+
+//  Messages left in the ring by a peer that has gone away are still
+//  delivered, and the ring keeps working when the receiver falls behind.
+//  The messages take more than a ring, but fit into the pipes.
+static void test_drain_after_disconnect (void *ctx)
+{
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int hwm = 10;
+    int rc = zmq_setsockopt (pull, ZMQ_RCVHWM, &hwm, sizeof hwm);
+    assert (rc == 0);
+    rc = zmq_bind (pull, "shm://@zmq-test-shm-drain");
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    rc = zmq_connect (push, "shm://@zmq-test-shm-drain");
+    assert (rc == 0);
+
+    const int count = 1000;
+    char buf [1000];
+    for (int i = 0; i < count; i++) {
+        memset (buf, i & 0xff, sizeof buf);
+        rc = zmq_send (push, buf, sizeof buf, 0);
+        assert (rc == (int) sizeof buf);
+    }
+    rc = zmq_close (push);
+    assert (rc == 0);
+
+    for (int i = 0; i < count; i++) {
+        rc = zmq_recv (pull, buf, sizeof buf, 0);
+        assert (rc == (int) sizeof buf);
+        assert ((unsigned char) buf [0] == (i & 0xff));
+        assert ((unsigned char) buf [sizeof buf - 1] == (i & 0xff));
+    }
+
+    rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+//  The rings are shared between different processes.
+static void test_fork ()
+{
+    const int count = 1000;
+
+    pid_t pid = fork ();
+    assert (pid >= 0);
+    if (pid == 0) {
+        void *ctx = zmq_ctx_new ();
+        assert (ctx);
+        void *push = zmq_socket (ctx, ZMQ_PUSH);
+        assert (push);
+        int rc = zmq_connect (push, "shm://@zmq-test-shm-fork");
+        assert (rc == 0);
+        for (int i = 0; i < count; i++) {
+            rc = zmq_send (push, &i, sizeof i, 0);
+            assert (rc == (int) sizeof i);
+        }
+        rc = zmq_close (push);
+        assert (rc == 0);
+        rc = zmq_ctx_term (ctx);
+        assert (rc == 0);
+        exit (0);
+    }
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_bind (pull, "shm://@zmq-test-shm-fork");
+    assert (rc == 0);
+
+    for (int i = 0; i < count; i++) {
+        int value;
+        rc = zmq_recv (pull, &value, sizeof value, 0);
+        assert (rc == (int) sizeof value);
+        assert (value == i);
+    }
+
+    int status;
+    assert (waitpid (pid, &status, 0) == pid);
+    assert (WIFEXITED (status) && WEXITSTATUS (status) == 0);
+
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+}
+
+//  A listener that passes descriptors other than eventfds for the wakeups
+//  gets its connection dropped rather than blocking the I/O thread.
+static void test_bogus_wake_fds (void *ctx)
+{
+    int listener = socket (AF_UNIX, SOCK_STREAM, 0);
+    assert (listener != -1);
+    struct sockaddr_un address;
+    memset (&address, 0, sizeof address);
+    address.sun_family = AF_UNIX;
+    const char name [] = "zmq-test-shm-bogus";
+    memcpy (address.sun_path + 1, name, sizeof name - 1);
+    int rc = bind (listener, (struct sockaddr *) &address,
+        sizeof (sa_family_t) + sizeof name);
+    assert (rc == 0);
+    rc = listen (listener, 1);
+    assert (rc == 0);
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    rc = zmq_connect (pull, "shm://@zmq-test-shm-bogus");
+    assert (rc == 0);
+    int s = accept (listener, NULL, NULL);
+    assert (s != -1);
+
+    //  A region the connecter is happy to map, but pipes for the wakeups.
+    const unsigned int capacity = 4096;
+    int memfd = memfd_create ("zmq-test-shm", MFD_ALLOW_SEALING);
+    assert (memfd != -1);
+    rc = ftruncate (memfd, 4 * capacity);
+    assert (rc == 0);
+    rc = fcntl (memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW);
+    assert (rc == 0);
+    int pipe_fds [2];
+    rc = pipe (pipe_fds);
+    assert (rc == 0);
+
+    unsigned char size [4] = {0, 0, capacity >> 8, 0};
+    struct iovec iov = {size, sizeof size};
+    const int fds [3] = {memfd, pipe_fds [0], pipe_fds [1]};
+    union {
+        char buf [CMSG_SPACE (sizeof fds)];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+    memset (&msg, 0, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof control.buf;
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN (sizeof fds);
+    memcpy (CMSG_DATA (cmsg), fds, sizeof fds);
+    rc = (int) sendmsg (s, &msg, 0);
+    assert (rc == (int) sizeof size);
+
+    //  The connecter hangs up.
+    struct pollfd item = {s, POLLIN, 0};
+    rc = poll (&item, 1, 2000);
+    assert (rc == 1);
+    char buf [1];
+    rc = (int) recv (s, buf, sizeof buf, 0);
+    assert (rc == 0);
+
+    close (s);
+    close (listener);
+    close (memfd);
+    close (pipe_fds [0]);
+    close (pipe_fds [1]);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    if (!zmq_has ("shm")) {
+        printf ("shm:// transport is not available, skipping test\n");
+        return 0;
+    }
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  STREAM sockets cannot use the transport.
+    void *stream = zmq_socket (ctx, ZMQ_STREAM);
+    assert (stream);
+    int rc = zmq_bind (stream, "shm://@zmq-test-shm-stream");
+    assert (rc == -1 && errno == ENOCOMPATPROTO);
+    rc = zmq_close (stream);
+    assert (rc == 0);
+
+    //  Neither can sockets that ask for security mechanisms other than NULL.
+    void *plain = zmq_socket (ctx, ZMQ_PAIR);
+    assert (plain);
+    int as_server = 1;
+    rc = zmq_setsockopt (plain, ZMQ_PLAIN_SERVER, &as_server, sizeof as_server);
+    assert (rc == 0);
+    rc = zmq_bind (plain, "shm://@zmq-test-shm-plain");
+    assert (rc == -1 && errno == ENOCOMPATPROTO);
+    rc = zmq_close (plain);
+    assert (rc == 0);
+
+    test_bounce (ctx);
+    test_drain_after_disconnect (ctx);
+    test_bogus_wake_fds (ctx);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    test_fork ();
+
+    return 0;
+}
@@ -0,0 +1,149 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *sender = zmq_socket (ctx, ZMQ_PUSH);
+    assert (sender);
+
+    //  Coalescing is off by default.
+    int delay;
+    size_t delay_size = sizeof (delay);
+    int rc = zmq_getsockopt (sender, ZMQ_SNDDELAY, &delay, &delay_size);
+    assert (rc == 0);
+    assert (delay == 0);
+
+    delay = -1;
+    rc = zmq_setsockopt (sender, ZMQ_SNDDELAY, &delay, sizeof (delay));
+    assert (rc == -1 && errno == EINVAL);
+
+    delay = 20;
+    rc = zmq_setsockopt (sender, ZMQ_SNDDELAY, &delay, sizeof (delay));
+    assert (rc == 0);
+    rc = zmq_getsockopt (sender, ZMQ_SNDDELAY, &delay, &delay_size);
+    assert (rc == 0);
+    assert (delay == 20);
+
+    void *receiver = zmq_socket (ctx, ZMQ_PULL);
+    assert (receiver);
+    int timeout = 2000;
+    rc = zmq_setsockopt (receiver, ZMQ_RCVTIMEO, &timeout, sizeof (timeout));
+    assert (rc == 0);
+    rc = zmq_bind (receiver, "tcp://127.0.0.1:5561");
+    assert (rc == 0);
+    rc = zmq_connect (sender, "tcp://127.0.0.1:5561");
+    assert (rc == 0);
+
+    //  A lone message is held back and then sent when the delay expires.
+    rc = zmq_send (sender, "lonely", 6, 0);
+    assert (rc == 6);
+    char buffer [16];
+    rc = zmq_recv (receiver, buffer, sizeof (buffer), 0);
+    assert (rc == 6);
+    assert (memcmp (buffer, "lonely", 6) == 0);
+
+    //  A stream of small messages arrives complete and in order.
+    for (int i = 0; i < 10000; i++) {
+        rc = zmq_send (sender, &i, sizeof (i), 0);
+        assert (rc == sizeof (i));
+    }
+    for (int i = 0; i < 10000; i++) {
+        int value;
+        rc = zmq_recv (receiver, &value, sizeof (value), 0);
+        assert (rc == sizeof (value));
+        assert (value == i);
+    }
+
+    //  Messages waiting for the delay to expire are not lost when
+    //  the socket is closed.
+    rc = zmq_send (sender, "last", 4, 0);
+    assert (rc == 4);
+    rc = zmq_close (sender);
+    assert (rc == 0);
+    rc = zmq_recv (receiver, buffer, sizeof (buffer), 0);
+    assert (rc == 4);
+    assert (memcmp (buffer, "last", 4) == 0);
+
+    rc = zmq_close (receiver);
+    assert (rc == 0);
+
+    //  A held batch larger than the socket buffers is written out
+    //  completely after the socket is closed, as the peer reads it.
+    sender = zmq_socket (ctx, ZMQ_DEALER);
+    assert (sender);
+    delay = 10000;
+    rc = zmq_setsockopt (sender, ZMQ_SNDDELAY, &delay, sizeof (delay));
+    assert (rc == 0);
+    int value = 262144;
+    rc = zmq_setsockopt (sender, ZMQ_OUT_BATCH_SIZE, &value, sizeof (value));
+    assert (rc == 0);
+    value = 4096;
+    rc = zmq_setsockopt (sender, ZMQ_SNDBUF, &value, sizeof (value));
+    assert (rc == 0);
+    value = 5000;
+    rc = zmq_setsockopt (sender, ZMQ_LINGER, &value, sizeof (value));
+    assert (rc == 0);
+
+    receiver = zmq_socket (ctx, ZMQ_DEALER);
+    assert (receiver);
+    rc = zmq_setsockopt (receiver, ZMQ_RCVTIMEO, &timeout, sizeof (timeout));
+    assert (rc == 0);
+    value = 4096;
+    rc = zmq_setsockopt (receiver, ZMQ_RCVBUF, &value, sizeof (value));
+    assert (rc == 0);
+    rc = zmq_bind (receiver, "tcp://127.0.0.1:5562");
+    assert (rc == 0);
+    rc = zmq_connect (sender, "tcp://127.0.0.1:5562");
+    assert (rc == 0);
+
+    //  Make sure the connection is up, so that the messages go into
+    //  the batch rather than wait in the pipe.
+    rc = zmq_send (receiver, "hi", 2, 0);
+    assert (rc == 2);
+    rc = zmq_recv (sender, buffer, sizeof (buffer), 0);
+    assert (rc == 2);
+
+    char message [1000];
+    for (int i = 0; i < 200; i++) {
+        memset (message, i, sizeof (message));
+        rc = zmq_send (sender, message, sizeof (message), 0);
+        assert (rc == sizeof (message));
+    }
+    rc = zmq_close (sender);
+    assert (rc == 0);
+    for (int i = 0; i < 200; i++) {
+        rc = zmq_recv (receiver, message, sizeof (message), 0);
+        assert (rc == sizeof (message));
+        assert (message [0] == (char) i && message [999] == (char) i);
+    }
+
+    rc = zmq_close (receiver);
+    assert (rc == 0);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,183 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+#include <set>
+#include <string>
+
+//  Checks that a SUB filters messages against many subscriptions: short,
+//  long and overlapping ones, and many sharing a prefix, before and
+//  after some of them are dropped. The publisher forwards everything so
+//  that the filtering is left to the SUB.
+
+typedef std::set <std::string> topics_t;
+
+static bool
+matches (const topics_t &topics, const std::string &msg)
+{
+    for (size_t size = 0; size <= msg.size (); size++)
+        if (topics.count (msg.substr (0, size)))
+            return true;
+    return false;
+}
+
+static void
+subscribe (void *sub, int option, const std::string &topic)
+{
+    int rc = zmq_setsockopt (sub, option, topic.data (), topic.size ());
+    assert (rc == 0);
+}
+
+//  Publishes the messages and checks the SUB gets those matching the
+//  topics, in order. A message no subscription matches ends the batch.
+static void
+check_filter (void *pub, void *sub, const topics_t &topics,
+              const std::set <std::string> &msgs)
+{
+    std::string last;
+    for (std::set <std::string>::const_iterator it = msgs.begin ();
+          it != msgs.end (); ++it) {
+        int rc = zmq_send (pub, it->data (), it->size (), 0);
+        assert (rc == (int) it->size ());
+    }
+    int rc = zmq_send (pub, "end", 3, 0);
+    assert (rc == 3);
+
+    char buffer [64];
+    for (std::set <std::string>::const_iterator it = msgs.begin ();
+          it != msgs.end (); ++it) {
+        if (!matches (topics, *it))
+            continue;
+        rc = zmq_recv (sub, buffer, sizeof buffer, 0);
+        assert (rc == (int) it->size ());
+        assert (memcmp (buffer, it->data (), rc) == 0);
+    }
+    rc = zmq_recv (sub, buffer, sizeof buffer, 0);
+    assert (rc == 3 && memcmp (buffer, "end", 3) == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *pub = zmq_socket (ctx, ZMQ_XPUB);
+    assert (pub);
+    int manual = 1;
+    int rc = zmq_setsockopt (pub, ZMQ_XPUB_MANUAL, &manual, sizeof manual);
+    assert (rc == 0);
+    rc = zmq_bind (pub, "inproc://topics");
+    assert (rc == 0);
+
+    void *sub = zmq_socket (ctx, ZMQ_SUB);
+    assert (sub);
+
+    //  Subscribe before connecting, so that the subscriptions are sent
+    //  from the SUB's filter once the pipe is attached.
+    topics_t topics;
+    topics.insert ("end");
+    topics.insert ("news");
+    topics.insert ("news.sport");
+    topics.insert ("new");
+    topics.insert ("a-topic-longer-than-sixteen-bytes");
+    topics.insert ("a-topic-longer-than-sixteen-bytes.and-then-some");
+    for (int i = 0; i < 200; i++) {
+        //  Many topics branching off at the same byte.
+        topics.insert (std::string ("t") + (char) i);
+        topics.insert (std::string ("t") + (char) i + "tail");
+    }
+    for (int i = 0; i < 500; i++) {
+        char topic [32];
+        sprintf (topic, "md.%c%c.%d", 'A' + i % 7, 'A' + i % 13, i);
+        topics.insert (topic);
+    }
+    for (topics_t::iterator it = topics.begin (); it != topics.end (); ++it)
+        subscribe (sub, ZMQ_SUBSCRIBE, *it);
+    subscribe (sub, ZMQ_SUBSCRIBE, "news");
+
+    rc = zmq_connect (sub, "inproc://topics");
+    assert (rc == 0);
+
+    //  Each subscription is passed upstream once.
+    topics_t received;
+    char buffer [64];
+    for (size_t i = 0; i < topics.size (); i++) {
+        rc = zmq_recv (pub, buffer, sizeof buffer, 0);
+        assert (rc >= 1 && buffer [0] == 1);
+        received.insert (std::string (buffer + 1, rc - 1));
+    }
+    assert (received == topics);
+    subscribe (pub, ZMQ_SUBSCRIBE, "");
+
+    std::set <std::string> msgs;
+    msgs.insert ("news");
+    msgs.insert ("news.sport.goal");
+    msgs.insert ("newt");
+    msgs.insert ("ne");
+    msgs.insert ("a-topic-longer-than-sixteen-bytes.xyz");
+    msgs.insert ("a-topic-longer-than-sixteen-byte");
+    msgs.insert ("other");
+    msgs.insert ("t");
+    for (int i = 0; i < 256; i++)
+        msgs.insert (std::string ("t") + (char) i + "x");
+    for (int i = 0; i < 600; i += 3) {
+        char msg [32];
+        sprintf (msg, "md.%c%c.%d!", 'A' + i % 7, 'A' + i % 13, i);
+        msgs.insert (msg);
+        sprintf (msg, "md.%c%c.%d", 'A' + i % 5, 'A' + i % 11, i);
+        msgs.insert (msg);
+    }
+    check_filter (pub, sub, topics, msgs);
+
+    //  Drop most topics, including most of those branching off at the
+    //  same byte and the prefixes of others.
+    subscribe (sub, ZMQ_UNSUBSCRIBE, "new");
+    subscribe (sub, ZMQ_UNSUBSCRIBE, "news");
+    topics.erase ("new");
+    subscribe (sub, ZMQ_UNSUBSCRIBE, "a-topic-longer-than-sixteen-bytes");
+    topics.erase ("a-topic-longer-than-sixteen-bytes");
+    for (int i = 0; i < 190; i++) {
+        std::string topic = std::string ("t") + (char) i;
+        subscribe (sub, ZMQ_UNSUBSCRIBE, topic);
+        topics.erase (topic);
+        if (i % 10 != 0) {
+            subscribe (sub, ZMQ_UNSUBSCRIBE, topic + "tail");
+            topics.erase (topic + "tail");
+        }
+    }
+    for (int i = 0; i < 500; i += 2) {
+        char topic [32];
+        sprintf (topic, "md.%c%c.%d", 'A' + i % 7, 'A' + i % 13, i);
+        subscribe (sub, ZMQ_UNSUBSCRIBE, topic);
+        topics.erase (topic);
+    }
+    check_filter (pub, sub, topics, msgs);
+
+    rc = zmq_close (pub);
+    assert (rc == 0);
+    rc = zmq_close (sub);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
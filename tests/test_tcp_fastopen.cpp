@@ -0,0 +1,94 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  Connects a REQ socket to a REP socket over TCP, with TCP Fast Open and
+//  the pipelined handshake enabled on either side as given, and does a
+//  few round-trips.
+static void test_roundtrip (void *ctx_, const char *endpoint_,
+    int server_fastopen_, int client_fastopen_)
+{
+    void *rep = zmq_socket (ctx_, ZMQ_REP);
+    assert (rep);
+    int rc = zmq_setsockopt (rep, ZMQ_TCP_FASTOPEN, &server_fastopen_,
+        sizeof (int));
+    assert (rc == 0);
+    rc = zmq_bind (rep, endpoint_);
+    assert (rc == 0);
+
+    //  Connect a few times so that later connections can use the fast
+    //  open cookie obtained by the first one.
+    for (int i = 0; i < 3; i++) {
+        void *req = zmq_socket (ctx_, ZMQ_REQ);
+        assert (req);
+        rc = zmq_setsockopt (req, ZMQ_TCP_FASTOPEN, &client_fastopen_,
+            sizeof (int));
+        assert (rc == 0);
+        rc = zmq_connect (req, endpoint_);
+        assert (rc == 0);
+
+        bounce (rep, req);
+
+        rc = zmq_close (req);
+        assert (rc == 0);
+    }
+
+    rc = zmq_close (rep);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  Check the option.
+    void *socket = zmq_socket (ctx, ZMQ_DEALER);
+    assert (socket);
+    int value;
+    size_t value_size = sizeof (value);
+    int rc = zmq_getsockopt (socket, ZMQ_TCP_FASTOPEN, &value, &value_size);
+    assert (rc == 0);
+    assert (value == 0);
+    value = 2;
+    rc = zmq_setsockopt (socket, ZMQ_TCP_FASTOPEN, &value, sizeof (int));
+    assert (rc == -1 && errno == EINVAL);
+    value = 1;
+    rc = zmq_setsockopt (socket, ZMQ_TCP_FASTOPEN, &value, sizeof (int));
+    assert (rc == 0);
+    value = 0;
+    rc = zmq_getsockopt (socket, ZMQ_TCP_FASTOPEN, &value, &value_size);
+    assert (rc == 0);
+    assert (value == 1);
+    rc = zmq_close (socket);
+    assert (rc == 0);
+
+    //  Peers pipelining their handshake talk to each other as well as to
+    //  peers that don't.
+    test_roundtrip (ctx, "tcp://127.0.0.1:5569", 1, 1);
+    test_roundtrip (ctx, "tcp://127.0.0.1:5570", 1, 0);
+    test_roundtrip (ctx, "tcp://127.0.0.1:5571", 0, 1);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+#include "tweetnacl_base.h"
+#include "tweetnacl_fast.h"
+
+//  Boxes messages of many lengths with every set of kernels the CPU
+//  supports and checks they match the reference code byte for byte.
+
+static const size_t max_size = 70000;
+
+//  Sizes of the plaintexts including the 32 zero bytes; the last ones
+//  take the 64-bit block counter past a byte boundary.
+static size_t test_size (int i)
+{
+    return i < 800 ? 32 + i : 32 + i * 61;
+}
+static const int sizes = 900;
+
+static void fill (unsigned char *data, size_t size, unsigned int seed)
+{
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1103515245 + 12345;
+        data [i] = (unsigned char) (seed >> 16);
+    }
+}
+
+static size_t total_size ()
+{
+    size_t total = 0;
+    for (int i = 0; i < sizes; i++)
+        total += test_size (i);
+    return total;
+}
+
+//  Stores the boxes of all the sizes back to back.
+static void box_all (unsigned char *boxes, const unsigned char *plain,
+    const unsigned char *nonce, const unsigned char *key)
+{
+    unsigned char *m = (unsigned char *) malloc (max_size);
+    assert (m);
+
+    for (int i = 0; i < sizes; i++) {
+        const size_t size = test_size (i);
+        unsigned char *c = boxes;
+        boxes += size;
+        int rc = crypto_box_afternm (c, plain, size, nonce, key);
+        assert (rc == 0);
+
+        //  Boxing in place gives the same result.
+        memcpy (m, plain, size);
+        rc = crypto_box_afternm (m, m, size, nonce, key);
+        assert (rc == 0);
+        assert (memcmp (m, c, size) == 0);
+
+        //  It opens in place, and not once tampered with.
+        rc = crypto_box_open_afternm (m, m, size, nonce, key);
+        assert (rc == 0);
+        assert (memcmp (m + 32, plain + 32, size - 32) == 0);
+        memcpy (m, c, size);
+        m [size - 1] ^= 1;
+        rc = crypto_box_open_afternm (m, m, size, nonce, key);
+        assert (rc == -1);
+    }
+
+    free (m);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    unsigned char key [32];
+    unsigned char nonce [24];
+    fill (key, sizeof key, 1);
+    fill (nonce, sizeof nonce, 2);
+
+    unsigned char *plain = (unsigned char *) malloc (max_size);
+    assert (plain);
+    memset (plain, 0, 32);
+    fill (plain + 32, max_size - 32, 3);
+
+    const size_t total = total_size ();
+    unsigned char *expected = (unsigned char *) malloc (total);
+    unsigned char *actual = (unsigned char *) malloc (total);
+    assert (expected && actual);
+
+    const int best = tweetnacl_kernels ();
+    assert (best >= TWEETNACL_KERNELS_SCALAR);
+
+    int rc = tweetnacl_select_kernels (TWEETNACL_KERNELS_REF);
+    assert (rc == 0);
+    assert (tweetnacl_kernels () == TWEETNACL_KERNELS_REF);
+    box_all (expected, plain, nonce, key);
+
+    for (int kernels = TWEETNACL_KERNELS_SCALAR; kernels <= best; kernels++) {
+        rc = tweetnacl_select_kernels (kernels);
+        assert (rc == 0);
+        box_all (actual, plain, nonce, key);
+        assert (memcmp (actual, expected, total) == 0);
+    }
+
+    //  Unsupported kernels are refused.
+    rc = tweetnacl_select_kernels (TWEETNACL_KERNELS_AVX2 + 1);
+    assert (rc == -1);
+    assert (tweetnacl_kernels () == best);
+
+    free (actual);
+    free (expected);
+    free (plain);
+    return 0;
+}
@@ -0,0 +1,200 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+#include <set>
+#include <string>
+
+//  Checks that an XPUB keeps track of overlapping, short and long topics
+//  from several subscribers: only the first subscription and the last
+//  unsubscription of a topic are passed upstream, messages reach the
+//  subscribers whose topics prefix them, and a subscriber going away
+//  releases exactly the topics nobody else holds.
+
+const char long_topic_1 [] = "a-topic-longer-than-sixteen-bytes.one";
+const char long_topic_2 [] = "a-topic-longer-than-sixteen-bytes.two";
+const int many_topic_count = 1000;
+
+static void
+send_subscription (void *xsub, bool subscribe, const char *topic)
+{
+    std::string msg (1, subscribe ? 1 : 0);
+    msg += topic;
+    int rc = zmq_send (xsub, msg.data (), msg.size (), 0);
+    assert (rc == (int) msg.size ());
+}
+
+//  Receives (un)subscriptions on the XPUB, in any order, and checks
+//  they are exactly the expected ones and that nothing else follows.
+static void
+recv_subscriptions (void *xpub, bool subscribe,
+                    const std::set <std::string> &expected)
+{
+    std::set <std::string> received;
+    char buffer [64];
+    for (size_t i = 0; i < expected.size (); i++) {
+        int rc = zmq_recv (xpub, buffer, sizeof buffer, 0);
+        assert (rc >= 1 && rc <= (int) sizeof buffer);
+        assert (buffer [0] == (subscribe ? 1 : 0));
+        bool inserted = received.insert (std::string (buffer + 1, rc - 1)).second;
+        assert (inserted);
+    }
+    assert (received == expected);
+
+    int rc = zmq_recv (xpub, buffer, sizeof buffer, ZMQ_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+}
+
+static void
+recv_topic (void *xsub, const char *topic)
+{
+    char buffer [64];
+    int rc = zmq_recv (xsub, buffer, sizeof buffer, 0);
+    assert (rc == (int) strlen (topic));
+    assert (memcmp (buffer, topic, rc) == 0);
+}
+
+static void
+recv_nothing (void *xsub)
+{
+    char buffer [64];
+    int rc = zmq_recv (xsub, buffer, sizeof buffer, 0);
+    assert (rc == -1 && errno == EAGAIN);
+}
+
+static void *
+create_xsub (void *ctx)
+{
+    void *xsub = zmq_socket (ctx, ZMQ_XSUB);
+    assert (xsub);
+    int timeout = 250;
+    int rc = zmq_setsockopt (xsub, ZMQ_RCVTIMEO, &timeout, sizeof timeout);
+    assert (rc == 0);
+    rc = zmq_connect (xsub, "inproc://topics");
+    assert (rc == 0);
+    return xsub;
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *xpub = zmq_socket (ctx, ZMQ_XPUB);
+    assert (xpub);
+    int timeout = 1000;
+    int rc = zmq_setsockopt (xpub, ZMQ_RCVTIMEO, &timeout, sizeof timeout);
+    assert (rc == 0);
+    rc = zmq_bind (xpub, "inproc://topics");
+    assert (rc == 0);
+
+    void *sub1 = create_xsub (ctx);
+    void *sub2 = create_xsub (ctx);
+    void *sub3 = create_xsub (ctx);
+
+    //  Duplicates are not passed upstream, while topics that are a prefix
+    //  of, or share a prefix with, known ones are.
+    send_subscription (sub1, true, "news");
+    send_subscription (sub1, true, long_topic_1);
+    send_subscription (sub2, true, "news.sport");
+    send_subscription (sub2, true, long_topic_1);
+    send_subscription (sub2, true, long_topic_2);
+    send_subscription (sub3, true, "news");
+    send_subscription (sub3, true, "new");
+    std::set <std::string> expected;
+    expected.insert ("news");
+    expected.insert ("news.sport");
+    expected.insert ("new");
+    expected.insert (long_topic_1);
+    expected.insert (long_topic_2);
+    recv_subscriptions (xpub, true, expected);
+
+    //  A subscriber gets a message once, however many of its topics
+    //  match it.
+    const char *topics [] = {
+        "news.sport.goal", "newt", "a-topic-longer-than-sixteen-bytes.onex",
+        "a-topic-longer-than-sixteen-bytes.t", "other", "ne"
+    };
+    for (size_t i = 0; i < sizeof topics / sizeof topics [0]; i++) {
+        rc = zmq_send (xpub, topics [i], strlen (topics [i]), 0);
+        assert (rc == (int) strlen (topics [i]));
+    }
+    recv_topic (sub1, "news.sport.goal");
+    recv_topic (sub1, "a-topic-longer-than-sixteen-bytes.onex");
+    recv_nothing (sub1);
+    recv_topic (sub2, "news.sport.goal");
+    recv_topic (sub2, "a-topic-longer-than-sixteen-bytes.onex");
+    recv_nothing (sub2);
+    recv_topic (sub3, "news.sport.goal");
+    recv_topic (sub3, "newt");
+    recv_nothing (sub3);
+
+    //  Only the last unsubscription from a topic is passed upstream.
+    send_subscription (sub2, false, long_topic_1);
+    send_subscription (sub2, false, "unknown");
+    send_subscription (sub1, false, long_topic_1);
+    expected.clear ();
+    expected.insert (long_topic_1);
+    recv_subscriptions (xpub, false, expected);
+
+    //  Subscribe the first subscriber to many topics sharing prefixes.
+    expected.clear ();
+    for (int i = 0; i < many_topic_count; i++) {
+        char topic [32];
+        sprintf (topic, "news.topic-%d", i);
+        send_subscription (sub1, true, topic);
+        expected.insert (topic);
+    }
+    recv_subscriptions (xpub, true, expected);
+
+    //  Closing subscribers releases the topics only they held.
+    rc = zmq_close (sub3);
+    assert (rc == 0);
+    expected.clear ();
+    expected.insert ("new");
+    recv_subscriptions (xpub, false, expected);
+
+    rc = zmq_close (sub2);
+    assert (rc == 0);
+    expected.clear ();
+    expected.insert ("news.sport");
+    expected.insert (long_topic_2);
+    recv_subscriptions (xpub, false, expected);
+
+    rc = zmq_close (sub1);
+    assert (rc == 0);
+    expected.clear ();
+    expected.insert ("news");
+    for (int i = 0; i < many_topic_count; i++) {
+        char topic [32];
+        sprintf (topic, "news.topic-%d", i);
+        expected.insert (topic);
+    }
+    recv_subscriptions (xpub, false, expected);
+
+    rc = zmq_close (xpub);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
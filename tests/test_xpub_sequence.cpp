@@ -0,0 +1,191 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  Publishes messages with a small HWM until at least some are dropped,
+//  then checks that the subscriber accounts for every message it missed.
+static void test_gaps (void *ctx, const char *endpoint, bool monitor)
+{
+    void *pub = zmq_socket (ctx, ZMQ_PUB);
+    assert (pub);
+    int sequence = 1;
+    int rc = zmq_setsockopt (pub, ZMQ_XPUB_SEQUENCE, &sequence,
+        sizeof sequence);
+    assert (rc == 0);
+    int hwm = 10;
+    rc = zmq_setsockopt (pub, ZMQ_SNDHWM, &hwm, sizeof hwm);
+    assert (rc == 0);
+    int buffer = 4096;
+    rc = zmq_setsockopt (pub, ZMQ_SNDBUF, &buffer, sizeof buffer);
+    assert (rc == 0);
+    rc = zmq_bind (pub, endpoint);
+    assert (rc == 0);
+
+    void *sub = zmq_socket (ctx, ZMQ_SUB);
+    assert (sub);
+    rc = zmq_setsockopt (sub, ZMQ_RCVHWM, &hwm, sizeof hwm);
+    assert (rc == 0);
+    rc = zmq_setsockopt (sub, ZMQ_RCVBUF, &buffer, sizeof buffer);
+    assert (rc == 0);
+    rc = zmq_setsockopt (sub, ZMQ_SUBSCRIBE, "", 0);
+    assert (rc == 0);
+
+    void *mon = NULL;
+    if (monitor) {
+        rc = zmq_socket_monitor (sub, "inproc://monitor-sub",
+            ZMQ_EVENT_MESSAGES_LOST);
+        assert (rc == 0);
+        mon = zmq_socket (ctx, ZMQ_PAIR);
+        assert (mon);
+        rc = zmq_connect (mon, "inproc://monitor-sub");
+        assert (rc == 0);
+    }
+
+    rc = zmq_connect (sub, endpoint);
+    assert (rc == 0);
+
+    //  Wait for the subscription to reach the publisher.
+    int received = 0;
+    int sent = 0;
+    int timeout = 100;
+    rc = zmq_setsockopt (sub, ZMQ_RCVTIMEO, &timeout, sizeof timeout);
+    assert (rc == 0);
+    while (true) {
+        rc = zmq_send (pub, "hello", 5, 0);
+        assert (rc == 5);
+        sent++;
+        if (zmq_recv (sub, NULL, 0, 0) == 5)
+            break;
+    }
+    received++;
+
+    //  Flood the subscriber that does not read.
+    char data [1024];
+    memset (data, 0, sizeof data);
+    for (int i = 0; i < 20000; i++) {
+        rc = zmq_send (pub, data, sizeof data, 0);
+        assert (rc == (int) sizeof data);
+        sent++;
+    }
+
+    //  Read what got through, then send the last message until it arrives.
+    //  It is preceded by the count of the messages dropped since the last
+    //  one delivered.
+    while (true) {
+        rc = zmq_recv (sub, data, sizeof data, 0);
+        if (rc == 4 && memcmp (data, "last", 4) == 0) {
+            received++;
+            break;
+        }
+        if (rc == -1) {
+            assert (errno == EAGAIN);
+            rc = zmq_send (pub, "last", 4, 0);
+            assert (rc == 4);
+            sent++;
+        }
+        else
+            received++;
+    }
+
+    uint64_t lost;
+    size_t size = sizeof lost;
+    rc = zmq_getsockopt (sub, ZMQ_MESSAGES_LOST, &lost, &size);
+    assert (rc == 0);
+    assert (size == sizeof lost);
+    assert (lost > 0);
+    assert ((uint64_t) received + lost == (uint64_t) sent);
+
+    //  The monitor reports the same gaps as they arrive.
+    if (monitor) {
+        uint64_t reported = 0;
+        while (reported < lost) {
+            zmq_msg_t msg;
+            rc = zmq_msg_init (&msg);
+            assert (rc == 0);
+            rc = zmq_msg_recv (&msg, mon, 0);
+            assert (rc == 6);
+            uint8_t *event = (uint8_t *) zmq_msg_data (&msg);
+            assert (*(uint16_t *) event == ZMQ_EVENT_MESSAGES_LOST);
+            reported += *(uint32_t *) (event + 2);
+            rc = zmq_msg_recv (&msg, mon, 0);
+            assert (rc >= 0);
+            rc = zmq_msg_close (&msg);
+            assert (rc == 0);
+        }
+        assert (reported == lost);
+        rc = zmq_close (mon);
+        assert (rc == 0);
+    }
+
+    rc = zmq_close (sub);
+    assert (rc == 0);
+    rc = zmq_close (pub);
+    assert (rc == 0);
+}
+
+static void test_options (void *ctx)
+{
+    void *pub = zmq_socket (ctx, ZMQ_PUB);
+    assert (pub);
+    void *sub = zmq_socket (ctx, ZMQ_SUB);
+    assert (sub);
+
+    //  Only publishers number their messages.
+    int sequence = 1;
+    int rc = zmq_setsockopt (sub, ZMQ_XPUB_SEQUENCE, &sequence,
+        sizeof sequence);
+    assert (rc == -1 && errno == EINVAL);
+    sequence = -1;
+    rc = zmq_setsockopt (pub, ZMQ_XPUB_SEQUENCE, &sequence, sizeof sequence);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  Only subscribers count the gaps.
+    uint64_t lost = 1;
+    size_t size = sizeof lost;
+    rc = zmq_getsockopt (sub, ZMQ_MESSAGES_LOST, &lost, &size);
+    assert (rc == 0);
+    assert (lost == 0);
+    rc = zmq_getsockopt (pub, ZMQ_MESSAGES_LOST, &lost, &size);
+    assert (rc == -1 && errno == EINVAL);
+    int small;
+    size = sizeof small;
+    rc = zmq_getsockopt (sub, ZMQ_MESSAGES_LOST, &small, &size);
+    assert (rc == -1 && errno == EINVAL);
+
+    rc = zmq_close (sub);
+    assert (rc == 0);
+    rc = zmq_close (pub);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_options (ctx);
+    test_gaps (ctx, "inproc://sequence", false);
+    test_gaps (ctx, "tcp://127.0.0.1:5584", true);
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
@@ -0,0 +1,207 @@
+/*
+    Copyright (c) 2007-2015 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  Number of requests the ZAP handler got.
+static int zap_requests = 0;
+
+static void
+zap_handler (void *handler)
+{
+    uint8_t metadata [] = {
+        5, 'H', 'e', 'l', 'l', 'o',
+        0, 0, 0, 5, 'W', 'o', 'r', 'l', 'd'
+    };
+
+    //  Process ZAP requests forever
+    while (true) {
+        char *version = s_recv (handler);
+        if (!version)
+            break;          //  Terminating
+
+        char *sequence = s_recv (handler);
+        char *domain = s_recv (handler);
+        char *address = s_recv (handler);
+        char *identity = s_recv (handler);
+        char *mechanism = s_recv (handler);
+        char *username = s_recv (handler);
+        char *password = s_recv (handler);
+
+        assert (streq (version, "1.0"));
+        assert (streq (mechanism, "PLAIN"));
+        zap_requests++;
+
+        s_sendmore (handler, version);
+        s_sendmore (handler, sequence);
+        if (streq (username, "admin")
+        &&  streq (password, "password")) {
+            s_sendmore (handler, "200");
+            s_sendmore (handler, "OK");
+            s_sendmore (handler, "admin");
+            zmq_send (handler, metadata, sizeof (metadata), 0);
+        }
+        else
+        if (streq (username, "busy")) {
+            s_sendmore (handler, "300");
+            s_sendmore (handler, "Try again later");
+            s_sendmore (handler, "");
+            s_send (handler, "");
+        }
+        else {
+            s_sendmore (handler, "400");
+            s_sendmore (handler, "Invalid username or password");
+            s_sendmore (handler, "");
+            s_send (handler, "");
+        }
+        free (version);
+        free (sequence);
+        free (domain);
+        free (address);
+        free (identity);
+        free (mechanism);
+        free (username);
+        free (password);
+    }
+    close_zero_linger (handler);
+}
+
+static void *
+connect_client (void *ctx, const char *endpoint,
+                const char *username, const char *password)
+{
+    void *client = zmq_socket (ctx, ZMQ_DEALER);
+    assert (client);
+    int rc = zmq_setsockopt (client, ZMQ_PLAIN_USERNAME,
+        username, strlen (username));
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_PLAIN_PASSWORD,
+        password, strlen (password));
+    assert (rc == 0);
+    //  Every connection makes exactly one handshake.
+    int reconnect_ivl = -1;
+    rc = zmq_setsockopt (client, ZMQ_RECONNECT_IVL,
+        &reconnect_ivl, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_connect (client, endpoint);
+    assert (rc == 0);
+    return client;
+}
+
+//  Connects a client that is let in and checks the server sees the
+//  user id and metadata the handler assigned to it.
+static void
+expect_accepted (void *ctx, void *server, const char *endpoint)
+{
+    void *client = connect_client (ctx, endpoint, "admin", "password");
+    s_send (client, "Hello");
+
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    rc = zmq_msg_recv (&msg, server, 0);
+    assert (rc == 5);
+    assert (streq (zmq_msg_gets (&msg, "User-Id"), "admin"));
+    assert (streq (zmq_msg_gets (&msg, "Hello"), "World"));
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+
+    close_zero_linger (client);
+}
+
+static void
+expect_rejected (void *ctx, void *server, const char *endpoint,
+                 const char *username)
+{
+    void *client = connect_client (ctx, endpoint, username, "secret");
+    expect_bounce_fail (server, client);
+    close_zero_linger (client);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  The cache is off by default.
+    assert (zmq_ctx_get (ctx, ZMQ_ZAP_CACHE_TTL) == 0);
+    int rc = zmq_ctx_set (ctx, ZMQ_ZAP_CACHE_TTL, -1);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  Spawn ZAP handler
+    void *handler = zmq_socket (ctx, ZMQ_REP);
+    assert (handler);
+    rc = zmq_bind (handler, "inproc://zeromq.zap.01");
+    assert (rc == 0);
+    void *zap_thread = zmq_threadstart (&zap_handler, handler);
+
+    void *server = zmq_socket (ctx, ZMQ_DEALER);
+    assert (server);
+    int as_server = 1;
+    rc = zmq_setsockopt (server, ZMQ_PLAIN_SERVER, &as_server, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_bind (server, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_len = sizeof endpoint;
+    rc = zmq_getsockopt (server, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_len);
+    assert (rc == 0);
+
+    //  Without the cache every connection asks the handler.
+    expect_accepted (ctx, server, endpoint);
+    expect_accepted (ctx, server, endpoint);
+    assert (zap_requests == 2);
+
+    //  With the cache only the first one does.
+    rc = zmq_ctx_set (ctx, ZMQ_ZAP_CACHE_TTL, 60000);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_ZAP_CACHE_TTL) == 60000);
+    expect_accepted (ctx, server, endpoint);
+    expect_accepted (ctx, server, endpoint);
+    expect_accepted (ctx, server, endpoint);
+    assert (zap_requests == 3);
+
+    //  Rejections are cached too.
+    expect_rejected (ctx, server, endpoint, "mallory");
+    expect_rejected (ctx, server, endpoint, "mallory");
+    assert (zap_requests == 4);
+
+    //  Temporary failures are not.
+    expect_rejected (ctx, server, endpoint, "busy");
+    expect_rejected (ctx, server, endpoint, "busy");
+    assert (zap_requests == 6);
+
+    //  Replies expire.
+    rc = zmq_ctx_set (ctx, ZMQ_ZAP_CACHE_TTL, 100);
+    assert (rc == 0);
+    expect_rejected (ctx, server, endpoint, "eve");
+    msleep (200);
+    expect_rejected (ctx, server, endpoint, "eve");
+    assert (zap_requests == 8);
+
+    close_zero_linger (server);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    //  Wait until ZAP handler terminates
+    zmq_threadclose (zap_thread);
+
+    return 0;
+}
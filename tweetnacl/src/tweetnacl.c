@@ -5,6 +5,7 @@
 /* direct tweetnacl usage */
 #include "tweetnacl_base.h"
 #endif
+#include "tweetnacl_fast.h"
 
 #define FOR(i,n) for (i = 0;i < n;++i)
 #define sv static void
@@ -125,6 +126,10 @@ int crypto_core_salsa20(u8 *out,const u8 *in,const u8 *k,const u8 *c)
 
 int crypto_core_hsalsa20(u8 *out,const u8 *in,const u8 *k,const u8 *c)
 {
+  if (tweetnacl_kernels() != TWEETNACL_KERNELS_REF) {
+    tweetnacl_hsalsa20(out,in,k,c);
+    return 0;
+  }
   core(out,in,k,c,1);
   return 0;
 }
@@ -136,6 +141,10 @@ int crypto_stream_salsa20_xor(u8 *c,const u8 *m,u64 b,const u8 *n,const u8 *k)
   u8 z[16],x[64];
   u32 u,i;
   if (!b) return 0;
+  if (tweetnacl_kernels() != TWEETNACL_KERNELS_REF) {
+    tweetnacl_salsa20_xor(c,m,b,n,k);
+    return 0;
+  }
   FOR(i,16) z[i] = 0;
   FOR(i,8) z[i] = n[i];
   while (b >= 64) {
@@ -195,6 +204,10 @@ int crypto_onetimeauth(u8 *out,const u8 *m,u64 n,const u8 *k)
 {
   u32 s,i,j,u,x[17],r[17],h[17],c[17],g[17];
 
+  if (tweetnacl_kernels() != TWEETNACL_KERNELS_REF) {
+    tweetnacl_poly1305(out,m,n,k);
+    return 0;
+  }
   FOR(j,17) r[j]=h[j]=0;
   FOR(j,16) r[j]=k[j];
   r[3]&=15;
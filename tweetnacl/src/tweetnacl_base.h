@@ -15,6 +15,7 @@
 #define crypto_secretbox_NONCEBYTES 24
 #define crypto_secretbox_ZEROBYTES 32
 #define crypto_secretbox_BOXZEROBYTES 16
+#define crypto_hash_BYTES 64
 typedef unsigned char u8;
 typedef unsigned long u32;
 typedef unsigned long long u64;
@@ -34,6 +35,7 @@ int crypto_box_open(u8 *m,const u8 *c,u64 d,const u8 *n,const u8 *y,const u8 *x)
 int crypto_box_beforenm(u8 *k,const u8 *y,const u8 *x);
 int crypto_secretbox(u8 *c,const u8 *m,u64 d,const u8 *n,const u8 *k);
 int crypto_secretbox_open(u8 *m,const u8 *c,u64 d,const u8 *n,const u8 *k);
+int crypto_hash(u8 *out,const u8 *m,u64 n);
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,440 @@
+/* Salsa20 and Poly1305 for tweetnacl: word-oriented scalar code, and SSE2
+   and AVX2 kernels doing several blocks at once, picked at run time. The
+   results are bit-exact with the reference code in tweetnacl.c. */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "tweetnacl_fast.h"
+
+#if (defined __x86_64__ || defined __i386__) \
+ && (defined __clang__ || (defined __GNUC__ && __GNUC__ >= 5))
+#define TWEETNACL_X86 1
+#include <immintrin.h>
+#endif
+
+static uint32_t LE32 (const uint8_t *p)
+{
+    return (uint32_t) p [0] | (uint32_t) p [1] << 8
+         | (uint32_t) p [2] << 16 | (uint32_t) p [3] << 24;
+}
+
+static void ST32 (uint8_t *p, uint32_t u)
+{
+    p [0] = (uint8_t) u;
+    p [1] = (uint8_t) (u >> 8);
+    p [2] = (uint8_t) (u >> 16);
+    p [3] = (uint8_t) (u >> 24);
+}
+
+/* Reduces the 26-bit limbs of a Poly1305 accumulator far enough for the
+   next multiplication. */
+static void poly1305_carry (uint32_t h [5])
+{
+    uint32_t c;
+
+    c = h [0] >> 26; h [0] &= 0x3ffffff; h [1] += c;
+    c = h [1] >> 26; h [1] &= 0x3ffffff; h [2] += c;
+    c = h [2] >> 26; h [2] &= 0x3ffffff; h [3] += c;
+    c = h [3] >> 26; h [3] &= 0x3ffffff; h [4] += c;
+    c = h [4] >> 26; h [4] &= 0x3ffffff; h [0] += c * 5;
+    c = h [0] >> 26; h [0] &= 0x3ffffff; h [1] += c;
+}
+
+#if defined TWEETNACL_X86
+
+static int cpu_kernels (void)
+{
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2"))
+        return TWEETNACL_KERNELS_AVX2;
+    if (__builtin_cpu_supports ("sse2"))
+        return TWEETNACL_KERNELS_SSE2;
+    return TWEETNACL_KERNELS_SCALAR;
+}
+
+/* SSE2: four Salsa20 blocks, two Poly1305 blocks at once. */
+
+static __attribute__ ((target ("sse2"))) void sse2_out (uint8_t *c,
+    const uint8_t *m, __m128i x)
+{
+    if (m)
+        x = _mm_xor_si128 (x, _mm_loadu_si128 ((const __m128i *) m));
+    _mm_storeu_si128 ((__m128i *) c, x);
+}
+
+#define SIMD_NAME(f) sse2_##f
+#define SIMD_ATTR __attribute__ ((target ("sse2")))
+#define SIMD_LANES 4
+#define V __m128i
+#define V_ADD32 _mm_add_epi32
+#define V_ADD64 _mm_add_epi64
+#define V_MUL32 _mm_mul_epu32
+#define V_AND _mm_and_si128
+#define V_OR _mm_or_si128
+#define V_XOR _mm_xor_si128
+#define V_SHL32 _mm_slli_epi32
+#define V_SHR32 _mm_srli_epi32
+#define V_SHL64 _mm_slli_epi64
+#define V_SHR64 _mm_srli_epi64
+#define V_UNPACKLO32 _mm_unpacklo_epi32
+#define V_UNPACKHI32 _mm_unpackhi_epi32
+#define V_UNPACKLO64 _mm_unpacklo_epi64
+#define V_UNPACKHI64 _mm_unpackhi_epi64
+#define V_SET1_32(x) _mm_set1_epi32 ((int) (x))
+#define V_SET1_64(x) _mm_set1_epi64x ((long long) (x))
+#define V_LOADU(p) _mm_loadu_si128 ((const __m128i *) (p))
+#define V_STOREU(p, x) _mm_storeu_si128 ((__m128i *) (p), x)
+#define SIMD_OUT(c, m, b, w, x) \
+    sse2_out ((c) + 64 * (b) + 4 * (w), \
+        (m) ? (m) + 64 * (b) + 4 * (w) : NULL, x)
+#include "tweetnacl_simd.h"
+#undef SIMD_NAME
+#undef SIMD_ATTR
+#undef SIMD_LANES
+#undef V
+#undef V_ADD32
+#undef V_ADD64
+#undef V_MUL32
+#undef V_AND
+#undef V_OR
+#undef V_XOR
+#undef V_SHL32
+#undef V_SHR32
+#undef V_SHL64
+#undef V_SHR64
+#undef V_UNPACKLO32
+#undef V_UNPACKHI32
+#undef V_UNPACKLO64
+#undef V_UNPACKHI64
+#undef V_SET1_32
+#undef V_SET1_64
+#undef V_LOADU
+#undef V_STOREU
+#undef SIMD_OUT
+
+/* AVX2: eight Salsa20 blocks, four Poly1305 blocks at once. The unpack
+   instructions work within 128-bit halves, so the high half of each
+   transposed vector belongs to the block four blocks further on. */
+
+static __attribute__ ((target ("avx2"))) void avx2_out (uint8_t *c,
+    const uint8_t *m, __m256i x)
+{
+    __m128i lo = _mm256_castsi256_si128 (x);
+    __m128i hi = _mm256_extracti128_si256 (x, 1);
+    if (m) {
+        lo = _mm_xor_si128 (lo, _mm_loadu_si128 ((const __m128i *) m));
+        hi = _mm_xor_si128 (hi,
+            _mm_loadu_si128 ((const __m128i *) (m + 256)));
+    }
+    _mm_storeu_si128 ((__m128i *) c, lo);
+    _mm_storeu_si128 ((__m128i *) (c + 256), hi);
+}
+
+#define SIMD_NAME(f) avx2_##f
+#define SIMD_ATTR __attribute__ ((target ("avx2")))
+#define SIMD_LANES 8
+#define V __m256i
+#define V_ADD32 _mm256_add_epi32
+#define V_ADD64 _mm256_add_epi64
+#define V_MUL32 _mm256_mul_epu32
+#define V_AND _mm256_and_si256
+#define V_OR _mm256_or_si256
+#define V_XOR _mm256_xor_si256
+#define V_SHL32 _mm256_slli_epi32
+#define V_SHR32 _mm256_srli_epi32
+#define V_SHL64 _mm256_slli_epi64
+#define V_SHR64 _mm256_srli_epi64
+#define V_UNPACKLO32 _mm256_unpacklo_epi32
+#define V_UNPACKHI32 _mm256_unpackhi_epi32
+#define V_UNPACKLO64 _mm256_unpacklo_epi64
+#define V_UNPACKHI64 _mm256_unpackhi_epi64
+#define V_SET1_32(x) _mm256_set1_epi32 ((int) (x))
+#define V_SET1_64(x) _mm256_set1_epi64x ((long long) (x))
+#define V_LOADU(p) _mm256_loadu_si256 ((const __m256i *) (p))
+#define V_STOREU(p, x) _mm256_storeu_si256 ((__m256i *) (p), x)
+#define SIMD_OUT(c, m, b, w, x) \
+    avx2_out ((c) + 64 * (b) + 4 * (w), \
+        (m) ? (m) + 64 * (b) + 4 * (w) : NULL, x)
+#include "tweetnacl_simd.h"
+#undef SIMD_NAME
+#undef SIMD_ATTR
+#undef SIMD_LANES
+#undef V
+#undef V_ADD32
+#undef V_ADD64
+#undef V_MUL32
+#undef V_AND
+#undef V_OR
+#undef V_XOR
+#undef V_SHL32
+#undef V_SHR32
+#undef V_SHL64
+#undef V_SHR64
+#undef V_UNPACKLO32
+#undef V_UNPACKHI32
+#undef V_UNPACKLO64
+#undef V_UNPACKHI64
+#undef V_SET1_32
+#undef V_SET1_64
+#undef V_LOADU
+#undef V_STOREU
+#undef SIMD_OUT
+
+#else
+
+static int cpu_kernels (void)
+{
+    return TWEETNACL_KERNELS_SCALAR;
+}
+
+#endif
+
+/* Set once, racing threads agree on the value. */
+static int selected = -1;
+
+int tweetnacl_kernels (void)
+{
+    if (selected < 0)
+        selected = cpu_kernels ();
+    return selected;
+}
+
+int tweetnacl_select_kernels (int kernels)
+{
+    if (kernels < TWEETNACL_KERNELS_REF || kernels > cpu_kernels ())
+        return -1;
+    selected = kernels;
+    return 0;
+}
+
+/* Salsa20 */
+
+#define ROTL32(x, c) (((x) << (c)) | ((x) >> (32 - (c))))
+
+#define QR(a, b, c, d) \
+    b ^= ROTL32 (a + d, 7); \
+    c ^= ROTL32 (b + a, 9); \
+    d ^= ROTL32 (c + b, 13); \
+    a ^= ROTL32 (d + c, 18);
+
+static void salsa20_rounds (uint32_t x [16])
+{
+    int i;
+
+    for (i = 0; i < 10; i++) {
+        QR (x [0], x [4], x [8], x [12])
+        QR (x [5], x [9], x [13], x [1])
+        QR (x [10], x [14], x [2], x [6])
+        QR (x [15], x [3], x [7], x [11])
+        QR (x [0], x [1], x [2], x [3])
+        QR (x [5], x [6], x [7], x [4])
+        QR (x [10], x [11], x [8], x [9])
+        QR (x [15], x [12], x [13], x [14])
+    }
+}
+
+/* Input words of the core: constants on the diagonal, the key, the
+   input (nonce and counter) in the middle. */
+static void salsa20_state (uint32_t s [16], const uint8_t *in,
+    const uint8_t *k, const uint8_t *c)
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        s [5 * i] = LE32 (c + 4 * i);
+        s [1 + i] = LE32 (k + 4 * i);
+        s [6 + i] = LE32 (in + 4 * i);
+        s [11 + i] = LE32 (k + 16 + 4 * i);
+    }
+}
+
+static const uint8_t sigma [16] = "expand 32-byte k";
+
+void tweetnacl_salsa20_xor (uint8_t *c, const uint8_t *m, uint64_t b,
+    const uint8_t *n, const uint8_t *k)
+{
+    uint8_t in [16], block [64];
+    uint32_t s [16], x [16];
+    uint64_t groups;
+    int i;
+
+    memcpy (in, n, 8);
+    memset (in + 8, 0, 8);
+    salsa20_state (s, in, k, sigma);
+
+#if defined TWEETNACL_X86
+    if (tweetnacl_kernels () == TWEETNACL_KERNELS_AVX2 && b >= 512) {
+        groups = b / 512;
+        avx2_salsa20 (c, m, groups, s);
+        c += groups * 512;
+        if (m)
+            m += groups * 512;
+        b -= groups * 512;
+    }
+    if (tweetnacl_kernels () >= TWEETNACL_KERNELS_SSE2 && b >= 256) {
+        groups = b / 256;
+        sse2_salsa20 (c, m, groups, s);
+        c += groups * 256;
+        if (m)
+            m += groups * 256;
+        b -= groups * 256;
+    }
+#else
+    (void) groups;
+#endif
+
+    while (b > 0) {
+        const size_t size = b < 64 ? (size_t) b : 64;
+        memcpy (x, s, sizeof x);
+        salsa20_rounds (x);
+        for (i = 0; i < 16; i++)
+            ST32 (block + 4 * i, x [i] + s [i]);
+        for (i = 0; i < (int) size; i++)
+            c [i] = (m ? m [i] : 0) ^ block [i];
+        if (++s [8] == 0)
+            ++s [9];
+        c += size;
+        if (m)
+            m += size;
+        b -= size;
+    }
+}
+
+void tweetnacl_hsalsa20 (uint8_t *out, const uint8_t *in, const uint8_t *k,
+    const uint8_t *c)
+{
+    uint32_t x [16];
+    int i;
+
+    salsa20_state (x, in, k, c);
+    salsa20_rounds (x);
+    for (i = 0; i < 4; i++) {
+        ST32 (out + 4 * i, x [5 * i]);
+        ST32 (out + 16 + 4 * i, x [6 + i]);
+    }
+}
+
+/* Poly1305, with the accumulator and r in five 26-bit limbs. */
+
+static void poly1305_mul (uint32_t h [5], const uint32_t r [5])
+{
+    const uint32_t s1 = r [1] * 5, s2 = r [2] * 5, s3 = r [3] * 5,
+        s4 = r [4] * 5;
+    uint64_t d0, d1, d2, d3, d4;
+    uint32_t c;
+
+    d0 = (uint64_t) h [0] * r [0] + (uint64_t) h [1] * s4
+       + (uint64_t) h [2] * s3 + (uint64_t) h [3] * s2
+       + (uint64_t) h [4] * s1;
+    d1 = (uint64_t) h [0] * r [1] + (uint64_t) h [1] * r [0]
+       + (uint64_t) h [2] * s4 + (uint64_t) h [3] * s3
+       + (uint64_t) h [4] * s2;
+    d2 = (uint64_t) h [0] * r [2] + (uint64_t) h [1] * r [1]
+       + (uint64_t) h [2] * r [0] + (uint64_t) h [3] * s4
+       + (uint64_t) h [4] * s3;
+    d3 = (uint64_t) h [0] * r [3] + (uint64_t) h [1] * r [2]
+       + (uint64_t) h [2] * r [1] + (uint64_t) h [3] * r [0]
+       + (uint64_t) h [4] * s4;
+    d4 = (uint64_t) h [0] * r [4] + (uint64_t) h [1] * r [3]
+       + (uint64_t) h [2] * r [2] + (uint64_t) h [3] * r [1]
+       + (uint64_t) h [4] * r [0];
+
+    d1 += d0 >> 26; h [0] = (uint32_t) d0 & 0x3ffffff;
+    d2 += d1 >> 26; h [1] = (uint32_t) d1 & 0x3ffffff;
+    d3 += d2 >> 26; h [2] = (uint32_t) d2 & 0x3ffffff;
+    d4 += d3 >> 26; h [3] = (uint32_t) d3 & 0x3ffffff;
+    c = (uint32_t) (d4 >> 26); h [4] = (uint32_t) d4 & 0x3ffffff;
+    h [0] += c * 5;
+    c = h [0] >> 26; h [0] &= 0x3ffffff;
+    h [1] += c;
+}
+
+static void poly1305_block (uint32_t h [5], const uint32_t r [5],
+    const uint8_t *m, uint32_t hibit)
+{
+    h [0] += LE32 (m) & 0x3ffffff;
+    h [1] += (LE32 (m + 3) >> 2) & 0x3ffffff;
+    h [2] += (LE32 (m + 6) >> 4) & 0x3ffffff;
+    h [3] += (LE32 (m + 9) >> 6) & 0x3ffffff;
+    h [4] += (LE32 (m + 12) >> 8) | hibit;
+    poly1305_mul (h, r);
+}
+
+void tweetnacl_poly1305 (uint8_t *out, const uint8_t *m, uint64_t n,
+    const uint8_t *k)
+{
+    uint32_t r [5], h [5] = {0, 0, 0, 0, 0}, g [5], mask, c;
+    uint8_t last [16];
+    uint64_t f;
+    int i;
+
+    r [0] = LE32 (k) & 0x3ffffff;
+    r [1] = (LE32 (k + 3) >> 2) & 0x3ffff03;
+    r [2] = (LE32 (k + 6) >> 4) & 0x3ffc0ff;
+    r [3] = (LE32 (k + 9) >> 6) & 0x3f03fff;
+    r [4] = (LE32 (k + 12) >> 8) & 0x00fffff;
+
+#if defined TWEETNACL_X86
+    {
+        /* Lanes of the kernel, and at least how many blocks make using
+           it worthwhile. */
+        const int lanes =
+            tweetnacl_kernels () == TWEETNACL_KERNELS_AVX2 ? 4
+          : tweetnacl_kernels () == TWEETNACL_KERNELS_SSE2 ? 2 : 0;
+        if (lanes && n / 16 >= (uint64_t) 4 * lanes) {
+            uint32_t rp [4] [5];
+            const uint64_t chunks = n / 16 / lanes;
+            memcpy (rp [0], r, sizeof r);
+            for (i = 1; i < lanes; i++) {
+                memcpy (rp [i], rp [i - 1], sizeof r);
+                poly1305_mul (rp [i], r);
+            }
+            if (lanes == 4)
+                avx2_poly1305 (h, m, chunks, rp);
+            else
+                sse2_poly1305 (h, m, chunks, rp);
+            m += chunks * lanes * 16;
+            n -= chunks * lanes * 16;
+        }
+    }
+#endif
+
+    for (; n >= 16; m += 16, n -= 16)
+        poly1305_block (h, r, m, 1 << 24);
+    if (n > 0) {
+        memset (last, 0, sizeof last);
+        memcpy (last, m, (size_t) n);
+        last [n] = 1;
+        poly1305_block (h, r, last, 0);
+    }
+
+    /* Fully reduce h modulo 2^130 - 5. */
+    poly1305_carry (h);
+    c = h [1] >> 26; h [1] &= 0x3ffffff; h [2] += c;
+    c = h [2] >> 26; h [2] &= 0x3ffffff; h [3] += c;
+    c = h [3] >> 26; h [3] &= 0x3ffffff; h [4] += c;
+    c = h [4] >> 26; h [4] &= 0x3ffffff; h [0] += c * 5;
+    c = h [0] >> 26; h [0] &= 0x3ffffff; h [1] += c;
+
+    g [0] = h [0] + 5; c = g [0] >> 26; g [0] &= 0x3ffffff;
+    g [1] = h [1] + c; c = g [1] >> 26; g [1] &= 0x3ffffff;
+    g [2] = h [2] + c; c = g [2] >> 26; g [2] &= 0x3ffffff;
+    g [3] = h [3] + c; c = g [3] >> 26; g [3] &= 0x3ffffff;
+    g [4] = h [4] + c - (1 << 26);
+
+    /* h - p if that is not negative, h otherwise. */
+    mask = (g [4] >> 31) - 1;
+    for (i = 0; i < 5; i++)
+        h [i] = (h [i] & ~mask) | (g [i] & mask);
+
+    /* Add the second half of the key modulo 2^128. */
+    f = (uint64_t) (h [0] | h [1] << 26) + LE32 (k + 16);
+    ST32 (out, (uint32_t) f);
+    f = (uint64_t) (h [1] >> 6 | h [2] << 20) + LE32 (k + 20) + (f >> 32);
+    ST32 (out + 4, (uint32_t) f);
+    f = (uint64_t) (h [2] >> 12 | h [3] << 14) + LE32 (k + 24) + (f >> 32);
+    ST32 (out + 8, (uint32_t) f);
+    f = (uint64_t) (h [3] >> 18 | h [4] << 8) + LE32 (k + 28) + (f >> 32);
+    ST32 (out + 12, (uint32_t) f);
+}
@@ -0,0 +1,46 @@
+#ifndef TWEETNACL_FAST_H
+#define TWEETNACL_FAST_H
+
+/* Faster implementations of the Salsa20 stream cipher and the Poly1305
+   authenticator behind crypto_box_afternm and crypto_box_open_afternm,
+   bit-exact with the reference code in tweetnacl.c. Which kernels are used
+   is decided at run time from the instruction sets the CPU supports. */
+
+#include <stdint.h>
+
+#define TWEETNACL_KERNELS_REF 0
+#define TWEETNACL_KERNELS_SCALAR 1
+#define TWEETNACL_KERNELS_SSE2 2
+#define TWEETNACL_KERNELS_AVX2 3
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Returns the kernels in use, the best ones the CPU supports unless
+   tweetnacl_select_kernels says otherwise. */
+int tweetnacl_kernels (void);
+
+/* Makes tweetnacl use the given kernels, TWEETNACL_KERNELS_REF being the
+   reference code. Returns -1 if the CPU doesn't support them. Meant for
+   tests and benchmarks, not to be called while boxes are being made. */
+int tweetnacl_select_kernels (int kernels);
+
+/* Same as crypto_stream_salsa20_xor, m may be NULL for the bare key
+   stream and may equal c. */
+void tweetnacl_salsa20_xor (uint8_t *c, const uint8_t *m, uint64_t b,
+    const uint8_t *n, const uint8_t *k);
+
+/* Same as crypto_core_hsalsa20. */
+void tweetnacl_hsalsa20 (uint8_t *out, const uint8_t *in, const uint8_t *k,
+    const uint8_t *c);
+
+/* Same as crypto_onetimeauth. */
+void tweetnacl_poly1305 (uint8_t *out, const uint8_t *m, uint64_t n,
+    const uint8_t *k);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,173 @@
+/* Salsa20 and Poly1305 kernels working on SIMD_LANES 32-bit lanes at once.
+   tweetnacl_fast.c includes this file once per instruction set, after
+   defining SIMD_NAME, SIMD_ATTR, SIMD_LANES, the vector type V, the V_*
+   operations and SIMD_OUT. There is no include guard on purpose. */
+
+/* Poly1305 works on 64-bit lanes, half as many. */
+#define SIMD_POLY_LANES (SIMD_LANES / 2)
+
+#define VROTL(x, c) V_OR (V_SHL32 (x, c), V_SHR32 (x, 32 - (c)))
+
+#define VQR(a, b, c, d) \
+    b = V_XOR (b, VROTL (V_ADD32 (a, d), 7)); \
+    c = V_XOR (c, VROTL (V_ADD32 (b, a), 9)); \
+    d = V_XOR (d, VROTL (V_ADD32 (c, b), 13)); \
+    a = V_XOR (a, VROTL (V_ADD32 (d, c), 18));
+
+/* XORs the next 'groups' * SIMD_LANES blocks of the key stream of state s
+   into m and writes the result to c. Lane i computes the block with counter
+   s[8..9] + i. Advances the counter. */
+static SIMD_ATTR void SIMD_NAME (salsa20) (uint8_t *c, const uint8_t *m,
+    uint64_t groups, uint32_t s [16])
+{
+    V x [16], y [16], t0, t1, t2, t3;
+    uint32_t lo [SIMD_LANES], hi [SIMD_LANES];
+    uint64_t ctr = s [8] | (uint64_t) s [9] << 32;
+    int i;
+
+    for (i = 0; i < 16; i++)
+        y [i] = V_SET1_32 (s [i]);
+
+    while (groups--) {
+        for (i = 0; i < SIMD_LANES; i++) {
+            lo [i] = (uint32_t) (ctr + i);
+            hi [i] = (uint32_t) ((ctr + i) >> 32);
+        }
+        y [8] = V_LOADU (lo);
+        y [9] = V_LOADU (hi);
+        for (i = 0; i < 16; i++)
+            x [i] = y [i];
+
+        for (i = 0; i < 10; i++) {
+            VQR (x [0], x [4], x [8], x [12])
+            VQR (x [5], x [9], x [13], x [1])
+            VQR (x [10], x [14], x [2], x [6])
+            VQR (x [15], x [3], x [7], x [11])
+            VQR (x [0], x [1], x [2], x [3])
+            VQR (x [5], x [6], x [7], x [4])
+            VQR (x [10], x [11], x [8], x [9])
+            VQR (x [15], x [12], x [13], x [14])
+        }
+
+        /* Transpose four words of four lanes at a time, so that each
+           vector holds consecutive words of one block. */
+        for (i = 0; i < 16; i += 4) {
+            V a = V_ADD32 (x [i], y [i]);
+            V b = V_ADD32 (x [i + 1], y [i + 1]);
+            V d = V_ADD32 (x [i + 2], y [i + 2]);
+            V e = V_ADD32 (x [i + 3], y [i + 3]);
+            t0 = V_UNPACKLO32 (a, b);
+            t1 = V_UNPACKLO32 (d, e);
+            t2 = V_UNPACKHI32 (a, b);
+            t3 = V_UNPACKHI32 (d, e);
+            SIMD_OUT (c, m, 0, i, V_UNPACKLO64 (t0, t1));
+            SIMD_OUT (c, m, 1, i, V_UNPACKHI64 (t0, t1));
+            SIMD_OUT (c, m, 2, i, V_UNPACKLO64 (t2, t3));
+            SIMD_OUT (c, m, 3, i, V_UNPACKHI64 (t2, t3));
+        }
+
+        ctr += SIMD_LANES;
+        c += 64 * SIMD_LANES;
+        if (m)
+            m += 64 * SIMD_LANES;
+    }
+
+    s [8] = (uint32_t) ctr;
+    s [9] = (uint32_t) (ctr >> 32);
+}
+
+/* a = a * r, lane by lane, in 26-bit limbs, s being 5 * r. */
+static SIMD_ATTR void SIMD_NAME (poly1305_mul) (V a [5], const V r [5],
+    const V s [5])
+{
+    const V mask = V_SET1_64 (0x3ffffff);
+    V d0, d1, d2, d3, d4, c;
+
+    d0 = V_ADD64 (V_ADD64 (V_ADD64 (V_ADD64 (V_MUL32 (a [0], r [0]),
+        V_MUL32 (a [1], s [4])), V_MUL32 (a [2], s [3])),
+        V_MUL32 (a [3], s [2])), V_MUL32 (a [4], s [1]));
+    d1 = V_ADD64 (V_ADD64 (V_ADD64 (V_ADD64 (V_MUL32 (a [0], r [1]),
+        V_MUL32 (a [1], r [0])), V_MUL32 (a [2], s [4])),
+        V_MUL32 (a [3], s [3])), V_MUL32 (a [4], s [2]));
+    d2 = V_ADD64 (V_ADD64 (V_ADD64 (V_ADD64 (V_MUL32 (a [0], r [2]),
+        V_MUL32 (a [1], r [1])), V_MUL32 (a [2], r [0])),
+        V_MUL32 (a [3], s [4])), V_MUL32 (a [4], s [3]));
+    d3 = V_ADD64 (V_ADD64 (V_ADD64 (V_ADD64 (V_MUL32 (a [0], r [3]),
+        V_MUL32 (a [1], r [2])), V_MUL32 (a [2], r [1])),
+        V_MUL32 (a [3], r [0])), V_MUL32 (a [4], s [4]));
+    d4 = V_ADD64 (V_ADD64 (V_ADD64 (V_ADD64 (V_MUL32 (a [0], r [4]),
+        V_MUL32 (a [1], r [3])), V_MUL32 (a [2], r [2])),
+        V_MUL32 (a [3], r [1])), V_MUL32 (a [4], r [0]));
+
+    d1 = V_ADD64 (d1, V_SHR64 (d0, 26));
+    a [0] = V_AND (d0, mask);
+    d2 = V_ADD64 (d2, V_SHR64 (d1, 26));
+    a [1] = V_AND (d1, mask);
+    d3 = V_ADD64 (d3, V_SHR64 (d2, 26));
+    a [2] = V_AND (d2, mask);
+    d4 = V_ADD64 (d4, V_SHR64 (d3, 26));
+    a [3] = V_AND (d3, mask);
+    c = V_SHR64 (d4, 26);
+    a [4] = V_AND (d4, mask);
+    a [0] = V_ADD64 (a [0], V_ADD64 (c, V_SHL64 (c, 2)));
+    c = V_SHR64 (a [0], 26);
+    a [0] = V_AND (a [0], mask);
+    a [1] = V_ADD64 (a [1], c);
+}
+
+/* Absorbs 'chunks' * SIMD_POLY_LANES full blocks of m into h, with the
+   same result as absorbing them one at a time. Lane j accumulates blocks
+   j, j + SIMD_POLY_LANES, ..., multiplying by r^SIMD_POLY_LANES in between,
+   and by r^(SIMD_POLY_LANES - j) at the end. rp [i] is r^(i + 1). */
+static SIMD_ATTR void SIMD_NAME (poly1305) (uint32_t h [5],
+    const uint8_t *m, uint64_t chunks, uint32_t rp [SIMD_POLY_LANES] [5])
+{
+    V a [5], rl [5], sl [5], rf [5], sf [5];
+    uint64_t t [5] [SIMD_POLY_LANES];
+    uint64_t sum;
+    int i, j;
+
+    for (i = 0; i < 5; i++) {
+        rl [i] = V_SET1_64 (rp [SIMD_POLY_LANES - 1] [i]);
+        sl [i] = V_SET1_64 (rp [SIMD_POLY_LANES - 1] [i] * 5);
+        for (j = 0; j < SIMD_POLY_LANES; j++)
+            t [i] [j] = rp [SIMD_POLY_LANES - 1 - j] [i];
+        rf [i] = V_LOADU (t [i]);
+        for (j = 0; j < SIMD_POLY_LANES; j++)
+            t [i] [j] *= 5;
+        sf [i] = V_LOADU (t [i]);
+
+        /* What has been absorbed so far goes with the first block. */
+        for (j = 0; j < SIMD_POLY_LANES; j++)
+            t [i] [j] = j == 0 ? h [i] : 0;
+        a [i] = V_LOADU (t [i]);
+    }
+
+    while (chunks--) {
+        for (j = 0; j < SIMD_POLY_LANES; j++, m += 16) {
+            t [0] [j] = LE32 (m) & 0x3ffffff;
+            t [1] [j] = (LE32 (m + 3) >> 2) & 0x3ffffff;
+            t [2] [j] = (LE32 (m + 6) >> 4) & 0x3ffffff;
+            t [3] [j] = (LE32 (m + 9) >> 6) & 0x3ffffff;
+            t [4] [j] = (LE32 (m + 12) >> 8) | (1 << 24);
+        }
+        for (i = 0; i < 5; i++)
+            a [i] = V_ADD64 (a [i], V_LOADU (t [i]));
+        if (chunks)
+            SIMD_NAME (poly1305_mul) (a, rl, sl);
+        else
+            SIMD_NAME (poly1305_mul) (a, rf, sf);
+    }
+
+    for (i = 0; i < 5; i++) {
+        V_STOREU (t [i], a [i]);
+        for (sum = 0, j = 0; j < SIMD_POLY_LANES; j++)
+            sum += t [i] [j];
+        h [i] = (uint32_t) sum;
+    }
+    poly1305_carry (h);
+}
+
+#undef SIMD_POLY_LANES
+#undef VROTL
+#undef VQR